@@ -0,0 +1,209 @@
+#include "api_interpose.h"
+
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+uint32_t findEntryPoint(char const * name)
+{
+    for (size_t i = 0; i < apiEntryPointCount; ++i)
+    {
+        if (std::strcmp(apiEntryPointNames[i], name) == 0)
+        {
+            return static_cast<uint32_t>(i);
+        }
+    }
+    return UINT32_MAX;
+}
+
+// writes the table when the process exits, with the interposer itself
+// left alive for calls made by other static destructors
+struct ExitReport
+{
+    ~ExitReport()
+    {
+        ApiInterposer const & interposer = ApiInterposer::instance();
+        if (!interposer.exitReport())
+        {
+            return;
+        }
+        char const * path = std::getenv("WGPU_INTERPOSE_REPORT");
+        if (path && *path)
+        {
+            std::ofstream file(path);
+            interposer.report(file);
+        }
+        else
+        {
+            interposer.report(std::cerr);
+        }
+    }
+};
+ExitReport exitReport;
+
+} // namespace
+
+ApiInterposer & ApiInterposer::instance()
+{
+    static ApiInterposer * interposer = new ApiInterposer();
+    return *interposer;
+}
+
+ApiInterposer::ApiInterposer()
+    : m_counters(new Counters[apiEntryPointCount]())
+    , m_frameStart(apiEntryPointCount)
+    , m_lastFrame(apiEntryPointCount)
+{
+    char const * frameEntryPoint = std::getenv("WGPU_INTERPOSE_FRAME");
+    m_frameEntryPoint = findEntryPoint(frameEntryPoint && *frameEntryPoint ? frameEntryPoint : "wgpuSurfacePresent");
+}
+
+void * ApiInterposer::resolve(uint32_t index) const
+{
+    // RTLD_NEXT skips this library, whether it was preloaded or linked
+    // ahead of the WebGPU library
+    void * function = dlsym(RTLD_NEXT, apiEntryPointNames[index]);
+    if (function == nullptr)
+    {
+        std::fprintf(stderr, "WebGPUInterpose: %s is not provided by the WebGPU library\n", apiEntryPointNames[index]);
+        std::abort();
+    }
+    return function;
+}
+
+void ApiInterposer::endFrame()
+{
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    for (size_t i = 0; i < apiEntryPointCount; ++i)
+    {
+        FrameTotals now;
+        now.calls = m_counters[i].calls.load(std::memory_order_relaxed);
+        now.totalNs = m_counters[i].totalNs.load(std::memory_order_relaxed);
+        m_lastFrame[i].calls = now.calls - m_frameStart[i].calls;
+        m_lastFrame[i].totalNs = now.totalNs - m_frameStart[i].totalNs;
+        m_frameStart[i] = now;
+    }
+    m_frameCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ApiInterposer::reset()
+{
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    for (size_t i = 0; i < apiEntryPointCount; ++i)
+    {
+        Counters & counters = m_counters[i];
+        counters.calls.store(0, std::memory_order_relaxed);
+        counters.totalNs.store(0, std::memory_order_relaxed);
+        counters.maxNs.store(0, std::memory_order_relaxed);
+        for (auto & count : counters.histogram)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        m_frameStart[i] = FrameTotals();
+        m_lastFrame[i] = FrameTotals();
+    }
+    m_frameCount.store(0, std::memory_order_relaxed);
+}
+
+uint64_t ApiInterposer::bucketUpperBound(size_t bucket)
+{
+    if (bucket < 4) return bucket;
+    size_t exponent = bucket / 4 + 1;
+    uint64_t upper = (uint64_t(4 + bucket % 4 + 1) << (exponent - 2)) - 1;
+    return upper;
+}
+
+uint64_t ApiInterposer::percentile(Counters const & counters, double fraction) const
+{
+    uint64_t calls = 0;
+    for (auto const & count : counters.histogram)
+    {
+        calls += count.load(std::memory_order_relaxed);
+    }
+    uint64_t rank = static_cast<uint64_t>(fraction * calls);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BucketCount; ++b)
+    {
+        seen += counters.histogram[b].load(std::memory_order_relaxed);
+        if (seen > rank)
+        {
+            return std::min(bucketUpperBound(b), counters.maxNs.load(std::memory_order_relaxed));
+        }
+    }
+    return counters.maxNs.load(std::memory_order_relaxed);
+}
+
+std::vector<ApiInterposer::EntryPoint> ApiInterposer::hottest(size_t count, bool lastFrame) const
+{
+    std::vector<EntryPoint> entryPoints;
+    size_t frames = frameCount();
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    for (size_t i = 0; i < apiEntryPointCount; ++i)
+    {
+        Counters const & counters = m_counters[i];
+        EntryPoint entryPoint;
+        entryPoint.name = apiEntryPointNames[i];
+        entryPoint.calls = lastFrame ? m_lastFrame[i].calls : counters.calls.load(std::memory_order_relaxed);
+        entryPoint.totalNs = lastFrame ? m_lastFrame[i].totalNs : counters.totalNs.load(std::memory_order_relaxed);
+        if (entryPoint.calls == 0)
+        {
+            continue;
+        }
+        // the distribution is only kept over the whole run
+        entryPoint.maxNs = counters.maxNs.load(std::memory_order_relaxed);
+        entryPoint.p50Ns = percentile(counters, 0.5);
+        entryPoint.p99Ns = percentile(counters, 0.99);
+        double divisor = lastFrame ? 1.0 : static_cast<double>(std::max<size_t>(frames, 1));
+        entryPoint.callsPerFrame = entryPoint.calls / divisor;
+        entryPoint.nsPerFrame = entryPoint.totalNs / divisor;
+        entryPoints.push_back(entryPoint);
+    }
+    std::sort(entryPoints.begin(), entryPoints.end(), [](EntryPoint const & a, EntryPoint const & b) {
+        return a.totalNs > b.totalNs;
+    });
+    if (entryPoints.size() > count)
+    {
+        entryPoints.resize(count);
+    }
+    return entryPoints;
+}
+
+void ApiInterposer::report(std::ostream & out, size_t count) const
+{
+    std::vector<EntryPoint> entryPoints = hottest(count);
+    uint64_t totalNs = 0;
+    for (size_t i = 0; i < apiEntryPointCount; ++i)
+    {
+        totalNs += m_counters[i].totalNs.load(std::memory_order_relaxed);
+    }
+    out << "WebGPU API calls (" << frameCount() << " frames, " << totalNs / 1e6 << " ms in the API):" << std::endl;
+    if (entryPoints.empty())
+    {
+        return;
+    }
+    out << std::left << std::setw(48) << "entry point" << std::right
+        << std::setw(10) << "calls" << std::setw(12) << "calls/frame" << std::setw(12) << "us/frame"
+        << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(10) << "max us" << std::setw(8) << "%" << std::endl;
+    out << std::fixed;
+    for (auto const & entryPoint : entryPoints)
+    {
+        out << std::left << std::setw(48) << entryPoint.name << std::right
+            << std::setw(10) << entryPoint.calls
+            << std::setw(12) << std::setprecision(1) << entryPoint.callsPerFrame
+            << std::setw(12) << std::setprecision(2) << entryPoint.nsPerFrame / 1e3
+            << std::setw(10) << entryPoint.p50Ns / 1e3
+            << std::setw(10) << entryPoint.p99Ns / 1e3
+            << std::setw(10) << entryPoint.maxNs / 1e3
+            << std::setw(8) << std::setprecision(1) << (totalNs ? 100.0 * entryPoint.totalNs / totalNs : 0.0) << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * Call counts and latency histograms of every entry point of the WebGPU C
+ * API, collected by the WebGPUInterpose library. Its entry points are
+ * generated by ApiInterposeGen from webgpu.h and wgpu.h; each one times the
+ * call and forwards it to the next definition of the symbol, which is the
+ * real WebGPU library. The layer is enabled either at load time, for any
+ * binary and without rebuilding it:
+ *     LD_PRELOAD=./libWebGPUInterpose.so ./App
+ * or at link time with the WEBGPU_INTERPOSE CMake option, which links it
+ * into the App ahead of the WebGPU library.
+ *
+ * A frame (or job) ends at each call of the entry point named by the
+ * WGPU_INTERPOSE_FRAME environment variable, wgpuSurfacePresent by default,
+ * or at each endFrame(). Unless disabled, a table of the hottest entry
+ * points is written at exit to stderr, or to the file named by
+ * WGPU_INTERPOSE_REPORT.
+ *
+ * Latencies are inclusive: an entry point called back from inside another
+ * one, e.g. from a map callback run by wgpuDevicePoll, counts in both.
+ */
+class ApiInterposer
+{
+public:
+    struct EntryPoint
+    {
+        char const * name;
+        uint64_t calls = 0;
+        uint64_t totalNs = 0;
+        uint64_t maxNs = 0;
+        uint64_t p50Ns = 0;         // from the histogram, within 25%
+        uint64_t p99Ns = 0;
+        double callsPerFrame = 0.0;
+        double nsPerFrame = 0.0;
+    };
+
+    static ApiInterposer & instance();
+
+    ApiInterposer(ApiInterposer const &) = delete;
+    ApiInterposer & operator=(ApiInterposer const &) = delete;
+
+    void endFrame();
+    size_t frameCount() const { return m_frameCount.load(std::memory_order_relaxed); }
+
+    /**
+     * The `count` entry points with the most time spent in them, since the
+     * start or, if lastFrame is set, in the last complete frame only.
+     */
+    std::vector<EntryPoint> hottest(size_t count, bool lastFrame = false) const;
+    void report(std::ostream & out, size_t count = 20) const;
+    void reset();
+
+    /**
+     * Whether the table is written at exit, on by default. An application
+     * reporting by itself should turn it off.
+     */
+    void setExitReport(bool enabled) { m_exitReport = enabled; }
+    bool exitReport() const { return m_exitReport; }
+
+    // used by the generated entry points
+    void * resolve(uint32_t index) const;
+    void record(uint32_t index, uint64_t nanoseconds)
+    {
+        Counters & counters = m_counters[index];
+        counters.calls.fetch_add(1, std::memory_order_relaxed);
+        counters.totalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+        counters.histogram[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = counters.maxNs.load(std::memory_order_relaxed);
+        while (nanoseconds > max && !counters.maxNs.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+        {
+        }
+        if (index == m_frameEntryPoint)
+        {
+            endFrame();
+        }
+    }
+
+    class CallTimer
+    {
+    public:
+        explicit CallTimer(uint32_t index)
+            : m_index(index)
+            , m_start(std::chrono::steady_clock::now())
+        {
+        }
+        ~CallTimer()
+        {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            ApiInterposer::instance().record(m_index, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+        CallTimer(CallTimer const &) = delete;
+        CallTimer & operator=(CallTimer const &) = delete;
+
+    private:
+        uint32_t m_index;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+private:
+    // 4 buckets per power of two: values below 4 exactly, then 25% wide
+    static constexpr size_t BucketCount = 252;
+
+    struct Counters
+    {
+        std::atomic<uint64_t> calls{ 0 };
+        std::atomic<uint64_t> totalNs{ 0 };
+        std::atomic<uint64_t> maxNs{ 0 };
+        std::atomic<uint64_t> histogram[BucketCount] = {};
+    };
+
+    struct FrameTotals
+    {
+        uint64_t calls = 0;
+        uint64_t totalNs = 0;
+    };
+
+    ApiInterposer();
+
+    static size_t bucket(uint64_t nanoseconds)
+    {
+        if (nanoseconds < 4) return static_cast<size_t>(nanoseconds);
+        int exponent = 63 - __builtin_clzll(nanoseconds);
+        return 4 * (exponent - 1) + ((nanoseconds >> (exponent - 2)) & 3);
+    }
+    static uint64_t bucketUpperBound(size_t bucket);
+    uint64_t percentile(Counters const & counters, double fraction) const;
+
+    std::unique_ptr<Counters[]> m_counters;
+    uint32_t m_frameEntryPoint;
+    bool m_exitReport = true;
+
+    std::atomic<size_t> m_frameCount{ 0 };
+    mutable std::mutex m_frameMutex;
+    std::vector<FrameTotals> m_frameStart;  // totals at the start of the current frame
+    std::vector<FrameTotals> m_lastFrame;
+};
+
+/**
+ * Defined in the generated entry points, in the same order as the indices
+ * they pass to ApiInterposer.
+ */
+extern size_t const apiEntryPointCount;
+extern char const * const apiEntryPointNames[];
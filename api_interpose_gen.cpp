@@ -0,0 +1,174 @@
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct Function
+{
+    std::string returnType;
+    std::string name;
+    std::string parameters;                 // as declared
+    std::vector<std::string> arguments;     // parameter names
+};
+
+std::string trim(std::string const & text)
+{
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+std::string removeWord(std::string text, std::string const & word)
+{
+    std::regex pattern("\\b" + word + "\\b");
+    return std::regex_replace(text, pattern, "");
+}
+
+bool parseParameters(std::string const & parameters, std::vector<std::string> & arguments)
+{
+    if (trim(parameters).empty() || trim(parameters) == "void")
+    {
+        return true;
+    }
+    // callbacks are typedefs in the headers, so commas only separate parameters
+    std::stringstream stream(parameters);
+    std::string parameter;
+    std::regex lastIdentifier("([A-Za-z_]\\w*)\\s*$");
+    while (std::getline(stream, parameter, ','))
+    {
+        std::smatch match;
+        std::string text = trim(parameter);
+        if (!std::regex_search(text, match, lastIdentifier) || match.position(1) == 0)
+        {
+            return false;
+        }
+        arguments.push_back(match[1]);
+    }
+    return true;
+}
+
+bool parseHeader(std::string const & path, std::vector<Function> & functions, std::set<std::string> & seen)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << path << ": could not open" << std::endl;
+        return false;
+    }
+    std::regex declaration("^(.*?[\\w\\*])\\s*\\b(wgpu[A-Z]\\w*)\\s*\\(([^()]*)\\)\\s*;$");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        line = trim(line);
+        if (line.empty() || line[0] == '#' || line.compare(0, 2, "//") == 0 || line.compare(0, 7, "typedef") == 0)
+        {
+            continue;
+        }
+        for (char const * macro : { "WGPU_EXPORT", "WGPU_FUNCTION_ATTRIBUTE" })
+        {
+            line = removeWord(line, macro);
+        }
+        line = trim(line);
+
+        std::smatch match;
+        if (!std::regex_match(line, match, declaration))
+        {
+            continue;
+        }
+        Function function;
+        function.returnType = trim(match[1]);
+        function.name = match[2];
+        function.parameters = trim(match[3]);
+        if (!parseParameters(function.parameters, function.arguments))
+        {
+            std::cerr << path << ": could not parse the parameters of " << function.name << std::endl;
+            return false;
+        }
+        if (seen.insert(function.name).second)
+        {
+            functions.push_back(function);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+/**
+ * Build step generating the entry points of the WebGPUInterpose library:
+ *     ApiInterposeGen <output.cpp> <header>...
+ * Every function declared in the headers (webgpu.h, wgpu.h) gets a
+ * definition timing the call and forwarding it to the real library.
+ */
+int main(int argc, char * argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output.cpp> <header>..." << std::endl;
+        return 1;
+    }
+
+    std::vector<Function> functions;
+    std::set<std::string> seen;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!parseHeader(argv[i], functions, seen))
+        {
+            return 1;
+        }
+    }
+    if (functions.empty())
+    {
+        std::cerr << "No entry point found" << std::endl;
+        return 1;
+    }
+
+    std::ostringstream out;
+    out << "// Generated by ApiInterposeGen, do not edit.\n"
+        << "#include \"api_interpose.h\"\n\n"
+        << "#include <webgpu/webgpu.h>\n"
+        << "#include <webgpu/wgpu.h>\n\n"
+        << "size_t const apiEntryPointCount = " << functions.size() << ";\n"
+        << "char const * const apiEntryPointNames[] = {\n";
+    for (auto const & function : functions)
+    {
+        out << "    \"" << function.name << "\",\n";
+    }
+    out << "};\n\n"
+        << "extern \"C\" {\n";
+    for (size_t i = 0; i < functions.size(); ++i)
+    {
+        Function const & function = functions[i];
+        std::string parameters = function.parameters.empty() ? "void" : function.parameters;
+        out << "\n"
+            << "WGPU_EXPORT " << function.returnType << " " << function.name << "(" << parameters << ")\n"
+            << "{\n"
+            << "    using Proc = " << function.returnType << " (*)(" << parameters << ");\n"
+            << "    static Proc const next = reinterpret_cast<Proc>(ApiInterposer::instance().resolve(" << i << "));\n"
+            << "    ApiInterposer::CallTimer timer(" << i << ");\n"
+            << "    return next(";
+        for (size_t a = 0; a < function.arguments.size(); ++a)
+        {
+            out << (a ? ", " : "") << function.arguments[a];
+        }
+        out << ");\n"
+            << "}\n";
+    }
+    out << "\n} // extern \"C\"\n";
+
+    std::ofstream output(argv[1]);
+    output << out.str();
+    if (!output)
+    {
+        std::cerr << argv[1] << ": could not write" << std::endl;
+        return 1;
+    }
+    std::cout << "Generated " << functions.size() << " interposed entry points" << std::endl;
+    return 0;
+}
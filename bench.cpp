@@ -0,0 +1,67 @@
+#include "bench_harness.h"
+#include "logger.h"
+
+#include <iostream>
+
+/**
+ * Microbenchmarks of the core WebGPU operations and of the compute helpers
+ * of this project, on the default or the fallback adapter.
+ *     bench [--fallback] [--json=<file>] [--filter=<text>] [--samples=<n>] [--list]
+ * The JSON output keeps the raw samples, to compare runs with BenchCompare.
+ */
+int main(int argc, char * argv[])
+{
+    BenchmarkHarness::Options options;
+    if (!BenchmarkHarness::parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    Logger::instance().setLevel(LogLevel::Warn);
+    Logger::instance().captureWebGPULog();
+
+    BenchmarkHarness harness(options);
+    // without a device only the compute backend suite runs, on the CPU
+    bool gpu = options.listOnly || harness.initialize();
+    if (!options.listOnly)
+    {
+        if (gpu)
+        {
+            std::cout << "Median of " << options.samples << " samples on " << harness.adapterInfo().name
+                << " (" << harness.adapterInfo().backend << "):" << std::endl;
+        }
+        else
+        {
+            std::cout << "Median of " << options.samples << " samples on the CPU backend, no GPU benchmarks:" << std::endl;
+        }
+    }
+
+    if (gpu)
+    {
+        runCoreBenchmarks(harness);
+        runShaderBenchmarks(harness);
+        runPrimitiveBenchmarks(harness);
+        runGemmBenchmarks(harness);
+        runTunerBenchmarks(harness);
+        runTensorBenchmarks(harness);
+        runChainBenchmarks(harness);
+        runSpmvBenchmarks(harness);
+        runFftBenchmarks(harness);
+        runImageBenchmarks(harness);
+        runStatisticsBenchmarks(harness);
+    }
+    runComputeBackendBenchmarks(harness);
+    if (options.listOnly)
+    {
+        return 0;
+    }
+
+    std::cout << std::endl;
+    harness.report(std::cout);
+    if (!options.jsonPath.empty() && !harness.writeJson(options.jsonPath))
+    {
+        std::cerr << "Could not write " << options.jsonPath << std::endl;
+        return 1;
+    }
+    Logger::instance().flush();
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include "bench_harness.h"
+#include "dispatch_chain.h"
+#include "gpu_primitives.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * A stream compaction followed by a stage over the kept elements, sized on
+ * the GPU through an indirect dispatch against the usual readback of the
+ * count between two submissions.
+ */
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+char const * processKernel = R"(
+@group(0) @binding(0) var<storage, read_write> values: array<u32>;
+@group(0) @binding(1) var<storage, read> count: array<u32>;
+
+@compute @workgroup_size(256)
+fn main(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(num_workgroups) groups: vec3u,
+    @builtin(local_invocation_index) local: u32)
+{
+    let i = (group.y * groups.x + group.x) * 256u + local;
+    if (i < count[0])
+    {
+        values[i] = values[i] * 2u + 1u;
+    }
+}
+)";
+
+WGPUBuffer createBuffer(WGPUDevice device, WGPUBufferUsageFlags usage, uint64_t size)
+{
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Chain data";
+    bufferDesc.usage = usage;
+    bufferDesc.size = std::max<uint64_t>(size, 16);
+    bufferDesc.mappedAtCreation = false;
+    return wgpuDeviceCreateBuffer(device, &bufferDesc);
+}
+
+WGPUCommandEncoder createEncoder(WGPUDevice device)
+{
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = "Chain";
+    return wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+}
+
+void submit(WGPUQueue queue, WGPUCommandEncoder encoder)
+{
+    WGPUCommandBufferDescriptor cmdBufferDesc = {};
+    cmdBufferDesc.nextInChain = nullptr;
+    cmdBufferDesc.label = nullptr;
+    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
+    wgpuQueueSubmit(queue, 1, &command);
+    wgpuCommandBufferRelease(command);
+}
+
+uint32_t readCount(WGPUDevice device, WGPUBuffer readback)
+{
+    uint32_t count = 0;
+    if (mapBufferSync(device, readback, WGPUMapMode_Read, 0, 4))
+    {
+        std::memcpy(&count, wgpuBufferGetConstMappedRange(readback, 0, 4), 4);
+        wgpuBufferUnmap(readback);
+    }
+    return count;
+}
+
+} // namespace
+
+void runChainBenchmarks(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+    std::mt19937 random(42);
+    GpuPrimitives primitives(device);
+    DispatchChain chain(device);
+    WGPUShaderModule module = nullptr;
+    WGPUComputePipeline pipeline = nullptr;
+
+    for (uint32_t count : { 1u << 16, 1u << 20, 1u << 24 })
+    {
+        std::string const indirectName = "chain/compact_process/indirect/" + std::to_string(count);
+        std::string const readbackName = "chain/compact_process/readback/" + std::to_string(count);
+        bool runIndirect = harness.selected(indirectName);
+        bool runReadback = harness.selected(readbackName);
+        if (!runIndirect && !runReadback)
+        {
+            continue;
+        }
+        if (pipeline == nullptr)
+        {
+            module = createShaderModule(device, processKernel, "Process kernel");
+            WGPUComputePipelineDescriptor pipelineDesc = {};
+            pipelineDesc.nextInChain = nullptr;
+            pipelineDesc.label = "Process kernel";
+            pipelineDesc.layout = nullptr;
+            pipelineDesc.compute.module = module;
+            pipelineDesc.compute.entryPoint = "main";
+            pipeline = wgpuDeviceCreateComputePipeline(device, &pipelineDesc);
+        }
+
+        std::vector<uint32_t> values(count);
+        std::vector<uint32_t> flags(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            values[i] = random() % 1000;
+            flags[i] = random() % 4 == 0 ? 1 : 0;
+        }
+        std::vector<uint32_t> expected = cpuCompact(values, flags);
+        for (uint32_t & value : expected)
+        {
+            value = value * 2 + 1;
+        }
+
+        uint64_t bytes = uint64_t(count) * 4;
+        WGPUBufferUsageFlags storage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+        WGPUBuffer input = createBuffer(device, storage, bytes);
+        WGPUBuffer flagBuffer = createBuffer(device, storage, bytes);
+        WGPUBuffer output = createBuffer(device, storage, bytes);
+        WGPUBuffer outputCount = createBuffer(device, storage, 4);
+        WGPUBuffer countReadback = createBuffer(device, WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, 4);
+        WGPUBuffer outputReadback = createBuffer(device, WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, bytes);
+        wgpuQueueWriteBuffer(queue, input, 0, values.data(), bytes);
+        wgpuQueueWriteBuffer(queue, flagBuffer, 0, flags.data(), bytes);
+
+        WGPUBindGroupEntry entries[2] = {};
+        entries[0].binding = 0;
+        entries[0].buffer = output;
+        entries[0].size = WGPU_WHOLE_SIZE;
+        entries[1].binding = 1;
+        entries[1].buffer = outputCount;
+        entries[1].size = WGPU_WHOLE_SIZE;
+        WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(pipeline, 0);
+        WGPUBindGroupDescriptor bindGroupDesc = {};
+        bindGroupDesc.nextInChain = nullptr;
+        bindGroupDesc.label = "Process";
+        bindGroupDesc.layout = layout;
+        bindGroupDesc.entryCount = 2;
+        bindGroupDesc.entries = entries;
+        WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+        wgpuBindGroupLayoutRelease(layout);
+
+        // one submission, the count never leaves the GPU
+        auto indirect = [&]() {
+            auto start = Clock::now();
+            WGPUCommandEncoder encoder = createEncoder(device);
+            primitives.compact(encoder, input, flagBuffer, count, output, outputCount);
+            chain.dispatchForCount(pipeline, { bindGroup }, outputCount, 0, 256).record(encoder);
+            submit(queue, encoder);
+            waitForSubmittedWork(device, queue);
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        };
+        // the count is read back to size the second submission
+        auto readback = [&]() {
+            auto start = Clock::now();
+            WGPUCommandEncoder encoder = createEncoder(device);
+            primitives.compact(encoder, input, flagBuffer, count, output, outputCount);
+            wgpuCommandEncoderCopyBufferToBuffer(encoder, outputCount, 0, countReadback, 0, 4);
+            submit(queue, encoder);
+            uint32_t kept = readCount(device, countReadback);
+            uint32_t groups = (kept + 255) / 256;
+            uint32_t x = std::min(groups, 65535u);
+            encoder = createEncoder(device);
+            chain.dispatch(pipeline, { bindGroup }, x, x ? (groups + x - 1) / x : 1).record(encoder);
+            submit(queue, encoder);
+            waitForSubmittedWork(device, queue);
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        };
+        auto check = [&]() {
+            WGPUCommandEncoder encoder = createEncoder(device);
+            wgpuCommandEncoderCopyBufferToBuffer(encoder, outputCount, 0, countReadback, 0, 4);
+            wgpuCommandEncoderCopyBufferToBuffer(encoder, output, 0, outputReadback, 0, bytes);
+            submit(queue, encoder);
+            if (readCount(device, countReadback) != expected.size()
+                || !mapBufferSync(device, outputReadback, WGPUMapMode_Read, 0, bytes))
+            {
+                return false;
+            }
+            auto const * result = static_cast<uint32_t const *>(wgpuBufferGetConstMappedRange(outputReadback, 0, bytes));
+            bool ok = std::equal(expected.begin(), expected.end(), result);
+            wgpuBufferUnmap(outputReadback);
+            return ok;
+        };
+
+        for (bool gpuSized : { true, false })
+        {
+            std::string const & name = gpuSized ? indirectName : readbackName;
+            if (!(gpuSized ? runIndirect : runReadback))
+            {
+                continue;
+            }
+            gpuSized ? indirect() : readback();
+            if (!check())
+            {
+                std::cerr << name << ": GPU result differs from the CPU reference, skipped" << std::endl;
+                continue;
+            }
+            harness.measureSamples(name, 1, [&]() { return gpuSized ? indirect() : readback(); }, bytes);
+        }
+
+        wgpuBindGroupRelease(bindGroup);
+        for (WGPUBuffer buffer : { input, flagBuffer, output, outputCount, countReadback, outputReadback })
+        {
+            wgpuBufferRelease(buffer);
+        }
+    }
+
+    chain.release();
+    primitives.release();
+    if (pipeline) wgpuComputePipelineRelease(pipeline);
+    if (module) wgpuShaderModuleRelease(module);
+}
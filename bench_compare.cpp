@@ -0,0 +1,505 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Regression gate over the JSON output of `bench`: compares the raw samples
+ * of a run against a stored baseline, per benchmark and adapter, with a
+ * one-sided Mann-Whitney U test. A benchmark regresses when it is both
+ * significantly slower and slower by at least the minimum effect size on
+ * its median, so that noise on tiny differences does not fail the gate.
+ *     BenchCompare [--alpha=0.01] [--min-effect=0.05] [--update] <baseline.json> <run.json>
+ * The baseline holds one run per adapter: either a single `bench` output or
+ * an array of them. --update stores the run as the baseline of its adapter.
+ * Exits with 1 on regressions, 2 on invalid input.
+ */
+
+namespace
+{
+
+// just enough JSON for the bench output
+struct JsonValue
+{
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    JsonValue const * find(std::string const & key) const
+    {
+        for (auto const & member : object)
+        {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+
+    std::string stringOr(std::string const & key, std::string const & fallback) const
+    {
+        JsonValue const * value = find(key);
+        return value && value->type == Type::String ? value->string : fallback;
+    }
+};
+
+class JsonParser
+{
+public:
+    explicit JsonParser(std::string const & text) : m_text(text) {}
+
+    bool parse(JsonValue & value, std::string & error)
+    {
+        if (!parseValue(value, 0) || (skipSpace(), m_pos != m_text.size()))
+        {
+            error = "invalid JSON at offset " + std::to_string(m_pos);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void skipSpace()
+    {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos]))) ++m_pos;
+    }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (m_pos < m_text.size() && m_text[m_pos] == c)
+        {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(char const * word)
+    {
+        size_t length = std::char_traits<char>::length(word);
+        if (m_text.compare(m_pos, length, word) != 0) return false;
+        m_pos += length;
+        return true;
+    }
+
+    bool parseString(std::string & out)
+    {
+        if (!consume('"')) return false;
+        while (m_pos < m_text.size())
+        {
+            char c = m_text[m_pos++];
+            if (c == '"') return true;
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) return false;
+            char escaped = m_text[m_pos++];
+            switch (escaped)
+            {
+            case 'n': out += '\n'; break;
+            case 't': out += '\t'; break;
+            case 'r': out += '\r'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'u':
+            {
+                // names are ASCII, other code points are kept as '?'
+                if (m_pos + 4 > m_text.size()) return false;
+                unsigned long code = std::strtoul(m_text.substr(m_pos, 4).c_str(), nullptr, 16);
+                out += code < 0x80 ? static_cast<char>(code) : '?';
+                m_pos += 4;
+                break;
+            }
+            default: out += escaped;
+            }
+        }
+        return false;
+    }
+
+    bool parseValue(JsonValue & value, int depth)
+    {
+        if (depth > 32) return false;
+        skipSpace();
+        if (m_pos >= m_text.size()) return false;
+        char c = m_text[m_pos];
+        if (c == '{')
+        {
+            ++m_pos;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) return true;
+            do
+            {
+                std::pair<std::string, JsonValue> member;
+                if (!parseString(member.first) || !consume(':') || !parseValue(member.second, depth + 1)) return false;
+                value.object.push_back(std::move(member));
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[')
+        {
+            ++m_pos;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) return true;
+            do
+            {
+                value.array.emplace_back();
+                if (!parseValue(value.array.back(), depth + 1)) return false;
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"')
+        {
+            value.type = JsonValue::Type::String;
+            return parseString(value.string);
+        }
+        if (literal("true"))
+        {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return true;
+        }
+        if (literal("false"))
+        {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = false;
+            return true;
+        }
+        if (literal("null"))
+        {
+            value.type = JsonValue::Type::Null;
+            return true;
+        }
+        char * end = nullptr;
+        value.number = std::strtod(m_text.c_str() + m_pos, &end);
+        if (end == m_text.c_str() + m_pos) return false;
+        value.type = JsonValue::Type::Number;
+        m_pos = end - m_text.c_str();
+        return true;
+    }
+
+    std::string const & m_text;
+    size_t m_pos = 0;
+};
+
+bool readJson(std::string const & path, JsonValue & value, std::string & error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!JsonParser(text).parse(value, error))
+    {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+void writeJson(std::ostream & out, JsonValue const & value, int indent)
+{
+    std::string pad(2 * indent, ' ');
+    switch (value.type)
+    {
+    case JsonValue::Type::Null: out << "null"; break;
+    case JsonValue::Type::Bool: out << (value.boolean ? "true" : "false"); break;
+    case JsonValue::Type::Number: out << std::setprecision(17) << value.number; break;
+    case JsonValue::Type::String:
+        out << '"';
+        for (char c : value.string)
+        {
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (c == '\n') out << "\\n";
+            else if (c == '\t') out << "\\t";
+            else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+            else out << c;
+        }
+        out << '"';
+        break;
+    case JsonValue::Type::Array:
+    {
+        // arrays of numbers (the samples) stay on one line
+        bool flat = std::all_of(value.array.begin(), value.array.end(), [](JsonValue const & item) {
+            return item.type != JsonValue::Type::Array && item.type != JsonValue::Type::Object;
+        });
+        out << '[';
+        for (size_t i = 0; i < value.array.size(); ++i)
+        {
+            out << (i ? "," : "") << (flat ? (i ? " " : "") : "\n" + pad + "  ");
+            writeJson(out, value.array[i], indent + 1);
+        }
+        out << (flat || value.array.empty() ? "" : "\n" + pad) << ']';
+        break;
+    }
+    case JsonValue::Type::Object:
+        out << '{';
+        for (size_t i = 0; i < value.object.size(); ++i)
+        {
+            out << (i ? "," : "") << "\n" << pad << "  \"" << value.object[i].first << "\": ";
+            writeJson(out, value.object[i].second, indent + 1);
+        }
+        out << (value.object.empty() ? "" : "\n" + pad) << '}';
+        break;
+    }
+}
+
+// runs are identified by their adapter, a fallback adapter being a distinct one
+std::string adapterKey(JsonValue const & run)
+{
+    JsonValue const * adapter = run.find("adapter");
+    if (adapter == nullptr) return "unknown adapter";
+    JsonValue const * fallback = adapter->find("fallback");
+    return adapter->stringOr("name", "unknown") + " (" + adapter->stringOr("backend", "unknown")
+        + (fallback && fallback->boolean ? ", fallback" : "") + ")";
+}
+
+std::map<std::string, std::vector<double>> benchmarkSamples(JsonValue const & run)
+{
+    std::map<std::string, std::vector<double>> samples;
+    JsonValue const * benchmarks = run.find("benchmarks");
+    if (benchmarks == nullptr) return samples;
+    for (auto const & benchmark : benchmarks->array)
+    {
+        JsonValue const * values = benchmark.find("samples");
+        if (values == nullptr) continue;
+        std::vector<double> & out = samples[benchmark.stringOr("name", "")];
+        for (auto const & value : values->array)
+        {
+            if (value.type == JsonValue::Type::Number) out.push_back(value.number);
+        }
+    }
+    return samples;
+}
+
+double median(std::vector<double> values)
+{
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+/**
+ * One-sided Mann-Whitney U test of "current is greater than baseline",
+ * with the normal approximation corrected for ties and for continuity.
+ * Returns the p-value.
+ */
+double mannWhitneyGreater(std::vector<double> const & baseline, std::vector<double> const & current)
+{
+    size_t n1 = current.size();
+    size_t n2 = baseline.size();
+    if (n1 == 0 || n2 == 0) return 1.0;
+
+    // pooled ranks, ties get the mean of their ranks
+    std::vector<std::pair<double, bool>> pooled;
+    for (double value : current) pooled.emplace_back(value, true);
+    for (double value : baseline) pooled.emplace_back(value, false);
+    std::sort(pooled.begin(), pooled.end(), [](auto const & a, auto const & b) { return a.first < b.first; });
+    double currentRankSum = 0.0;
+    double tieTerm = 0.0;
+    for (size_t i = 0; i < pooled.size();)
+    {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) ++j;
+        double rank = 0.5 * (i + 1 + j);
+        for (size_t k = i; k < j; ++k)
+        {
+            if (pooled[k].second) currentRankSum += rank;
+        }
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+
+    double n = static_cast<double>(n1 + n2);
+    double u = currentRankSum - 0.5 * n1 * (n1 + 1);
+    double mean = 0.5 * n1 * n2;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tieTerm / (n * (n - 1)));
+    if (variance <= 0.0)
+    {
+        // all samples equal
+        return 1.0;
+    }
+    double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+struct Options
+{
+    double alpha = 0.01;
+    double minEffect = 0.05;
+    bool update = false;
+    std::string baselinePath;
+    std::string runPath;
+};
+
+bool parseOptions(int argc, char * argv[], Options & options)
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--alpha=", 0) == 0)
+        {
+            options.alpha = std::atof(arg.c_str() + 8);
+        }
+        else if (arg.rfind("--min-effect=", 0) == 0)
+        {
+            options.minEffect = std::atof(arg.c_str() + 13);
+        }
+        else if (arg == "--update")
+        {
+            options.update = true;
+        }
+        else if (arg.rfind("--", 0) == 0)
+        {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return false;
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2)
+    {
+        std::cerr << "Usage: BenchCompare [--alpha=0.01] [--min-effect=0.05] [--update] <baseline.json> <run.json>" << std::endl;
+        return false;
+    }
+    options.baselinePath = paths[0];
+    options.runPath = paths[1];
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+
+    std::string error;
+    JsonValue run;
+    if (!readJson(options.runPath, run, error))
+    {
+        std::cerr << error << std::endl;
+        return 2;
+    }
+    std::string adapter = adapterKey(run);
+
+    // a missing baseline is only an error when not creating it
+    JsonValue baselines;
+    baselines.type = JsonValue::Type::Array;
+    {
+        JsonValue stored;
+        if (readJson(options.baselinePath, stored, error))
+        {
+            if (stored.type == JsonValue::Type::Array) baselines = std::move(stored);
+            else baselines.array.push_back(std::move(stored));
+        }
+        else if (!options.update)
+        {
+            std::cerr << error << std::endl;
+            return 2;
+        }
+    }
+    auto baseline = std::find_if(baselines.array.begin(), baselines.array.end(), [&](JsonValue const & stored) {
+        return adapterKey(stored) == adapter;
+    });
+
+    if (options.update)
+    {
+        if (baseline != baselines.array.end()) *baseline = run;
+        else baselines.array.push_back(run);
+        std::ofstream out(options.baselinePath);
+        writeJson(out, baselines, 0);
+        out << std::endl;
+        if (!out)
+        {
+            std::cerr << "Could not write " << options.baselinePath << std::endl;
+            return 2;
+        }
+        std::cout << "Stored the baseline of " << adapter << " in " << options.baselinePath << std::endl;
+        return 0;
+    }
+    if (baseline == baselines.array.end())
+    {
+        std::cout << "No baseline for " << adapter << ", nothing to compare" << std::endl;
+        return 0;
+    }
+
+    auto baselineSamples = benchmarkSamples(*baseline);
+    auto runSamples = benchmarkSamples(run);
+    int regressions = 0;
+    int improvements = 0;
+    std::cout << adapter << ", alpha " << options.alpha << ", minimum effect "
+        << 100.0 * options.minEffect << "%:" << std::endl;
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(14) << "baseline (ns)"
+        << std::setw(14) << "run (ns)" << std::setw(10) << "change" << std::setw(10) << "p" << "  verdict" << std::endl;
+    for (auto const & entry : runSamples)
+    {
+        auto const & name = entry.first;
+        auto found = baselineSamples.find(name);
+        if (found == baselineSamples.end())
+        {
+            std::cout << std::left << std::setw(40) << name << std::right << "  new benchmark" << std::endl;
+            continue;
+        }
+        double before = median(found->second);
+        double after = median(entry.second);
+        double change = before > 0.0 ? after / before - 1.0 : 0.0;
+        double pSlower = mannWhitneyGreater(found->second, entry.second);
+        double pFaster = mannWhitneyGreater(entry.second, found->second);
+
+        char const * verdict = "";
+        if (pSlower < options.alpha && change >= options.minEffect)
+        {
+            verdict = "REGRESSION";
+            ++regressions;
+        }
+        else if (pFaster < options.alpha && -change >= options.minEffect)
+        {
+            verdict = "improvement";
+            ++improvements;
+        }
+        std::cout << std::left << std::setw(40) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(14) << before << std::setw(14) << after
+            << std::showpos << std::setw(9) << 100.0 * change << "%" << std::noshowpos
+            << std::setprecision(4) << std::setw(10) << std::min(pSlower, pFaster)
+            << "  " << verdict << std::defaultfloat << std::endl;
+        if (std::min(found->second.size(), entry.second.size()) < 8)
+        {
+            std::cout << "    (under 8 samples, the normal approximation is rough)" << std::endl;
+        }
+    }
+    for (auto const & entry : baselineSamples)
+    {
+        if (runSamples.count(entry.first) == 0)
+        {
+            std::cout << std::left << std::setw(40) << entry.first << std::right << "  missing from the run" << std::endl;
+        }
+    }
+
+    std::cout << regressions << " regression(s), " << improvements << " improvement(s)" << std::endl;
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,303 @@
+#include "bench_harness.h"
+#include "gpu_timer.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * Cost of the core WebGPU operations: command encoding, submission, buffer
+ * uploads and readbacks, object creation and compute dispatches.
+ */
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedNs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+char const * emptyKernel = R"(
+@group(0) @binding(0) var<storage, read_write> values: array<u32>;
+
+@compute @workgroup_size(64)
+fn main(@builtin(global_invocation_id) id: vec3<u32>) {
+    if (id.x < arrayLength(&values)) {
+        values[id.x] = values[id.x] + 1u;
+    }
+}
+)";
+
+WGPUComputePipeline createPipeline(WGPUDevice device, WGPUShaderModule module)
+{
+    WGPUComputePipelineDescriptor pipelineDesc = {};
+    pipelineDesc.nextInChain = nullptr;
+    pipelineDesc.label = "Benchmark kernel";
+    pipelineDesc.layout = nullptr;
+    pipelineDesc.compute.module = module;
+    pipelineDesc.compute.entryPoint = "main";
+    return wgpuDeviceCreateComputePipeline(device, &pipelineDesc);
+}
+
+WGPUCommandBuffer finishEmptyEncoder(WGPUDevice device)
+{
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = nullptr;
+    WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+    WGPUCommandBufferDescriptor cmdBufferDesc = {};
+    cmdBufferDesc.nextInChain = nullptr;
+    cmdBufferDesc.label = nullptr;
+    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
+    return command;
+}
+
+void benchmarkEncoding(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+
+    if (harness.selected("encoder/create_finish"))
+    {
+        harness.measure("encoder/create_finish", 100, [&]() {
+            wgpuCommandBufferRelease(finishEmptyEncoder(device));
+        });
+    }
+
+    // only the submission itself, command buffers are recorded beforehand
+    if (harness.selected("submit/empty"))
+    {
+        constexpr uint32_t submits = 100;
+        harness.measureSamples("submit/empty", submits, [&]() {
+            std::vector<WGPUCommandBuffer> commands(submits);
+            for (auto & command : commands)
+            {
+                command = finishEmptyEncoder(device);
+            }
+            auto start = Clock::now();
+            for (auto command : commands)
+            {
+                wgpuQueueSubmit(queue, 1, &command);
+            }
+            double ns = elapsedNs(start);
+            for (auto command : commands)
+            {
+                wgpuCommandBufferRelease(command);
+            }
+            waitForSubmittedWork(device, queue);
+            return ns;
+        });
+    }
+}
+
+void benchmarkTransfers(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+
+    // throughput up to the completion of the copies, not only their staging
+    for (uint64_t size : { 256ull, 4096ull, 65536ull, 1ull << 20, 16ull << 20 })
+    {
+        std::string name = "write_buffer/" + std::to_string(size);
+        if (!harness.selected(name))
+        {
+            continue;
+        }
+        WGPUBuffer buffer = harness.createBuffer("Upload target", WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage, size);
+        std::vector<uint8_t> data(size, 0x5a);
+        uint32_t writes = size <= 65536 ? 64 : 4;
+        harness.measureSamples(name, writes, [&]() {
+            auto start = Clock::now();
+            for (uint32_t i = 0; i < writes; ++i)
+            {
+                wgpuQueueWriteBuffer(queue, buffer, 0, data.data(), size);
+            }
+            waitForSubmittedWork(device, queue);
+            return elapsedNs(start);
+        }, size);
+        wgpuBufferRelease(buffer);
+    }
+
+    // latency of a readback of a small result, the usual end of a compute job
+    if (harness.selected("map_async/roundtrip"))
+    {
+        constexpr uint64_t size = 256;
+        WGPUBuffer buffer = harness.createBuffer("Readback", WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, size);
+        harness.measure("map_async/roundtrip", 20, [&]() {
+            if (mapBufferSync(device, buffer, WGPUMapMode_Read, 0, size))
+            {
+                wgpuBufferUnmap(buffer);
+            }
+        });
+        wgpuBufferRelease(buffer);
+    }
+}
+
+void benchmarkCreation(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+
+    // every module differs by a comment so that no driver cache hides the cost
+    uint32_t variant = 0;
+    auto uniqueSource = [&]() {
+        return "// variant " + std::to_string(variant++) + "\n" + emptyKernel;
+    };
+
+    if (harness.selected("shader_module/create"))
+    {
+        harness.measure("shader_module/create", 10, [&]() {
+            std::string source = uniqueSource();
+            WGPUShaderModule module = createShaderModule(device, source.c_str(), "Benchmark kernel");
+            if (module) wgpuShaderModuleRelease(module);
+        });
+    }
+
+    if (harness.selected("compute_pipeline/create"))
+    {
+        harness.measureSamples("compute_pipeline/create", 10, [&]() {
+            std::vector<WGPUShaderModule> modules;
+            for (int i = 0; i < 10; ++i)
+            {
+                std::string source = uniqueSource();
+                modules.push_back(createShaderModule(device, source.c_str(), "Benchmark kernel"));
+            }
+            auto start = Clock::now();
+            for (auto module : modules)
+            {
+                WGPUComputePipeline pipeline = createPipeline(device, module);
+                if (pipeline) wgpuComputePipelineRelease(pipeline);
+            }
+            double ns = elapsedNs(start);
+            for (auto module : modules)
+            {
+                if (module) wgpuShaderModuleRelease(module);
+            }
+            return ns;
+        });
+    }
+
+    if (harness.selected("bind_group/create"))
+    {
+        WGPUShaderModule module = createShaderModule(device, emptyKernel, "Benchmark kernel");
+        WGPUComputePipeline pipeline = createPipeline(device, module);
+        WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(pipeline, 0);
+        WGPUBuffer buffer = harness.createBuffer("Values", WGPUBufferUsage_Storage, 4096);
+
+        WGPUBindGroupEntry entry = {};
+        entry.nextInChain = nullptr;
+        entry.binding = 0;
+        entry.buffer = buffer;
+        entry.offset = 0;
+        entry.size = 4096;
+        WGPUBindGroupDescriptor bindGroupDesc = {};
+        bindGroupDesc.nextInChain = nullptr;
+        bindGroupDesc.layout = layout;
+        bindGroupDesc.entryCount = 1;
+        bindGroupDesc.entries = &entry;
+        harness.measure("bind_group/create", 100, [&]() {
+            wgpuBindGroupRelease(wgpuDeviceCreateBindGroup(device, &bindGroupDesc));
+        });
+
+        wgpuBufferRelease(buffer);
+        wgpuBindGroupLayoutRelease(layout);
+        wgpuComputePipelineRelease(pipeline);
+        wgpuShaderModuleRelease(module);
+    }
+}
+
+void benchmarkDispatch(BenchmarkHarness & harness)
+{
+    bool encode = harness.selected("dispatch/encode");
+    bool gpu = harness.selected("dispatch/gpu");
+    if (!encode && !gpu)
+    {
+        return;
+    }
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+
+    WGPUShaderModule module = createShaderModule(device, emptyKernel, "Benchmark kernel");
+    WGPUComputePipeline pipeline = createPipeline(device, module);
+    WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(pipeline, 0);
+    WGPUBuffer buffer = harness.createBuffer("Values", WGPUBufferUsage_Storage, 256);
+    WGPUBindGroupEntry entry = {};
+    entry.nextInChain = nullptr;
+    entry.binding = 0;
+    entry.buffer = buffer;
+    entry.offset = 0;
+    entry.size = 256;
+    WGPUBindGroupDescriptor bindGroupDesc = {};
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.layout = layout;
+    bindGroupDesc.entryCount = 1;
+    bindGroupDesc.entries = &entry;
+    WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+
+    // a single workgroup per dispatch, so that the overhead dominates
+    constexpr uint32_t dispatches = 1000;
+    auto record = [&](WGPUComputePassEncoder pass) {
+        wgpuComputePassEncoderSetPipeline(pass, pipeline);
+        wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+        for (uint32_t i = 0; i < dispatches; ++i)
+        {
+            wgpuComputePassEncoderDispatchWorkgroups(pass, 1, 1, 1);
+        }
+    };
+
+    if (encode)
+    {
+        harness.measureSamples("dispatch/encode", dispatches, [&]() {
+            auto start = Clock::now();
+            WGPUCommandEncoderDescriptor encoderDesc = {};
+            encoderDesc.nextInChain = nullptr;
+            encoderDesc.label = nullptr;
+            WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+            WGPUComputePassDescriptor passDesc = {};
+            passDesc.nextInChain = nullptr;
+            passDesc.timestampWrites = nullptr;
+            WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+            record(pass);
+            wgpuComputePassEncoderEnd(pass);
+            wgpuComputePassEncoderRelease(pass);
+            WGPUCommandBufferDescriptor cmdBufferDesc = {};
+            cmdBufferDesc.nextInChain = nullptr;
+            cmdBufferDesc.label = nullptr;
+            WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+            double ns = elapsedNs(start);
+            wgpuCommandEncoderRelease(encoder);
+            wgpuCommandBufferRelease(command);
+            return ns;
+        });
+    }
+
+    if (gpu)
+    {
+        GpuTimer timer(device, queue);
+        harness.measureSamples(timer.hasTimestamps() ? "dispatch/gpu" : "dispatch/gpu_wall", dispatches, [&]() {
+            return 1e6 * timer.timeComputePass(record, 1);
+        });
+    }
+
+    wgpuBindGroupRelease(bindGroup);
+    wgpuBufferRelease(buffer);
+    wgpuBindGroupLayoutRelease(layout);
+    wgpuComputePipelineRelease(pipeline);
+    wgpuShaderModuleRelease(module);
+}
+
+} // namespace
+
+void runCoreBenchmarks(BenchmarkHarness & harness)
+{
+    benchmarkEncoding(harness);
+    benchmarkTransfers(harness);
+    benchmarkCreation(harness);
+    benchmarkDispatch(harness);
+}
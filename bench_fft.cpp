@@ -0,0 +1,152 @@
+#include "bench_harness.h"
+#include "fft.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <complex>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Batched FFTs of 2^20 complex values in total: many short signals or a
+ * few long ones in 1D, square images in 2D, out of place and in place.
+ * Results are checked against a double-precision reference first.
+ */
+
+namespace
+{
+
+using Complex = std::complex<float>;
+
+struct Shape
+{
+    uint32_t width;
+    uint32_t height;    // 1 for 1D
+    uint32_t batch;
+    bool inPlace;
+};
+
+std::string shapeName(Shape const & shape)
+{
+    std::string name = shape.height == 1 ? "fft/1d" : "fft/2d";
+    name += shape.inPlace ? "_inplace/" : "/";
+    name += std::to_string(shape.width);
+    if (shape.height > 1) name += "x" + std::to_string(shape.height);
+    return name + "/batch_" + std::to_string(shape.batch);
+}
+
+std::vector<Complex> reference(std::vector<Complex> data, Shape const & shape)
+{
+    cpuFft(data, shape.width, shape.height * shape.batch, false);
+    if (shape.height == 1)
+    {
+        return data;
+    }
+    std::vector<Complex> column(shape.height);
+    for (uint32_t image = 0; image < shape.batch; ++image)
+    {
+        Complex * values = data.data() + size_t(image) * shape.width * shape.height;
+        for (uint32_t x = 0; x < shape.width; ++x)
+        {
+            for (uint32_t y = 0; y < shape.height; ++y) column[y] = values[size_t(y) * shape.width + x];
+            cpuFft(column, shape.height, 1, false);
+            for (uint32_t y = 0; y < shape.height; ++y) values[size_t(y) * shape.width + x] = column[y];
+        }
+    }
+    return data;
+}
+
+// error relative to the largest value, f32 rounding grows with log n
+bool matches(std::vector<Complex> const & result, std::vector<Complex> const & expected)
+{
+    float largest = 1.0f;
+    float error = 0.0f;
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        largest = std::max(largest, std::abs(expected[i]));
+        error = std::max(error, std::abs(result[i] - expected[i]));
+    }
+    return error <= 1e-4f * largest;
+}
+
+} // namespace
+
+void runFftBenchmarks(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    std::mt19937 random(42);
+    Shape const shapes[] = {
+        { 64, 1, 1u << 14, false },
+        { 1024, 1, 1u << 10, false },
+        { 1024, 1, 1u << 10, true },
+        { 16384, 1, 1u << 6, false },
+        { 1024, 1024, 1, false },
+        { 1024, 1024, 1, true },
+        { 128, 128, 64, false },
+    };
+
+    // created once something runs, there is no device in list mode
+    std::unique_ptr<Fft> fft;
+    for (Shape const & shape : shapes)
+    {
+        std::string const name = shapeName(shape);
+        if (!harness.selected(name))
+        {
+            continue;
+        }
+        if (!fft)
+        {
+            fft = std::make_unique<Fft>(device);
+        }
+
+        size_t count = size_t(shape.width) * shape.height * shape.batch;
+        uint64_t bytes = count * sizeof(Complex);
+        std::vector<Complex> signal(count);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        for (Complex & value : signal)
+        {
+            value = Complex(unit(random), unit(random));
+        }
+        std::vector<Complex> expected = reference(signal, shape);
+
+        WGPUBufferUsageFlags const storage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+        WGPUBuffer source = harness.createBuffer("FFT data", storage, bytes, signal.data());
+        WGPUBuffer output = harness.createBuffer("FFT data", storage, bytes);
+
+        // in place, the signal is restored by a GPU copy before every transform
+        auto body = [&](WGPUCommandEncoder encoder) {
+            WGPUBuffer input = source;
+            if (shape.inPlace)
+            {
+                wgpuCommandEncoderCopyBufferToBuffer(encoder, source, 0, output, 0, bytes);
+                input = output;
+            }
+            if (shape.height == 1)
+            {
+                fft->transform(encoder, input, output, shape.width, shape.batch);
+            }
+            else
+            {
+                fft->transform2d(encoder, input, output, shape.width, shape.height, shape.batch);
+            }
+        };
+        harness.runOnce("FFT", body);
+        if (matches(harness.read<Complex>(output, count), expected))
+        {
+            harness.measureSamples(name, 1, [&]() { return harness.runOnce("FFT", body); }, bytes);
+        }
+        else
+        {
+            std::cerr << name << ": GPU result differs from the reference, skipped" << std::endl;
+        }
+
+        for (WGPUBuffer buffer : { source, output })
+        {
+            wgpuBufferRelease(buffer);
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#include "bench_harness.h"
+#include "gemm.h"
+#include "tuning_cache.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Square matrix products with every tile shape the device accepts, then
+ * with the shape picked by the autotuner, which is stored in tuning.cache
+ * in the working directory. Results are checked on sampled rows first.
+ */
+
+namespace
+{
+
+/**
+ * Compare a few rows of C with the CPU product. The tolerance is relative to
+ * the sum of the absolute products, f16 accumulation being far coarser.
+ */
+bool checkRows(
+    std::vector<float> const & a,
+    std::vector<float> const & b,
+    std::vector<float> const & c,
+    uint32_t size,
+    float tolerance)
+{
+    for (uint32_t row : { 0u, size / 3, size / 2, size - 1 })
+    {
+        for (uint32_t col = 0; col < size; ++col)
+        {
+            double expected = 0.0;
+            double magnitude = 0.0;
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                double product = double(a[size_t(row) * size + i]) * b[size_t(i) * size + col];
+                expected += product;
+                magnitude += std::abs(product);
+            }
+            if (std::abs(c[size_t(row) * size + col] - expected) > tolerance * std::max(magnitude, 1.0))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void runGemmBenchmarks(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+    bool listOnly = harness.options().listOnly;
+    std::unique_ptr<TuningCache> cache;
+    std::unique_ptr<Gemm> gemm;
+    if (!listOnly)
+    {
+        cache = std::make_unique<TuningCache>("tuning.cache", harness.adapter());
+        gemm = std::make_unique<Gemm>(device, queue, cache.get());
+    }
+    std::mt19937 random(42);
+
+    // listing does not open a device, so it shows every shape of both precisions
+    std::vector<Gemm::Variant> const & candidates = listOnly ? Gemm::variants() : gemm->candidates();
+    std::vector<Gemm::Precision> precisions = { Gemm::Precision::F32 };
+    if (listOnly || gemm->supportsF16())
+    {
+        precisions.push_back(Gemm::Precision::F16);
+    }
+
+    for (Gemm::Precision precision : precisions)
+    {
+        bool f16 = precision == Gemm::Precision::F16;
+        for (uint32_t size : { 256u, 1024u, 2048u })
+        {
+            std::string prefix = std::string("gemm/") + (f16 ? "f16/" : "f32/") + std::to_string(size) + "/";
+            std::vector<Gemm::Variant> variants;
+            for (Gemm::Variant const & variant : candidates)
+            {
+                if (harness.selected(prefix + variant.name()))
+                {
+                    variants.push_back(variant);
+                }
+            }
+            bool tuned = harness.selected(prefix + "tuned");
+            if (variants.empty() && !tuned)
+            {
+                continue;
+            }
+
+            // multiples of 1/8 in [-1, 1] are exact in f16 as well
+            size_t count = size_t(size) * size;
+            std::vector<float> a(count);
+            std::vector<float> b(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                a[i] = static_cast<float>(int(random() % 17) - 8) / 8.0f;
+                b[i] = static_cast<float>(int(random() % 17) - 8) / 8.0f;
+            }
+            uint64_t elementSize = f16 ? 2 : 4;
+            uint64_t bytes = count * elementSize;
+            WGPUBufferUsageFlags const storage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+            WGPUBuffer aBuffer = nullptr;
+            WGPUBuffer bBuffer = nullptr;
+            if (f16)
+            {
+                std::vector<uint16_t> aHalf(count);
+                std::vector<uint16_t> bHalf(count);
+                std::transform(a.begin(), a.end(), aHalf.begin(), floatToHalf);
+                std::transform(b.begin(), b.end(), bHalf.begin(), floatToHalf);
+                aBuffer = harness.createBuffer("GEMM matrix", storage, bytes, aHalf.data());
+                bBuffer = harness.createBuffer("GEMM matrix", storage, bytes, bHalf.data());
+            }
+            else
+            {
+                aBuffer = harness.createBuffer("GEMM matrix", storage, bytes, a.data());
+                bBuffer = harness.createBuffer("GEMM matrix", storage, bytes, b.data());
+            }
+            WGPUBuffer cBuffer = harness.createBuffer("GEMM matrix", storage, bytes);
+
+            auto verify = [&]() {
+                std::vector<float> c(count);
+                if (f16)
+                {
+                    std::vector<uint16_t> halves = harness.read<uint16_t>(cBuffer, count);
+                    std::transform(halves.begin(), halves.end(), c.begin(), halfToFloat);
+                }
+                else
+                {
+                    c = harness.read<float>(cBuffer, count);
+                }
+                return checkRows(a, b, c, size, f16 ? 5e-2f : 1e-4f);
+            };
+            auto run = [&](std::string const & name, Gemm::Variant const & variant) {
+                auto body = [&](WGPUCommandEncoder encoder) {
+                    gemm->multiply(encoder, aBuffer, bBuffer, cBuffer, size, size, size, precision, variant);
+                };
+                harness.runOnce("GEMM", body);
+                if (!verify())
+                {
+                    std::cerr << name << ": GPU result differs from the CPU reference, skipped" << std::endl;
+                    return;
+                }
+                harness.measureSamples(name, 1, [&]() { return harness.runOnce("GEMM", body); }, 3 * bytes);
+            };
+
+            for (Gemm::Variant const & variant : variants)
+            {
+                run(prefix + variant.name(), variant);
+            }
+            if (tuned)
+            {
+                run(prefix + "tuned", gemm->tune(size, size, size, precision));
+            }
+
+            for (WGPUBuffer buffer : { aBuffer, bBuffer, cBuffer })
+            {
+                wgpuBufferRelease(buffer);
+            }
+        }
+    }
+}
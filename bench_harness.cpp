@@ -0,0 +1,386 @@
+#include "bench_harness.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+char const * backendName(WGPUBackendType backend)
+{
+    switch (backend)
+    {
+    case WGPUBackendType_Null: return "null";
+    case WGPUBackendType_WebGPU: return "webgpu";
+    case WGPUBackendType_D3D11: return "d3d11";
+    case WGPUBackendType_D3D12: return "d3d12";
+    case WGPUBackendType_Metal: return "metal";
+    case WGPUBackendType_Vulkan: return "vulkan";
+    case WGPUBackendType_OpenGL: return "opengl";
+    case WGPUBackendType_OpenGLES: return "opengles";
+    default: return "undefined";
+    }
+}
+
+char const * adapterTypeName(WGPUAdapterType type)
+{
+    switch (type)
+    {
+    case WGPUAdapterType_DiscreteGPU: return "discrete";
+    case WGPUAdapterType_IntegratedGPU: return "integrated";
+    case WGPUAdapterType_CPU: return "cpu";
+    default: return "unknown";
+    }
+}
+
+std::string jsonString(std::string const & value)
+{
+    std::string out = "\"";
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    return out + "\"";
+}
+
+// human-readable duration of a time in nanoseconds
+std::string formatTime(double ns)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(ns < 10.0 ? 2 : 1);
+    if (ns < 1e3) out << ns << " ns";
+    else if (ns < 1e6) out << ns / 1e3 << " us";
+    else if (ns < 1e9) out << ns / 1e6 << " ms";
+    else out << ns / 1e9 << " s";
+    return out.str();
+}
+
+} // namespace
+
+bool BenchmarkHarness::parseOptions(int argc, char * argv[], Options & options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--fallback")
+        {
+            options.fallbackAdapter = true;
+        }
+        else if (arg == "--list")
+        {
+            options.listOnly = true;
+        }
+        else if (arg.rfind("--json=", 0) == 0)
+        {
+            options.jsonPath = arg.substr(7);
+        }
+        else if (arg.rfind("--filter=", 0) == 0)
+        {
+            options.filter = arg.substr(9);
+        }
+        else if (arg.rfind("--samples=", 0) == 0)
+        {
+            options.samples = std::max(1, std::atoi(arg.c_str() + 10));
+        }
+        else
+        {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+BenchmarkHarness::BenchmarkHarness(Options const & options)
+    : m_options(options)
+{}
+
+BenchmarkHarness::~BenchmarkHarness()
+{
+    if (m_queue) wgpuQueueRelease(m_queue);
+    if (m_device) wgpuDeviceRelease(m_device);
+    if (m_adapter) wgpuAdapterRelease(m_adapter);
+    if (m_instance) wgpuInstanceRelease(m_instance);
+}
+
+bool BenchmarkHarness::initialize()
+{
+    WGPUInstanceDescriptor desc = {};
+    desc.nextInChain = nullptr;
+    m_instance = wgpuCreateInstance(&desc);
+    if (m_instance == nullptr)
+    {
+        std::cerr << "Could not initialize WebGPU!" << std::endl;
+        return false;
+    }
+
+    WGPURequestAdapterOptions adapterOpts = {};
+    adapterOpts.nextInChain = nullptr;
+    adapterOpts.forceFallbackAdapter = m_options.fallbackAdapter;
+    m_adapter = requestAdapterSync(m_instance, &adapterOpts);
+    if (m_adapter == nullptr)
+    {
+        std::cerr << (m_options.fallbackAdapter ? "No fallback adapter" : "No adapter") << std::endl;
+        return false;
+    }
+
+    WGPUAdapterProperties properties = {};
+    properties.nextInChain = nullptr;
+    wgpuAdapterGetProperties(m_adapter, &properties);
+    m_adapterInfo.name = properties.name ? properties.name : "";
+    m_adapterInfo.vendor = properties.vendorName ? properties.vendorName : "";
+    m_adapterInfo.architecture = properties.architecture ? properties.architecture : "";
+    m_adapterInfo.driver = properties.driverDescription ? properties.driverDescription : "";
+    m_adapterInfo.backend = backendName(properties.backendType);
+    m_adapterInfo.type = adapterTypeName(properties.adapterType);
+    m_adapterInfo.fallback = m_options.fallbackAdapter;
+
+    // timestamps are optional, the GPU-timed benchmarks fall back to wall time
+    std::vector<WGPUFeatureName> requiredFeatures;
+    if (wgpuAdapterHasFeature(m_adapter, WGPUFeatureName_TimestampQuery))
+    {
+        requiredFeatures.push_back(WGPUFeatureName_TimestampQuery);
+    }
+    if (wgpuAdapterHasFeature(m_adapter, WGPUFeatureName_ShaderF16))
+    {
+        requiredFeatures.push_back(WGPUFeatureName_ShaderF16);
+    }
+    WGPUDeviceDescriptor deviceDesc = {};
+    deviceDesc.nextInChain = nullptr;
+    deviceDesc.label = "Benchmark device";
+    deviceDesc.requiredFeatureCount = requiredFeatures.size();
+    deviceDesc.requiredFeatures = requiredFeatures.data();
+    deviceDesc.requiredLimits = nullptr;
+    deviceDesc.defaultQueue.nextInChain = nullptr;
+    deviceDesc.defaultQueue.label = "Benchmark queue";
+    m_device = requestDeviceSync(m_adapter, &deviceDesc);
+    if (m_device == nullptr)
+    {
+        std::cerr << "No device" << std::endl;
+        return false;
+    }
+    m_queue = wgpuDeviceGetQueue(m_device);
+    return true;
+}
+
+bool BenchmarkHarness::selected(std::string const & name)
+{
+    if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos)
+    {
+        return false;
+    }
+    if (m_options.listOnly)
+    {
+        std::cout << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void BenchmarkHarness::measure(std::string const & name, uint32_t operations, std::function<void()> const & body, uint64_t bytesPerOperation)
+{
+    measureSamples(name, operations, [&]() {
+        auto start = Clock::now();
+        for (uint32_t i = 0; i < operations; ++i)
+        {
+            body();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }, bytesPerOperation);
+}
+
+void BenchmarkHarness::measureSamples(std::string const & name, uint32_t operations, std::function<double()> const & sample, uint64_t bytesPerOperation)
+{
+    operations = std::max(1u, operations);
+    for (uint32_t i = 0; i < m_options.warmupSamples; ++i)
+    {
+        sample();
+    }
+
+    Result result;
+    result.name = name;
+    result.operations = operations;
+    result.bytesPerOperation = bytesPerOperation;
+    result.samples.reserve(m_options.samples);
+    for (uint32_t i = 0; i < m_options.samples; ++i)
+    {
+        result.samples.push_back(sample() / operations);
+    }
+    addResult(std::move(result));
+}
+
+double BenchmarkHarness::runOnce(char const * label, std::function<void(WGPUCommandEncoder encoder)> const & body)
+{
+    auto start = Clock::now();
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = label;
+    WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &encoderDesc);
+    body(encoder);
+    WGPUCommandBufferDescriptor cmdBufferDesc = {};
+    cmdBufferDesc.nextInChain = nullptr;
+    cmdBufferDesc.label = nullptr;
+    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
+    wgpuQueueSubmit(m_queue, 1, &command);
+    wgpuCommandBufferRelease(command);
+    waitForSubmittedWork(m_device, m_queue);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+WGPUBuffer BenchmarkHarness::createBuffer(char const * label, WGPUBufferUsageFlags usage, uint64_t size, void const * data)
+{
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = label;
+    bufferDesc.usage = usage;
+    bufferDesc.size = std::max<uint64_t>((size + 3) & ~uint64_t(3), 4);
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    if (data)
+    {
+        wgpuQueueWriteBuffer(m_queue, buffer, 0, data, size);
+    }
+    return buffer;
+}
+
+void BenchmarkHarness::read(WGPUBuffer buffer, void * destination, uint64_t size)
+{
+    uint64_t copySize = std::max<uint64_t>((size + 3) & ~uint64_t(3), 4);
+    WGPUBuffer readback = createBuffer("Readback", WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, copySize);
+    runOnce("Readback", [&](WGPUCommandEncoder encoder) {
+        wgpuCommandEncoderCopyBufferToBuffer(encoder, buffer, 0, readback, 0, copySize);
+    });
+    if (mapBufferSync(m_device, readback, WGPUMapMode_Read, 0, copySize))
+    {
+        if (size > 0)
+        {
+            std::memcpy(destination, wgpuBufferGetConstMappedRange(readback, 0, copySize), size);
+        }
+        wgpuBufferUnmap(readback);
+    }
+    wgpuBufferRelease(readback);
+}
+
+void BenchmarkHarness::addResult(Result result)
+{
+    std::vector<double> sorted = result.samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    if (n > 0)
+    {
+        result.median = n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+        result.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
+        double squares = 0.0;
+        for (double s : sorted)
+        {
+            squares += (s - result.mean) * (s - result.mean);
+        }
+        result.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+        result.min = sorted.front();
+        result.max = sorted.back();
+    }
+    std::cout << "  " << std::left << std::setw(40) << result.name << std::right
+        << std::setw(12) << formatTime(result.median);
+    if (result.bytesPerOperation > 0 && result.median > 0.0)
+    {
+        // bytes per ns is GB/s
+        std::cout << std::fixed << std::setprecision(2) << std::setw(10)
+            << result.bytesPerOperation / result.median << " GB/s" << std::defaultfloat;
+    }
+    std::cout << std::endl;
+    m_results.push_back(std::move(result));
+}
+
+void BenchmarkHarness::report(std::ostream & out) const
+{
+    out << "Adapter: " << m_adapterInfo.name << " (" << m_adapterInfo.backend << ", " << m_adapterInfo.type
+        << (m_adapterInfo.fallback ? ", fallback" : "") << ")" << std::endl;
+    out << std::left << std::setw(40) << "benchmark" << std::right
+        << std::setw(12) << "median" << std::setw(12) << "min" << std::setw(12) << "max"
+        << std::setw(10) << "cv" << std::setw(12) << "throughput" << std::endl;
+    for (auto const & result : m_results)
+    {
+        out << std::left << std::setw(40) << result.name << std::right
+            << std::setw(12) << formatTime(result.median)
+            << std::setw(12) << formatTime(result.min)
+            << std::setw(12) << formatTime(result.max)
+            << std::fixed << std::setprecision(1)
+            << std::setw(9) << (result.mean > 0.0 ? 100.0 * result.stddev / result.mean : 0.0) << "%";
+        if (result.bytesPerOperation > 0 && result.median > 0.0)
+        {
+            out << std::setprecision(2) << std::setw(7) << result.bytesPerOperation / result.median << " GB/s";
+        }
+        out << std::defaultfloat << std::endl;
+    }
+}
+
+bool BenchmarkHarness::writeJson(std::string const & path) const
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        return false;
+    }
+    out << std::setprecision(17);
+    out << "{\n  \"version\": 1,\n  \"adapter\": {"
+        << "\"name\": " << jsonString(m_adapterInfo.name)
+        << ", \"vendor\": " << jsonString(m_adapterInfo.vendor)
+        << ", \"architecture\": " << jsonString(m_adapterInfo.architecture)
+        << ", \"driver\": " << jsonString(m_adapterInfo.driver)
+        << ", \"backend\": " << jsonString(m_adapterInfo.backend)
+        << ", \"type\": " << jsonString(m_adapterInfo.type)
+        << ", \"fallback\": " << (m_adapterInfo.fallback ? "true" : "false") << "},\n"
+        << "  \"benchmarks\": [";
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        Result const & result = m_results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(result.name)
+            << ", \"unit\": \"ns\""
+            << ", \"operations\": " << result.operations
+            << ", \"bytes_per_operation\": " << result.bytesPerOperation
+            << ", \"median\": " << result.median
+            << ", \"mean\": " << result.mean
+            << ", \"stddev\": " << result.stddev
+            << ", \"min\": " << result.min
+            << ", \"max\": " << result.max
+            << ", \"samples\": [";
+        for (size_t s = 0; s < result.samples.size(); ++s)
+        {
+            out << (s ? ", " : "") << result.samples[s];
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
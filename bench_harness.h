@@ -0,0 +1,154 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Shared harness of the `bench` target: creates the device, runs the
+ * benchmarks of every suite with warm-up and repeated samples, and writes
+ * a table or JSON with the raw samples for trend tracking and for
+ * BenchCompare.
+ *     bench [--fallback] [--json=<file>] [--filter=<text>] [--samples=<n>] [--list]
+ *
+ * Every sample is the time of one operation in nanoseconds, averaged over
+ * the operations the sample runs; benchmarks moving data also report their
+ * throughput. Names are "<group>/<case>", e.g. "write_buffer/65536".
+ */
+class BenchmarkHarness
+{
+public:
+    struct Options
+    {
+        bool fallbackAdapter = false;   // forceFallbackAdapter, e.g. a software rasterizer
+        std::string jsonPath;
+        std::string filter;             // only run the benchmarks whose name contains it
+        uint32_t samples = 15;
+        uint32_t warmupSamples = 2;
+        bool listOnly = false;
+    };
+
+    struct AdapterInfo
+    {
+        std::string name;
+        std::string vendor;
+        std::string architecture;
+        std::string driver;
+        std::string backend;
+        std::string type;
+        bool fallback = false;
+    };
+
+    struct Result
+    {
+        std::string name;
+        uint32_t operations = 1;            // per sample
+        uint64_t bytesPerOperation = 0;
+        std::vector<double> samples;        // ns per operation
+        double median = 0.0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+    };
+
+    /**
+     * Returns false on unknown arguments.
+     */
+    static bool parseOptions(int argc, char * argv[], Options & options);
+
+    explicit BenchmarkHarness(Options const & options);
+    ~BenchmarkHarness();
+
+    BenchmarkHarness(BenchmarkHarness const &) = delete;
+    BenchmarkHarness & operator=(BenchmarkHarness const &) = delete;
+
+    /**
+     * Create the device, with the optional features the suites can use.
+     */
+    bool initialize();
+
+    WGPUInstance instance() const { return m_instance; }
+    WGPUAdapter adapter() const { return m_adapter; }
+    WGPUDevice device() const { return m_device; }
+    WGPUQueue queue() const { return m_queue; }
+    AdapterInfo const & adapterInfo() const { return m_adapterInfo; }
+    Options const & options() const { return m_options; }
+
+    /**
+     * Whether the benchmark is selected; suites check it before any
+     * expensive setup. With --list it prints the name and returns false.
+     */
+    bool selected(std::string const & name);
+
+    /**
+     * Time `operations` calls of body per sample on the CPU clock.
+     */
+    void measure(std::string const & name, uint32_t operations, std::function<void()> const & body, uint64_t bytesPerOperation = 0);
+
+    /**
+     * For benchmarks timing themselves, e.g. with GPU timestamps or to leave
+     * out per-sample setup: sample returns the duration of `operations`
+     * operations in nanoseconds.
+     */
+    void measureSamples(std::string const & name, uint32_t operations, std::function<double()> const & sample, uint64_t bytesPerOperation = 0);
+
+    /**
+     * Record with `body`, submit and wait; returns the wall time in ns.
+     */
+    double runOnce(char const * label, std::function<void(WGPUCommandEncoder encoder)> const & body);
+
+    /**
+     * Buffer of `size` bytes, rounded up to the multiple of 4 copies need,
+     * with `data` written to it when given.
+     */
+    WGPUBuffer createBuffer(char const * label, WGPUBufferUsageFlags usage, uint64_t size, void const * data = nullptr);
+
+    /**
+     * Copy the front of a buffer with the CopySrc usage back and wait.
+     */
+    void read(WGPUBuffer buffer, void * destination, uint64_t size);
+
+    template <typename T>
+    std::vector<T> read(WGPUBuffer buffer, size_t count)
+    {
+        std::vector<T> result(count);
+        read(buffer, result.data(), count * sizeof(T));
+        return result;
+    }
+
+    std::vector<Result> const & results() const { return m_results; }
+    void report(std::ostream & out) const;
+    bool writeJson(std::string const & path) const;
+
+private:
+    void addResult(Result result);
+
+    Options m_options;
+    WGPUInstance m_instance = nullptr;
+    WGPUAdapter m_adapter = nullptr;
+    WGPUDevice m_device = nullptr;
+    WGPUQueue m_queue = nullptr;
+    AdapterInfo m_adapterInfo;
+    std::vector<Result> m_results;
+};
+
+/**
+ * Benchmark suites, each in its own bench_*.cpp.
+ */
+void runCoreBenchmarks(BenchmarkHarness & harness);
+void runShaderBenchmarks(BenchmarkHarness & harness);
+void runPrimitiveBenchmarks(BenchmarkHarness & harness);
+void runGemmBenchmarks(BenchmarkHarness & harness);
+void runTunerBenchmarks(BenchmarkHarness & harness);
+void runTensorBenchmarks(BenchmarkHarness & harness);
+void runChainBenchmarks(BenchmarkHarness & harness);
+void runSpmvBenchmarks(BenchmarkHarness & harness);
+void runFftBenchmarks(BenchmarkHarness & harness);
+void runImageBenchmarks(BenchmarkHarness & harness);
+void runStatisticsBenchmarks(BenchmarkHarness & harness);
+void runComputeBackendBenchmarks(BenchmarkHarness & harness);     // also without a device
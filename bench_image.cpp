@@ -0,0 +1,177 @@
+#include "bench_harness.h"
+#include "image_filters.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Filter chains on rgba32float images, each with fusion on and off, so the
+ * difference is what one pass over workgroup tiles saves against a round
+ * trip through an intermediate texture. Results are checked against the
+ * CPU reference first, and the plan of dispatches is printed.
+ */
+
+namespace
+{
+
+struct Chain
+{
+    char const * name;
+    ImageFilterChain chain;
+};
+
+std::vector<Chain> chains()
+{
+    std::vector<Chain> result;
+    result.push_back({ "blur", ImageFilterChain().gaussian(2.0f) });
+    result.push_back({ "blur_downsample", ImageFilterChain().gaussian(2.0f).downsample() });
+    std::vector<float> sharpen = { 0, -1, 0, -1, 5, -1, 0, -1, 0 };
+    result.push_back({ "box_convolve", ImageFilterChain().box(2).convolve(sharpen, 3, 3) });
+    result.push_back({ "pyramid", ImageFilterChain().gaussian(1.0f).downsample().gaussian(1.0f).downsample().upsample().upsample() });
+    return result;
+}
+
+WGPUTexture createTexture(WGPUDevice device, WGPUTextureUsageFlags usage, uint32_t width, uint32_t height)
+{
+    WGPUTextureDescriptor textureDesc = {};
+    textureDesc.nextInChain = nullptr;
+    textureDesc.label = "Image";
+    textureDesc.usage = usage;
+    textureDesc.dimension = WGPUTextureDimension_2D;
+    textureDesc.size = { width, height, 1 };
+    textureDesc.format = WGPUTextureFormat_RGBA32Float;
+    textureDesc.mipLevelCount = 1;
+    textureDesc.sampleCount = 1;
+    textureDesc.viewFormatCount = 0;
+    textureDesc.viewFormats = nullptr;
+    return wgpuDeviceCreateTexture(device, &textureDesc);
+}
+
+// rows of 16-byte pixels, padded to the 256 bytes copies need
+uint32_t paddedRowBytes(uint32_t width)
+{
+    return (width * 16 + 255) / 256 * 256;
+}
+
+} // namespace
+
+void runImageBenchmarks(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+    std::mt19937 random(42);
+    uint32_t const sizes[] = { 1024, 2048 };
+
+    // created once something runs, there is no device in list mode
+    std::unique_ptr<ImageFilters> filters;
+    for (Chain const & chain : chains())
+    {
+        for (bool fused : { true, false })
+        {
+            for (uint32_t size : sizes)
+            {
+                std::string const name = std::string("image/") + chain.name + (fused ? "/fused/" : "/unfused/") + std::to_string(size);
+                if (!harness.selected(name))
+                {
+                    continue;
+                }
+                if (!filters)
+                {
+                    filters = std::make_unique<ImageFilters>(device);
+                }
+                filters->setFusion(fused);
+                for (std::string const & line : filters->describe(chain.chain, size, size))
+                {
+                    std::cout << "    " << line << std::endl;
+                }
+
+                std::vector<float> pixels(size_t(size) * size * 4);
+                std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+                for (float & value : pixels)
+                {
+                    value = unit(random);
+                }
+                uint32_t width = size;
+                uint32_t height = size;
+                std::vector<float> expected = cpuImageFilter(chain.chain, pixels, width, height);
+
+                WGPUTexture input = createTexture(device, WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst, size, size);
+                WGPUTexture output = createTexture(device, WGPUTextureUsage_StorageBinding | WGPUTextureUsage_CopySrc, width, height);
+                uint32_t rowBytes = paddedRowBytes(width);
+                WGPUBuffer readback = harness.createBuffer("Image readback", WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, uint64_t(rowBytes) * height);
+
+                WGPUImageCopyTexture inputCopy = {};
+                inputCopy.nextInChain = nullptr;
+                inputCopy.texture = input;
+                inputCopy.mipLevel = 0;
+                inputCopy.origin = { 0, 0, 0 };
+                inputCopy.aspect = WGPUTextureAspect_All;
+                WGPUTextureDataLayout inputLayout = {};
+                inputLayout.nextInChain = nullptr;
+                inputLayout.offset = 0;
+                inputLayout.bytesPerRow = size * 16;
+                inputLayout.rowsPerImage = size;
+                WGPUExtent3D inputExtent = { size, size, 1 };
+                wgpuQueueWriteTexture(queue, &inputCopy, pixels.data(), pixels.size() * sizeof(float), &inputLayout, &inputExtent);
+
+                auto body = [&](WGPUCommandEncoder encoder) { filters->apply(encoder, chain.chain, input, output); };
+                harness.runOnce("Image filters", body);
+                harness.runOnce("Image filters", [&](WGPUCommandEncoder encoder) {
+                    WGPUImageCopyTexture source = {};
+                    source.nextInChain = nullptr;
+                    source.texture = output;
+                    source.mipLevel = 0;
+                    source.origin = { 0, 0, 0 };
+                    source.aspect = WGPUTextureAspect_All;
+                    WGPUImageCopyBuffer destination = {};
+                    destination.nextInChain = nullptr;
+                    destination.buffer = readback;
+                    destination.layout.nextInChain = nullptr;
+                    destination.layout.offset = 0;
+                    destination.layout.bytesPerRow = rowBytes;
+                    destination.layout.rowsPerImage = height;
+                    WGPUExtent3D extent = { width, height, 1 };
+                    wgpuCommandEncoderCopyTextureToBuffer(encoder, &source, &destination, &extent);
+                });
+                bool ok = false;
+                if (mapBufferSync(device, readback, WGPUMapMode_Read, 0, uint64_t(rowBytes) * height))
+                {
+                    auto const * mapped = static_cast<uint8_t const *>(wgpuBufferGetConstMappedRange(readback, 0, uint64_t(rowBytes) * height));
+                    float error = 0.0f;
+                    for (uint32_t y = 0; y < height; ++y)
+                    {
+                        float const * row = reinterpret_cast<float const *>(mapped + size_t(y) * rowBytes);
+                        for (uint32_t i = 0; i < width * 4; ++i)
+                        {
+                            error = std::max(error, std::abs(row[i] - expected[size_t(y) * width * 4 + i]));
+                        }
+                    }
+                    ok = error <= 1e-3f;
+                    wgpuBufferUnmap(readback);
+                }
+                if (ok)
+                {
+                    // the input read and the output written once, what fusion approaches
+                    uint64_t bytes = uint64_t(size) * size * 16 + uint64_t(width) * height * 16;
+                    harness.measureSamples(name, 1, [&]() { return harness.runOnce("Image filters", body); }, bytes);
+                }
+                else
+                {
+                    std::cerr << name << ": GPU result differs from the CPU reference, skipped" << std::endl;
+                }
+
+                wgpuBufferRelease(readback);
+                wgpuTextureRelease(output);
+                wgpuTextureRelease(input);
+            }
+        }
+    }
+}
@@ -0,0 +1,328 @@
+#include "bench_harness.h"
+#include "compute_backend.h"
+#include "gpu_primitives.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Throughput of the compute primitives across input sizes, on the GPU, on
+ * the CPU backend and on the backend createComputeBackend picks, which is
+ * all that runs without a device. Every benchmark first checks its result
+ * against the sequential reference, or the CPU backend, and is skipped if
+ * they differ.
+ */
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+bool check(bool ok, std::string const & name)
+{
+    if (!ok)
+    {
+        std::cerr << name << ": result differs from the CPU reference, skipped" << std::endl;
+    }
+    return ok;
+}
+
+/**
+ * The primitives through a ComputeBackend on host memory. Results are
+ * checked against the oracle backend when given, else against the
+ * sequential references. The backend is only asked for once something is
+ * selected, there is no device in list mode.
+ */
+template <typename GetBackend>
+void runBackendPrimitiveBenchmarks(BenchmarkHarness & harness, std::string const & prefix, GetBackend const & getBackend, ComputeBackend * oracle)
+{
+    std::mt19937 random(42);
+    using Scalar = ComputeBackend::Scalar;
+    using ReduceOp = ComputeBackend::ReduceOp;
+
+    for (uint32_t count : { 1u << 16, 1u << 20, 1u << 24 })
+    {
+        std::string suffix = "/" + std::to_string(count);
+        std::string const reduceU32 = prefix + "reduce_sum_u32" + suffix;
+        std::string const reduceF32 = prefix + "reduce_max_f32" + suffix;
+        std::string const exclusive = prefix + "exclusive_scan" + suffix;
+        std::string const compact = prefix + "compact" + suffix;
+        std::string const sortPairs = prefix + "radix_sort_pairs" + suffix;
+        bool selected[] = {
+            harness.selected(reduceU32), harness.selected(reduceF32), harness.selected(exclusive),
+            harness.selected(compact), harness.selected(sortPairs),
+        };
+        if (std::find(std::begin(selected), std::end(selected), true) == std::end(selected))
+        {
+            continue;
+        }
+        ComputeBackend & backend = getBackend();
+
+        std::vector<uint32_t> values(count);
+        std::vector<float> floats(count);
+        std::vector<uint32_t> flags(count);
+        std::vector<uint32_t> keys(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            values[i] = random() % 16;
+            floats[i] = static_cast<float>(random() % 1000) / 1000.0f;
+            flags[i] = random() % 3 == 0 ? 1 : 0;
+            keys[i] = random();
+        }
+        std::vector<uint32_t> output(count);
+        std::vector<uint32_t> sortedKeys(count);
+        uint64_t bytes = uint64_t(count) * 4;
+
+        auto measure = [&](std::string const & name, auto const & body) {
+            harness.measureSamples(name, 1, [&]() {
+                auto start = Clock::now();
+                body();
+                return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            }, bytes);
+        };
+
+        if (selected[0])
+        {
+            uint32_t sum = 0;
+            auto body = [&]() { backend.reduce(values.data(), count, &sum, Scalar::U32, ReduceOp::Sum); };
+            body();
+            uint32_t expected = cpuReduce(values, ReduceOp::Sum);
+            if (oracle) oracle->reduce(values.data(), count, &expected, Scalar::U32, ReduceOp::Sum);
+            if (check(sum == expected, reduceU32))
+            {
+                measure(reduceU32, body);
+            }
+        }
+        if (selected[1])
+        {
+            float max = 0.0f;
+            auto body = [&]() { backend.reduce(floats.data(), count, &max, Scalar::F32, ReduceOp::Max); };
+            body();
+            float expected = cpuReduce(floats, ReduceOp::Max);
+            if (oracle) oracle->reduce(floats.data(), count, &expected, Scalar::F32, ReduceOp::Max);
+            if (check(max == expected, reduceF32))
+            {
+                measure(reduceF32, body);
+            }
+        }
+        if (selected[2])
+        {
+            auto body = [&]() { backend.exclusiveScan(values.data(), output.data(), count, Scalar::U32); };
+            body();
+            std::vector<uint32_t> expected = cpuExclusiveScan(values);
+            if (oracle) oracle->exclusiveScan(values.data(), expected.data(), count, Scalar::U32);
+            if (check(output == expected, exclusive))
+            {
+                measure(exclusive, body);
+            }
+        }
+        if (selected[3])
+        {
+            uint32_t kept = 0;
+            auto body = [&]() { kept = backend.compact(values.data(), flags.data(), count, output.data()); };
+            body();
+            std::vector<uint32_t> expected = cpuCompact(values, flags);
+            if (oracle)
+            {
+                expected.resize(count);
+                expected.resize(oracle->compact(values.data(), flags.data(), count, expected.data()));
+            }
+            if (check(kept == expected.size() && std::equal(expected.begin(), expected.end(), output.begin()), compact))
+            {
+                measure(compact, body);
+            }
+        }
+        if (selected[4])
+        {
+            // every sample sorts the same unsorted keys again, the copies are timed too
+            auto body = [&]() {
+                sortedKeys = keys;
+                output = values;
+                backend.radixSort(sortedKeys.data(), count, output.data());
+            };
+            body();
+            std::vector<uint32_t> expectedKeys = keys;
+            std::vector<uint32_t> expectedValues = values;
+            if (oracle)
+            {
+                oracle->radixSort(expectedKeys.data(), count, expectedValues.data());
+            }
+            else
+            {
+                cpuRadixSort(expectedKeys, expectedValues);
+            }
+            if (check(sortedKeys == expectedKeys && output == expectedValues, sortPairs))
+            {
+                measure(sortPairs, body);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void runPrimitiveBenchmarks(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    GpuPrimitives primitives(device);
+    std::mt19937 random(42);
+
+    for (uint32_t count : { 1u << 16, 1u << 20, 1u << 24 })
+    {
+        std::string suffix = "/" + std::to_string(count);
+        std::string const reduceU32 = "primitives/reduce_sum_u32" + suffix;
+        std::string const reduceF32 = "primitives/reduce_max_f32" + suffix;
+        std::string const inclusive = "primitives/inclusive_scan" + suffix;
+        std::string const exclusive = "primitives/exclusive_scan" + suffix;
+        std::string const compact = "primitives/compact" + suffix;
+        std::string const sortKeys = "primitives/radix_sort_keys" + suffix;
+        std::string const sortPairs = "primitives/radix_sort_pairs" + suffix;
+        bool selected[] = {
+            harness.selected(reduceU32), harness.selected(reduceF32), harness.selected(inclusive),
+            harness.selected(exclusive), harness.selected(compact), harness.selected(sortKeys), harness.selected(sortPairs),
+        };
+        if (std::find(std::begin(selected), std::end(selected), true) == std::end(selected))
+        {
+            continue;
+        }
+
+        // small values keep the u32 sums exact
+        std::vector<uint32_t> values(count);
+        std::vector<float> floats(count);
+        std::vector<uint32_t> flags(count);
+        std::vector<uint32_t> keys(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            values[i] = random() % 16;
+            floats[i] = static_cast<float>(random() % 1000) / 1000.0f;
+            flags[i] = random() % 3 == 0 ? 1 : 0;
+            keys[i] = random();
+        }
+        uint64_t bytes = uint64_t(count) * 4;
+        WGPUBufferUsageFlags const storage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+        WGPUBuffer input = harness.createBuffer("Primitive data", storage, bytes, values.data());
+        WGPUBuffer floatInput = harness.createBuffer("Primitive data", storage, bytes, floats.data());
+        WGPUBuffer flagBuffer = harness.createBuffer("Primitive data", storage, bytes, flags.data());
+        WGPUBuffer output = harness.createBuffer("Primitive data", storage, bytes);
+        WGPUBuffer outputCount = harness.createBuffer("Primitive data", storage, 4);
+        WGPUBuffer keySource = harness.createBuffer("Primitive data", storage, bytes, keys.data());
+        WGPUBuffer keyBuffer = harness.createBuffer("Primitive data", storage, bytes);
+        WGPUBuffer valueBuffer = harness.createBuffer("Primitive data", storage, bytes);
+
+        auto measure = [&](std::string const & name, auto const & body) {
+            harness.measureSamples(name, 1, [&]() { return harness.runOnce("Primitive", body); }, bytes);
+        };
+
+        if (selected[0])
+        {
+            auto body = [&](WGPUCommandEncoder encoder) { primitives.reduce(encoder, input, count, output); };
+            harness.runOnce("Primitive", body);
+            if (check(harness.read<uint32_t>(output, 1)[0] == cpuReduce(values, GpuPrimitives::ReduceOp::Sum), reduceU32))
+            {
+                measure(reduceU32, body);
+            }
+        }
+        if (selected[1])
+        {
+            auto body = [&](WGPUCommandEncoder encoder) {
+                primitives.reduce(encoder, floatInput, count, output, GpuPrimitives::Scalar::F32, GpuPrimitives::ReduceOp::Max);
+            };
+            harness.runOnce("Primitive", body);
+            if (check(harness.read<float>(output, 1)[0] == cpuReduce(floats, GpuPrimitives::ReduceOp::Max), reduceF32))
+            {
+                measure(reduceF32, body);
+            }
+        }
+        if (selected[2])
+        {
+            auto body = [&](WGPUCommandEncoder encoder) { primitives.inclusiveScan(encoder, input, output, count); };
+            harness.runOnce("Primitive", body);
+            if (check(harness.read<uint32_t>(output, count) == cpuInclusiveScan(values), inclusive))
+            {
+                measure(inclusive, body);
+            }
+        }
+        if (selected[3])
+        {
+            auto body = [&](WGPUCommandEncoder encoder) { primitives.exclusiveScan(encoder, input, output, count); };
+            harness.runOnce("Primitive", body);
+            if (check(harness.read<uint32_t>(output, count) == cpuExclusiveScan(values), exclusive))
+            {
+                measure(exclusive, body);
+            }
+        }
+        if (selected[4])
+        {
+            auto body = [&](WGPUCommandEncoder encoder) {
+                primitives.compact(encoder, input, flagBuffer, count, output, outputCount);
+            };
+            harness.runOnce("Primitive", body);
+            std::vector<uint32_t> expected = cpuCompact(values, flags);
+            uint32_t kept = harness.read<uint32_t>(outputCount, 1)[0];
+            if (check(kept == expected.size() && harness.read<uint32_t>(output, kept) == expected, compact))
+            {
+                measure(compact, body);
+            }
+        }
+        for (bool pairs : { false, true })
+        {
+            std::string const & name = pairs ? sortPairs : sortKeys;
+            if (!selected[pairs ? 6 : 5])
+            {
+                continue;
+            }
+            // every sample sorts the same unsorted keys again, restored by a GPU copy
+            auto body = [&](WGPUCommandEncoder encoder) {
+                wgpuCommandEncoderCopyBufferToBuffer(encoder, keySource, 0, keyBuffer, 0, bytes);
+                if (pairs) wgpuCommandEncoderCopyBufferToBuffer(encoder, input, 0, valueBuffer, 0, bytes);
+                primitives.radixSort(encoder, keyBuffer, count, pairs ? valueBuffer : nullptr);
+            };
+            harness.runOnce("Primitive", body);
+            std::vector<uint32_t> expectedKeys = keys;
+            std::vector<uint32_t> expectedValues = pairs ? values : std::vector<uint32_t>();
+            cpuRadixSort(expectedKeys, expectedValues);
+            bool ok = harness.read<uint32_t>(keyBuffer, count) == expectedKeys
+                && (!pairs || harness.read<uint32_t>(valueBuffer, count) == expectedValues);
+            if (check(ok, name))
+            {
+                measure(name, body);
+            }
+        }
+
+        for (WGPUBuffer buffer : { input, floatInput, flagBuffer, output, outputCount, keySource, keyBuffer, valueBuffer })
+        {
+            wgpuBufferRelease(buffer);
+        }
+    }
+    primitives.release();
+}
+
+void runComputeBackendBenchmarks(BenchmarkHarness & harness)
+{
+    // the CPU backend against the sequential references, the baseline of
+    // the GPU primitives
+    CpuComputeBackend cpu;
+    runBackendPrimitiveBenchmarks(harness, "primitives/cpu/", [&]() -> ComputeBackend & { return cpu; }, nullptr);
+
+    // the backend this host gets, the GPU one unless there is no usable
+    // adapter, checked against the CPU backend on the same inputs
+    std::unique_ptr<ComputeBackend> picked;
+    runBackendPrimitiveBenchmarks(harness, "primitives/backend/", [&]() -> ComputeBackend & {
+        if (!picked)
+        {
+            picked = createComputeBackend(harness.adapter(), harness.device(), harness.queue());
+            std::cout << "primitives/backend: " << picked->name() << std::endl;
+        }
+        return *picked;
+    }, &cpu);
+}
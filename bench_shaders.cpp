@@ -0,0 +1,290 @@
+#include "bench_harness.h"
+#include "bind_group_layout_cache.h"
+#include "glsl_frontend.h"
+#include "gpu_timer.h"
+#include "pipeline_specialization.h"
+#include "shader_library.h"
+#include "shader_module_cache.h"
+#include "shader_pack.h"
+#include "shader_reflection.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Shader loading from loose files (read, splice includes, create module)
+ * against the memory-mapped shader pack, and kernels specialized with
+ * override constants against uniform-parameterized ones.
+ */
+
+namespace
+{
+
+// Returns false if any source could not be loaded.
+bool loadLooseFiles(WGPUDevice device, std::string const & root, std::vector<std::string> const & names)
+{
+    for (auto const & name : names)
+    {
+        ShaderLanguage language;
+        WGPUShaderStage glslStage;
+        std::string code;
+        std::string error;
+        if (!shaderLanguageFromPath(name, language, glslStage)
+            || !preprocessShaderFile(root + name, code, error)
+            || (language == ShaderLanguage::GLSL && !selectGLSLStage(code, glslStage, error)))
+        {
+            std::cerr << error << std::endl;
+            return false;
+        }
+
+        ShaderPack::Shader shader;
+        shader.name = name.c_str();
+        shader.code = code.c_str();
+        shader.language = language;
+        shader.stageMask = glslStage;
+        WGPUShaderModule module = createShaderModule(device, shader);
+        if (module) wgpuShaderModuleRelease(module);
+    }
+    return true;
+}
+
+void benchmarkShaderLoading(BenchmarkHarness & harness)
+{
+    bool loose = harness.selected("shader_load/loose_files");
+    bool packed = harness.selected("shader_load/pack");
+    if (!loose && !packed)
+    {
+        return;
+    }
+
+    // the pack tells which loose files to compare against
+    std::string const packPath = "shaders.pack";
+    std::vector<std::string> names;
+    {
+        ShaderPack pack;
+        if (!pack.open(packPath))
+        {
+            std::cerr << "Could not open " << packPath << ", skipping the shader loading benchmarks" << std::endl;
+            return;
+        }
+        for (uint32_t i = 0; i < pack.shaderCount(); ++i)
+        {
+            names.push_back(pack.shader(i).name);
+        }
+    }
+    std::string root = SHADER_SOURCE_DIR;
+    if (root.back() != '/') root += '/';
+
+    WGPUDevice device = harness.device();
+    if (loose)
+    {
+        harness.measure("shader_load/loose_files", 1, [&]() {
+            loadLooseFiles(device, root, names);
+        });
+    }
+    if (packed)
+    {
+        harness.measure("shader_load/pack", 1, [&]() {
+            ShaderModuleCache moduleCache(device);
+            ShaderLibrary library;
+            library.load(moduleCache, packPath);
+        });
+    }
+}
+
+// both kernels declare the same bindings so they share one bind group
+char const * uniformKernel = R"(
+struct Params {
+    count: u32,
+    iterations: u32,
+    a: f32,
+    b: f32,
+}
+
+@group(0) @binding(0) var<storage, read_write> values: array<f32>;
+@group(0) @binding(1) var<uniform> params: Params;
+
+@compute @workgroup_size(64)
+fn main(@builtin(global_invocation_id) id: vec3<u32>) {
+    if (id.x >= params.count) {
+        return;
+    }
+    var x = values[id.x];
+    for (var k = 0u; k < params.iterations; k++) {
+        x = x * params.a + params.b;
+    }
+    values[id.x] = x;
+}
+)";
+
+char const * specializedKernel = R"(
+struct Params {
+    count: u32,
+    iterations: u32,
+    a: f32,
+    b: f32,
+}
+
+override ITERATIONS: u32 = 1u;
+override A: f32 = 1.0;
+override B: f32 = 0.0;
+
+@group(0) @binding(0) var<storage, read_write> values: array<f32>;
+@group(0) @binding(1) var<uniform> params: Params;
+
+@compute @workgroup_size(64)
+fn main(@builtin(global_invocation_id) id: vec3<u32>) {
+    if (id.x >= params.count) {
+        return;
+    }
+    var x = values[id.x];
+    for (var k = 0u; k < ITERATIONS; k++) {
+        x = x * A + B;
+    }
+    values[id.x] = x;
+}
+)";
+
+struct Params
+{
+    uint32_t count;
+    uint32_t iterations;
+    float a;
+    float b;
+};
+
+void benchmarkSpecialization(BenchmarkHarness & harness)
+{
+    std::vector<uint32_t> const iterationCounts = { 1u, 4u, 16u, 64u, 256u };
+    bool any = false;
+    for (uint32_t iterations : iterationCounts)
+    {
+        std::string suffix = "/" + std::to_string(iterations);
+        // evaluated for all so that --list shows every name
+        bool uniformSelected = harness.selected("specialization/uniform" + suffix);
+        bool specializedSelected = harness.selected("specialization/specialized" + suffix);
+        any = any || uniformSelected || specializedSelected;
+    }
+    if (!any)
+    {
+        return;
+    }
+
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+    constexpr uint32_t count = 1u << 20;
+
+    // shared explicit layout from the reflection of either kernel
+    std::vector<ShaderBindingInfo> bindings;
+    std::string error;
+    if (!reflectShaderBindings(uniformKernel, ShaderLanguage::WGSL, WGPUShaderStage_None, bindings, error))
+    {
+        std::cerr << error << std::endl;
+        return;
+    }
+    std::vector<ShaderBindingLayout> layouts;
+    for (auto const & binding : bindings)
+    {
+        layouts.push_back(binding.layout);
+    }
+    BindGroupLayoutCache layoutCache(device);
+    WGPUPipelineLayout layout = layoutCache.pipelineLayout(layouts);
+
+    WGPUShaderModule uniformModule = createShaderModule(device, uniformKernel, "Uniform kernel");
+    WGPUShaderModule specializedModule = createShaderModule(device, specializedKernel, "Specialized kernel");
+
+    WGPUComputePipelineDescriptor pipelineDesc = {};
+    pipelineDesc.nextInChain = nullptr;
+    pipelineDesc.label = "Uniform kernel";
+    pipelineDesc.layout = layout;
+    pipelineDesc.compute.module = uniformModule;
+    pipelineDesc.compute.entryPoint = "main";
+    WGPUComputePipeline uniformPipeline = wgpuDeviceCreateComputePipeline(device, &pipelineDesc);
+
+    // loop bounds are baked as is here, real selectors would bucket them
+    SpecializedPipelineCache pipelineCache(device);
+    SpecializedKernel<Params> kernel(pipelineCache, specializedModule, "main", layout, [](Params const & params) {
+        return SpecializationConstants()
+            .set("ITERATIONS", params.iterations)
+            .set("A", params.a)
+            .set("B", params.b);
+    });
+
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Values";
+    bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = count * sizeof(float);
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer valueBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    bufferDesc.label = "Params";
+    bufferDesc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = sizeof(Params);
+    WGPUBuffer paramBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+    WGPUBindGroupEntry entries[2] = {};
+    entries[0].binding = 0;
+    entries[0].buffer = valueBuffer;
+    entries[0].size = count * sizeof(float);
+    entries[1].binding = 1;
+    entries[1].buffer = paramBuffer;
+    entries[1].size = sizeof(Params);
+    WGPUBindGroupDescriptor bindGroupDesc = {};
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.layout = layoutCache.bindGroupLayout(layouts, 0);
+    bindGroupDesc.entryCount = 2;
+    bindGroupDesc.entries = entries;
+    WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+
+    GpuTimer timer(device, queue);
+    auto timePipeline = [&](WGPUComputePipeline pipeline) {
+        // one sample per run, the harness takes the median
+        return 1e6 * timer.timeComputePass([&](WGPUComputePassEncoder pass) {
+            wgpuComputePassEncoderSetPipeline(pass, pipeline);
+            wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+            wgpuComputePassEncoderDispatchWorkgroups(pass, (count + 63) / 64, 1, 1);
+        }, 1);
+    };
+
+    for (uint32_t iterations : iterationCounts)
+    {
+        Params params = { count, iterations, 0.999f, 0.001f };
+        wgpuQueueWriteBuffer(queue, paramBuffer, 0, &params, sizeof(Params));
+        WGPUComputePipeline specializedPipeline = kernel.pipeline(params);
+
+        std::string suffix = "/" + std::to_string(iterations);
+        if (harness.selected("specialization/uniform" + suffix))
+        {
+            harness.measureSamples("specialization/uniform" + suffix, 1, [&]() {
+                return timePipeline(uniformPipeline);
+            });
+        }
+        if (harness.selected("specialization/specialized" + suffix))
+        {
+            harness.measureSamples("specialization/specialized" + suffix, 1, [&]() {
+                return timePipeline(specializedPipeline);
+            });
+        }
+    }
+
+    wgpuBindGroupRelease(bindGroup);
+    wgpuBufferRelease(paramBuffer);
+    wgpuBufferRelease(valueBuffer);
+    pipelineCache.release();
+    wgpuComputePipelineRelease(uniformPipeline);
+    wgpuShaderModuleRelease(specializedModule);
+    wgpuShaderModuleRelease(uniformModule);
+    layoutCache.release();
+}
+
+} // namespace
+
+void runShaderBenchmarks(BenchmarkHarness & harness)
+{
+    benchmarkShaderLoading(harness);
+    benchmarkSpecialization(harness);
+}
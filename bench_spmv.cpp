@@ -0,0 +1,221 @@
+#include "bench_harness.h"
+#include "spmv.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Sparse matrix-vector products in every GPU layout against the threaded
+ * CPU baseline, on matrices with the row length distributions each layout
+ * is meant for. "<matrix>/auto" is the layout analyzeSparseRows() picks.
+ */
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct TestMatrix
+{
+    char const * name;
+    uint32_t rows;
+    CsrMatrix (*generate)(uint32_t rows, std::mt19937 & random);
+};
+
+CsrMatrix fromLengths(std::vector<uint32_t> const & lengths, uint32_t cols, std::mt19937 & random)
+{
+    CsrMatrix matrix;
+    matrix.rows = static_cast<uint32_t>(lengths.size());
+    matrix.cols = cols;
+    matrix.rowOffsets.resize(lengths.size() + 1, 0);
+    for (size_t row = 0; row < lengths.size(); ++row)
+    {
+        matrix.rowOffsets[row + 1] = matrix.rowOffsets[row] + std::min(lengths[row], cols);
+    }
+    matrix.columns.resize(matrix.nonZeros());
+    matrix.values.resize(matrix.nonZeros());
+    for (uint32_t i = 0; i < matrix.nonZeros(); ++i)
+    {
+        matrix.columns[i] = random() % cols;
+        matrix.values[i] = static_cast<float>(random() % 1000) / 1000.0f;
+    }
+    return matrix;
+}
+
+// 9-point stencil rows, all of the same length
+CsrMatrix banded(uint32_t rows, std::mt19937 &)
+{
+    CsrMatrix matrix;
+    matrix.rows = rows;
+    matrix.cols = rows;
+    matrix.rowOffsets.push_back(0);
+    for (uint32_t row = 0; row < rows; ++row)
+    {
+        for (int offset = -4; offset <= 4; ++offset)
+        {
+            matrix.columns.push_back((row + rows + offset) % rows);
+            matrix.values.push_back(1.0f / (1 + std::abs(offset)));
+        }
+        matrix.rowOffsets.push_back(static_cast<uint32_t>(matrix.columns.size()));
+    }
+    return matrix;
+}
+
+// lengths uniform in [1, 32)
+CsrMatrix uniform(uint32_t rows, std::mt19937 & random)
+{
+    std::vector<uint32_t> lengths(rows);
+    for (uint32_t & length : lengths)
+    {
+        length = 1 + random() % 31;
+    }
+    return fromLengths(lengths, rows, random);
+}
+
+// graph-like: most rows short, a few very long
+CsrMatrix powerLaw(uint32_t rows, std::mt19937 & random)
+{
+    std::vector<uint32_t> lengths(rows);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (uint32_t & length : lengths)
+    {
+        length = static_cast<uint32_t>(std::min(4096.0, 2.0 / std::pow(1.0 - unit(random), 1.0 / 1.2)));
+    }
+    return fromLengths(lengths, rows, random);
+}
+
+// few rows, hundreds of entries each
+CsrMatrix longRows(uint32_t rows, std::mt19937 & random)
+{
+    std::vector<uint32_t> lengths(rows);
+    for (uint32_t & length : lengths)
+    {
+        length = 128 + random() % 384;
+    }
+    return fromLengths(lengths, rows * 16, random);
+}
+
+bool matches(std::vector<float> const & result, std::vector<float> const & expected)
+{
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        // the sums run in another order
+        if (std::abs(result[i] - expected[i]) > 1e-4f * std::max(1.0f, std::abs(expected[i])))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void runSpmvBenchmarks(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+    std::mt19937 random(42);
+    TestMatrix const matrices[] = {
+        { "banded", 1u << 20, banded },
+        { "uniform", 1u << 20, uniform },
+        { "power_law", 1u << 19, powerLaw },
+        { "long_rows", 1u << 14, longRows },
+    };
+    SparseFormat const formats[] = { SparseFormat::CsrScalar, SparseFormat::CsrVector, SparseFormat::Ell, SparseFormat::SellCSigma };
+
+    // created once something runs, there is no device in list mode
+    std::unique_ptr<Spmv> spmv;
+    uint64_t maxBinding = 0;
+
+    for (TestMatrix const & test : matrices)
+    {
+        std::string const prefix = std::string("spmv/") + test.name + "/";
+        std::vector<std::string> names = { prefix + "cpu", prefix + "auto" };
+        for (SparseFormat format : formats)
+        {
+            names.push_back(prefix + sparseFormatName(format));
+        }
+        std::vector<bool> selected;
+        for (std::string const & name : names)
+        {
+            selected.push_back(harness.selected(name));
+        }
+        if (std::find(selected.begin(), selected.end(), true) == selected.end())
+        {
+            continue;
+        }
+
+        if (!spmv)
+        {
+            spmv = std::make_unique<Spmv>(device);
+            WGPUSupportedLimits supported = {};
+            supported.nextInChain = nullptr;
+            wgpuDeviceGetLimits(device, &supported);
+            maxBinding = supported.limits.maxStorageBufferBindingSize;
+        }
+        CsrMatrix matrix = test.generate(test.rows, random);
+        std::vector<float> x(matrix.cols);
+        for (float & value : x)
+        {
+            value = static_cast<float>(random() % 1000) / 1000.0f;
+        }
+        std::vector<float> expected(matrix.rows);
+        cpuSpmv(matrix, x.data(), expected.data());
+        SparseRowStats stats = analyzeSparseRows(matrix);
+        std::cout << "spmv/" << test.name << ": " << matrix.nonZeros() << " nonzeros, rows of " << stats.minLength << " to "
+            << stats.maxLength << " (mean " << stats.meanLength << ", stddev " << stats.stddevLength << "), fill ELL "
+            << stats.ellFill << " SELL " << stats.sellFill << ", picked " << sparseFormatName(stats.recommended) << std::endl;
+
+        uint64_t csrBytes = uint64_t(matrix.nonZeros()) * 8 + uint64_t(matrix.rows) * 8 + uint64_t(matrix.cols) * 4;
+        if (selected[0])
+        {
+            std::vector<float> y(matrix.rows);
+            harness.measureSamples(names[0], 1, [&]() {
+                auto start = Clock::now();
+                cpuSpmv(matrix, x.data(), y.data());
+                return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            }, csrBytes);
+        }
+
+        WGPUBuffer xBuffer = harness.createBuffer("SpMV vector", WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst, x.size() * 4, x.data());
+        WGPUBuffer yBuffer = harness.createBuffer("SpMV vector", WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc, uint64_t(matrix.rows) * 4);
+
+        for (size_t i = 1; i < names.size(); ++i)
+        {
+            if (!selected[i])
+            {
+                continue;
+            }
+            SparseFormat format = i == 1 ? stats.recommended : formats[i - 2];
+            // padding beyond 4x would only measure the padding
+            double fill = format == SparseFormat::Ell ? stats.ellFill : format == SparseFormat::SellCSigma ? stats.sellFill : 1.0;
+            if (fill > 4.0 || double(matrix.nonZeros()) * fill * 4 > double(maxBinding))
+            {
+                std::cerr << names[i] << ": " << fill << "x padding, skipped" << std::endl;
+                continue;
+            }
+            GpuSparseMatrix gpuMatrix(device, queue, matrix, format);
+            auto body = [&](WGPUCommandEncoder encoder) { spmv->multiply(encoder, gpuMatrix, xBuffer, yBuffer); };
+            harness.runOnce("SpMV", body);
+            if (!matches(harness.read<float>(yBuffer, matrix.rows), expected))
+            {
+                std::cerr << names[i] << ": GPU result differs from the CPU reference, skipped" << std::endl;
+                continue;
+            }
+            harness.measureSamples(names[i], 1, [&]() { return harness.runOnce("SpMV", body); }, gpuMatrix.trafficBytes());
+        }
+
+        for (WGPUBuffer buffer : { xBuffer, yBuffer })
+        {
+            wgpuBufferRelease(buffer);
+        }
+    }
+}
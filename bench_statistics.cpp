@@ -0,0 +1,220 @@
+#include "bench_harness.h"
+#include "statistics.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Statistics of a buffer of f32 values and of one channel of an rgba8unorm
+ * frame, computed on the GPU and read back as one small result, against
+ * downloading the whole data and computing them on the CPU, which is what
+ * the GPU kernels replace. Results are checked against the CPU reference
+ * first.
+ */
+
+namespace
+{
+
+struct Source
+{
+    std::string name;
+    uint32_t width;
+    uint32_t height;        // 0 for a buffer of width values
+};
+
+// f32 accumulation order differs from the reference, values can move by one
+// bin at its edges
+bool matches(StatisticsSummary const & result, StatisticsSummary const & expected)
+{
+    double spread = std::max(std::sqrt(expected.variance), 1e-6);
+    // unorm conversions may be off by an ulp
+    float ulps = 4.0f * std::numeric_limits<float>::epsilon() * std::max(std::abs(expected.minimum), std::abs(expected.maximum));
+    if (result.count != expected.count || std::abs(result.minimum - expected.minimum) > ulps
+        || std::abs(result.maximum - expected.maximum) > ulps || result.histogram.size() != expected.histogram.size())
+    {
+        return false;
+    }
+    uint64_t moved = 0;
+    for (size_t b = 0; b < expected.histogram.size(); ++b)
+    {
+        moved += std::abs(int64_t(result.histogram[b]) - int64_t(expected.histogram[b]));
+    }
+    return std::abs(result.mean - expected.mean) <= 1e-3 * spread
+        && std::abs(result.variance - expected.variance) <= 1e-3 * expected.variance + 1e-9
+        && moved <= expected.count / 1000 + 16;
+}
+
+} // namespace
+
+void runStatisticsBenchmarks(BenchmarkHarness & harness)
+{
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+    std::mt19937 random(42);
+    Source const sources[] = {
+        { "statistics/buffer/1M", 1u << 20, 0 },
+        { "statistics/buffer/16M", 1u << 24, 0 },
+        { "statistics/frame/1920x1080", 1920, 1080 },
+        { "statistics/frame/3840x2160", 3840, 2160 },
+    };
+
+    // created once something runs, there is no device in list mode
+    std::unique_ptr<Statistics> statistics;
+    for (Source const & source : sources)
+    {
+        std::string const gpuName = source.name + "/gpu";
+        std::string const downloadName = source.name + "/download";
+        bool gpuSelected = harness.selected(gpuName);
+        bool downloadSelected = harness.selected(downloadName);
+        if (!gpuSelected && !downloadSelected)
+        {
+            continue;
+        }
+        if (!statistics)
+        {
+            statistics = std::make_unique<Statistics>(device, queue);
+        }
+
+        bool frame = source.height > 0;
+        uint32_t count = frame ? source.width * source.height : source.width;
+        std::vector<float> values(count);
+        WGPUBuffer data = nullptr;
+        WGPUTexture texture = nullptr;
+        // rgba8 rows padded to the 256 bytes copies need
+        uint32_t rowBytes = frame ? (source.width * 4 + 255) / 256 * 256 : 0;
+        uint64_t bytes = frame ? uint64_t(rowBytes) * source.height : uint64_t(count) * sizeof(float);
+        if (frame)
+        {
+            // a smooth gradient with noise, like a camera frame
+            std::vector<uint8_t> pixels(size_t(count) * 4);
+            std::uniform_int_distribution<int> noise(-24, 24);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                int base = int(255.0f * (i % source.width) / source.width);
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    pixels[size_t(i) * 4 + c] = uint8_t(std::clamp(base + noise(random), 0, 255));
+                }
+                values[i] = pixels[size_t(i) * 4] / 255.0f;
+            }
+            WGPUTextureDescriptor textureDesc = {};
+            textureDesc.nextInChain = nullptr;
+            textureDesc.label = "Statistics frame";
+            textureDesc.usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopySrc | WGPUTextureUsage_CopyDst;
+            textureDesc.dimension = WGPUTextureDimension_2D;
+            textureDesc.size = { source.width, source.height, 1 };
+            textureDesc.format = WGPUTextureFormat_RGBA8Unorm;
+            textureDesc.mipLevelCount = 1;
+            textureDesc.sampleCount = 1;
+            textureDesc.viewFormatCount = 0;
+            textureDesc.viewFormats = nullptr;
+            texture = wgpuDeviceCreateTexture(device, &textureDesc);
+
+            WGPUImageCopyTexture destination = {};
+            destination.nextInChain = nullptr;
+            destination.texture = texture;
+            destination.mipLevel = 0;
+            destination.origin = { 0, 0, 0 };
+            destination.aspect = WGPUTextureAspect_All;
+            WGPUTextureDataLayout layout = {};
+            layout.nextInChain = nullptr;
+            layout.offset = 0;
+            layout.bytesPerRow = source.width * 4;
+            layout.rowsPerImage = source.height;
+            WGPUExtent3D extent = { source.width, source.height, 1 };
+            wgpuQueueWriteTexture(queue, &destination, pixels.data(), pixels.size(), &layout, &extent);
+        }
+        else
+        {
+            std::normal_distribution<float> normal(10.0f, 3.0f);
+            for (float & value : values)
+            {
+                value = normal(random);
+            }
+            data = harness.createBuffer("Statistics data", WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst, bytes, values.data());
+        }
+        StatisticsSummary expected = cpuStatistics(values);
+
+        auto gpu = [&]() {
+            return frame ? statistics->compute(texture, 0) : statistics->compute(data, count);
+        };
+        // what monitoring did before: download everything, summarize on the CPU
+        WGPUBuffer readback = harness.createBuffer("Statistics readback", WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, bytes);
+        std::vector<float> downloaded(count);
+        auto download = [&]() {
+            harness.runOnce("Statistics download", [&](WGPUCommandEncoder encoder) {
+                if (!frame)
+                {
+                    wgpuCommandEncoderCopyBufferToBuffer(encoder, data, 0, readback, 0, bytes);
+                    return;
+                }
+                WGPUImageCopyTexture copySource = {};
+                copySource.nextInChain = nullptr;
+                copySource.texture = texture;
+                copySource.mipLevel = 0;
+                copySource.origin = { 0, 0, 0 };
+                copySource.aspect = WGPUTextureAspect_All;
+                WGPUImageCopyBuffer copyDestination = {};
+                copyDestination.nextInChain = nullptr;
+                copyDestination.buffer = readback;
+                copyDestination.layout.nextInChain = nullptr;
+                copyDestination.layout.offset = 0;
+                copyDestination.layout.bytesPerRow = rowBytes;
+                copyDestination.layout.rowsPerImage = source.height;
+                WGPUExtent3D extent = { source.width, source.height, 1 };
+                wgpuCommandEncoderCopyTextureToBuffer(encoder, &copySource, &copyDestination, &extent);
+            });
+            if (!mapBufferSync(device, readback, WGPUMapMode_Read, 0, bytes))
+            {
+                return StatisticsSummary();
+            }
+            auto const * mapped = static_cast<uint8_t const *>(wgpuBufferGetConstMappedRange(readback, 0, bytes));
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                downloaded[i] = frame
+                    ? mapped[size_t(i / source.width) * rowBytes + size_t(i % source.width) * 4] / 255.0f
+                    : reinterpret_cast<float const *>(mapped)[i];
+            }
+            wgpuBufferUnmap(readback);
+            return cpuStatistics(downloaded);
+        };
+
+        uint64_t dataBytes = frame ? uint64_t(count) * 4 : bytes;
+        if (gpuSelected)
+        {
+            if (matches(gpu(), expected))
+            {
+                harness.measure(gpuName, 1, [&]() { gpu(); }, dataBytes);
+            }
+            else
+            {
+                std::cerr << gpuName << ": GPU result differs from the CPU reference, skipped" << std::endl;
+            }
+        }
+        if (downloadSelected)
+        {
+            if (matches(download(), expected))
+            {
+                harness.measure(downloadName, 1, [&]() { download(); }, dataBytes);
+            }
+            else
+            {
+                std::cerr << downloadName << ": downloaded data differs from the CPU reference, skipped" << std::endl;
+            }
+        }
+
+        wgpuBufferRelease(readback);
+        if (data) wgpuBufferRelease(data);
+        if (texture) wgpuTextureRelease(texture);
+    }
+}
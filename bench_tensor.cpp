@@ -0,0 +1,124 @@
+#include "bench_harness.h"
+#include "tensor.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Elementwise expressions evaluated as one fused kernel against the same
+ * expression split into one kernel per operation, each writing its result
+ * to memory. Bytes per operation count the traffic of the fused version.
+ */
+
+namespace
+{
+
+bool matches(std::vector<float> const & actual, std::vector<float> const & expected)
+{
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        if (std::abs(actual[i] - expected[i]) > 1e-5f * std::max(1.0f, std::abs(expected[i])))
+        {
+            return false;
+        }
+    }
+    return actual.size() == expected.size();
+}
+
+} // namespace
+
+void runTensorBenchmarks(BenchmarkHarness & harness)
+{
+    std::mt19937 random(42);
+    std::unique_ptr<TensorContext> context;
+
+    for (uint32_t count : { 1u << 20, 1u << 24 })
+    {
+        std::string suffix = "/" + std::to_string(count);
+        std::string const names[] = {
+            "tensor/madd_fused" + suffix,
+            "tensor/madd_unfused" + suffix,
+            "tensor/chain_fused" + suffix,
+            "tensor/chain_unfused" + suffix,
+        };
+        bool selected[4];
+        std::transform(std::begin(names), std::end(names), selected, [&](std::string const & name) {
+            return harness.selected(name);
+        });
+        if (std::find(std::begin(selected), std::end(selected), true) == std::end(selected))
+        {
+            continue;
+        }
+        if (!context)
+        {
+            context = std::make_unique<TensorContext>(harness.device(), harness.queue());
+        }
+
+        std::vector<float> aValues(count);
+        std::vector<float> bValues(count);
+        std::vector<float> cValues(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            aValues[i] = static_cast<float>(random() % 2000) / 1000.0f - 1.0f;
+            bValues[i] = static_cast<float>(random() % 2000) / 1000.0f - 1.0f;
+            cValues[i] = static_cast<float>(random() % 2000) / 1000.0f - 1.0f;
+        }
+        Tensor<float> a(*context, { count }, aValues);
+        Tensor<float> b(*context, { count }, bValues);
+        Tensor<float> c(*context, { count }, cValues);
+        Tensor<float> d(*context, { count });
+        Tensor<float> t(*context, { count });
+        Tensor<float> u(*context, { count });
+
+        std::vector<float> madd(count);
+        std::vector<float> chain(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            madd[i] = aValues[i] * bValues[i] + cValues[i];
+            chain[i] = std::max((aValues[i] * 2.0f + bValues[i] * 3.0f) - cValues[i], 0.0f);
+        }
+
+        // d = a * b + c reads 3 and writes 1 array when fused, 4 and 2 in two kernels
+        auto maddFused = [&](WGPUCommandEncoder encoder) { d.assign(encoder, a * b + c); };
+        auto maddUnfused = [&](WGPUCommandEncoder encoder) {
+            t.assign(encoder, a * b);
+            d.assign(encoder, t + c);
+        };
+        // d = max(a * 2 + b * 3 - c, 0) reads 3 and writes 1 when fused, 7 and 5 in five kernels
+        auto chainFused = [&](WGPUCommandEncoder encoder) {
+            d.assign(encoder, maximum(a * 2.0f + b * 3.0f - c, 0.0f));
+        };
+        auto chainUnfused = [&](WGPUCommandEncoder encoder) {
+            t.assign(encoder, a * 2.0f);
+            u.assign(encoder, b * 3.0f);
+            t.assign(encoder, t + u);
+            t.assign(encoder, t - c);
+            d.assign(encoder, maximum(t, 0.0f));
+        };
+
+        auto measure = [&](int index, auto const & body, std::vector<float> const & expected) {
+            if (!selected[index])
+            {
+                return;
+            }
+            harness.runOnce("Tensor", body);
+            if (!matches(d.download(), expected))
+            {
+                std::cerr << names[index] << ": GPU result differs from the CPU reference, skipped" << std::endl;
+                return;
+            }
+            harness.measureSamples(names[index], 1, [&]() { return harness.runOnce("Tensor", body); }, 4 * uint64_t(count) * sizeof(float));
+        };
+        measure(0, maddFused, madd);
+        measure(1, maddUnfused, madd);
+        measure(2, chainFused, chain);
+        measure(3, chainUnfused, chain);
+    }
+}
@@ -0,0 +1,203 @@
+#include "bench_harness.h"
+#include "bind_group_layout_cache.h"
+#include "gpu_timer.h"
+#include "kernel_tuner.h"
+#include "pipeline_specialization.h"
+#include "shader_reflection.h"
+#include "tuning_cache.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * A streaming kernel with one element per thread and workgroups of 64, as
+ * the kernels of this project hardcode them, against the workgroup size and
+ * items per thread the tuner picks for this adapter, stored in tuning.cache.
+ */
+
+namespace
+{
+
+// WORKGROUP_SIZE is written into the source, naga cannot take it from an
+// override in @workgroup_size
+char const * saxpyKernel = R"(
+override ITEMS_PER_THREAD: u32 = 1;
+
+struct Params
+{
+    count: u32,
+    a: f32,
+}
+
+@group(0) @binding(0) var<storage, read> x: array<f32>;
+@group(0) @binding(1) var<storage, read_write> y: array<f32>;
+@group(0) @binding(2) var<uniform> params: Params;
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn main(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(num_workgroups) groups: vec3u,
+    @builtin(local_invocation_index) local: u32)
+{
+    // neighbouring threads touch neighbouring elements on every iteration
+    let base = (group.y * groups.x + group.x) * WORKGROUP_SIZE * ITEMS_PER_THREAD + local;
+    for (var i = 0u; i < ITEMS_PER_THREAD; i++)
+    {
+        let index = base + i * WORKGROUP_SIZE;
+        if (index < params.count)
+        {
+            y[index] = params.a * x[index] + y[index];
+        }
+    }
+}
+)";
+
+struct Params
+{
+    uint32_t count;
+    float a;
+    uint32_t padding[2];
+};
+
+void dispatch(WGPUComputePassEncoder pass, uint32_t count, KernelTuner::Configuration const & configuration)
+{
+    uint32_t perGroup = configuration.at("WORKGROUP_SIZE") * configuration.at("ITEMS_PER_THREAD");
+    uint32_t groups = (count + perGroup - 1) / perGroup;
+    uint32_t x = std::min(groups, 65535u);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, x, (groups + x - 1) / x, 1);
+}
+
+} // namespace
+
+void runTunerBenchmarks(BenchmarkHarness & harness)
+{
+    uint32_t const count = 1u << 24;
+    std::string const defaultName = "tuner/saxpy/default";
+    std::string const tunedName = "tuner/saxpy/tuned";
+    bool runDefault = harness.selected(defaultName);
+    bool runTuned = harness.selected(tunedName);
+    if (!runDefault && !runTuned)
+    {
+        return;
+    }
+    WGPUDevice device = harness.device();
+    WGPUQueue queue = harness.queue();
+
+    std::vector<ShaderBindingInfo> bindings;
+    std::string error;
+    std::string const reflected = std::string("const WORKGROUP_SIZE = 64u;\n") + saxpyKernel;
+    if (!reflectShaderBindings(reflected.c_str(), ShaderLanguage::WGSL, WGPUShaderStage_None, bindings, error))
+    {
+        std::cerr << error << std::endl;
+        return;
+    }
+    std::vector<ShaderBindingLayout> layouts;
+    for (auto const & binding : bindings)
+    {
+        layouts.push_back(binding.layout);
+    }
+    BindGroupLayoutCache layoutCache(device);
+    SpecializedPipelineCache pipelineCache(device);
+    TuningCache cache("tuning.cache", harness.adapter());
+    KernelTuner tuner(device, queue, pipelineCache, &cache);
+
+    TunableKernel kernel;
+    kernel.name = "saxpy/16M";
+    kernel.source = saxpyKernel;
+    kernel.layout = layoutCache.pipelineLayout(layouts);
+    kernel.parameters = {
+        { "WORKGROUP_SIZE", { 64, 32, 128, 256, 512, 1024 }, TunableKernel::Role::WorkgroupSizeX, true },
+        { "ITEMS_PER_THREAD", { 1, 2, 4, 8, 16 }, TunableKernel::Role::ItemsPerThread },
+    };
+
+    std::vector<float> x(count);
+    std::vector<float> y(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        x[i] = static_cast<float>(i % 1000);
+        y[i] = 1.0f;
+    }
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Saxpy x";
+    bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = uint64_t(count) * sizeof(float);
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer xBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    bufferDesc.label = "Saxpy y";
+    WGPUBuffer yBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    bufferDesc.label = "Saxpy params";
+    bufferDesc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = sizeof(Params);
+    WGPUBuffer paramBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    wgpuQueueWriteBuffer(queue, xBuffer, 0, x.data(), uint64_t(count) * sizeof(float));
+    wgpuQueueWriteBuffer(queue, yBuffer, 0, y.data(), uint64_t(count) * sizeof(float));
+    // a = 0 keeps y constant however many times the kernel runs
+    Params params = { count, 0.0f, { 0, 0 } };
+    wgpuQueueWriteBuffer(queue, paramBuffer, 0, &params, sizeof(Params));
+
+    WGPUBindGroupEntry entries[3] = {};
+    WGPUBuffer buffers[3] = { xBuffer, yBuffer, paramBuffer };
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        entries[i].nextInChain = nullptr;
+        entries[i].binding = i;
+        entries[i].buffer = buffers[i];
+        entries[i].offset = 0;
+        entries[i].size = i < 2 ? uint64_t(count) * sizeof(float) : sizeof(Params);
+    }
+    WGPUBindGroupDescriptor bindGroupDesc = {};
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label = "Saxpy";
+    bindGroupDesc.layout = layoutCache.bindGroupLayout(layouts, 0);
+    bindGroupDesc.entryCount = 3;
+    bindGroupDesc.entries = entries;
+    WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+
+    auto record = [&](WGPUComputePassEncoder pass, WGPUComputePipeline pipeline, KernelTuner::Configuration const & configuration) {
+        wgpuComputePassEncoderSetPipeline(pass, pipeline);
+        wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+        dispatch(pass, count, configuration);
+    };
+
+    GpuTimer timer(device, queue);
+    auto measure = [&](std::string const & name, KernelTuner::Configuration const & configuration) {
+        WGPUComputePipeline pipeline = tuner.pipeline(kernel, configuration);
+        harness.measureSamples(name, 1, [&]() {
+            return 1e6 * timer.timeComputePass([&](WGPUComputePassEncoder pass) {
+                record(pass, pipeline, configuration);
+            }, 1);
+        }, 3 * uint64_t(count) * sizeof(float));
+    };
+
+    if (runDefault)
+    {
+        KernelTuner::Configuration configuration;
+        for (auto const & parameter : kernel.parameters)
+        {
+            configuration[parameter.name] = parameter.values.front();
+        }
+        measure(defaultName, configuration);
+    }
+    if (runTuned)
+    {
+        // tuned once per adapter and driver, later runs reuse the cache
+        KernelTuner::Configuration configuration = tuner.isTuned(kernel)
+            ? tuner.configuration(kernel)
+            : tuner.tune(kernel, record);
+        std::cout << tunedName << ": " << KernelTuner::format(configuration) << std::endl;
+        measure(tunedName, configuration);
+    }
+
+    wgpuBindGroupRelease(bindGroup);
+    wgpuBufferRelease(paramBuffer);
+    wgpuBufferRelease(yBuffer);
+    wgpuBufferRelease(xBuffer);
+    pipelineCache.release();
+    layoutCache.release();
+}
@@ -0,0 +1,145 @@
+#include "bind_group_layout_cache.h"
+
+#include <algorithm>
+
+namespace
+{
+
+template <typename T>
+void appendKey(std::string & key, T const & value)
+{
+    key.append(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+// Serialize the meaningful fields only, so that padding never splits keys.
+std::string layoutKey(std::vector<WGPUBindGroupLayoutEntry> const & entries)
+{
+    std::string key;
+    for (auto const & entry : entries)
+    {
+        appendKey(key, entry.binding);
+        appendKey(key, entry.visibility);
+        appendKey(key, entry.buffer.type);
+        appendKey(key, entry.buffer.hasDynamicOffset);
+        appendKey(key, entry.buffer.minBindingSize);
+        appendKey(key, entry.sampler.type);
+        appendKey(key, entry.texture.sampleType);
+        appendKey(key, entry.texture.viewDimension);
+        appendKey(key, entry.texture.multisampled);
+        appendKey(key, entry.storageTexture.access);
+        appendKey(key, entry.storageTexture.format);
+        appendKey(key, entry.storageTexture.viewDimension);
+    }
+    return key;
+}
+
+} // namespace
+
+BindGroupLayoutCache::BindGroupLayoutCache(WGPUDevice device)
+    : m_device(device)
+{
+}
+
+BindGroupLayoutCache::~BindGroupLayoutCache()
+{
+    release();
+}
+
+WGPUBindGroupLayout BindGroupLayoutCache::bindGroupLayout(std::vector<WGPUBindGroupLayoutEntry> entries)
+{
+    std::sort(entries.begin(), entries.end(), [](WGPUBindGroupLayoutEntry const & a, WGPUBindGroupLayoutEntry const & b) {
+        return a.binding < b.binding;
+    });
+    std::string key = layoutKey(entries);
+    auto it = m_bindGroupLayouts.find(key);
+    if (it != m_bindGroupLayouts.end())
+    {
+        return it->second;
+    }
+
+    WGPUBindGroupLayoutDescriptor desc = {};
+    desc.nextInChain = nullptr;
+    desc.label = "Reflected bind group layout";
+    desc.entryCount = entries.size();
+    desc.entries = entries.data();
+    WGPUBindGroupLayout layout = wgpuDeviceCreateBindGroupLayout(m_device, &desc);
+    m_bindGroupLayouts.emplace(key, layout);
+    return layout;
+}
+
+WGPUBindGroupLayout BindGroupLayoutCache::bindGroupLayout(std::vector<ShaderBindingLayout> const & bindings, uint32_t group)
+{
+    std::vector<WGPUBindGroupLayoutEntry> entries;
+    for (auto const & binding : bindings)
+    {
+        if (binding.group == group)
+        {
+            entries.push_back(toBindGroupLayoutEntry(binding));
+        }
+    }
+    return bindGroupLayout(entries);
+}
+
+WGPUPipelineLayout BindGroupLayoutCache::pipelineLayout(std::vector<ShaderBindingLayout> const & bindings)
+{
+    uint32_t groupCount = 0;
+    for (auto const & binding : bindings)
+    {
+        groupCount = std::max(groupCount, binding.group + 1);
+    }
+
+    std::vector<WGPUBindGroupLayout> groups;
+    for (uint32_t group = 0; group < groupCount; ++group)
+    {
+        groups.push_back(bindGroupLayout(bindings, group));
+    }
+
+    auto it = m_pipelineLayouts.find(groups);
+    if (it != m_pipelineLayouts.end())
+    {
+        return it->second;
+    }
+
+    WGPUPipelineLayoutDescriptor desc = {};
+    desc.nextInChain = nullptr;
+    desc.label = "Reflected pipeline layout";
+    desc.bindGroupLayoutCount = groups.size();
+    desc.bindGroupLayouts = groups.data();
+    WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(m_device, &desc);
+    m_pipelineLayouts.emplace(groups, layout);
+    return layout;
+}
+
+void BindGroupLayoutCache::release()
+{
+    for (auto & entry : m_pipelineLayouts)
+    {
+        wgpuPipelineLayoutRelease(entry.second);
+    }
+    for (auto & entry : m_bindGroupLayouts)
+    {
+        wgpuBindGroupLayoutRelease(entry.second);
+    }
+    m_pipelineLayouts.clear();
+    m_bindGroupLayouts.clear();
+}
+
+void mergeShaderBindings(
+    std::vector<ShaderBindingLayout> & bindings,
+    std::vector<ShaderBindingLayout> const & added)
+{
+    for (auto const & binding : added)
+    {
+        auto it = std::find_if(bindings.begin(), bindings.end(), [&](ShaderBindingLayout const & b) {
+            return b.group == binding.group && b.binding == binding.binding;
+        });
+        if (it == bindings.end())
+        {
+            bindings.push_back(binding);
+        }
+        else
+        {
+            it->visibility |= binding.visibility;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "shader_reflection.h"
+
+#include <webgpu/webgpu.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Explicit bind group and pipeline layouts built from shader reflection and
+ * deduplicated by content, instead of one implicit "auto" layout per
+ * pipeline. Two pipelines whose reflected groups match get the very same
+ * WGPUBindGroupLayout, so a bind group created once can be set on both.
+ *
+ * The cache owns every layout it returns: callers must not release them.
+ */
+class BindGroupLayoutCache
+{
+public:
+    explicit BindGroupLayoutCache(WGPUDevice device);
+    ~BindGroupLayoutCache();
+
+    BindGroupLayoutCache(BindGroupLayoutCache const &) = delete;
+    BindGroupLayoutCache & operator=(BindGroupLayoutCache const &) = delete;
+
+    /**
+     * Layout for a set of entries, in any order.
+     */
+    WGPUBindGroupLayout bindGroupLayout(std::vector<WGPUBindGroupLayoutEntry> entries);
+
+    /**
+     * Layout of one group of the given bindings (possibly empty).
+     */
+    WGPUBindGroupLayout bindGroupLayout(std::vector<ShaderBindingLayout> const & bindings, uint32_t group);
+
+    /**
+     * Pipeline layout covering every group of the bindings; groups that no
+     * binding uses get an empty layout so that indices stay contiguous.
+     */
+    WGPUPipelineLayout pipelineLayout(std::vector<ShaderBindingLayout> const & bindings);
+
+    size_t bindGroupLayoutCount() const { return m_bindGroupLayouts.size(); }
+    size_t pipelineLayoutCount() const { return m_pipelineLayouts.size(); }
+
+    void release();
+
+private:
+    WGPUDevice m_device;
+    std::map<std::string, WGPUBindGroupLayout> m_bindGroupLayouts;
+    std::map<std::vector<WGPUBindGroupLayout>, WGPUPipelineLayout> m_pipelineLayouts;
+};
+
+/**
+ * Merge the bindings of another shader stage into a pipeline-wide list,
+ * combining the visibility of bindings declared by both.
+ */
+void mergeShaderBindings(
+    std::vector<ShaderBindingLayout> & bindings,
+    std::vector<ShaderBindingLayout> const & added);
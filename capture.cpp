@@ -0,0 +1,646 @@
+#include "capture_format.h"
+
+#include <webgpu/webgpu.h>
+#include <webgpu/wgpu.h>
+
+#include <dlfcn.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * WebGPUCapture: records the compute subset of the WebGPU API into a
+ * capture file (see capture_format.h) for the Replay tool. Like
+ * WebGPUInterpose, it is either preloaded or linked ahead of the WebGPU
+ * library; every hook forwards to the real entry point found with
+ * dlsym(RTLD_NEXT), so the two layers can be stacked.
+ *     WGPU_CAPTURE=run.wgpucap LD_PRELOAD=./libWebGPUCapture.so ./App
+ * Without WGPU_CAPTURE the hooks only forward.
+ *
+ * Buffers, shader modules (WGSL, SPIR-V, GLSL), layouts, compute pipelines,
+ * bind groups of buffers, compute passes, buffer copies and clears and
+ * submissions are recorded, along with the data written with
+ * wgpuQueueWriteBuffer or into mappings. Textures, samplers, render
+ * passes and queries are not: bind group entries using them are recorded
+ * empty and pass timestamp writes are dropped. One device is assumed.
+ */
+namespace
+{
+
+template <typename Proc>
+Proc nextEntryPoint(char const * name)
+{
+    Proc function = reinterpret_cast<Proc>(dlsym(RTLD_NEXT, name));
+    if (function == nullptr)
+    {
+        std::fprintf(stderr, "WebGPUCapture: %s is not provided by the WebGPU library\n", name);
+        std::abort();
+    }
+    return function;
+}
+
+// the real entry point, resolved at the first call of the hook
+#define NEXT(function) static auto const next = nextEntryPoint<decltype(&function)>(#function)
+
+class Capture
+{
+public:
+    static Capture & instance()
+    {
+        // never destroyed: static destructors may still call the API
+        static Capture * capture = new Capture();
+        return *capture;
+    }
+
+    bool enabled() const { return m_file != nullptr; }
+
+    /**
+     * Locks the capture so that ids are assigned in record order.
+     */
+    std::unique_lock<std::mutex> lock() { return std::unique_lock<std::mutex>(m_mutex); }
+
+    uint64_t add(void const * handle)
+    {
+        if (handle == nullptr) return 0;
+        uint64_t id = m_nextId++;
+        m_ids[handle] = id;
+        return id;
+    }
+
+    uint64_t id(void const * handle) const
+    {
+        auto found = m_ids.find(handle);
+        return found == m_ids.end() ? 0 : found->second;
+    }
+
+    void reference(void const * handle)
+    {
+        ++m_references[handle];
+    }
+
+    /**
+     * The release is only recorded with the last reference.
+     */
+    void release(void const * handle)
+    {
+        auto reference = m_references.find(handle);
+        if (reference != m_references.end())
+        {
+            if (--reference->second == 0) m_references.erase(reference);
+            return;
+        }
+        auto found = m_ids.find(handle);
+        if (found == m_ids.end())
+        {
+            return;
+        }
+        write(CaptureRecord(CaptureCommand::Release).u64(found->second));
+        m_ids.erase(found);
+        m_buffers.erase(handle);
+    }
+
+    void write(CaptureRecord const & record)
+    {
+        auto time = std::chrono::steady_clock::now() - m_start;
+        if (!record.write(m_file, std::chrono::duration_cast<std::chrono::nanoseconds>(time).count()))
+        {
+            std::fprintf(stderr, "WebGPUCapture: could not write the capture, stopping\n");
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    void flush()
+    {
+        if (m_file) std::fflush(m_file);
+    }
+
+    struct MappedRange
+    {
+        uint8_t const * data;
+        size_t offset;
+        size_t size;
+    };
+
+    struct Buffer
+    {
+        uint64_t size = 0;
+        bool writeMapping = false;  // mapped at creation or for writing
+        std::vector<MappedRange> ranges;
+    };
+
+    Buffer & buffer(WGPUBuffer handle) { return m_buffers[handle]; }
+
+    void warnOnce(char const * message)
+    {
+        if (m_warnings.emplace(message, true).second)
+        {
+            std::fprintf(stderr, "WebGPUCapture: %s\n", message);
+        }
+    }
+
+private:
+    Capture()
+        : m_start(std::chrono::steady_clock::now())
+    {
+        char const * path = std::getenv("WGPU_CAPTURE");
+        if (path == nullptr || *path == '\0')
+        {
+            return;
+        }
+        m_file = std::fopen(path, "wb");
+        if (m_file == nullptr || std::fwrite(captureMagic, sizeof(captureMagic), 1, m_file) != 1)
+        {
+            std::fprintf(stderr, "WebGPUCapture: could not create %s\n", path);
+            m_file = nullptr;
+            return;
+        }
+        std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+        std::atexit([] {
+            auto lock = Capture::instance().lock();
+            Capture::instance().flush();
+        });
+    }
+
+    std::mutex m_mutex;
+    std::FILE * m_file = nullptr;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_nextId = 1;
+    std::unordered_map<void const *, uint64_t> m_ids;
+    std::unordered_map<void const *, uint32_t> m_references;   // extra references
+    std::unordered_map<void const *, Buffer> m_buffers;
+    std::unordered_map<char const *, bool> m_warnings;
+};
+
+void recordShaderModule(Capture & capture, uint64_t id, WGPUShaderModuleDescriptor const * descriptor)
+{
+    CaptureRecord record(CaptureCommand::CreateShaderModule);
+    record.u64(id);
+    WGPUChainedStruct const * chain = descriptor ? descriptor->nextInChain : nullptr;
+    if (chain && chain->sType == WGPUSType_ShaderModuleWGSLDescriptor)
+    {
+        auto const * wgsl = reinterpret_cast<WGPUShaderModuleWGSLDescriptor const *>(chain);
+        record.u32(static_cast<uint32_t>(CaptureShaderKind::WGSL)).u32(0).string(wgsl->code).u32(0);
+    }
+    else if (chain && chain->sType == WGPUSType_ShaderModuleSPIRVDescriptor)
+    {
+        auto const * spirv = reinterpret_cast<WGPUShaderModuleSPIRVDescriptor const *>(chain);
+        record.u32(static_cast<uint32_t>(CaptureShaderKind::SPIRV)).u32(0)
+            .bytes(spirv->code, spirv->codeSize * sizeof(uint32_t)).u32(0);
+    }
+    else if (chain && chain->sType == static_cast<WGPUSType>(WGPUSType_ShaderModuleGLSLDescriptor))
+    {
+        auto const * glsl = reinterpret_cast<WGPUShaderModuleGLSLDescriptor const *>(chain);
+        record.u32(static_cast<uint32_t>(CaptureShaderKind::GLSL)).u32(glsl->stage).string(glsl->code).u32(glsl->defineCount);
+        for (uint32_t i = 0; i < glsl->defineCount; ++i)
+        {
+            record.string(glsl->defines[i].name).string(glsl->defines[i].value);
+        }
+    }
+    else
+    {
+        capture.warnOnce("shader module of unknown kind recorded empty");
+        record.u32(static_cast<uint32_t>(CaptureShaderKind::WGSL)).u32(0).string("").u32(0);
+    }
+    record.string(descriptor ? descriptor->label : nullptr);
+    capture.write(record);
+}
+
+void recordSubmit(Capture & capture, size_t commandCount, WGPUCommandBuffer const * commands)
+{
+    CaptureRecord record(CaptureCommand::Submit);
+    record.u32(static_cast<uint32_t>(commandCount));
+    for (size_t i = 0; i < commandCount; ++i)
+    {
+        record.u64(capture.id(commands[i]));
+    }
+    capture.write(record);
+    // a capture cut short by a crash still ends at a submission
+    capture.flush();
+}
+
+} // namespace
+
+extern "C" {
+
+WGPU_EXPORT void wgpuAdapterRequestDevice(WGPUAdapter adapter, WGPU_NULLABLE WGPUDeviceDescriptor const * descriptor, WGPURequestDeviceCallback callback, void * userdata)
+{
+    NEXT(wgpuAdapterRequestDevice);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        CaptureRecord record(CaptureCommand::RequestDevice);
+        size_t featureCount = descriptor ? descriptor->requiredFeatureCount : 0;
+        record.u32(static_cast<uint32_t>(featureCount));
+        for (size_t i = 0; i < featureCount; ++i)
+        {
+            record.u32(descriptor->requiredFeatures[i]);
+        }
+        bool hasLimits = descriptor && descriptor->requiredLimits;
+        record.u32(hasLimits);
+        if (hasLimits)
+        {
+            record.bytes(&descriptor->requiredLimits->limits, sizeof(WGPULimits));
+        }
+        capture.write(record);
+    }
+    next(adapter, descriptor, callback, userdata);
+}
+
+WGPU_EXPORT WGPUBuffer wgpuDeviceCreateBuffer(WGPUDevice device, WGPUBufferDescriptor const * descriptor)
+{
+    NEXT(wgpuDeviceCreateBuffer);
+    WGPUBuffer buffer = next(device, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && buffer)
+    {
+        auto lock = capture.lock();
+        uint64_t id = capture.add(buffer);
+        Capture::Buffer & state = capture.buffer(buffer);
+        state.size = descriptor->size;
+        state.writeMapping = descriptor->mappedAtCreation;
+        capture.write(CaptureRecord(CaptureCommand::CreateBuffer)
+            .u64(id).u64(descriptor->size).u32(descriptor->usage).u32(descriptor->mappedAtCreation).string(descriptor->label));
+    }
+    return buffer;
+}
+
+WGPU_EXPORT void wgpuBufferMapAsync(WGPUBuffer buffer, WGPUMapModeFlags mode, size_t offset, size_t size, WGPUBufferMapCallback callback, void * userdata)
+{
+    NEXT(wgpuBufferMapAsync);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.buffer(buffer).writeMapping = (mode & WGPUMapMode_Write) != 0;
+    }
+    next(buffer, mode, offset, size, callback, userdata);
+}
+
+WGPU_EXPORT void * wgpuBufferGetMappedRange(WGPUBuffer buffer, size_t offset, size_t size)
+{
+    NEXT(wgpuBufferGetMappedRange);
+    void * data = next(buffer, offset, size);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && data)
+    {
+        auto lock = capture.lock();
+        Capture::Buffer & state = capture.buffer(buffer);
+        if (state.writeMapping)
+        {
+            // the content is only final at unmap
+            size_t length = size == WGPU_WHOLE_MAP_SIZE ? state.size - offset : size;
+            state.ranges.push_back({ static_cast<uint8_t const *>(data), offset, length });
+        }
+    }
+    return data;
+}
+
+WGPU_EXPORT void wgpuBufferUnmap(WGPUBuffer buffer)
+{
+    NEXT(wgpuBufferUnmap);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        Capture::Buffer & state = capture.buffer(buffer);
+        uint64_t id = capture.id(buffer);
+        for (auto const & range : state.ranges)
+        {
+            capture.write(CaptureRecord(CaptureCommand::WriteBuffer)
+                .u64(id).u64(range.offset).u32(1).bytes(range.data, range.size));
+        }
+        if (state.writeMapping)
+        {
+            capture.write(CaptureRecord(CaptureCommand::UnmapBuffer).u64(id));
+        }
+        state.ranges.clear();
+        state.writeMapping = false;
+    }
+    next(buffer);
+}
+
+WGPU_EXPORT void wgpuQueueWriteBuffer(WGPUQueue queue, WGPUBuffer buffer, uint64_t bufferOffset, void const * data, size_t size)
+{
+    NEXT(wgpuQueueWriteBuffer);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::WriteBuffer)
+            .u64(capture.id(buffer)).u64(bufferOffset).u32(0).bytes(data, size));
+    }
+    next(queue, buffer, bufferOffset, data, size);
+}
+
+WGPU_EXPORT WGPUShaderModule wgpuDeviceCreateShaderModule(WGPUDevice device, WGPUShaderModuleDescriptor const * descriptor)
+{
+    NEXT(wgpuDeviceCreateShaderModule);
+    WGPUShaderModule module = next(device, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && module)
+    {
+        auto lock = capture.lock();
+        recordShaderModule(capture, capture.add(module), descriptor);
+    }
+    return module;
+}
+
+WGPU_EXPORT WGPUBindGroupLayout wgpuDeviceCreateBindGroupLayout(WGPUDevice device, WGPUBindGroupLayoutDescriptor const * descriptor)
+{
+    NEXT(wgpuDeviceCreateBindGroupLayout);
+    WGPUBindGroupLayout layout = next(device, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && layout)
+    {
+        auto lock = capture.lock();
+        CaptureRecord record(CaptureCommand::CreateBindGroupLayout);
+        record.u64(capture.add(layout)).u32(static_cast<uint32_t>(descriptor->entryCount));
+        for (size_t i = 0; i < descriptor->entryCount; ++i)
+        {
+            WGPUBindGroupLayoutEntry const & entry = descriptor->entries[i];
+            record.u32(entry.binding).u32(entry.visibility)
+                .u32(entry.buffer.type).u32(entry.buffer.hasDynamicOffset).u64(entry.buffer.minBindingSize)
+                .u32(entry.sampler.type)
+                .u32(entry.texture.sampleType).u32(entry.texture.viewDimension).u32(entry.texture.multisampled)
+                .u32(entry.storageTexture.access).u32(entry.storageTexture.format).u32(entry.storageTexture.viewDimension);
+        }
+        record.string(descriptor->label);
+        capture.write(record);
+    }
+    return layout;
+}
+
+WGPU_EXPORT WGPUPipelineLayout wgpuDeviceCreatePipelineLayout(WGPUDevice device, WGPUPipelineLayoutDescriptor const * descriptor)
+{
+    NEXT(wgpuDeviceCreatePipelineLayout);
+    WGPUPipelineLayout layout = next(device, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && layout)
+    {
+        auto lock = capture.lock();
+        CaptureRecord record(CaptureCommand::CreatePipelineLayout);
+        record.u64(capture.add(layout)).u32(static_cast<uint32_t>(descriptor->bindGroupLayoutCount));
+        for (size_t i = 0; i < descriptor->bindGroupLayoutCount; ++i)
+        {
+            record.u64(capture.id(descriptor->bindGroupLayouts[i]));
+        }
+        capture.write(record);
+    }
+    return layout;
+}
+
+WGPU_EXPORT WGPUComputePipeline wgpuDeviceCreateComputePipeline(WGPUDevice device, WGPUComputePipelineDescriptor const * descriptor)
+{
+    NEXT(wgpuDeviceCreateComputePipeline);
+    WGPUComputePipeline pipeline = next(device, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && pipeline)
+    {
+        auto lock = capture.lock();
+        CaptureRecord record(CaptureCommand::CreateComputePipeline);
+        WGPUProgrammableStageDescriptor const & stage = descriptor->compute;
+        record.u64(capture.add(pipeline)).u64(capture.id(descriptor->layout)).u64(capture.id(stage.module))
+            .string(stage.entryPoint).u32(static_cast<uint32_t>(stage.constantCount));
+        for (size_t i = 0; i < stage.constantCount; ++i)
+        {
+            record.string(stage.constants[i].key).f64(stage.constants[i].value);
+        }
+        record.string(descriptor->label);
+        capture.write(record);
+    }
+    return pipeline;
+}
+
+WGPU_EXPORT WGPUBindGroupLayout wgpuComputePipelineGetBindGroupLayout(WGPUComputePipeline computePipeline, uint32_t groupIndex)
+{
+    NEXT(wgpuComputePipelineGetBindGroupLayout);
+    WGPUBindGroupLayout layout = next(computePipeline, groupIndex);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && layout)
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::GetBindGroupLayout)
+            .u64(capture.add(layout)).u64(capture.id(computePipeline)).u32(groupIndex));
+    }
+    return layout;
+}
+
+WGPU_EXPORT WGPUBindGroup wgpuDeviceCreateBindGroup(WGPUDevice device, WGPUBindGroupDescriptor const * descriptor)
+{
+    NEXT(wgpuDeviceCreateBindGroup);
+    WGPUBindGroup bindGroup = next(device, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && bindGroup)
+    {
+        auto lock = capture.lock();
+        CaptureRecord record(CaptureCommand::CreateBindGroup);
+        record.u64(capture.add(bindGroup)).u64(capture.id(descriptor->layout)).u32(static_cast<uint32_t>(descriptor->entryCount));
+        for (size_t i = 0; i < descriptor->entryCount; ++i)
+        {
+            WGPUBindGroupEntry const & entry = descriptor->entries[i];
+            if (entry.sampler || entry.textureView)
+            {
+                capture.warnOnce("samplers and textures are not captured, their bind group entries are recorded empty");
+            }
+            record.u32(entry.binding).u64(capture.id(entry.buffer)).u64(entry.offset).u64(entry.size);
+        }
+        capture.write(record);
+    }
+    return bindGroup;
+}
+
+WGPU_EXPORT WGPUCommandEncoder wgpuDeviceCreateCommandEncoder(WGPUDevice device, WGPU_NULLABLE WGPUCommandEncoderDescriptor const * descriptor)
+{
+    NEXT(wgpuDeviceCreateCommandEncoder);
+    WGPUCommandEncoder encoder = next(device, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && encoder)
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::CreateCommandEncoder).u64(capture.add(encoder)));
+    }
+    return encoder;
+}
+
+WGPU_EXPORT WGPUComputePassEncoder wgpuCommandEncoderBeginComputePass(WGPUCommandEncoder commandEncoder, WGPU_NULLABLE WGPUComputePassDescriptor const * descriptor)
+{
+    NEXT(wgpuCommandEncoderBeginComputePass);
+    WGPUComputePassEncoder pass = next(commandEncoder, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && pass)
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::BeginComputePass).u64(capture.add(pass)).u64(capture.id(commandEncoder)));
+    }
+    return pass;
+}
+
+WGPU_EXPORT void wgpuComputePassEncoderSetPipeline(WGPUComputePassEncoder computePassEncoder, WGPUComputePipeline pipeline)
+{
+    NEXT(wgpuComputePassEncoderSetPipeline);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::SetPipeline).u64(capture.id(computePassEncoder)).u64(capture.id(pipeline)));
+    }
+    next(computePassEncoder, pipeline);
+}
+
+WGPU_EXPORT void wgpuComputePassEncoderSetBindGroup(WGPUComputePassEncoder computePassEncoder, uint32_t groupIndex, WGPU_NULLABLE WGPUBindGroup group, size_t dynamicOffsetCount, uint32_t const * dynamicOffsets)
+{
+    NEXT(wgpuComputePassEncoderSetBindGroup);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::SetBindGroup)
+            .u64(capture.id(computePassEncoder)).u32(groupIndex).u64(capture.id(group))
+            .bytes(dynamicOffsets, dynamicOffsetCount * sizeof(uint32_t)));
+    }
+    next(computePassEncoder, groupIndex, group, dynamicOffsetCount, dynamicOffsets);
+}
+
+WGPU_EXPORT void wgpuComputePassEncoderDispatchWorkgroups(WGPUComputePassEncoder computePassEncoder, uint32_t workgroupCountX, uint32_t workgroupCountY, uint32_t workgroupCountZ)
+{
+    NEXT(wgpuComputePassEncoderDispatchWorkgroups);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::DispatchWorkgroups)
+            .u64(capture.id(computePassEncoder)).u32(workgroupCountX).u32(workgroupCountY).u32(workgroupCountZ));
+    }
+    next(computePassEncoder, workgroupCountX, workgroupCountY, workgroupCountZ);
+}
+
+WGPU_EXPORT void wgpuComputePassEncoderDispatchWorkgroupsIndirect(WGPUComputePassEncoder computePassEncoder, WGPUBuffer indirectBuffer, uint64_t indirectOffset)
+{
+    NEXT(wgpuComputePassEncoderDispatchWorkgroupsIndirect);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::DispatchWorkgroupsIndirect)
+            .u64(capture.id(computePassEncoder)).u64(capture.id(indirectBuffer)).u64(indirectOffset));
+    }
+    next(computePassEncoder, indirectBuffer, indirectOffset);
+}
+
+WGPU_EXPORT void wgpuComputePassEncoderEnd(WGPUComputePassEncoder computePassEncoder)
+{
+    NEXT(wgpuComputePassEncoderEnd);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::EndComputePass).u64(capture.id(computePassEncoder)));
+    }
+    next(computePassEncoder);
+}
+
+WGPU_EXPORT void wgpuCommandEncoderCopyBufferToBuffer(WGPUCommandEncoder commandEncoder, WGPUBuffer source, uint64_t sourceOffset, WGPUBuffer destination, uint64_t destinationOffset, uint64_t size)
+{
+    NEXT(wgpuCommandEncoderCopyBufferToBuffer);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::CopyBufferToBuffer)
+            .u64(capture.id(commandEncoder)).u64(capture.id(source)).u64(sourceOffset)
+            .u64(capture.id(destination)).u64(destinationOffset).u64(size));
+    }
+    next(commandEncoder, source, sourceOffset, destination, destinationOffset, size);
+}
+
+WGPU_EXPORT void wgpuCommandEncoderClearBuffer(WGPUCommandEncoder commandEncoder, WGPUBuffer buffer, uint64_t offset, uint64_t size)
+{
+    NEXT(wgpuCommandEncoderClearBuffer);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::ClearBuffer)
+            .u64(capture.id(commandEncoder)).u64(capture.id(buffer)).u64(offset).u64(size));
+    }
+    next(commandEncoder, buffer, offset, size);
+}
+
+WGPU_EXPORT WGPUCommandBuffer wgpuCommandEncoderFinish(WGPUCommandEncoder commandEncoder, WGPU_NULLABLE WGPUCommandBufferDescriptor const * descriptor)
+{
+    NEXT(wgpuCommandEncoderFinish);
+    WGPUCommandBuffer commandBuffer = next(commandEncoder, descriptor);
+    Capture & capture = Capture::instance();
+    if (capture.enabled() && commandBuffer)
+    {
+        auto lock = capture.lock();
+        capture.write(CaptureRecord(CaptureCommand::Finish).u64(capture.add(commandBuffer)).u64(capture.id(commandEncoder)));
+    }
+    return commandBuffer;
+}
+
+WGPU_EXPORT void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, WGPUCommandBuffer const * commands)
+{
+    NEXT(wgpuQueueSubmit);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        recordSubmit(capture, commandCount, commands);
+    }
+    next(queue, commandCount, commands);
+}
+
+WGPU_EXPORT WGPUSubmissionIndex wgpuQueueSubmitForIndex(WGPUQueue queue, size_t commandCount, WGPUCommandBuffer const * commands)
+{
+    NEXT(wgpuQueueSubmitForIndex);
+    Capture & capture = Capture::instance();
+    if (capture.enabled())
+    {
+        auto lock = capture.lock();
+        recordSubmit(capture, commandCount, commands);
+    }
+    return next(queue, commandCount, commands);
+}
+
+// reference counting of the captured objects, so that the release is
+// recorded when the object actually goes away
+#define CAPTURE_REFERENCE_RELEASE(Type)                          \
+    WGPU_EXPORT void wgpu##Type##Reference(WGPU##Type object)    \
+    {                                                            \
+        NEXT(wgpu##Type##Reference);                             \
+        Capture & capture = Capture::instance();                 \
+        if (capture.enabled())                                   \
+        {                                                        \
+            auto lock = capture.lock();                          \
+            capture.reference(object);                           \
+        }                                                        \
+        next(object);                                            \
+    }                                                            \
+    WGPU_EXPORT void wgpu##Type##Release(WGPU##Type object)      \
+    {                                                            \
+        NEXT(wgpu##Type##Release);                               \
+        Capture & capture = Capture::instance();                 \
+        if (capture.enabled())                                   \
+        {                                                        \
+            auto lock = capture.lock();                          \
+            capture.release(object);                             \
+        }                                                        \
+        next(object);                                            \
+    }
+
+CAPTURE_REFERENCE_RELEASE(Buffer)
+CAPTURE_REFERENCE_RELEASE(ShaderModule)
+CAPTURE_REFERENCE_RELEASE(BindGroupLayout)
+CAPTURE_REFERENCE_RELEASE(PipelineLayout)
+CAPTURE_REFERENCE_RELEASE(ComputePipeline)
+CAPTURE_REFERENCE_RELEASE(BindGroup)
+CAPTURE_REFERENCE_RELEASE(CommandEncoder)
+CAPTURE_REFERENCE_RELEASE(ComputePassEncoder)
+CAPTURE_REFERENCE_RELEASE(CommandBuffer)
+
+} // extern "C"
@@ -0,0 +1,138 @@
+#include "capture_format.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+CaptureRecord & CaptureRecord::string(char const * value)
+{
+    return bytes(value, value ? std::strlen(value) : 0);
+}
+
+CaptureRecord & CaptureRecord::bytes(void const * data, size_t size, bool prefixed)
+{
+    if (prefixed)
+    {
+        u32(static_cast<uint32_t>(size));
+    }
+    uint8_t const * begin = static_cast<uint8_t const *>(data);
+    if (size > 0)
+    {
+        m_payload.insert(m_payload.end(), begin, begin + size);
+    }
+    return *this;
+}
+
+bool CaptureRecord::write(std::FILE * file, uint64_t timeNs) const
+{
+    uint32_t header[2] = { static_cast<uint32_t>(m_command), static_cast<uint32_t>(m_payload.size()) };
+    return std::fwrite(header, sizeof(header), 1, file) == 1
+        && std::fwrite(&timeNs, sizeof(timeNs), 1, file) == 1
+        && (m_payload.empty() || std::fwrite(m_payload.data(), m_payload.size(), 1, file) == 1);
+}
+
+bool CaptureReader::open(std::string const & path, std::string & error)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        error = "could not open " + path;
+        return false;
+    }
+    m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (m_data.size() < sizeof(captureMagic) || std::memcmp(m_data.data(), captureMagic, sizeof(captureMagic)) != 0)
+    {
+        error = path + " is not a WebGPU capture";
+        return false;
+    }
+    m_next = sizeof(captureMagic);
+    m_recordCount = 0;
+    m_ok = true;
+    return true;
+}
+
+bool CaptureReader::next()
+{
+    constexpr size_t headerSize = 2 * sizeof(uint32_t) + sizeof(uint64_t);
+    if (!m_ok || m_next + headerSize > m_data.size())
+    {
+        // a capture cut short by a crash ends at its last whole record
+        return false;
+    }
+    uint32_t header[2];
+    std::memcpy(header, m_data.data() + m_next, sizeof(header));
+    std::memcpy(&m_timeNs, m_data.data() + m_next + sizeof(header), sizeof(m_timeNs));
+    if (m_next + headerSize + header[1] > m_data.size())
+    {
+        return false;
+    }
+    m_command = static_cast<CaptureCommand>(header[0]);
+    m_cursor = m_next + headerSize;
+    m_end = m_cursor + header[1];
+    m_next = m_end;
+    ++m_recordCount;
+    return true;
+}
+
+void CaptureReader::read(void * data, size_t size)
+{
+    if (!m_ok || m_cursor + size > m_end)
+    {
+        m_ok = false;
+        std::memset(data, 0, size);
+        return;
+    }
+    std::memcpy(data, m_data.data() + m_cursor, size);
+    m_cursor += size;
+}
+
+uint32_t CaptureReader::u32()
+{
+    uint32_t value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+uint64_t CaptureReader::u64()
+{
+    uint64_t value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+double CaptureReader::f64()
+{
+    double value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+uint32_t CaptureReader::count(size_t elementSize)
+{
+    uint32_t value = u32();
+    if (!m_ok || uint64_t(value) * elementSize > m_end - m_cursor)
+    {
+        m_ok = false;
+        return 0;
+    }
+    return value;
+}
+
+std::string CaptureReader::string()
+{
+    std::vector<uint8_t> data = bytes();
+    return std::string(data.begin(), data.end());
+}
+
+std::vector<uint8_t> CaptureReader::bytes()
+{
+    uint32_t size = u32();
+    if (!m_ok || m_cursor + size > m_end)
+    {
+        m_ok = false;
+        return {};
+    }
+    std::vector<uint8_t> data(m_data.begin() + m_cursor, m_data.begin() + m_cursor + size);
+    m_cursor += size;
+    return data;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * Binary command stream recorded by the WebGPUCapture library and played
+ * back by Replay. A capture is the 8-byte magic followed by records:
+ *     uint32 command, uint32 payload size, uint64 time (ns since start), payload
+ * Integers, like the buffer contents, SPIR-V words and structs recorded as
+ * bytes, are in the byte order of the captured host, so captures replay on
+ * hosts of the same endianness. Strings and byte arrays are prefixed by
+ * their uint32 size. Objects are referred to by ids assigned at capture, 0
+ * being null, so that a capture is independent of the handles of the
+ * process.
+ */
+constexpr char captureMagic[8] = { 'W', 'G', 'P', 'U', 'C', 'A', 'P', '1' };
+
+enum class CaptureCommand : uint32_t
+{
+    RequestDevice = 1,          // feature count, features, has limits, WGPULimits
+    CreateBuffer,               // buffer, size, usage, mappedAtCreation, label
+    WriteBuffer,                // buffer, offset, mapped, bytes (queue writes, or writes to a mapping)
+    UnmapBuffer,                // buffer, after the writes to its mapping
+    CreateShaderModule,         // module, kind, stage, code, define count, (name, value)..., label
+    CreateBindGroupLayout,      // layout, entry count, entries, label
+    CreatePipelineLayout,       // layout, bind group layout count, layouts
+    CreateComputePipeline,      // pipeline, layout (0 for auto), module, entry point, constant count, (key, value)..., label
+    GetBindGroupLayout,         // layout, pipeline, group index
+    CreateBindGroup,            // bind group, layout, entry count, (binding, buffer, offset, size)...
+    CreateCommandEncoder,       // encoder
+    BeginComputePass,           // pass, encoder
+    SetPipeline,                // pass, pipeline
+    SetBindGroup,               // pass, group index, bind group, dynamic offset count, offsets
+    DispatchWorkgroups,         // pass, x, y, z
+    DispatchWorkgroupsIndirect, // pass, buffer, offset
+    EndComputePass,             // pass
+    CopyBufferToBuffer,         // encoder, source, source offset, destination, destination offset, size
+    ClearBuffer,                // encoder, buffer, offset, size
+    Finish,                     // command buffer, encoder
+    Submit,                     // command buffer count, command buffers
+    Release,                    // object
+};
+
+enum class CaptureShaderKind : uint32_t
+{
+    WGSL = 0,
+    SPIRV = 1,
+    GLSL = 2,
+};
+
+/**
+ * Accumulates the payload of one record, then appends it to a file.
+ */
+class CaptureRecord
+{
+public:
+    explicit CaptureRecord(CaptureCommand command) : m_command(command) {}
+
+    CaptureRecord & u32(uint32_t value) { return bytes(&value, sizeof(value), false); }
+    CaptureRecord & u64(uint64_t value) { return bytes(&value, sizeof(value), false); }
+    CaptureRecord & f64(double value) { return bytes(&value, sizeof(value), false); }
+    CaptureRecord & string(char const * value);
+    CaptureRecord & bytes(void const * data, size_t size, bool prefixed = true);
+
+    /**
+     * Not thread-safe, the capture serializes the writes.
+     */
+    bool write(std::FILE * file, uint64_t timeNs) const;
+
+private:
+    CaptureCommand m_command;
+    std::vector<uint8_t> m_payload;
+};
+
+/**
+ * Reads a whole capture and walks its records. Reads past the end of a
+ * payload fail the reader rather than the process.
+ */
+class CaptureReader
+{
+public:
+    bool open(std::string const & path, std::string & error);
+
+    /**
+     * Move to the next record, false at the end of the capture.
+     */
+    bool next();
+    CaptureCommand command() const { return m_command; }
+    uint64_t timeNs() const { return m_timeNs; }
+
+    uint32_t u32();
+    uint64_t u64();
+    double f64();
+    std::string string();
+    std::vector<uint8_t> bytes();
+    void read(void * data, size_t size);
+
+    /**
+     * Element count of an array whose elements take at least `elementSize`
+     * bytes of payload; a count that the rest of the payload cannot hold
+     * fails the reader and returns 0, so that it never sizes an allocation.
+     */
+    uint32_t count(size_t elementSize);
+
+    /**
+     * False once a record was truncated or read past its end.
+     */
+    bool ok() const { return m_ok; }
+    size_t recordCount() const { return m_recordCount; }
+
+private:
+    std::vector<uint8_t> m_data;
+    size_t m_next = 0;          // offset of the next record
+    size_t m_cursor = 0;        // read offset in the current payload
+    size_t m_end = 0;           // end of the current payload
+    CaptureCommand m_command = CaptureCommand::Release;
+    uint64_t m_timeNs = 0;
+    size_t m_recordCount = 0;
+    bool m_ok = true;
+};
@@ -0,0 +1,528 @@
+#include "compute_backend.h"
+#include "logger.h"
+#include "thread_pool.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COMPUTE_BACKEND_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define COMPUTE_BACKEND_NEON
+#endif
+
+namespace
+{
+
+using Scalar = ComputeBackend::Scalar;
+using ReduceOp = ComputeBackend::ReduceOp;
+
+// elements per block: large enough to amortize a task, small enough to
+// balance the threads and to stay in L2
+constexpr size_t blockSize = 1 << 16;
+
+size_t blockCount(size_t count)
+{
+    return (count + blockSize - 1) / blockSize;
+}
+
+template <typename T>
+T identity(ReduceOp op)
+{
+    switch (op)
+    {
+    case ReduceOp::Min: return std::numeric_limits<T>::max();
+    case ReduceOp::Max: return std::numeric_limits<T>::lowest();
+    default: return T(0);
+    }
+}
+
+template <typename T>
+T combine(T a, T b, ReduceOp op)
+{
+    switch (op)
+    {
+    case ReduceOp::Min: return std::min(a, b);
+    case ReduceOp::Max: return std::max(a, b);
+    default: return a + b;
+    }
+}
+
+// four independent accumulators let the compiler vectorize and hide the
+// latency of the additions
+template <typename T>
+T scalarReduce(T const * values, size_t count, ReduceOp op)
+{
+    T accumulators[4] = { identity<T>(op), identity<T>(op), identity<T>(op), identity<T>(op) };
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        for (size_t lane = 0; lane < 4; ++lane)
+        {
+            accumulators[lane] = combine(accumulators[lane], values[i + lane], op);
+        }
+    }
+    for (; i < count; ++i)
+    {
+        accumulators[0] = combine(accumulators[0], values[i], op);
+    }
+    return combine(combine(accumulators[0], accumulators[1], op), combine(accumulators[2], accumulators[3], op), op);
+}
+
+uint32_t reduceBlock(uint32_t const * values, size_t count, ReduceOp op)
+{
+    if (op != ReduceOp::Sum)
+    {
+        return scalarReduce(values, count, op);
+    }
+    uint32_t lanes[4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+#if defined(COMPUTE_BACKEND_SSE2)
+    __m128i sum = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4)
+    {
+        sum = _mm_add_epi32(sum, _mm_loadu_si128(reinterpret_cast<__m128i const *>(values + i)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sum);
+#elif defined(COMPUTE_BACKEND_NEON)
+    uint32x4_t sum = vdupq_n_u32(0);
+    for (; i + 4 <= count; i += 4)
+    {
+        sum = vaddq_u32(sum, vld1q_u32(values + i));
+    }
+    vst1q_u32(lanes, sum);
+#endif
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + scalarReduce(values + i, count - i, op);
+}
+
+int32_t reduceBlock(int32_t const * values, size_t count, ReduceOp op)
+{
+    if (op != ReduceOp::Sum)
+    {
+        return scalarReduce(values, count, op);
+    }
+    // two's complement sums wrap like the GPU ones
+    return static_cast<int32_t>(reduceBlock(reinterpret_cast<uint32_t const *>(values), count, op));
+}
+
+float reduceBlock(float const * values, size_t count, ReduceOp op)
+{
+    float lanes[4] = { identity<float>(op), identity<float>(op), identity<float>(op), identity<float>(op) };
+    size_t i = 0;
+#if defined(COMPUTE_BACKEND_SSE2)
+    __m128 accumulator = _mm_loadu_ps(lanes);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 loaded = _mm_loadu_ps(values + i);
+        accumulator = op == ReduceOp::Sum ? _mm_add_ps(accumulator, loaded)
+            : op == ReduceOp::Min ? _mm_min_ps(accumulator, loaded)
+            : _mm_max_ps(accumulator, loaded);
+    }
+    _mm_storeu_ps(lanes, accumulator);
+#elif defined(COMPUTE_BACKEND_NEON)
+    float32x4_t accumulator = vld1q_f32(lanes);
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t loaded = vld1q_f32(values + i);
+        accumulator = op == ReduceOp::Sum ? vaddq_f32(accumulator, loaded)
+            : op == ReduceOp::Min ? vminq_f32(accumulator, loaded)
+            : vmaxq_f32(accumulator, loaded);
+    }
+    vst1q_f32(lanes, accumulator);
+#endif
+    float result = scalarReduce(values + i, count - i, op);
+    for (float lane : lanes)
+    {
+        result = combine(result, lane, op);
+    }
+    return result;
+}
+
+// fixed blocks combined in order: f32 results do not depend on the number
+// of threads
+template <typename T>
+T parallelReduce(ThreadPool & pool, T const * values, size_t count, ReduceOp op)
+{
+    std::vector<T> partials(blockCount(count));
+    pool.parallelFor(partials.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block)
+        {
+            size_t first = block * blockSize;
+            partials[block] = reduceBlock(values + first, std::min(blockSize, count - first), op);
+        }
+    });
+    T result = identity<T>(op);
+    for (T partial : partials)
+    {
+        result = combine(result, partial, op);
+    }
+    return result;
+}
+
+// block sums, their exclusive scan, then every block scanned from its offset
+template <typename T>
+void parallelScan(ThreadPool & pool, T const * input, T * output, size_t count, bool exclusive)
+{
+    std::vector<T> offsets(blockCount(count));
+    pool.parallelFor(offsets.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block)
+        {
+            size_t first = block * blockSize;
+            offsets[block] = reduceBlock(input + first, std::min(blockSize, count - first), ReduceOp::Sum);
+        }
+    });
+    T sum = T(0);
+    for (T & offset : offsets)
+    {
+        T blockSum = offset;
+        offset = sum;
+        sum += blockSum;
+    }
+    pool.parallelFor(offsets.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block)
+        {
+            size_t first = block * blockSize;
+            size_t last = std::min(first + blockSize, count);
+            T running = offsets[block];
+            for (size_t i = first; i < last; ++i)
+            {
+                // read first, input and output may be the same array
+                T value = input[i];
+                output[i] = exclusive ? running : running + value;
+                running += value;
+            }
+        }
+    });
+}
+
+void scan(ThreadPool & pool, void const * input, void * output, uint32_t count, Scalar type, bool exclusive)
+{
+    switch (type)
+    {
+    case Scalar::F32:
+        parallelScan(pool, static_cast<float const *>(input), static_cast<float *>(output), count, exclusive);
+        break;
+    default:
+        // i32 too: two's complement sums wrap like the GPU ones, signed
+        // overflow would be undefined
+        parallelScan(pool, static_cast<uint32_t const *>(input), static_cast<uint32_t *>(output), count, exclusive);
+        break;
+    }
+}
+
+WGPUCommandEncoder createEncoder(WGPUDevice device)
+{
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = "Compute backend";
+    return wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+}
+
+void submit(WGPUQueue queue, WGPUCommandEncoder encoder)
+{
+    WGPUCommandBufferDescriptor cmdBufferDesc = {};
+    cmdBufferDesc.nextInChain = nullptr;
+    cmdBufferDesc.label = nullptr;
+    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
+    wgpuQueueSubmit(queue, 1, &command);
+    wgpuCommandBufferRelease(command);
+}
+
+} // namespace
+
+CpuComputeBackend::CpuComputeBackend(ThreadPool * pool)
+    : m_pool(pool ? *pool : ThreadPool::shared())
+{}
+
+void CpuComputeBackend::reduce(void const * input, uint32_t count, void * output, Scalar type, ReduceOp op)
+{
+    switch (type)
+    {
+    case Scalar::I32:
+        *static_cast<int32_t *>(output) = parallelReduce(m_pool, static_cast<int32_t const *>(input), count, op);
+        break;
+    case Scalar::F32:
+        *static_cast<float *>(output) = parallelReduce(m_pool, static_cast<float const *>(input), count, op);
+        break;
+    default:
+        *static_cast<uint32_t *>(output) = parallelReduce(m_pool, static_cast<uint32_t const *>(input), count, op);
+        break;
+    }
+}
+
+void CpuComputeBackend::inclusiveScan(void const * input, void * output, uint32_t count, Scalar type)
+{
+    scan(m_pool, input, output, count, type, false);
+}
+
+void CpuComputeBackend::exclusiveScan(void const * input, void * output, uint32_t count, Scalar type)
+{
+    scan(m_pool, input, output, count, type, true);
+}
+
+uint32_t CpuComputeBackend::compact(uint32_t const * input, uint32_t const * flags, uint32_t count, uint32_t * output)
+{
+    std::vector<uint32_t> offsets(blockCount(count));
+    m_pool.parallelFor(offsets.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block)
+        {
+            size_t first = block * blockSize;
+            size_t last = std::min<size_t>(first + blockSize, count);
+            uint32_t kept = 0;
+            for (size_t i = first; i < last; ++i)
+            {
+                kept += flags[i] != 0 ? 1 : 0;
+            }
+            offsets[block] = kept;
+        }
+    });
+    uint32_t total = 0;
+    for (uint32_t & offset : offsets)
+    {
+        uint32_t kept = offset;
+        offset = total;
+        total += kept;
+    }
+    m_pool.parallelFor(offsets.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block)
+        {
+            size_t first = block * blockSize;
+            size_t last = std::min<size_t>(first + blockSize, count);
+            uint32_t * cursor = output + offsets[block];
+            for (size_t i = first; i < last; ++i)
+            {
+                if (flags[i] != 0) *cursor++ = input[i];
+            }
+        }
+    });
+    return total;
+}
+
+void CpuComputeBackend::radixSort(uint32_t * keys, uint32_t count, uint32_t * values)
+{
+    // 8 bits per pass, every block histograms and scatters its own elements;
+    // digit-major then block-major offsets keep the sort stable
+    constexpr size_t radix = 256;
+    size_t blocks = blockCount(count);
+    std::vector<uint32_t> keyScratch(count);
+    std::vector<uint32_t> valueScratch(values ? count : 0);
+    std::vector<uint32_t> offsets(blocks * radix);
+    uint32_t * sourceKeys = keys;
+    uint32_t * sourceValues = values;
+    uint32_t * targetKeys = keyScratch.data();
+    uint32_t * targetValues = valueScratch.data();
+
+    for (uint32_t shift = 0; shift < 32; shift += 8)
+    {
+        m_pool.parallelFor(blocks, 1, [&](size_t begin, size_t end) {
+            for (size_t block = begin; block < end; ++block)
+            {
+                uint32_t * histogram = &offsets[block * radix];
+                std::fill(histogram, histogram + radix, 0u);
+                size_t last = std::min<size_t>((block + 1) * blockSize, count);
+                for (size_t i = block * blockSize; i < last; ++i)
+                {
+                    ++histogram[(sourceKeys[i] >> shift) & 0xff];
+                }
+            }
+        });
+
+        uint32_t total = 0;
+        bool trivial = false;
+        for (size_t digit = 0; digit < radix; ++digit)
+        {
+            uint32_t digitStart = total;
+            for (size_t block = 0; block < blocks; ++block)
+            {
+                uint32_t kept = offsets[block * radix + digit];
+                offsets[block * radix + digit] = total;
+                total += kept;
+            }
+            // every key has this digit, the pass would not move anything
+            trivial = trivial || (total - digitStart == count && count > 0);
+        }
+        if (trivial)
+        {
+            continue;
+        }
+
+        m_pool.parallelFor(blocks, 1, [&](size_t begin, size_t end) {
+            for (size_t block = begin; block < end; ++block)
+            {
+                uint32_t * cursor = &offsets[block * radix];
+                size_t last = std::min<size_t>((block + 1) * blockSize, count);
+                for (size_t i = block * blockSize; i < last; ++i)
+                {
+                    uint32_t target = cursor[(sourceKeys[i] >> shift) & 0xff]++;
+                    targetKeys[target] = sourceKeys[i];
+                    if (values) targetValues[target] = sourceValues[i];
+                }
+            }
+        });
+        std::swap(sourceKeys, targetKeys);
+        std::swap(sourceValues, targetValues);
+    }
+
+    if (sourceKeys != keys)
+    {
+        std::memcpy(keys, sourceKeys, size_t(count) * 4);
+        if (values) std::memcpy(values, sourceValues, size_t(count) * 4);
+    }
+}
+
+GpuComputeBackend::GpuComputeBackend(WGPUDevice device, WGPUQueue queue)
+    : m_device(device)
+    , m_queue(queue)
+    , m_primitives(device)
+{}
+
+GpuComputeBackend::~GpuComputeBackend()
+{
+    m_primitives.release();
+}
+
+WGPUBuffer GpuComputeBackend::upload(void const * data, uint32_t count)
+{
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Compute backend data";
+    bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = std::max<uint64_t>(uint64_t(count) * 4, 16);
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    if (data && count > 0)
+    {
+        wgpuQueueWriteBuffer(m_queue, buffer, 0, data, uint64_t(count) * 4);
+    }
+    return buffer;
+}
+
+void GpuComputeBackend::download(WGPUBuffer buffer, void * data, uint32_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    uint64_t size = uint64_t(count) * 4;
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Compute backend readback";
+    bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = size;
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer readback = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    WGPUCommandEncoder encoder = createEncoder(m_device);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, buffer, 0, readback, 0, size);
+    submit(m_queue, encoder);
+    if (mapBufferSync(m_device, readback, WGPUMapMode_Read, 0, size))
+    {
+        std::memcpy(data, wgpuBufferGetConstMappedRange(readback, 0, size), size);
+        wgpuBufferUnmap(readback);
+    }
+    else
+    {
+        logError() << "Compute backend: could not read back " << size << " bytes";
+    }
+    wgpuBufferRelease(readback);
+}
+
+void GpuComputeBackend::reduce(void const * input, uint32_t count, void * output, Scalar type, ReduceOp op)
+{
+    WGPUBuffer inputBuffer = upload(input, count);
+    WGPUBuffer outputBuffer = upload(nullptr, 1);
+    WGPUCommandEncoder encoder = createEncoder(m_device);
+    m_primitives.reduce(encoder, inputBuffer, count, outputBuffer, type, op);
+    submit(m_queue, encoder);
+    download(outputBuffer, output, 1);
+    wgpuBufferRelease(outputBuffer);
+    wgpuBufferRelease(inputBuffer);
+}
+
+void GpuComputeBackend::inclusiveScan(void const * input, void * output, uint32_t count, Scalar type)
+{
+    WGPUBuffer inputBuffer = upload(input, count);
+    WGPUBuffer outputBuffer = upload(nullptr, count);
+    WGPUCommandEncoder encoder = createEncoder(m_device);
+    m_primitives.inclusiveScan(encoder, inputBuffer, outputBuffer, count, type);
+    submit(m_queue, encoder);
+    download(outputBuffer, output, count);
+    wgpuBufferRelease(outputBuffer);
+    wgpuBufferRelease(inputBuffer);
+}
+
+void GpuComputeBackend::exclusiveScan(void const * input, void * output, uint32_t count, Scalar type)
+{
+    WGPUBuffer inputBuffer = upload(input, count);
+    WGPUBuffer outputBuffer = upload(nullptr, count);
+    WGPUCommandEncoder encoder = createEncoder(m_device);
+    m_primitives.exclusiveScan(encoder, inputBuffer, outputBuffer, count, type);
+    submit(m_queue, encoder);
+    download(outputBuffer, output, count);
+    wgpuBufferRelease(outputBuffer);
+    wgpuBufferRelease(inputBuffer);
+}
+
+uint32_t GpuComputeBackend::compact(uint32_t const * input, uint32_t const * flags, uint32_t count, uint32_t * output)
+{
+    // the primitive scans the flags as 0/1 values, any other non-zero flag
+    // would throw the output offsets off
+    std::vector<uint32_t> keep(count);
+    std::transform(flags, flags + count, keep.begin(), [](uint32_t flag) { return flag != 0 ? 1u : 0u; });
+    WGPUBuffer inputBuffer = upload(input, count);
+    WGPUBuffer flagBuffer = upload(keep.data(), count);
+    WGPUBuffer outputBuffer = upload(nullptr, count);
+    WGPUBuffer countBuffer = upload(nullptr, 1);
+    WGPUCommandEncoder encoder = createEncoder(m_device);
+    m_primitives.compact(encoder, inputBuffer, flagBuffer, count, outputBuffer, countBuffer);
+    submit(m_queue, encoder);
+    uint32_t kept = 0;
+    download(countBuffer, &kept, 1);
+    download(outputBuffer, output, std::min(kept, count));
+    for (WGPUBuffer buffer : { inputBuffer, flagBuffer, outputBuffer, countBuffer })
+    {
+        wgpuBufferRelease(buffer);
+    }
+    return kept;
+}
+
+void GpuComputeBackend::radixSort(uint32_t * keys, uint32_t count, uint32_t * values)
+{
+    WGPUBuffer keyBuffer = upload(keys, count);
+    WGPUBuffer valueBuffer = values ? upload(values, count) : nullptr;
+    WGPUCommandEncoder encoder = createEncoder(m_device);
+    m_primitives.radixSort(encoder, keyBuffer, count, valueBuffer);
+    submit(m_queue, encoder);
+    download(keyBuffer, keys, count);
+    wgpuBufferRelease(keyBuffer);
+    if (valueBuffer)
+    {
+        download(valueBuffer, values, count);
+        wgpuBufferRelease(valueBuffer);
+    }
+}
+
+std::unique_ptr<ComputeBackend> createComputeBackend(WGPUAdapter adapter, WGPUDevice device, WGPUQueue queue, bool allowSoftware)
+{
+    if (adapter == nullptr || device == nullptr || queue == nullptr)
+    {
+        logWarn() << "No WebGPU device, compute primitives run on the CPU";
+        return std::make_unique<CpuComputeBackend>();
+    }
+    WGPUAdapterProperties properties = {};
+    properties.nextInChain = nullptr;
+    wgpuAdapterGetProperties(adapter, &properties);
+    if (properties.adapterType == WGPUAdapterType_CPU && !allowSoftware)
+    {
+        logInfo() << "Software adapter " << (properties.name ? properties.name : "") << ", compute primitives run on the CPU";
+        return std::make_unique<CpuComputeBackend>();
+    }
+    return std::make_unique<GpuComputeBackend>(device, queue);
+}
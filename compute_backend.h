@@ -0,0 +1,116 @@
+#pragma once
+
+#include "gpu_primitives.h"
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <memory>
+
+class ThreadPool;
+
+/**
+ * The compute primitives on host memory, run either on the GPU or on the
+ * CPU, so that jobs keep running on hosts without a usable adapter:
+ *     std::unique_ptr<ComputeBackend> backend = createComputeBackend(adapter, device, queue);
+ *     backend->exclusiveScan(input.data(), output.data(), count, ComputeBackend::Scalar::U32);
+ *
+ * Both backends give the results of the GpuPrimitives calls of the same
+ * name, bit for bit except for f32 sums, whose rounding depends on the
+ * order of the additions. The CPU one is also the reference the GPU results
+ * are checked against. Elements are 32-bit, of the given scalar type.
+ */
+class ComputeBackend
+{
+public:
+    using Scalar = GpuPrimitives::Scalar;
+    using ReduceOp = GpuPrimitives::ReduceOp;
+
+    virtual ~ComputeBackend() = default;
+
+    virtual char const * name() const = 0;
+
+    /**
+     * Combine the `count` elements of input into *output.
+     */
+    virtual void reduce(void const * input, uint32_t count, void * output, Scalar type, ReduceOp op) = 0;
+
+    virtual void inclusiveScan(void const * input, void * output, uint32_t count, Scalar type) = 0;
+    virtual void exclusiveScan(void const * input, void * output, uint32_t count, Scalar type) = 0;
+
+    /**
+     * Copy the elements whose flag is not 0 to the front of output, in
+     * order, and return their number.
+     */
+    virtual uint32_t compact(uint32_t const * input, uint32_t const * flags, uint32_t count, uint32_t * output) = 0;
+
+    /**
+     * Stable ascending sort of the keys in place, moving the values along
+     * if not null.
+     */
+    virtual void radixSort(uint32_t * keys, uint32_t count, uint32_t * values = nullptr) = 0;
+};
+
+/**
+ * Primitives on the CPU, blocks of elements spread over a work-stealing
+ * thread pool, vectorized with SSE2 or NEON where available.
+ */
+class CpuComputeBackend : public ComputeBackend
+{
+public:
+    /**
+     * Runs on the shared pool if none is given.
+     */
+    explicit CpuComputeBackend(ThreadPool * pool = nullptr);
+
+    char const * name() const override { return "cpu"; }
+    void reduce(void const * input, uint32_t count, void * output, Scalar type, ReduceOp op) override;
+    void inclusiveScan(void const * input, void * output, uint32_t count, Scalar type) override;
+    void exclusiveScan(void const * input, void * output, uint32_t count, Scalar type) override;
+    uint32_t compact(uint32_t const * input, uint32_t const * flags, uint32_t count, uint32_t * output) override;
+    void radixSort(uint32_t * keys, uint32_t count, uint32_t * values = nullptr) override;
+
+private:
+    ThreadPool & m_pool;
+};
+
+/**
+ * Primitives on the GPU through GpuPrimitives, with the upload and the
+ * readback of the data in every call: worth it for large inputs, or to
+ * check the GPU against the CPU.
+ */
+class GpuComputeBackend : public ComputeBackend
+{
+public:
+    GpuComputeBackend(WGPUDevice device, WGPUQueue queue);
+    ~GpuComputeBackend() override;
+
+    GpuComputeBackend(GpuComputeBackend const &) = delete;
+    GpuComputeBackend & operator=(GpuComputeBackend const &) = delete;
+
+    char const * name() const override { return "gpu"; }
+    void reduce(void const * input, uint32_t count, void * output, Scalar type, ReduceOp op) override;
+    void inclusiveScan(void const * input, void * output, uint32_t count, Scalar type) override;
+    void exclusiveScan(void const * input, void * output, uint32_t count, Scalar type) override;
+    uint32_t compact(uint32_t const * input, uint32_t const * flags, uint32_t count, uint32_t * output) override;
+    void radixSort(uint32_t * keys, uint32_t count, uint32_t * values = nullptr) override;
+
+private:
+    WGPUBuffer upload(void const * data, uint32_t count);
+    void download(WGPUBuffer buffer, void * data, uint32_t count);
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    GpuPrimitives m_primitives;
+};
+
+/**
+ * GPU backend when given a hardware device, CPU backend when the adapter or
+ * the device is null, or when the adapter is a software rasterizer, which
+ * is slower than the CPU backend itself unless `allowSoftware` is set.
+ */
+std::unique_ptr<ComputeBackend> createComputeBackend(
+    WGPUAdapter adapter,
+    WGPUDevice device,
+    WGPUQueue queue,
+    bool allowSoftware = false);
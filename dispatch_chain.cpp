@@ -0,0 +1,229 @@
+#include "dispatch_chain.h"
+#include "utility.h"
+
+#include <cstring>
+
+namespace
+{
+
+// arguments and params of each counted stage, at the offset alignment
+constexpr uint64_t slotStride = 256;
+
+struct ArgumentParams
+{
+    uint32_t countIndex;
+    uint32_t itemsPerWorkgroup;
+    uint32_t maxGroupsPerDimension;
+    uint32_t padding;
+};
+
+char const * argumentSource = R"(
+struct Params
+{
+    countIndex: u32,
+    itemsPerWorkgroup: u32,
+    maxGroupsPerDimension: u32,
+    padding: u32,
+}
+
+@group(0) @binding(0) var<storage, read> counts: array<u32>;
+@group(0) @binding(1) var<storage, read_write> arguments: array<u32, 3>;
+@group(0) @binding(2) var<uniform> params: Params;
+
+@compute @workgroup_size(1)
+fn main()
+{
+    // no overflow near 2^32 items
+    let count = counts[params.countIndex];
+    let groups = count / params.itemsPerWorkgroup + select(0u, 1u, count % params.itemsPerWorkgroup != 0u);
+    let x = min(groups, params.maxGroupsPerDimension);
+    arguments[0] = x;
+    arguments[1] = select(1u, (groups + x - 1u) / x, x > 0u);
+    arguments[2] = 1u;
+}
+)";
+
+} // namespace
+
+DispatchChain::DispatchChain(WGPUDevice device)
+    : m_device(device)
+{
+    WGPUSupportedLimits supported = {};
+    supported.nextInChain = nullptr;
+    wgpuDeviceGetLimits(device, &supported);
+    m_maxGroupsPerDimension = supported.limits.maxComputeWorkgroupsPerDimension;
+}
+
+DispatchChain::~DispatchChain()
+{
+    release();
+}
+
+void DispatchChain::release()
+{
+    m_stages.clear();
+    if (m_argumentPipeline)
+    {
+        wgpuComputePipelineRelease(m_argumentPipeline);
+        m_argumentPipeline = nullptr;
+    }
+}
+
+DispatchChain & DispatchChain::dispatch(WGPUComputePipeline pipeline, std::vector<WGPUBindGroup> bindGroups, uint32_t x, uint32_t y, uint32_t z)
+{
+    m_stages.push_back({ pipeline, std::move(bindGroups), { x, y, z }, nullptr, 0, 0 });
+    return *this;
+}
+
+DispatchChain & DispatchChain::dispatchIndirect(WGPUComputePipeline pipeline, std::vector<WGPUBindGroup> bindGroups, WGPUBuffer arguments, uint64_t offset)
+{
+    m_stages.push_back({ pipeline, std::move(bindGroups), { 0, 0, 0 }, arguments, offset, 0 });
+    return *this;
+}
+
+DispatchChain & DispatchChain::dispatchForCount(
+    WGPUComputePipeline pipeline,
+    std::vector<WGPUBindGroup> bindGroups,
+    WGPUBuffer count,
+    uint64_t countOffset,
+    uint32_t itemsPerWorkgroup)
+{
+    m_stages.push_back({ pipeline, std::move(bindGroups), { 0, 0, 0 }, count, countOffset, itemsPerWorkgroup > 0 ? itemsPerWorkgroup : 1 });
+    return *this;
+}
+
+WGPUComputePipeline DispatchChain::argumentPipeline()
+{
+    if (m_argumentPipeline == nullptr)
+    {
+        WGPUShaderModule module = createShaderModule(m_device, argumentSource, "Dispatch arguments");
+        WGPUComputePipelineDescriptor pipelineDesc = {};
+        pipelineDesc.nextInChain = nullptr;
+        pipelineDesc.label = "Dispatch arguments";
+        pipelineDesc.layout = nullptr;
+        pipelineDesc.compute.module = module;
+        pipelineDesc.compute.entryPoint = "main";
+        m_argumentPipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+        wgpuShaderModuleRelease(module);
+    }
+    return m_argumentPipeline;
+}
+
+void DispatchChain::record(WGPUCommandEncoder encoder, char const * label)
+{
+    if (m_stages.empty())
+    {
+        return;
+    }
+
+    size_t countedStages = 0;
+    for (Stage const & stage : m_stages)
+    {
+        if (stage.itemsPerWorkgroup) ++countedStages;
+    }
+
+    // one slot of arguments and params per counted stage, written on the GPU
+    // and on the CPU respectively
+    WGPUBuffer argumentBuffer = nullptr;
+    WGPUBuffer paramBuffer = nullptr;
+    std::vector<WGPUBindGroup> argumentBindGroups;
+    if (countedStages > 0)
+    {
+        WGPUBufferDescriptor bufferDesc = {};
+        bufferDesc.nextInChain = nullptr;
+        bufferDesc.label = "Dispatch arguments";
+        bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_Indirect;
+        bufferDesc.size = slotStride * countedStages;
+        bufferDesc.mappedAtCreation = false;
+        argumentBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+
+        bufferDesc.label = "Dispatch argument params";
+        bufferDesc.usage = WGPUBufferUsage_Uniform;
+        bufferDesc.mappedAtCreation = true;
+        paramBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+        uint8_t * mapped = static_cast<uint8_t *>(wgpuBufferGetMappedRange(paramBuffer, 0, bufferDesc.size));
+
+        WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(argumentPipeline(), 0);
+        size_t slot = 0;
+        for (Stage const & stage : m_stages)
+        {
+            if (!stage.itemsPerWorkgroup)
+            {
+                continue;
+            }
+            ArgumentParams params = {
+                static_cast<uint32_t>(stage.offset / 4), stage.itemsPerWorkgroup, m_maxGroupsPerDimension, 0
+            };
+            std::memcpy(mapped + slot * slotStride, &params, sizeof(params));
+
+            WGPUBindGroupEntry entries[3] = {};
+            WGPUBuffer buffers[3] = { stage.indirect, argumentBuffer, paramBuffer };
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                entries[i].nextInChain = nullptr;
+                entries[i].binding = i;
+                entries[i].buffer = buffers[i];
+                entries[i].offset = i == 0 ? 0 : slot * slotStride;
+            }
+            entries[0].size = WGPU_WHOLE_SIZE;
+            entries[1].size = 3 * sizeof(uint32_t);
+            entries[2].size = sizeof(ArgumentParams);
+            WGPUBindGroupDescriptor bindGroupDesc = {};
+            bindGroupDesc.nextInChain = nullptr;
+            bindGroupDesc.label = "Dispatch arguments";
+            bindGroupDesc.layout = layout;
+            bindGroupDesc.entryCount = 3;
+            bindGroupDesc.entries = entries;
+            argumentBindGroups.push_back(wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc));
+            ++slot;
+        }
+        wgpuBindGroupLayoutRelease(layout);
+        wgpuBufferUnmap(paramBuffer);
+    }
+
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = label;
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    size_t slot = 0;
+    for (Stage const & stage : m_stages)
+    {
+        if (stage.itemsPerWorkgroup)
+        {
+            wgpuComputePassEncoderSetPipeline(pass, m_argumentPipeline);
+            wgpuComputePassEncoderSetBindGroup(pass, 0, argumentBindGroups[slot], 0, nullptr);
+            wgpuComputePassEncoderDispatchWorkgroups(pass, 1, 1, 1);
+        }
+
+        wgpuComputePassEncoderSetPipeline(pass, stage.pipeline);
+        for (size_t i = 0; i < stage.bindGroups.size(); ++i)
+        {
+            wgpuComputePassEncoderSetBindGroup(pass, static_cast<uint32_t>(i), stage.bindGroups[i], 0, nullptr);
+        }
+        if (stage.itemsPerWorkgroup)
+        {
+            wgpuComputePassEncoderDispatchWorkgroupsIndirect(pass, argumentBuffer, slot * slotStride);
+            ++slot;
+        }
+        else if (stage.indirect)
+        {
+            wgpuComputePassEncoderDispatchWorkgroupsIndirect(pass, stage.indirect, stage.offset);
+        }
+        else
+        {
+            wgpuComputePassEncoderDispatchWorkgroups(pass, stage.groups[0], stage.groups[1], stage.groups[2]);
+        }
+    }
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+
+    // the encoder keeps what the pass uses alive
+    for (WGPUBindGroup bindGroup : argumentBindGroups)
+    {
+        wgpuBindGroupRelease(bindGroup);
+    }
+    if (paramBuffer) wgpuBufferRelease(paramBuffer);
+    if (argumentBuffer) wgpuBufferRelease(argumentBuffer);
+    m_stages.clear();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Compute stages recorded into one pass, where a stage can be sized by data
+ * an earlier stage left on the GPU, e.g. the number of elements kept by a
+ * compaction, through indirect dispatches. The CPU never reads the size
+ * back, so data-dependent stages cost no submit and poll in between:
+ *     DispatchChain chain(device);
+ *     chain.dispatch(flagPipeline, { flagBindGroup }, groups);
+ *     chain.dispatchForCount(processPipeline, { processBindGroup }, countBuffer, 0, 256);
+ *     chain.record(encoder);
+ *
+ * Dispatches of a compute pass see the writes of the previous ones, and the
+ * arguments written by one stage are a valid indirect source for the next.
+ * Stages whose workgroup count may exceed maxComputeWorkgroupsPerDimension
+ * get the extra groups along y and should linearize their workgroup id with
+ * num_workgroups. Bind groups stay owned by the caller and must be alive
+ * until record().
+ */
+class DispatchChain
+{
+public:
+    explicit DispatchChain(WGPUDevice device);
+    ~DispatchChain();
+
+    DispatchChain(DispatchChain const &) = delete;
+    DispatchChain & operator=(DispatchChain const &) = delete;
+
+    /**
+     * Stage with workgroup counts known on the CPU.
+     */
+    DispatchChain & dispatch(
+        WGPUComputePipeline pipeline,
+        std::vector<WGPUBindGroup> bindGroups,
+        uint32_t x,
+        uint32_t y = 1,
+        uint32_t z = 1);
+
+    /**
+     * Stage sized by three u32 workgroup counts at `offset` (a multiple of
+     * 4) of a buffer with the Indirect usage, written by an earlier stage
+     * or command.
+     */
+    DispatchChain & dispatchIndirect(
+        WGPUComputePipeline pipeline,
+        std::vector<WGPUBindGroup> bindGroups,
+        WGPUBuffer arguments,
+        uint64_t offset = 0);
+
+    /**
+     * Stage over the number of items in the u32 at `countOffset` (a
+     * multiple of 4) of a storage buffer, `itemsPerWorkgroup` per group. A
+     * single-invocation kernel turns the count into indirect arguments right
+     * before the stage; a count of zero dispatches nothing.
+     */
+    DispatchChain & dispatchForCount(
+        WGPUComputePipeline pipeline,
+        std::vector<WGPUBindGroup> bindGroups,
+        WGPUBuffer count,
+        uint64_t countOffset,
+        uint32_t itemsPerWorkgroup);
+
+    size_t stageCount() const { return m_stages.size(); }
+
+    /**
+     * Record every stage in one compute pass and start a new chain.
+     */
+    void record(WGPUCommandEncoder encoder, char const * label = "Dispatch chain");
+
+    void release();
+
+private:
+    struct Stage
+    {
+        WGPUComputePipeline pipeline;
+        std::vector<WGPUBindGroup> bindGroups;
+        uint32_t groups[3];
+        WGPUBuffer indirect;            // arguments, or count when itemsPerWorkgroup != 0
+        uint64_t offset;
+        uint32_t itemsPerWorkgroup;
+    };
+
+    WGPUComputePipeline argumentPipeline();
+
+    WGPUDevice m_device;
+    uint32_t m_maxGroupsPerDimension;
+    WGPUComputePipeline m_argumentPipeline = nullptr;
+    std::vector<Stage> m_stages;
+};
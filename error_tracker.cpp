@@ -0,0 +1,195 @@
+#include "error_tracker.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// innermost scope of the thread, for the errors of unsampled scopes
+thread_local ErrorTracker::Site const * currentSite = nullptr;
+
+ErrorTracker::Site unscopedSite{ "(unscoped)", "", 0 };
+
+char const * errorTypeName(WGPUErrorType type)
+{
+    switch (type)
+    {
+    case WGPUErrorType_NoError: return "none";
+    case WGPUErrorType_Validation: return "validation";
+    case WGPUErrorType_OutOfMemory: return "out_of_memory";
+    case WGPUErrorType_Internal: return "internal";
+    case WGPUErrorType_DeviceLost: return "device_lost";
+    default: return "unknown";
+    }
+}
+
+// file name without its directories
+char const * baseName(char const * path)
+{
+    char const * slash = std::strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+struct PopContext
+{
+    ErrorTracker * tracker;
+    ErrorTracker::Site const * site;
+};
+
+} // namespace
+
+ErrorTracker::Scope::Scope(ErrorTracker & tracker, Site & site)
+    : m_tracker(tracker)
+    , m_site(site)
+    , m_parent(currentSite)
+    , m_sampled(tracker.m_device != nullptr && tracker.beginSampledScope(site))
+{
+    currentSite = &site;
+}
+
+ErrorTracker::Scope::~Scope()
+{
+    currentSite = m_parent;
+    if (!m_sampled || m_tracker.m_device == nullptr)
+    {
+        return;
+    }
+
+    // scopes pop in reverse order, each callback owns its context
+    auto onError = [](WGPUErrorType type, char const * message, void * userdata)
+    {
+        PopContext * context = static_cast<PopContext *>(userdata);
+        if (type != WGPUErrorType_NoError)
+        {
+            context->tracker->record(context->site, type, message, true);
+        }
+        delete context;
+    };
+    wgpuDevicePopErrorScope(m_tracker.m_device, onError, new PopContext{ &m_tracker, &m_site });
+    wgpuDevicePopErrorScope(m_tracker.m_device, onError, new PopContext{ &m_tracker, &m_site });
+}
+
+ErrorTracker::ErrorTracker(WGPUDevice device)
+    : m_device(device)
+#ifdef NDEBUG
+    , m_samplePeriod(16)
+    , m_frameBudget(32)
+#else
+    , m_samplePeriod(1)
+    , m_frameBudget(0)
+#endif
+{
+    wgpuDeviceSetUncapturedErrorCallback(m_device, onUncapturedError, this);
+}
+
+ErrorTracker::~ErrorTracker()
+{
+    release();
+}
+
+void ErrorTracker::release()
+{
+    if (m_device)
+    {
+        wgpuDeviceSetUncapturedErrorCallback(m_device, nullptr, nullptr);
+        m_device = nullptr;
+    }
+}
+
+bool ErrorTracker::beginSampledScope(Site & site)
+{
+    uint32_t entry = site.entries.fetch_add(1, std::memory_order_relaxed);
+    bool sampled = entry % m_samplePeriod == 0
+        && (m_frameBudget == 0 || m_frameScopes.fetch_add(1, std::memory_order_relaxed) < m_frameBudget);
+    if (!sampled)
+    {
+        m_skippedScopes.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_sampledScopes.fetch_add(1, std::memory_order_relaxed);
+
+    // internal errors are rare, they are left to the uncaptured callback
+    wgpuDevicePushErrorScope(m_device, WGPUErrorFilter_OutOfMemory);
+    wgpuDevicePushErrorScope(m_device, WGPUErrorFilter_Validation);
+    return true;
+}
+
+void ErrorTracker::onUncapturedError(WGPUErrorType type, char const * message, void * userdata)
+{
+    ErrorTracker * tracker = static_cast<ErrorTracker *>(userdata);
+    tracker->record(currentSite ? currentSite : &unscopedSite, type, message, false);
+}
+
+void ErrorTracker::record(Site const * site, WGPUErrorType type, char const * message, bool scoped)
+{
+    m_errorCount.fetch_add(1, std::memory_order_relaxed);
+    bool first = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry & entry = m_entries[{ site, type }];
+        first = entry.count == 0;
+        entry.site = site;
+        entry.type = type;
+        ++entry.count;
+        entry.scopedCount += scoped ? 1 : 0;
+        entry.lastMessage = message ? message : "";
+    }
+
+    // the full message once per site and type, the counts tell the rest
+    if (first)
+    {
+        LogLine line(LogLevel::Error);
+        line << errorTypeName(type) << " error in " << site->name;
+        if (site->line > 0)
+        {
+            line << " (" << baseName(site->file) << ":" << site->line << ")";
+        }
+        line << ": " << (message ? message : "");
+    }
+}
+
+std::vector<ErrorTracker::Entry> ErrorTracker::entries() const
+{
+    std::vector<Entry> result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto const & entry : m_entries)
+        {
+            result.push_back(entry.second);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](Entry const & a, Entry const & b) { return a.count > b.count; });
+    return result;
+}
+
+void ErrorTracker::report(std::ostream & out) const
+{
+    out << errorCount() << " WebGPU error(s), " << sampledScopeCount() << " of "
+        << sampledScopeCount() + skippedScopeCount() << " scopes sampled";
+    for (auto const & entry : entries())
+    {
+        out << "\n - " << entry.count << " " << errorTypeName(entry.type) << " in " << entry.site->name;
+        if (entry.site->line > 0)
+        {
+            out << " (" << baseName(entry.site->file) << ":" << entry.site->line << ")";
+        }
+        out << ", last: " << entry.lastMessage.substr(0, entry.lastMessage.find('\n'));
+    }
+}
+
+void ErrorTracker::writePrometheus(std::ostream & out) const
+{
+    out << "# HELP wgpu_errors_total WebGPU errors by type and call site\n";
+    out << "# TYPE wgpu_errors_total counter\n";
+    for (auto const & entry : entries())
+    {
+        out << "wgpu_errors_total{type=\"" << errorTypeName(entry.type) << "\",site=\"" << entry.site->name
+            << "\"} " << entry.count << "\n";
+    }
+    out << "# HELP wgpu_error_scopes_total Tracked scopes, by whether they pushed error scopes\n";
+    out << "# TYPE wgpu_error_scopes_total counter\n";
+    out << "wgpu_error_scopes_total{sampled=\"true\"} " << sampledScopeCount() << "\n";
+    out << "wgpu_error_scopes_total{sampled=\"false\"} " << skippedScopeCount() << "\n";
+}
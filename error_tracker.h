@@ -0,0 +1,138 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Counts the errors of a device by type and call site, so that validation
+ * failures, which make wgpu-native fall back to error objects, show up in
+ * the metrics instead of being lost:
+ *     ErrorTracker errors(device);
+ *     {
+ *         WGPU_ERROR_SCOPE(errors, "Create pipelines");
+ *         ...
+ *     }
+ *     errors.endFrame();
+ *
+ * Errors of sampled scopes are caught by their validation and out-of-memory
+ * error scopes; all the others reach the uncaptured error callback and are
+ * attributed to the innermost scope of the thread. wgpu-native reports
+ * errors from within the failing call, so that attribution is exact there;
+ * backends reporting them later may blame a later scope.
+ *
+ * In release builds only one entry in 16 of each scope pushes error scopes,
+ * and at most 32 per frame, to bound the per-frame cost.
+ */
+class ErrorTracker
+{
+public:
+    /**
+     * Call site of a scope, static so that it is identified by its address.
+     */
+    struct Site
+    {
+        char const * name;
+        char const * file;
+        int line;
+        std::atomic<uint32_t> entries{ 0 };
+    };
+
+    struct Entry
+    {
+        Site const * site;
+        WGPUErrorType type;
+        uint64_t count = 0;
+        uint64_t scopedCount = 0;       // caught by a sampled error scope
+        std::string lastMessage;
+    };
+
+    class Scope
+    {
+    public:
+        Scope(ErrorTracker & tracker, Site & site);
+        ~Scope();
+
+        Scope(Scope const &) = delete;
+        Scope & operator=(Scope const &) = delete;
+
+    private:
+        ErrorTracker & m_tracker;
+        Site & m_site;
+        Site const * m_parent;
+        bool m_sampled;
+    };
+
+    explicit ErrorTracker(WGPUDevice device);
+    ~ErrorTracker();
+
+    ErrorTracker(ErrorTracker const &) = delete;
+    ErrorTracker & operator=(ErrorTracker const &) = delete;
+
+    /**
+     * Stop tracking, before the device is released. Counts are kept.
+     */
+    void release();
+
+    /**
+     * Push error scopes for one entry in `period` of each site, 1 for all.
+     */
+    void setSamplePeriod(uint32_t period) { m_samplePeriod = period > 0 ? period : 1; }
+
+    /**
+     * At most `scopes` sampled scopes between two endFrame(), 0 for no limit.
+     */
+    void setFrameBudget(uint32_t scopes) { m_frameBudget = scopes; }
+    void endFrame() { m_frameScopes.store(0, std::memory_order_relaxed); }
+
+    uint64_t errorCount() const { return m_errorCount.load(std::memory_order_relaxed); }
+    uint64_t sampledScopeCount() const { return m_sampledScopes.load(std::memory_order_relaxed); }
+    uint64_t skippedScopeCount() const { return m_skippedScopes.load(std::memory_order_relaxed); }
+
+    /**
+     * Aggregated errors, most frequent first.
+     */
+    std::vector<Entry> entries() const;
+
+    void report(std::ostream & out) const;
+
+    /**
+     * Error and scope counters in Prometheus text exposition format.
+     */
+    void writePrometheus(std::ostream & out) const;
+
+private:
+    bool beginSampledScope(Site & site);
+    void record(Site const * site, WGPUErrorType type, char const * message, bool scoped);
+
+    static void onUncapturedError(WGPUErrorType type, char const * message, void * userdata);
+
+    WGPUDevice m_device;
+    uint32_t m_samplePeriod;
+    uint32_t m_frameBudget;
+    std::atomic<uint32_t> m_frameScopes{ 0 };
+    std::atomic<uint64_t> m_sampledScopes{ 0 };
+    std::atomic<uint64_t> m_skippedScopes{ 0 };
+    std::atomic<uint64_t> m_errorCount{ 0 };
+
+    // errors may be reported from wgpu-native threads
+    mutable std::mutex m_mutex;
+    std::map<std::pair<Site const *, WGPUErrorType>, Entry> m_entries;
+};
+
+#define WGPU_ERROR_SCOPE_CONCAT_(a, b) a##b
+#define WGPU_ERROR_SCOPE_CONCAT(a, b) WGPU_ERROR_SCOPE_CONCAT_(a, b)
+
+/**
+ * Track the errors until the end of the enclosing block under `name`.
+ */
+#define WGPU_ERROR_SCOPE(tracker, name) \
+    static ErrorTracker::Site WGPU_ERROR_SCOPE_CONCAT(errorSite, __LINE__){ name, __FILE__, __LINE__ }; \
+    ErrorTracker::Scope WGPU_ERROR_SCOPE_CONCAT(errorScope, __LINE__)(tracker, WGPU_ERROR_SCOPE_CONCAT(errorSite, __LINE__))
@@ -0,0 +1,532 @@
+#include "fft.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+// Stockham autosort pass: invocation j of a signal reads the values j + r n/R,
+// multiplies them by the twiddles of its sub-transform, runs an R-point DFT
+// and writes the results r * stride apart, in order for the next pass
+char const * fftSource = R"(
+struct Params
+{
+    n: u32,
+    stride: u32,
+    twiddleStep: u32,
+    elementStride: u32,
+    innerCount: u32,
+    innerStride: u32,
+    outerStride: u32,
+    batchCount: u32,
+    batchFastest: u32,
+    sign: f32,
+    scale: f32,
+    groups: u32,
+}
+
+@group(0) @binding(0) var<storage, read> src: array<vec2f>;
+@group(0) @binding(1) var<storage, read_write> dst: array<vec2f>;
+@group(0) @binding(2) var<storage, read> twiddles: array<vec2f>;
+@group(0) @binding(3) var<uniform> params: Params;
+
+const SQRT_HALF = 0.70710678118654752;
+
+fn mul(a: vec2f, b: vec2f) -> vec2f
+{
+    return vec2f(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// multiplication by sign * i, a quarter turn
+fn quarter(z: vec2f) -> vec2f
+{
+    return params.sign * vec2f(-z.y, z.x);
+}
+
+fn dft4(a: vec2f, b: vec2f, c: vec2f, d: vec2f) -> array<vec2f, 4>
+{
+    let t0 = a + c;
+    let t1 = a - c;
+    let t2 = b + d;
+    let t3 = quarter(b - d);
+    return array<vec2f, 4>(t0 + t2, t1 + t3, t0 - t2, t1 - t3);
+}
+
+// x: signal start, y: j, z: 0 past the last invocation
+fn locate(wid: vec3u, nwg: vec3u, local: u32, radix: u32) -> vec3u
+{
+    let index = (wid.y * nwg.x + wid.x) * 256u + local;
+    let perSignal = params.n / radix;
+    var b = index / perSignal;
+    var j = index % perSignal;
+    if (params.batchFastest != 0u)
+    {
+        b = index % params.batchCount;
+        j = index / params.batchCount;
+    }
+    let start = (b / params.innerCount) * params.outerStride + (b % params.innerCount) * params.innerStride;
+    return vec3u(start, j, select(0u, 1u, index < params.batchCount * perSignal));
+}
+
+fn load(start: u32, j: u32, radix: u32, r: u32) -> vec2f
+{
+    let value = src[start + (j + r * (params.n / radix)) * params.elementStride];
+    if (r == 0u)
+    {
+        return value;
+    }
+    // the table holds the forward twiddles, conjugated for the inverse
+    let t = twiddles[(j % params.stride) * r * params.twiddleStep];
+    return mul(value, vec2f(t.x, -params.sign * t.y));
+}
+
+fn store(start: u32, j: u32, radix: u32, r: u32, value: vec2f)
+{
+    let k = j % params.stride;
+    dst[start + ((j - k) * radix + k + r * params.stride) * params.elementStride] = value * params.scale;
+}
+
+@compute @workgroup_size(256)
+fn radix4(@builtin(workgroup_id) wid: vec3u, @builtin(num_workgroups) nwg: vec3u, @builtin(local_invocation_index) local: u32)
+{
+    let at = locate(wid, nwg, local, 4u);
+    if (at.z == 0u)
+    {
+        return;
+    }
+    var x = dft4(load(at.x, at.y, 4u, 0u), load(at.x, at.y, 4u, 1u), load(at.x, at.y, 4u, 2u), load(at.x, at.y, 4u, 3u));
+    for (var r = 0u; r < 4u; r++)
+    {
+        store(at.x, at.y, 4u, r, x[r]);
+    }
+}
+
+@compute @workgroup_size(256)
+fn radix2(@builtin(workgroup_id) wid: vec3u, @builtin(num_workgroups) nwg: vec3u, @builtin(local_invocation_index) local: u32)
+{
+    let at = locate(wid, nwg, local, 2u);
+    if (at.z == 0u)
+    {
+        return;
+    }
+    let a = load(at.x, at.y, 2u, 0u);
+    let b = load(at.x, at.y, 2u, 1u);
+    store(at.x, at.y, 2u, 0u, a + b);
+    store(at.x, at.y, 2u, 1u, a - b);
+}
+
+@compute @workgroup_size(256)
+fn radix8(@builtin(workgroup_id) wid: vec3u, @builtin(num_workgroups) nwg: vec3u, @builtin(local_invocation_index) local: u32)
+{
+    let at = locate(wid, nwg, local, 8u);
+    if (at.z == 0u)
+    {
+        return;
+    }
+    var v: array<vec2f, 8>;
+    for (var r = 0u; r < 8u; r++)
+    {
+        v[r] = load(at.x, at.y, 8u, r);
+    }
+    // two 4-point DFTs of the even and odd values, combined with the
+    // eighth-turn twiddles
+    var even = dft4(v[0], v[2], v[4], v[6]);
+    let odd = dft4(v[1], v[3], v[5], v[7]);
+    let w1 = SQRT_HALF * vec2f(1.0, params.sign);
+    let w3 = SQRT_HALF * vec2f(-1.0, params.sign);
+    var turned = array<vec2f, 4>(odd[0], mul(odd[1], w1), quarter(odd[2]), mul(odd[3], w3));
+    for (var r = 0u; r < 4u; r++)
+    {
+        store(at.x, at.y, 8u, r, even[r] + turned[r]);
+        store(at.x, at.y, 8u, r + 4u, even[r] - turned[r]);
+    }
+}
+)";
+
+/**
+ * Split the last pass of radix 4 or more in two, to get an even number
+ * of passes.
+ */
+void splitPass(std::vector<uint32_t> & plan)
+{
+    for (size_t i = plan.size(); i-- > 0;)
+    {
+        if (plan[i] >= 4)
+        {
+            plan[i] /= 2;
+            plan.insert(plan.begin() + i + 1, 2);
+            return;
+        }
+    }
+}
+
+} // namespace
+
+Fft::Fft(WGPUDevice device)
+    : m_device(device)
+{
+    WGPUSupportedLimits supported = {};
+    supported.nextInChain = nullptr;
+    wgpuDeviceGetLimits(device, &supported);
+    m_maxGroupsPerDimension = supported.limits.maxComputeWorkgroupsPerDimension;
+}
+
+Fft::~Fft()
+{
+    release();
+}
+
+void Fft::release()
+{
+    for (auto & entry : m_pipelines)
+    {
+        wgpuComputePipelineRelease(entry.second);
+    }
+    m_pipelines.clear();
+    for (auto & entry : m_twiddles)
+    {
+        wgpuBufferRelease(entry.second);
+    }
+    m_twiddles.clear();
+    if (m_scratch)
+    {
+        wgpuBufferRelease(m_scratch);
+        m_scratch = nullptr;
+        m_scratchSize = 0;
+    }
+    for (WGPUBuffer buffer : m_retired)
+    {
+        wgpuBufferRelease(buffer);
+    }
+    m_retired.clear();
+    if (m_module)
+    {
+        wgpuShaderModuleRelease(m_module);
+        m_module = nullptr;
+    }
+}
+
+bool Fft::supportedSize(uint32_t n)
+{
+    return n >= 4 && (n & (n - 1)) == 0;
+}
+
+std::vector<uint32_t> Fft::radices(uint32_t n)
+{
+    uint32_t bits = 0;
+    while ((1u << bits) < n) ++bits;
+
+    // radix 8 for every 3 bits, a remainder of 1 bit turns one 8 into 4 x 4
+    std::vector<uint32_t> plan(bits / 3, 8);
+    if (bits % 3 == 2)
+    {
+        plan.push_back(4);
+    }
+    else if (bits % 3 == 1)
+    {
+        if (plan.empty())
+        {
+            plan.push_back(2);
+        }
+        else
+        {
+            plan.back() = 4;
+            plan.push_back(4);
+        }
+    }
+    return plan;
+}
+
+void Fft::transform(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer output, uint32_t n, uint32_t batch, Direction direction)
+{
+    if (!supportedSize(n))
+    {
+        logError() << "FFT of " << n << " values: sizes are powers of two from 4";
+        return;
+    }
+    if (batch == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> plan = radices(n);
+    // in place, the first pass must not write the buffer it reads
+    if (input == output && plan.size() % 2 == 1)
+    {
+        splitPass(plan);
+    }
+    Params layout = {};
+    layout.elementStride = 1;
+    layout.innerCount = batch;
+    layout.innerStride = n;
+    layout.batchCount = batch;
+    std::vector<Pass> passes;
+    appendPasses(passes, n, plan, layout, direction);
+    if (direction == Direction::Inverse)
+    {
+        passes.back().params.scale = 1.0f / n;
+    }
+    run(encoder, input, output, passes, uint64_t(n) * batch * 8);
+}
+
+void Fft::transform2d(
+    WGPUCommandEncoder encoder,
+    WGPUBuffer input,
+    WGPUBuffer output,
+    uint32_t width,
+    uint32_t height,
+    uint32_t batch,
+    Direction direction)
+{
+    if (!supportedSize(width) || !supportedSize(height))
+    {
+        logError() << "FFT of " << width << "x" << height << " values: sizes are powers of two from 4";
+        return;
+    }
+    if (batch == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> rowPlan = radices(width);
+    std::vector<uint32_t> columnPlan = radices(height);
+    if (input == output && (rowPlan.size() + columnPlan.size()) % 2 == 1)
+    {
+        splitPass(rowPlan);
+    }
+
+    std::vector<Pass> passes;
+    // every row, one signal after the other
+    Params rows = {};
+    rows.elementStride = 1;
+    rows.innerCount = height * batch;
+    rows.innerStride = width;
+    rows.batchCount = height * batch;
+    appendPasses(passes, width, rowPlan, rows, direction);
+    // every column of every image, neighbouring invocations on neighbouring
+    // columns for coalesced accesses
+    Params columns = {};
+    columns.elementStride = width;
+    columns.innerCount = width;
+    columns.innerStride = 1;
+    columns.outerStride = width * height;
+    columns.batchCount = width * batch;
+    columns.batchFastest = 1;
+    appendPasses(passes, height, columnPlan, columns, direction);
+    if (direction == Direction::Inverse)
+    {
+        passes.back().params.scale = 1.0f / (float(width) * height);
+    }
+    run(encoder, input, output, passes, uint64_t(width) * height * batch * 8);
+}
+
+void Fft::appendPasses(std::vector<Pass> & passes, uint32_t n, std::vector<uint32_t> const & plan, Params layout, Direction direction)
+{
+    WGPUBuffer table = twiddles(n);
+    uint32_t stride = 1;
+    for (uint32_t radix : plan)
+    {
+        Params params = layout;
+        params.n = n;
+        params.stride = stride;
+        params.twiddleStep = n / (stride * radix);
+        params.sign = direction == Direction::Forward ? -1.0f : 1.0f;
+        params.scale = 1.0f;
+        uint64_t invocations = uint64_t(layout.batchCount) * (n / radix);
+        params.groups = static_cast<uint32_t>((invocations + 255) / 256);
+        passes.push_back({ radix, table, params });
+        stride *= radix;
+    }
+}
+
+void Fft::run(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer output, std::vector<Pass> const & passes, uint64_t size)
+{
+    // the last pass writes the output, the ones before alternate with the
+    // scratch buffer
+    WGPUBuffer scratchBuffer = scratch(size);
+    std::vector<WGPUBuffer> targets(passes.size());
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        targets[i] = (passes.size() - 1 - i) % 2 == 0 ? output : scratchBuffer;
+    }
+
+    // one uniform buffer holds the params of every pass, at the offset alignment
+    constexpr uint64_t paramStride = 256;
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "FFT params";
+    bufferDesc.usage = WGPUBufferUsage_Uniform;
+    bufferDesc.size = paramStride * passes.size();
+    bufferDesc.mappedAtCreation = true;
+    WGPUBuffer paramBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    uint8_t * mapped = static_cast<uint8_t *>(wgpuBufferGetMappedRange(paramBuffer, 0, bufferDesc.size));
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        std::memcpy(mapped + i * paramStride, &passes[i].params, sizeof(Params));
+    }
+    wgpuBufferUnmap(paramBuffer);
+
+    std::vector<WGPUBindGroup> bindGroups;
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        WGPUBuffer buffers[4] = { i == 0 ? input : targets[i - 1], targets[i], passes[i].twiddles, paramBuffer };
+        WGPUBindGroupEntry entries[4] = {};
+        for (uint32_t b = 0; b < 4; ++b)
+        {
+            entries[b].nextInChain = nullptr;
+            entries[b].binding = b;
+            entries[b].buffer = buffers[b];
+            entries[b].offset = b == 3 ? i * paramStride : 0;
+            entries[b].size = b == 3 ? sizeof(Params) : WGPU_WHOLE_SIZE;
+        }
+        WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(pipeline(passes[i].radix), 0);
+        WGPUBindGroupDescriptor bindGroupDesc = {};
+        bindGroupDesc.nextInChain = nullptr;
+        bindGroupDesc.label = "FFT pass";
+        bindGroupDesc.layout = layout;
+        bindGroupDesc.entryCount = 4;
+        bindGroupDesc.entries = entries;
+        bindGroups.push_back(wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc));
+        wgpuBindGroupLayoutRelease(layout);
+    }
+
+    // dispatches of a pass see the writes of the previous ones
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = "FFT";
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        uint32_t groups = std::max(1u, passes[i].params.groups);
+        uint32_t x = std::min(groups, m_maxGroupsPerDimension);
+        wgpuComputePassEncoderSetPipeline(pass, pipeline(passes[i].radix));
+        wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroups[i], 0, nullptr);
+        wgpuComputePassEncoderDispatchWorkgroups(pass, x, (groups + x - 1) / x, 1);
+    }
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+
+    // the encoder keeps what the pass uses alive
+    for (WGPUBindGroup bindGroup : bindGroups)
+    {
+        wgpuBindGroupRelease(bindGroup);
+    }
+    wgpuBufferRelease(paramBuffer);
+    for (WGPUBuffer buffer : m_retired)
+    {
+        wgpuBufferRelease(buffer);
+    }
+    m_retired.clear();
+}
+
+WGPUComputePipeline Fft::pipeline(uint32_t radix)
+{
+    auto found = m_pipelines.find(radix);
+    if (found != m_pipelines.end())
+    {
+        return found->second;
+    }
+    if (m_module == nullptr)
+    {
+        m_module = createShaderModule(m_device, fftSource, "FFT");
+    }
+    std::string entryPoint = "radix" + std::to_string(radix);
+    WGPUComputePipelineDescriptor pipelineDesc = {};
+    pipelineDesc.nextInChain = nullptr;
+    pipelineDesc.label = "FFT";
+    pipelineDesc.layout = nullptr;
+    pipelineDesc.compute.module = m_module;
+    pipelineDesc.compute.entryPoint = entryPoint.c_str();
+    WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+    m_pipelines[radix] = pipeline;
+    return pipeline;
+}
+
+WGPUBuffer Fft::twiddles(uint32_t n)
+{
+    auto found = m_twiddles.find(n);
+    if (found != m_twiddles.end())
+    {
+        return found->second;
+    }
+    // exp(-2 pi i k / n), exact angles in double before rounding to f32
+    std::vector<float> table(size_t(n) * 2);
+    double const pi = 3.14159265358979323846;
+    for (uint32_t k = 0; k < n; ++k)
+    {
+        double angle = -2.0 * pi * k / n;
+        table[2 * k] = static_cast<float>(std::cos(angle));
+        table[2 * k + 1] = static_cast<float>(std::sin(angle));
+    }
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "FFT twiddles";
+    bufferDesc.usage = WGPUBufferUsage_Storage;
+    bufferDesc.size = table.size() * sizeof(float);
+    bufferDesc.mappedAtCreation = true;
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    std::memcpy(wgpuBufferGetMappedRange(buffer, 0, bufferDesc.size), table.data(), bufferDesc.size);
+    wgpuBufferUnmap(buffer);
+    m_twiddles[n] = buffer;
+    return buffer;
+}
+
+WGPUBuffer Fft::scratch(uint64_t size)
+{
+    if (m_scratchSize < size)
+    {
+        // the old buffer may already be referenced by the passes recorded so far
+        if (m_scratch) m_retired.push_back(m_scratch);
+        WGPUBufferDescriptor bufferDesc = {};
+        bufferDesc.nextInChain = nullptr;
+        bufferDesc.label = "FFT scratch";
+        bufferDesc.usage = WGPUBufferUsage_Storage;
+        bufferDesc.size = size;
+        bufferDesc.mappedAtCreation = false;
+        m_scratch = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+        m_scratchSize = size;
+    }
+    return m_scratch;
+}
+
+void cpuFft(std::vector<std::complex<float>> & data, uint32_t n, uint32_t batch, bool inverse)
+{
+    double const pi = 3.14159265358979323846;
+    std::vector<std::complex<double>> signal(n);
+    for (uint32_t b = 0; b < batch; ++b)
+    {
+        std::complex<float> * values = data.data() + size_t(b) * n;
+        // iterative radix-2, bit-reversed input order
+        for (uint32_t i = 0, j = 0; i < n; ++i)
+        {
+            signal[j] = values[i];
+            uint32_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j |= bit;
+        }
+        for (uint32_t length = 2; length <= n; length <<= 1)
+        {
+            double angle = (inverse ? 2.0 : -2.0) * pi / length;
+            for (uint32_t start = 0; start < n; start += length)
+            {
+                for (uint32_t k = 0; k < length / 2; ++k)
+                {
+                    std::complex<double> w = std::polar(1.0, angle * k);
+                    std::complex<double> odd = w * signal[start + k + length / 2];
+                    signal[start + k + length / 2] = signal[start + k] - odd;
+                    signal[start + k] += odd;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            values[i] = std::complex<float>(inverse ? signal[i] / double(n) : signal[i]);
+        }
+    }
+}
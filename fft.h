@@ -0,0 +1,113 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <complex>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * Batched complex FFTs on the GPU, 1D and 2D, on interleaved f32 (re, im)
+ * pairs. Sizes are powers of two from 4 on, transformed with Stockham
+ * passes of radix 8, then 4 for the remaining bits, each pass one dispatch
+ * over the whole batch:
+ *     Fft fft(device);
+ *     fft.transform(encoder, signals, spectra, 1024, 512);     // 512 signals of 1024
+ *     fft.transform2d(encoder, image, image, 512, 512, 1, Fft::Direction::Inverse);
+ *
+ * Passes ping-pong between the output and a scratch buffer owned by this
+ * object, so the input is left untouched unless it is the output; in-place
+ * transforms are supported. Inverse transforms are scaled by 1 / size.
+ * Twiddle tables are computed in double precision and cached per size.
+ */
+class Fft
+{
+public:
+    enum class Direction { Forward, Inverse };
+
+    explicit Fft(WGPUDevice device);
+    ~Fft();
+
+    Fft(Fft const &) = delete;
+    Fft & operator=(Fft const &) = delete;
+
+    static bool supportedSize(uint32_t n);
+
+    /**
+     * Radix of every pass for a size, largest first.
+     */
+    static std::vector<uint32_t> radices(uint32_t n);
+
+    /**
+     * `batch` consecutive signals of n complex values.
+     */
+    void transform(
+        WGPUCommandEncoder encoder,
+        WGPUBuffer input,
+        WGPUBuffer output,
+        uint32_t n,
+        uint32_t batch = 1,
+        Direction direction = Direction::Forward);
+
+    /**
+     * `batch` consecutive row-major images of width x height complex values.
+     */
+    void transform2d(
+        WGPUCommandEncoder encoder,
+        WGPUBuffer input,
+        WGPUBuffer output,
+        uint32_t width,
+        uint32_t height,
+        uint32_t batch = 1,
+        Direction direction = Direction::Forward);
+
+    size_t twiddleTableCount() const { return m_twiddles.size(); }
+
+    void release();
+
+private:
+    struct Params
+    {
+        uint32_t n;
+        uint32_t stride;            // length of the sub-transforms done by the previous passes
+        uint32_t twiddleStep;       // n / (stride * radix)
+        uint32_t elementStride;     // between the values of one signal
+        uint32_t innerCount;        // signals batch index b starts at
+        uint32_t innerStride;       //   (b / innerCount) * outerStride + (b % innerCount) * innerStride
+        uint32_t outerStride;
+        uint32_t batchCount;
+        uint32_t batchFastest;      // neighbouring invocations work on neighbouring signals
+        float sign;                 // of the exponent, -1 forward
+        float scale;
+        uint32_t groups;
+    };
+
+    struct Pass
+    {
+        uint32_t radix;
+        WGPUBuffer twiddles;
+        Params params;
+    };
+
+    void appendPasses(std::vector<Pass> & passes, uint32_t n, std::vector<uint32_t> const & plan, Params layout, Direction direction);
+    void run(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer output, std::vector<Pass> const & passes, uint64_t size);
+    WGPUComputePipeline pipeline(uint32_t radix);
+    WGPUBuffer twiddles(uint32_t n);
+    WGPUBuffer scratch(uint64_t size);
+
+    WGPUDevice m_device;
+    uint32_t m_maxGroupsPerDimension;
+    WGPUShaderModule m_module = nullptr;
+    std::map<uint32_t, WGPUComputePipeline> m_pipelines;
+    std::map<uint32_t, WGPUBuffer> m_twiddles;
+    WGPUBuffer m_scratch = nullptr;
+    uint64_t m_scratchSize = 0;
+    std::vector<WGPUBuffer> m_retired;     // replaced scratch, released once recorded
+};
+
+/**
+ * Reference DFT of `batch` consecutive signals of n values, in double
+ * precision, to verify the GPU results; n must be a power of two.
+ */
+void cpuFft(std::vector<std::complex<float>> & data, uint32_t n, uint32_t batch, bool inverse);
@@ -0,0 +1,551 @@
+#include "gemm.h"
+#include "gpu_timer.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <tuple>
+
+namespace
+{
+
+/**
+ * Tile shapes tried, in order of preference for large matrices. Workgroups
+ * range from 128 to 256 invocations, staged tiles from 2 KiB to 8 KiB of f32.
+ */
+std::vector<Gemm::Variant> const allVariants = {
+    { 64, 64, 16, 4, 4 },
+    { 64, 64, 8, 4, 4 },
+    { 128, 64, 8, 8, 4 },
+    { 32, 64, 16, 4, 4 },
+    { 64, 32, 16, 4, 2 },
+    { 32, 32, 16, 2, 2 },
+    { 16, 16, 16, 1, 1 },
+};
+
+// each thread owns the rows local.y + i * WGY and the columns local.x + j * WGX
+// of the workgroup tile, so that neighbouring threads read neighbouring
+// elements of the staged tiles and write neighbouring elements of C
+char const * kernelSource = R"(
+struct Params
+{
+    m: u32,
+    n: u32,
+    k: u32,
+    padding: u32,
+}
+
+const WGX = BN / TN;
+const WGY = BM / TM;
+const THREADS = WGX * WGY;
+
+@group(0) @binding(0) var<storage, read> a: array<T>;
+@group(0) @binding(1) var<storage, read> b: array<T>;
+@group(0) @binding(2) var<storage, read_write> c: array<T>;
+@group(0) @binding(3) var<uniform> params: Params;
+
+var<workgroup> tileA: array<T, BM * BK>;
+var<workgroup> tileB: array<T, BK * BN>;
+
+@compute @workgroup_size(WGX, WGY)
+fn main(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(local_invocation_id) local: vec3u,
+    @builtin(local_invocation_index) index: u32)
+{
+    let row0 = group.y * BM;
+    let col0 = group.x * BN;
+    var sum: array<T, TM * TN>;
+    var aRegister: array<T, TM>;
+    var bRegister: array<T, TN>;
+
+    for (var k0 = 0u; k0 < params.k; k0 += BK)
+    {
+        for (var i = index; i < BM * BK; i += THREADS)
+        {
+            let row = row0 + i / BK;
+            let k = k0 + i % BK;
+            var value = T(0);
+            if (row < params.m && k < params.k)
+            {
+                value = a[row * params.k + k];
+            }
+            tileA[i] = value;
+        }
+        for (var i = index; i < BK * BN; i += THREADS)
+        {
+            let k = k0 + i / BN;
+            let col = col0 + i % BN;
+            var value = T(0);
+            if (k < params.k && col < params.n)
+            {
+                value = b[k * params.n + col];
+            }
+            tileB[i] = value;
+        }
+        workgroupBarrier();
+
+        for (var k = 0u; k < BK; k++)
+        {
+            for (var i = 0u; i < TM; i++)
+            {
+                aRegister[i] = tileA[(local.y + i * WGY) * BK + k];
+            }
+            for (var j = 0u; j < TN; j++)
+            {
+                bRegister[j] = tileB[k * BN + local.x + j * WGX];
+            }
+            for (var i = 0u; i < TM; i++)
+            {
+                for (var j = 0u; j < TN; j++)
+                {
+                    sum[i * TN + j] = fma(aRegister[i], bRegister[j], sum[i * TN + j]);
+                }
+            }
+        }
+        workgroupBarrier();
+    }
+
+    for (var i = 0u; i < TM; i++)
+    {
+        let row = row0 + local.y + i * WGY;
+        for (var j = 0u; j < TN; j++)
+        {
+            let col = col0 + local.x + j * WGX;
+            if (row < params.m && col < params.n)
+            {
+                c[row * params.n + col] = sum[i * TN + j];
+            }
+        }
+    }
+}
+)";
+
+// the tile sizes size function-scope arrays, which overrides cannot do
+std::string kernelPrelude(Gemm::Variant const & variant, Gemm::Precision precision)
+{
+    std::string prelude = precision == Gemm::Precision::F16 ? "enable f16;\nalias T = f16;\n" : "alias T = f32;\n";
+    prelude += "const BM = " + std::to_string(variant.tileM) + "u;\n";
+    prelude += "const BN = " + std::to_string(variant.tileN) + "u;\n";
+    prelude += "const BK = " + std::to_string(variant.tileK) + "u;\n";
+    prelude += "const TM = " + std::to_string(variant.threadM) + "u;\n";
+    prelude += "const TN = " + std::to_string(variant.threadN) + "u;\n";
+    return prelude;
+}
+
+uint32_t divideRoundingUp(uint32_t a, uint32_t b)
+{
+    return (a + b - 1) / b;
+}
+
+uint32_t roundUpToPowerOfTwo(uint32_t value)
+{
+    uint32_t result = 1;
+    while (result < value && result < (1u << 31))
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+char const * precisionName(Gemm::Precision precision)
+{
+    return precision == Gemm::Precision::F16 ? "f16" : "f32";
+}
+
+WGPUBuffer createMatrix(WGPUDevice device, uint64_t size)
+{
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "GEMM tuning matrix";
+    bufferDesc.usage = WGPUBufferUsage_Storage;
+    bufferDesc.size = std::max<uint64_t>((size + 3) & ~uint64_t(3), 16);
+    bufferDesc.mappedAtCreation = false;
+    return wgpuDeviceCreateBuffer(device, &bufferDesc);
+}
+
+} // namespace
+
+std::string Gemm::Variant::name() const
+{
+    char text[64];
+    std::snprintf(text, sizeof(text), "%ux%ux%u/%ux%u", tileM, tileN, tileK, threadM, threadN);
+    return text;
+}
+
+bool Gemm::Variant::parse(std::string const & text)
+{
+    Variant parsed = {};
+    if (std::sscanf(text.c_str(), "%ux%ux%u/%ux%u",
+            &parsed.tileM, &parsed.tileN, &parsed.tileK, &parsed.threadM, &parsed.threadN) != 5)
+    {
+        return false;
+    }
+    *this = parsed;
+    return true;
+}
+
+bool Gemm::Variant::operator<(Variant const & other) const
+{
+    return std::tie(tileM, tileN, tileK, threadM, threadN)
+        < std::tie(other.tileM, other.tileN, other.tileK, other.threadM, other.threadN);
+}
+
+bool Gemm::Variant::operator==(Variant const & other) const
+{
+    return std::tie(tileM, tileN, tileK, threadM, threadN)
+        == std::tie(other.tileM, other.tileN, other.tileK, other.threadM, other.threadN);
+}
+
+std::vector<Gemm::Variant> const & Gemm::variants()
+{
+    return allVariants;
+}
+
+Gemm::Gemm(WGPUDevice device, WGPUQueue queue, TuningCache * cache)
+    : m_device(device)
+    , m_queue(queue)
+    , m_cache(cache)
+{
+    m_f16 = wgpuDeviceHasFeature(device, WGPUFeatureName_ShaderF16);
+
+    WGPUSupportedLimits supported = {};
+    supported.nextInChain = nullptr;
+    wgpuDeviceGetLimits(device, &supported);
+    WGPULimits const & limits = supported.limits;
+    for (Variant const & variant : allVariants)
+    {
+        uint32_t x = variant.workgroupSizeX();
+        uint32_t y = variant.workgroupSizeY();
+        // sized for f32, so that both precisions share the candidates
+        uint32_t storage = (variant.tileM * variant.tileK + variant.tileK * variant.tileN) * sizeof(float);
+        if (x <= limits.maxComputeWorkgroupSizeX
+            && y <= limits.maxComputeWorkgroupSizeY
+            && x * y <= limits.maxComputeInvocationsPerWorkgroup
+            && storage <= limits.maxComputeWorkgroupStorageSize)
+        {
+            m_candidates.push_back(variant);
+        }
+    }
+    if (m_candidates.empty())
+    {
+        // 16x16 is the WebGPU minimum, a device that rejects it does not exist
+        m_candidates.push_back(allVariants.back());
+    }
+}
+
+Gemm::~Gemm()
+{
+    release();
+}
+
+void Gemm::release()
+{
+    for (auto & entry : m_pipelines)
+    {
+        wgpuComputePipelineRelease(entry.second);
+    }
+    m_pipelines.clear();
+}
+
+std::string Gemm::sizeClass(uint32_t m, uint32_t n, uint32_t k, Precision precision)
+{
+    return std::string("gemm/") + precisionName(precision) + "/" + std::to_string(roundUpToPowerOfTwo(m)) + "x"
+        + std::to_string(roundUpToPowerOfTwo(n)) + "x" + std::to_string(roundUpToPowerOfTwo(k));
+}
+
+Gemm::Variant Gemm::variant(uint32_t m, uint32_t n, uint32_t k, Precision precision) const
+{
+    std::string key = sizeClass(m, n, k, precision);
+    auto tuned = m_tuned.find(key);
+    if (tuned != m_tuned.end())
+    {
+        return tuned->second;
+    }
+    std::string value;
+    Variant cached;
+    if (m_cache && m_cache->find(key, value) && cached.parse(value)
+        && std::find(m_candidates.begin(), m_candidates.end(), cached) != m_candidates.end())
+    {
+        return cached;
+    }
+
+    // small matrices would leave most of a large tile idle
+    if (m < 64 || n < 64)
+    {
+        return *std::min_element(m_candidates.begin(), m_candidates.end(), [](Variant const & a, Variant const & b) {
+            return a.tileM * a.tileN < b.tileM * b.tileN;
+        });
+    }
+    return m_candidates.front();
+}
+
+Gemm::Variant Gemm::tune(uint32_t m, uint32_t n, uint32_t k, Precision precision, int repetitions)
+{
+    if (precision == Precision::F16 && !m_f16)
+    {
+        logError() << "GEMM: f16 needs the ShaderF16 feature";
+        return variant(m, n, k, precision);
+    }
+
+    // contents do not matter for timing
+    uint64_t elementSize = precision == Precision::F16 ? 2 : 4;
+    WGPUBuffer a = createMatrix(m_device, uint64_t(m) * k * elementSize);
+    WGPUBuffer b = createMatrix(m_device, uint64_t(k) * n * elementSize);
+    WGPUBuffer c = createMatrix(m_device, uint64_t(m) * n * elementSize);
+    WGPUBuffer params = createParams(m, n, k);
+
+    GpuTimer timer(m_device, m_queue);
+    Variant best = m_candidates.front();
+    double bestTime = std::numeric_limits<double>::infinity();
+    for (Variant const & candidate : m_candidates)
+    {
+        WGPUComputePipeline kernel = pipeline(candidate, precision);
+        WGPUBindGroup bindGroup = createBindGroup(kernel, a, b, c, params);
+        double time = timer.timeComputePass([&](WGPUComputePassEncoder pass) {
+            dispatch(pass, bindGroup, kernel, candidate, m, n);
+        }, repetitions);
+        wgpuBindGroupRelease(bindGroup);
+        logDebug() << "GEMM " << precisionName(precision) << " " << m << "x" << n << "x" << k
+            << " " << candidate.name() << ": " << time << " ms";
+        if (time < bestTime)
+        {
+            bestTime = time;
+            best = candidate;
+        }
+    }
+
+    for (WGPUBuffer buffer : { a, b, c, params })
+    {
+        wgpuBufferRelease(buffer);
+    }
+
+    std::string key = sizeClass(m, n, k, precision);
+    m_tuned[key] = best;
+    if (m_cache && !m_cache->store(key, best.name()))
+    {
+        logWarn() << "GEMM: could not write the tuning cache";
+    }
+    logInfo() << "GEMM " << key << ": " << best.name() << " (" << bestTime << " ms)";
+    return best;
+}
+
+void Gemm::multiply(
+    WGPUCommandEncoder encoder,
+    WGPUBuffer a,
+    WGPUBuffer b,
+    WGPUBuffer c,
+    uint32_t m,
+    uint32_t n,
+    uint32_t k,
+    Precision precision)
+{
+    multiply(encoder, a, b, c, m, n, k, precision, variant(m, n, k, precision));
+}
+
+void Gemm::multiply(
+    WGPUCommandEncoder encoder,
+    WGPUBuffer a,
+    WGPUBuffer b,
+    WGPUBuffer c,
+    uint32_t m,
+    uint32_t n,
+    uint32_t k,
+    Precision precision,
+    Variant const & variant)
+{
+    if (precision == Precision::F16 && !m_f16)
+    {
+        logError() << "GEMM: f16 needs the ShaderF16 feature";
+        return;
+    }
+    if (m == 0 || n == 0)
+    {
+        return;
+    }
+
+    WGPUComputePipeline kernel = pipeline(variant, precision);
+    WGPUBuffer params = createParams(m, n, k);
+    WGPUBindGroup bindGroup = createBindGroup(kernel, a, b, c, params);
+
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = "GEMM";
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    dispatch(pass, bindGroup, kernel, variant, m, n);
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+
+    // the encoder keeps what the pass uses alive
+    wgpuBindGroupRelease(bindGroup);
+    wgpuBufferRelease(params);
+}
+
+WGPUComputePipeline Gemm::pipeline(Variant const & variant, Precision precision)
+{
+    WGPUComputePipeline & pipeline = m_pipelines[{ variant, precision }];
+    if (pipeline == nullptr)
+    {
+        std::string source = kernelPrelude(variant, precision) + kernelSource;
+        std::string label = std::string("GEMM ") + precisionName(precision) + " " + variant.name();
+        WGPUShaderModule module = createShaderModule(m_device, source.c_str(), label.c_str());
+
+        WGPUComputePipelineDescriptor pipelineDesc = {};
+        pipelineDesc.nextInChain = nullptr;
+        pipelineDesc.label = label.c_str();
+        pipelineDesc.layout = nullptr;
+        pipelineDesc.compute.module = module;
+        pipelineDesc.compute.entryPoint = "main";
+        pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+        wgpuShaderModuleRelease(module);
+    }
+    return pipeline;
+}
+
+void Gemm::dispatch(WGPUComputePassEncoder pass, WGPUBindGroup bindGroup, WGPUComputePipeline pipeline, Variant const & variant, uint32_t m, uint32_t n)
+{
+    wgpuComputePassEncoderSetPipeline(pass, pipeline);
+    wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, divideRoundingUp(n, variant.tileN), divideRoundingUp(m, variant.tileM), 1);
+}
+
+WGPUBindGroup Gemm::createBindGroup(WGPUComputePipeline pipeline, WGPUBuffer a, WGPUBuffer b, WGPUBuffer c, WGPUBuffer params)
+{
+    WGPUBuffer buffers[] = { a, b, c, params };
+    WGPUBindGroupEntry entries[4] = {};
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        entries[i].nextInChain = nullptr;
+        entries[i].binding = i;
+        entries[i].buffer = buffers[i];
+        entries[i].offset = 0;
+        entries[i].size = i < 3 ? WGPU_WHOLE_SIZE : sizeof(Params);
+    }
+    WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(pipeline, 0);
+    WGPUBindGroupDescriptor bindGroupDesc = {};
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label = "GEMM";
+    bindGroupDesc.layout = layout;
+    bindGroupDesc.entryCount = 4;
+    bindGroupDesc.entries = entries;
+    WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc);
+    wgpuBindGroupLayoutRelease(layout);
+    return bindGroup;
+}
+
+WGPUBuffer Gemm::createParams(uint32_t m, uint32_t n, uint32_t k)
+{
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "GEMM params";
+    bufferDesc.usage = WGPUBufferUsage_Uniform;
+    bufferDesc.size = sizeof(Params);
+    bufferDesc.mappedAtCreation = true;
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    Params params = { m, n, k, 0 };
+    std::memcpy(wgpuBufferGetMappedRange(buffer, 0, sizeof(Params)), &params, sizeof(Params));
+    wgpuBufferUnmap(buffer);
+    return buffer;
+}
+
+void cpuGemm(std::vector<float> const & a, std::vector<float> const & b, std::vector<float> & c, uint32_t m, uint32_t n, uint32_t k)
+{
+    c.assign(size_t(m) * n, 0.0f);
+    for (uint32_t row = 0; row < m; ++row)
+    {
+        float * cRow = c.data() + size_t(row) * n;
+        for (uint32_t i = 0; i < k; ++i)
+        {
+            float value = a[size_t(row) * k + i];
+            float const * bRow = b.data() + size_t(i) * n;
+            for (uint32_t col = 0; col < n; ++col)
+            {
+                cRow[col] += value * bRow[col];
+            }
+        }
+    }
+}
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (((bits >> 23) & 0xff) == 0xff)
+    {
+        // infinity stays infinity, NaN stays a quiet NaN
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31)
+    {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return static_cast<uint16_t>(sign);
+        }
+        // subnormal: shift the mantissa with its implicit bit into place
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            ++half;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        // may carry into the exponent, up to infinity, which is the right result
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t value)
+{
+    uint32_t sign = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        bits = sign;
+    }
+    else
+    {
+        // subnormal half, normal float
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
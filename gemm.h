@@ -0,0 +1,148 @@
+#pragma once
+
+#include "tuning_cache.h"
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Dense matrix multiplication C = A * B of row-major matrices, A being
+ * m x k and B k x n, with shared-memory tiled kernels: each workgroup
+ * computes a tileM x tileN block of C from tileK-wide slices of A and B
+ * staged in workgroup memory, each thread a threadM x threadN register
+ * block of it.
+ *
+ * Tile shapes are chosen per size class, from the tuning cache if tune()
+ * ran for it on this adapter, else a default that fits the device limits:
+ *     Gemm gemm(device, queue, &cache);
+ *     gemm.tune(1024, 1024, 1024);      // once, persisted
+ *     gemm.multiply(encoder, a, b, c, 1024, 1024, 1024);
+ *
+ * f16 needs the ShaderF16 feature on the device; f16 kernels accumulate
+ * in f16, so long dot products lose precision quickly.
+ */
+class Gemm
+{
+public:
+    enum class Precision { F32, F16 };
+
+    struct Variant
+    {
+        uint32_t tileM;
+        uint32_t tileN;
+        uint32_t tileK;
+        uint32_t threadM;       // rows of C per thread
+        uint32_t threadN;       // columns of C per thread
+
+        uint32_t workgroupSizeX() const { return tileN / threadN; }
+        uint32_t workgroupSizeY() const { return tileM / threadM; }
+        std::string name() const;
+        bool parse(std::string const & text);
+        bool operator<(Variant const & other) const;
+        bool operator==(Variant const & other) const;
+    };
+
+    /**
+     * The cache may be null, tune() then only lasts as long as the object.
+     */
+    Gemm(WGPUDevice device, WGPUQueue queue, TuningCache * cache = nullptr);
+    ~Gemm();
+
+    Gemm(Gemm const &) = delete;
+    Gemm & operator=(Gemm const &) = delete;
+
+    /**
+     * Every tile shape this class knows, whatever the device.
+     */
+    static std::vector<Variant> const & variants();
+
+    bool supportsF16() const { return m_f16; }
+
+    /**
+     * Tile shapes fitting maxComputeWorkgroupSizeX/Y, the invocation count
+     * and maxComputeWorkgroupStorageSize of the device.
+     */
+    std::vector<Variant> const & candidates() const { return m_candidates; }
+
+    /**
+     * Shape used for the size class of (m, n, k): tuned if known, else the
+     * default one.
+     */
+    Variant variant(uint32_t m, uint32_t n, uint32_t k, Precision precision = Precision::F32) const;
+
+    /**
+     * Time every candidate on the size class of (m, n, k) with scratch
+     * matrices, keep the fastest and store it in the cache.
+     */
+    Variant tune(uint32_t m, uint32_t n, uint32_t k, Precision precision = Precision::F32, int repetitions = 5);
+
+    /**
+     * Record one compute pass computing C. Buffers hold f32 or f16 elements
+     * according to the precision, C is overwritten.
+     */
+    void multiply(
+        WGPUCommandEncoder encoder,
+        WGPUBuffer a,
+        WGPUBuffer b,
+        WGPUBuffer c,
+        uint32_t m,
+        uint32_t n,
+        uint32_t k,
+        Precision precision = Precision::F32);
+
+    /**
+     * Same with an explicit tile shape, e.g. to benchmark them.
+     */
+    void multiply(
+        WGPUCommandEncoder encoder,
+        WGPUBuffer a,
+        WGPUBuffer b,
+        WGPUBuffer c,
+        uint32_t m,
+        uint32_t n,
+        uint32_t k,
+        Precision precision,
+        Variant const & variant);
+
+    void release();
+
+private:
+    struct Params
+    {
+        uint32_t m;
+        uint32_t n;
+        uint32_t k;
+        uint32_t padding;
+    };
+
+    static std::string sizeClass(uint32_t m, uint32_t n, uint32_t k, Precision precision);
+    WGPUComputePipeline pipeline(Variant const & variant, Precision precision);
+    void dispatch(WGPUComputePassEncoder pass, WGPUBindGroup bindGroup, WGPUComputePipeline pipeline, Variant const & variant, uint32_t m, uint32_t n);
+    WGPUBindGroup createBindGroup(WGPUComputePipeline pipeline, WGPUBuffer a, WGPUBuffer b, WGPUBuffer c, WGPUBuffer params);
+    WGPUBuffer createParams(uint32_t m, uint32_t n, uint32_t k);
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    TuningCache * m_cache;
+    bool m_f16 = false;
+    std::vector<Variant> m_candidates;
+    std::map<std::string, Variant> m_tuned;     // by size class, when there is no cache
+    std::map<std::pair<Variant, Precision>, WGPUComputePipeline> m_pipelines;
+};
+
+/**
+ * CPU reference, row-major like the kernels.
+ */
+void cpuGemm(std::vector<float> const & a, std::vector<float> const & b, std::vector<float> & c, uint32_t m, uint32_t n, uint32_t k);
+
+/**
+ * IEEE half-precision conversions for f16 uploads and readbacks, rounding
+ * to nearest even.
+ */
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
@@ -0,0 +1,75 @@
+#include "glsl_frontend.h"
+
+#include <cctype>
+#include <sstream>
+
+bool selectGLSLStage(std::string const & code, WGPUShaderStage & stage, std::string & error)
+{
+    std::istringstream lines(code);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        // tolerate whitespace around '#', "pragma" and the parenthesis
+        std::string compact;
+        for (char c : line)
+        {
+            if (!std::isspace(static_cast<unsigned char>(c))) compact += c;
+        }
+        size_t close = compact.find(')');
+        if (compact.compare(0, 20, "#pragmashader_stage(") != 0 || close == std::string::npos || close < 20)
+        {
+            continue;
+        }
+        std::string name = compact.substr(20, close - 20);
+        if (name == "compute") stage = WGPUShaderStage_Compute;
+        else if (name == "vertex") stage = WGPUShaderStage_Vertex;
+        else if (name == "fragment") stage = WGPUShaderStage_Fragment;
+        else
+        {
+            error = "unknown shader stage '" + name + "'";
+            return false;
+        }
+        return true;
+    }
+    if (stage == WGPUShaderStage_None)
+    {
+        error = "no GLSL stage, use a .comp/.vert/.frag extension or #pragma shader_stage(...)";
+        return false;
+    }
+    return true;
+}
+
+std::vector<ShaderDefines> expandDefinePermutations(std::vector<ShaderDefineAxis> const & axes)
+{
+    std::vector<ShaderDefines> permutations(1);
+    for (auto const & axis : axes)
+    {
+        std::vector<ShaderDefines> expanded;
+        for (auto const & permutation : permutations)
+        {
+            for (auto const & value : axis.values)
+            {
+                expanded.push_back(permutation);
+                expanded.back().push_back({ axis.name, value });
+            }
+        }
+        permutations = std::move(expanded);
+    }
+    return permutations;
+}
+
+std::string permutationName(std::string const & shaderName, ShaderDefines const & defines)
+{
+    if (defines.empty())
+    {
+        return shaderName;
+    }
+    std::string name = shaderName + "[";
+    for (size_t i = 0; i < defines.size(); ++i)
+    {
+        if (i > 0) name += ",";
+        name += defines[i].name;
+        if (!defines[i].value.empty()) name += "=" + defines[i].value;
+    }
+    return name + "]";
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Host-side part of the GLSL ingestion path: stage selection and define
+ * permutations. Modules themselves are created by ShaderModuleCache, which
+ * hands the defines to wgpu-native's GLSL front-end.
+ */
+
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
+using ShaderDefines = std::vector<ShaderDefine>;
+
+/**
+ * One axis of a permutation space, e.g. { "BLOCK_SIZE", { "64", "128" } }.
+ */
+struct ShaderDefineAxis
+{
+    std::string name;
+    std::vector<std::string> values;
+};
+
+/**
+ * Stage of a GLSL source, given the stage guessed from its file extension.
+ * A `#pragma shader_stage(compute)` line (also vertex or fragment), as
+ * understood by glslang, wins over the extension so that generic .glsl
+ * files can be used. Returns false if neither tells the stage.
+ */
+bool selectGLSLStage(std::string const & code, WGPUShaderStage & stage, std::string & error);
+
+/**
+ * Every combination of the axes values, in lexicographic order of the axes
+ * (the last axis varies fastest). No axis gives a single empty permutation.
+ */
+std::vector<ShaderDefines> expandDefinePermutations(std::vector<ShaderDefineAxis> const & axes);
+
+/**
+ * Readable name of a permutation, e.g. "scale.comp[CLAMP=1,BLOCK=64]".
+ */
+std::string permutationName(std::string const & shaderName, ShaderDefines const & defines);
@@ -0,0 +1,587 @@
+#include "gpu_primitives.h"
+#include "utility.h"
+
+#include <cstring>
+
+namespace
+{
+
+// element type and operator of the reduction and scan kernels
+std::string kernelPrelude(GpuPrimitives::Scalar type, GpuPrimitives::ReduceOp op)
+{
+    char const * typeName = "u32";
+    char const * zero = "0u";
+    char const * lowest = "0u";
+    char const * highest = "0xffffffffu";
+    if (type == GpuPrimitives::Scalar::I32)
+    {
+        typeName = "i32";
+        zero = "0i";
+        lowest = "-2147483647i - 1i";
+        highest = "2147483647i";
+    }
+    else if (type == GpuPrimitives::Scalar::F32)
+    {
+        typeName = "f32";
+        zero = "0.0f";
+        lowest = "-3.40282347e+38f";
+        highest = "3.40282347e+38f";
+    }
+
+    std::string prelude = std::string("alias T = ") + typeName + ";\n";
+    switch (op)
+    {
+    case GpuPrimitives::ReduceOp::Sum:
+        prelude += std::string("const IDENTITY: T = ") + zero + ";\n"
+            "fn combine(a: T, b: T) -> T { return a + b; }\n";
+        break;
+    case GpuPrimitives::ReduceOp::Min:
+        prelude += std::string("const IDENTITY: T = ") + highest + ";\n"
+            "fn combine(a: T, b: T) -> T { return min(a, b); }\n";
+        break;
+    case GpuPrimitives::ReduceOp::Max:
+        prelude += std::string("const IDENTITY: T = ") + lowest + ";\n"
+            "fn combine(a: T, b: T) -> T { return max(a, b); }\n";
+        break;
+    }
+    return prelude;
+}
+
+// workgroups are laid out on two dimensions past 65535 of them
+char const * commonSource = R"(
+struct Params {
+    count: u32,
+    shift: u32,
+    exclusive: u32,
+    groups: u32,
+}
+
+fn groupIndex(wid: vec3<u32>, nwg: vec3<u32>) -> u32 {
+    return wid.x + wid.y * nwg.x;
+}
+)";
+
+char const * reduceScanSource = R"(
+@group(0) @binding(0) var<storage, read> reduceInput: array<T>;
+@group(0) @binding(1) var<storage, read_write> reduceOutput: array<T>;
+@group(0) @binding(2) var<uniform> reduceParams: Params;
+
+var<workgroup> partials: array<T, 256>;
+
+@compute @workgroup_size(256)
+fn reduce(@builtin(local_invocation_id) lid: vec3<u32>, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) nwg: vec3<u32>) {
+    let group = groupIndex(wid, nwg);
+    var acc = IDENTITY;
+    for (var k = 0u; k < 4u; k++) {
+        let i = group * 1024u + k * 256u + lid.x;
+        if (i < reduceParams.count) {
+            acc = combine(acc, reduceInput[i]);
+        }
+    }
+    partials[lid.x] = acc;
+    workgroupBarrier();
+    for (var stride = 128u; stride > 0u; stride >>= 1u) {
+        if (lid.x < stride) {
+            partials[lid.x] = combine(partials[lid.x], partials[lid.x + stride]);
+        }
+        workgroupBarrier();
+    }
+    if (lid.x == 0u && group < reduceParams.groups) {
+        reduceOutput[group] = partials[0];
+    }
+}
+
+@group(0) @binding(0) var<storage, read> scanInput: array<T>;
+@group(0) @binding(1) var<storage, read_write> scanOutput: array<T>;
+@group(0) @binding(2) var<storage, read_write> blockSums: array<T>;
+@group(0) @binding(3) var<uniform> scanParams: Params;
+
+var<workgroup> threadSums: array<T, 256>;
+
+// each thread scans 4 consecutive elements, then the workgroup scans the
+// thread totals; the block total goes to blockSums for the next level
+@compute @workgroup_size(256)
+fn scanBlocks(@builtin(local_invocation_id) lid: vec3<u32>, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) nwg: vec3<u32>) {
+    let group = groupIndex(wid, nwg);
+    let base = group * 1024u + lid.x * 4u;
+    var items: array<T, 4>;
+    var running = IDENTITY;
+    for (var k = 0u; k < 4u; k++) {
+        var x = IDENTITY;
+        if (base + k < scanParams.count) {
+            x = scanInput[base + k];
+        }
+        items[k] = x;
+        running = running + x;
+    }
+    threadSums[lid.x] = running;
+    workgroupBarrier();
+    for (var offset = 1u; offset < 256u; offset <<= 1u) {
+        var value = threadSums[lid.x];
+        if (lid.x >= offset) {
+            value = value + threadSums[lid.x - offset];
+        }
+        workgroupBarrier();
+        threadSums[lid.x] = value;
+        workgroupBarrier();
+    }
+
+    var prefix = IDENTITY;
+    if (lid.x > 0u) {
+        prefix = threadSums[lid.x - 1u];
+    }
+    for (var k = 0u; k < 4u; k++) {
+        let i = base + k;
+        let before = prefix;
+        prefix = prefix + items[k];
+        if (i < scanParams.count) {
+            scanOutput[i] = select(prefix, before, scanParams.exclusive != 0u);
+        }
+    }
+    if (lid.x == 255u && group < scanParams.groups) {
+        blockSums[group] = threadSums[255];
+    }
+}
+
+@group(0) @binding(0) var<storage, read_write> scanData: array<T>;
+@group(0) @binding(1) var<storage, read> scannedSums: array<T>;
+@group(0) @binding(2) var<uniform> addParams: Params;
+
+@compute @workgroup_size(256)
+fn addBlockOffsets(@builtin(local_invocation_id) lid: vec3<u32>, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) nwg: vec3<u32>) {
+    let group = groupIndex(wid, nwg);
+    if (group == 0u || group >= addParams.groups) {
+        return;
+    }
+    let offset = scannedSums[group - 1u];
+    for (var k = 0u; k < 4u; k++) {
+        let i = group * 1024u + k * 256u + lid.x;
+        if (i < addParams.count) {
+            scanData[i] = scanData[i] + offset;
+        }
+    }
+}
+)";
+
+// u32 only, elements are moved as raw 32-bit words
+char const * compactSortSource = R"(
+@group(0) @binding(0) var<storage, read> compactInput: array<u32>;
+@group(0) @binding(1) var<storage, read> compactFlags: array<u32>;
+@group(0) @binding(2) var<storage, read> compactOffsets: array<u32>;
+@group(0) @binding(3) var<storage, read_write> compactOutput: array<u32>;
+@group(0) @binding(4) var<storage, read_write> compactCount: array<u32>;
+@group(0) @binding(5) var<uniform> compactParams: Params;
+
+@compute @workgroup_size(256)
+fn compactScatter(@builtin(local_invocation_id) lid: vec3<u32>, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) nwg: vec3<u32>) {
+    let i = groupIndex(wid, nwg) * 256u + lid.x;
+    if (i >= compactParams.count) {
+        return;
+    }
+    let keep = compactFlags[i] != 0u;
+    if (keep) {
+        compactOutput[compactOffsets[i]] = compactInput[i];
+    }
+    if (i == compactParams.count - 1u) {
+        compactCount[0] = compactOffsets[i] + select(0u, 1u, keep);
+    }
+}
+
+@group(0) @binding(0) var<storage, read> histogramKeys: array<u32>;
+@group(0) @binding(1) var<storage, read_write> histogram: array<u32>;
+@group(0) @binding(2) var<uniform> histogramParams: Params;
+
+var<workgroup> digitCounts: array<atomic<u32>, 16>;
+
+// digit-major, so that the exclusive scan of the histogram gives the
+// output offset of each digit of each block
+@compute @workgroup_size(256)
+fn radixHistogram(@builtin(local_invocation_id) lid: vec3<u32>, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) nwg: vec3<u32>) {
+    let group = groupIndex(wid, nwg);
+    if (lid.x < 16u) {
+        atomicStore(&digitCounts[lid.x], 0u);
+    }
+    workgroupBarrier();
+    for (var k = 0u; k < 4u; k++) {
+        let i = group * 1024u + k * 256u + lid.x;
+        if (i < histogramParams.count) {
+            atomicAdd(&digitCounts[(histogramKeys[i] >> histogramParams.shift) & 15u], 1u);
+        }
+    }
+    workgroupBarrier();
+    if (lid.x < 16u && group < histogramParams.groups) {
+        histogram[lid.x * histogramParams.groups + group] = atomicLoad(&digitCounts[lid.x]);
+    }
+}
+
+override HAS_VALUES: bool = false;
+
+@group(0) @binding(0) var<storage, read> keysIn: array<u32>;
+@group(0) @binding(1) var<storage, read_write> keysOut: array<u32>;
+@group(0) @binding(2) var<storage, read> valuesIn: array<u32>;
+@group(0) @binding(3) var<storage, read_write> valuesOut: array<u32>;
+@group(0) @binding(4) var<storage, read> digitOffsets: array<u32>;
+@group(0) @binding(5) var<uniform> scatterParams: Params;
+
+var<workgroup> localKeys: array<u32, 1024>;
+var<workgroup> localValues: array<u32, 1024>;
+var<workgroup> zeroCounts: array<u32, 256>;
+var<workgroup> digitStarts: array<u32, 16>;
+
+fn digitOf(key: u32) -> u32 {
+    return (key >> scatterParams.shift) & 15u;
+}
+
+// the block is sorted by digit in workgroup memory with four stable 1-bit
+// splits, then each element goes to the offset of its digit in its block
+@compute @workgroup_size(256)
+fn radixScatter(@builtin(local_invocation_id) lid: vec3<u32>, @builtin(workgroup_id) wid: vec3<u32>, @builtin(num_workgroups) nwg: vec3<u32>) {
+    let group = groupIndex(wid, nwg);
+    let base = group * 1024u;
+
+    // out of range elements sort last, as the largest digit
+    for (var k = 0u; k < 4u; k++) {
+        let j = lid.x * 4u + k;
+        var key = 0xffffffffu;
+        var value = 0u;
+        if (base + j < scatterParams.count) {
+            key = keysIn[base + j];
+            if (HAS_VALUES) {
+                value = valuesIn[base + j];
+            }
+        }
+        localKeys[j] = key;
+        localValues[j] = value;
+    }
+    workgroupBarrier();
+
+    for (var bit = 0u; bit < 4u; bit++) {
+        var myKeys: array<u32, 4>;
+        var myValues: array<u32, 4>;
+        var zeros = 0u;
+        for (var k = 0u; k < 4u; k++) {
+            myKeys[k] = localKeys[lid.x * 4u + k];
+            myValues[k] = localValues[lid.x * 4u + k];
+            zeros += 1u - ((myKeys[k] >> (scatterParams.shift + bit)) & 1u);
+        }
+        zeroCounts[lid.x] = zeros;
+        workgroupBarrier();
+        for (var offset = 1u; offset < 256u; offset <<= 1u) {
+            var value = zeroCounts[lid.x];
+            if (lid.x >= offset) {
+                value += zeroCounts[lid.x - offset];
+            }
+            workgroupBarrier();
+            zeroCounts[lid.x] = value;
+            workgroupBarrier();
+        }
+        let totalZeros = zeroCounts[255];
+        var zerosBefore = zeroCounts[lid.x] - zeros;
+        var onesBefore = lid.x * 4u - zerosBefore;
+        for (var k = 0u; k < 4u; k++) {
+            var destination = 0u;
+            if (((myKeys[k] >> (scatterParams.shift + bit)) & 1u) == 0u) {
+                destination = zerosBefore;
+                zerosBefore++;
+            } else {
+                destination = totalZeros + onesBefore;
+                onesBefore++;
+            }
+            localKeys[destination] = myKeys[k];
+            localValues[destination] = myValues[k];
+        }
+        workgroupBarrier();
+    }
+
+    for (var k = 0u; k < 4u; k++) {
+        let j = lid.x * 4u + k;
+        let digit = digitOf(localKeys[j]);
+        if (j == 0u || digitOf(localKeys[j - 1u]) != digit) {
+            digitStarts[digit] = j;
+        }
+    }
+    workgroupBarrier();
+
+    if (group >= scatterParams.groups) {
+        return;
+    }
+    let validCount = min(1024u, scatterParams.count - base);
+    for (var k = 0u; k < 4u; k++) {
+        let j = k * 256u + lid.x;
+        if (j < validCount) {
+            let key = localKeys[j];
+            let digit = digitOf(key);
+            let destination = digitOffsets[digit * scatterParams.groups + group] + j - digitStarts[digit];
+            keysOut[destination] = key;
+            if (HAS_VALUES) {
+                valuesOut[destination] = localValues[j];
+            }
+        }
+    }
+}
+)";
+
+uint32_t divideRoundingUp(uint32_t a, uint32_t b)
+{
+    return (a + b - 1) / b;
+}
+
+uint64_t bufferSize(WGPUBuffer buffer)
+{
+    return wgpuBufferGetSize(buffer);
+}
+
+} // namespace
+
+GpuPrimitives::GpuPrimitives(WGPUDevice device)
+    : m_device(device)
+    , m_pipelines(device)
+{}
+
+GpuPrimitives::~GpuPrimitives()
+{
+    release();
+}
+
+void GpuPrimitives::release()
+{
+    m_pipelines.release();
+    for (auto & entry : m_modules)
+    {
+        wgpuShaderModuleRelease(entry.second);
+    }
+    m_modules.clear();
+    for (auto & entry : m_scratch)
+    {
+        if (entry.first) wgpuBufferRelease(entry.first);
+    }
+    m_scratch.clear();
+    for (WGPUBuffer buffer : m_retired)
+    {
+        wgpuBufferRelease(buffer);
+    }
+    m_retired.clear();
+}
+
+WGPUComputePipeline GpuPrimitives::pipeline(Scalar type, ReduceOp op, char const * entryPoint, SpecializationConstants const & constants)
+{
+    WGPUShaderModule & module = m_modules[{ type, op }];
+    if (module == nullptr)
+    {
+        std::string source = kernelPrelude(type, op) + commonSource + reduceScanSource;
+        if (type == Scalar::U32 && op == ReduceOp::Sum)
+        {
+            source += compactSortSource;
+        }
+        module = createShaderModule(m_device, source.c_str(), "Compute primitives");
+    }
+    // explicit layouts would not save much, every kernel has its own bindings
+    return m_pipelines.computePipeline(module, entryPoint, nullptr, constants, entryPoint);
+}
+
+WGPUBuffer GpuPrimitives::scratch(uint32_t slot, uint64_t size)
+{
+    if (m_scratch.size() <= slot)
+    {
+        m_scratch.resize(slot + 1, { nullptr, 0 });
+    }
+    auto & entry = m_scratch[slot];
+    size = std::max<uint64_t>(size, 16);
+    if (entry.second < size)
+    {
+        // the old buffer may already be referenced by the steps recorded so far
+        if (entry.first) m_retired.push_back(entry.first);
+        WGPUBufferDescriptor bufferDesc = {};
+        bufferDesc.nextInChain = nullptr;
+        bufferDesc.label = "Primitive scratch";
+        bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+        bufferDesc.size = (size + 3) & ~uint64_t(3);
+        bufferDesc.mappedAtCreation = false;
+        entry.first = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+        entry.second = bufferDesc.size;
+    }
+    return entry.first;
+}
+
+void GpuPrimitives::run(WGPUCommandEncoder encoder, char const * label, std::vector<Step> const & steps)
+{
+    if (steps.empty())
+    {
+        return;
+    }
+
+    // one uniform buffer holds the params of every step, at the offset alignment
+    constexpr uint64_t paramStride = 256;
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Primitive params";
+    bufferDesc.usage = WGPUBufferUsage_Uniform;
+    bufferDesc.size = paramStride * steps.size();
+    bufferDesc.mappedAtCreation = true;
+    WGPUBuffer paramBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    uint8_t * mapped = static_cast<uint8_t *>(wgpuBufferGetMappedRange(paramBuffer, 0, bufferDesc.size));
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        std::memcpy(mapped + i * paramStride, &steps[i].params, sizeof(Params));
+    }
+    wgpuBufferUnmap(paramBuffer);
+
+    std::vector<WGPUBindGroup> bindGroups;
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        Step const & step = steps[i];
+        std::vector<WGPUBindGroupEntry> entries(step.buffers.size() + 1);
+        for (size_t b = 0; b < entries.size(); ++b)
+        {
+            WGPUBindGroupEntry & entry = entries[b];
+            entry.nextInChain = nullptr;
+            entry.binding = static_cast<uint32_t>(b);
+            entry.buffer = b < step.buffers.size() ? step.buffers[b] : paramBuffer;
+            entry.offset = b < step.buffers.size() ? 0 : i * paramStride;
+            entry.size = b < step.buffers.size() ? bufferSize(step.buffers[b]) : sizeof(Params);
+        }
+        WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(step.pipeline, 0);
+        WGPUBindGroupDescriptor bindGroupDesc = {};
+        bindGroupDesc.nextInChain = nullptr;
+        bindGroupDesc.label = label;
+        bindGroupDesc.layout = layout;
+        bindGroupDesc.entryCount = entries.size();
+        bindGroupDesc.entries = entries.data();
+        bindGroups.push_back(wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc));
+        wgpuBindGroupLayoutRelease(layout);
+    }
+
+    // dispatches of a pass see the writes of the previous ones
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = label;
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        uint32_t groups = std::max(1u, steps[i].params.groups);
+        uint32_t x = std::min(groups, 65535u);
+        wgpuComputePassEncoderSetPipeline(pass, steps[i].pipeline);
+        wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroups[i], 0, nullptr);
+        wgpuComputePassEncoderDispatchWorkgroups(pass, x, divideRoundingUp(groups, x), 1);
+    }
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+
+    // the encoder keeps what the pass uses alive
+    for (WGPUBindGroup bindGroup : bindGroups)
+    {
+        wgpuBindGroupRelease(bindGroup);
+    }
+    wgpuBufferRelease(paramBuffer);
+    for (WGPUBuffer buffer : m_retired)
+    {
+        wgpuBufferRelease(buffer);
+    }
+    m_retired.clear();
+}
+
+void GpuPrimitives::reduce(WGPUCommandEncoder encoder, WGPUBuffer input, uint32_t count, WGPUBuffer output, Scalar type, ReduceOp op)
+{
+    // one partial per workgroup, until a single workgroup is left
+    std::vector<Step> steps;
+    WGPUComputePipeline kernel = pipeline(type, op, "reduce");
+    WGPUBuffer source = input;
+    uint32_t remaining = count;
+    for (uint32_t level = 0;; ++level)
+    {
+        uint32_t groups = std::max(1u, divideRoundingUp(remaining, elementsPerWorkgroup));
+        WGPUBuffer destination = groups == 1 ? output : scratch(level % 2 ? ReducePong : ReducePing, uint64_t(groups) * 4);
+        steps.push_back({ kernel, { source, destination }, { remaining, 0, 0, groups } });
+        if (groups == 1)
+        {
+            break;
+        }
+        source = destination;
+        remaining = groups;
+    }
+    run(encoder, "Reduce", steps);
+}
+
+void GpuPrimitives::appendScan(std::vector<Step> & steps, WGPUBuffer input, WGPUBuffer output, uint32_t count, Scalar type, bool exclusive, uint32_t level)
+{
+    uint32_t groups = std::max(1u, divideRoundingUp(count, elementsPerWorkgroup));
+    WGPUBuffer sums = scratch(ScanLevels + 2 * level, uint64_t(groups) * 4);
+    steps.push_back({ pipeline(type, ReduceOp::Sum, "scanBlocks"), { input, output, sums }, { count, 0, exclusive ? 1u : 0u, groups } });
+    if (groups == 1)
+    {
+        return;
+    }
+    // block totals are scanned in turn and added to the following blocks
+    WGPUBuffer scannedSums = scratch(ScanLevels + 2 * level + 1, uint64_t(groups) * 4);
+    appendScan(steps, sums, scannedSums, groups, type, false, level + 1);
+    steps.push_back({ pipeline(type, ReduceOp::Sum, "addBlockOffsets"), { output, scannedSums }, { count, 0, 0, groups } });
+}
+
+void GpuPrimitives::inclusiveScan(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer output, uint32_t count, Scalar type)
+{
+    std::vector<Step> steps;
+    appendScan(steps, input, output, count, type, false, 0);
+    run(encoder, "Inclusive scan", steps);
+}
+
+void GpuPrimitives::exclusiveScan(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer output, uint32_t count, Scalar type)
+{
+    std::vector<Step> steps;
+    appendScan(steps, input, output, count, type, true, 0);
+    run(encoder, "Exclusive scan", steps);
+}
+
+void GpuPrimitives::compact(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer flags, uint32_t count, WGPUBuffer output, WGPUBuffer outputCount)
+{
+    if (count == 0)
+    {
+        wgpuCommandEncoderClearBuffer(encoder, outputCount, 0, 4);
+        return;
+    }
+    std::vector<Step> steps;
+    WGPUBuffer offsets = scratch(CompactOffsets, uint64_t(count) * 4);
+    appendScan(steps, flags, offsets, count, Scalar::U32, true, 0);
+    steps.push_back({
+        pipeline(Scalar::U32, ReduceOp::Sum, "compactScatter"),
+        { input, flags, offsets, output, outputCount },
+        { count, 0, 0, divideRoundingUp(count, 256) }
+    });
+    run(encoder, "Compact", steps);
+}
+
+void GpuPrimitives::radixSort(WGPUCommandEncoder encoder, WGPUBuffer keys, uint32_t count, WGPUBuffer values)
+{
+    if (count <= 1)
+    {
+        return;
+    }
+    bool hasValues = values != nullptr;
+    uint32_t groups = divideRoundingUp(count, elementsPerWorkgroup);
+    WGPUComputePipeline histogramKernel = pipeline(Scalar::U32, ReduceOp::Sum, "radixHistogram");
+    WGPUComputePipeline scatterKernel = pipeline(Scalar::U32, ReduceOp::Sum, "radixScatter",
+        SpecializationConstants().set("HAS_VALUES", hasValues ? 1 : 0));
+
+    WGPUBuffer otherKeys = scratch(SortKeys, uint64_t(count) * 4);
+    // without values, the value bindings point to small placeholders
+    WGPUBuffer otherValues = hasValues ? scratch(SortValues, uint64_t(count) * 4) : scratch(DummyValuesOut, 16);
+    if (!hasValues) values = scratch(DummyValuesIn, 16);
+    WGPUBuffer histogram = scratch(SortHistogram, uint64_t(groups) * 16 * 4);
+    WGPUBuffer offsets = scratch(SortOffsets, uint64_t(groups) * 16 * 4);
+
+    // an even number of passes leaves the result in the caller's buffers
+    std::vector<Step> steps;
+    for (uint32_t shift = 0; shift < 32; shift += 4)
+    {
+        bool forward = shift % 8 == 0;
+        WGPUBuffer keysIn = forward ? keys : otherKeys;
+        WGPUBuffer keysOut = forward ? otherKeys : keys;
+        WGPUBuffer valuesIn = !hasValues || forward ? values : otherValues;
+        WGPUBuffer valuesOut = !hasValues || forward ? otherValues : values;
+        Params params = { count, shift, 0, groups };
+        steps.push_back({ histogramKernel, { keysIn, histogram }, params });
+        appendScan(steps, histogram, offsets, groups * 16, Scalar::U32, true, 0);
+        steps.push_back({ scatterKernel, { keysIn, keysOut, valuesIn, valuesOut, offsets }, params });
+    }
+    run(encoder, hasValues ? "Radix sort (pairs)" : "Radix sort", steps);
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "pipeline_specialization.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+/**
+ * Data-parallel building blocks on the GPU: reduction, inclusive and
+ * exclusive prefix sums, stream compaction and LSD radix sort of 32-bit
+ * keys, optionally carrying 32-bit values. Each call records one compute
+ * pass into the given encoder:
+ *     GpuPrimitives primitives(device);
+ *     primitives.exclusiveScan(encoder, input, output, count);
+ *     primitives.radixSort(encoder, keys, count, values);
+ *
+ * Workgroups handle 1024 elements each; larger inputs are processed in
+ * levels, with intermediate results in scratch buffers owned by this object
+ * and reused between calls. Inputs and outputs must be distinct storage
+ * buffers. Kernels are compiled on first use per element type and operator.
+ */
+class GpuPrimitives
+{
+public:
+    enum class Scalar { U32, I32, F32 };
+    enum class ReduceOp { Sum, Min, Max };
+
+    static constexpr uint32_t elementsPerWorkgroup = 1024;
+
+    explicit GpuPrimitives(WGPUDevice device);
+    ~GpuPrimitives();
+
+    GpuPrimitives(GpuPrimitives const &) = delete;
+    GpuPrimitives & operator=(GpuPrimitives const &) = delete;
+
+    /**
+     * Combine the `count` first elements of input into the first element
+     * of output. f32 sums depend on the order of the additions, they may
+     * differ from a sequential sum by rounding.
+     */
+    void reduce(
+        WGPUCommandEncoder encoder,
+        WGPUBuffer input,
+        uint32_t count,
+        WGPUBuffer output,
+        Scalar type = Scalar::U32,
+        ReduceOp op = ReduceOp::Sum);
+
+    /**
+     * output[i] = input[0] + ... + input[i].
+     */
+    void inclusiveScan(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer output, uint32_t count, Scalar type = Scalar::U32);
+
+    /**
+     * output[i] = input[0] + ... + input[i - 1], output[0] = 0.
+     */
+    void exclusiveScan(WGPUCommandEncoder encoder, WGPUBuffer input, WGPUBuffer output, uint32_t count, Scalar type = Scalar::U32);
+
+    /**
+     * Copy the 32-bit elements of input whose u32 flag is 1 (flags are 0
+     * or 1) to the front of output, in order, and their number to the
+     * first u32 of outputCount, which is cleared when count is 0 and needs
+     * the CopyDst usage for it.
+     */
+    void compact(
+        WGPUCommandEncoder encoder,
+        WGPUBuffer input,
+        WGPUBuffer flags,
+        uint32_t count,
+        WGPUBuffer output,
+        WGPUBuffer outputCount);
+
+    /**
+     * Stable ascending sort of u32 keys in place, 4 bits per pass, moving
+     * the values along if given. Signed or float keys need the usual bit
+     * flips before and after.
+     */
+    void radixSort(WGPUCommandEncoder encoder, WGPUBuffer keys, uint32_t count, WGPUBuffer values = nullptr);
+
+    size_t pipelineCount() const { return m_pipelines.pipelineCount(); }
+
+    void release();
+
+private:
+    struct Params
+    {
+        uint32_t count;
+        uint32_t shift;         // radix sort digit
+        uint32_t exclusive;
+        uint32_t groups;        // workgroups doing useful work
+    };
+
+    // one dispatch, the params binding follows the buffers
+    struct Step
+    {
+        WGPUComputePipeline pipeline;
+        std::vector<WGPUBuffer> buffers;
+        Params params;
+    };
+
+    enum ScratchSlot : uint32_t
+    {
+        ReducePing,
+        ReducePong,
+        CompactOffsets,
+        SortKeys,
+        SortValues,
+        SortHistogram,
+        SortOffsets,
+        DummyValuesIn,
+        DummyValuesOut,
+        ScanLevels,             // two per level from there
+    };
+
+    WGPUComputePipeline pipeline(Scalar type, ReduceOp op, char const * entryPoint, SpecializationConstants const & constants = {});
+    WGPUBuffer scratch(uint32_t slot, uint64_t size);
+    void appendScan(std::vector<Step> & steps, WGPUBuffer input, WGPUBuffer output, uint32_t count, Scalar type, bool exclusive, uint32_t level);
+    void run(WGPUCommandEncoder encoder, char const * label, std::vector<Step> const & steps);
+
+    WGPUDevice m_device;
+    std::map<std::pair<Scalar, ReduceOp>, WGPUShaderModule> m_modules;
+    SpecializedPipelineCache m_pipelines;
+    std::vector<std::pair<WGPUBuffer, uint64_t>> m_scratch;
+    std::vector<WGPUBuffer> m_retired;     // replaced scratch, released once recorded
+};
+
+/**
+ * CPU references of the primitives, to verify the GPU results.
+ */
+template <typename T>
+T cpuReduce(std::vector<T> const & values, GpuPrimitives::ReduceOp op)
+{
+    switch (op)
+    {
+    case GpuPrimitives::ReduceOp::Min:
+        return values.empty() ? std::numeric_limits<T>::max() : *std::min_element(values.begin(), values.end());
+    case GpuPrimitives::ReduceOp::Max:
+        return values.empty() ? std::numeric_limits<T>::lowest() : *std::max_element(values.begin(), values.end());
+    default:
+        return std::accumulate(values.begin(), values.end(), T(0));
+    }
+}
+
+template <typename T>
+std::vector<T> cpuInclusiveScan(std::vector<T> const & values)
+{
+    std::vector<T> result(values.size());
+    std::partial_sum(values.begin(), values.end(), result.begin());
+    return result;
+}
+
+template <typename T>
+std::vector<T> cpuExclusiveScan(std::vector<T> const & values)
+{
+    std::vector<T> result(values.size());
+    T sum = T(0);
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        result[i] = sum;
+        sum += values[i];
+    }
+    return result;
+}
+
+template <typename T>
+std::vector<T> cpuCompact(std::vector<T> const & values, std::vector<uint32_t> const & flags)
+{
+    std::vector<T> result;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (flags[i] != 0) result.push_back(values[i]);
+    }
+    return result;
+}
+
+/**
+ * Stable sort of the keys, values follow if not empty.
+ */
+inline void cpuRadixSort(std::vector<uint32_t> & keys, std::vector<uint32_t> & values)
+{
+    std::vector<uint32_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    std::vector<uint32_t> sortedKeys(keys.size());
+    std::vector<uint32_t> sortedValues(values.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        sortedKeys[i] = keys[order[i]];
+        if (!values.empty()) sortedValues[i] = values[order[i]];
+    }
+    keys.swap(sortedKeys);
+    values.swap(sortedValues);
+}
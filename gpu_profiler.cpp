@@ -0,0 +1,285 @@
+#include "gpu_profiler.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <iomanip>
+
+GpuProfiler::GpuProfiler(WGPUDevice device, uint32_t maxScopes, uint32_t framesInFlight, uint32_t window)
+    : m_device(device)
+    , m_maxQueries(2 * maxScopes)
+    , m_window(std::max(1u, window))
+{
+    if (!wgpuDeviceHasFeature(device, WGPUFeatureName_TimestampQuery) || maxScopes == 0)
+    {
+        return;
+    }
+
+    m_frames.resize(std::max(1u, framesInFlight));
+    for (Frame & frame : m_frames)
+    {
+        WGPUQuerySetDescriptor querySetDesc = {};
+        querySetDesc.nextInChain = nullptr;
+        querySetDesc.label = "GPU profiler queries";
+        querySetDesc.type = WGPUQueryType_Timestamp;
+        querySetDesc.count = m_maxQueries;
+        frame.querySet = wgpuDeviceCreateQuerySet(device, &querySetDesc);
+
+        WGPUBufferDescriptor bufferDesc = {};
+        bufferDesc.nextInChain = nullptr;
+        bufferDesc.label = "GPU profiler resolve";
+        bufferDesc.usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+        bufferDesc.size = m_maxQueries * sizeof(uint64_t);
+        bufferDesc.mappedAtCreation = false;
+        frame.resolveBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+        bufferDesc.label = "GPU profiler readback";
+        bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+        frame.readbackBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    release();
+}
+
+void GpuProfiler::release()
+{
+    // map callbacks point to the frames, let pending ones land first
+    auto mapping = [this]() {
+        return std::any_of(m_frames.begin(), m_frames.end(), [](Frame const & f) { return f.state == FrameState::Mapping; });
+    };
+    for (int i = 0; i < 100 && mapping(); ++i)
+    {
+        pollDevice(m_device, true);
+    }
+
+    for (Frame & frame : m_frames)
+    {
+        if (frame.state == FrameState::Mapped) wgpuBufferUnmap(frame.readbackBuffer);
+        if (frame.readbackBuffer) wgpuBufferRelease(frame.readbackBuffer);
+        if (frame.resolveBuffer) wgpuBufferRelease(frame.resolveBuffer);
+        if (frame.querySet) wgpuQuerySetRelease(frame.querySet);
+    }
+    m_frames.clear();
+    m_current = nullptr;
+}
+
+void GpuProfiler::beginFrame()
+{
+    collect();
+    m_stack.clear();
+    m_pathStack.clear();
+    m_current = nullptr;
+    if (!enabled())
+    {
+        return;
+    }
+
+    Frame & frame = m_frames[m_frameIndex % m_frames.size()];
+    if (frame.state != FrameState::Idle)
+    {
+        // results of that slot are still on their way back
+        ++m_droppedFrames;
+        return;
+    }
+    frame.records.clear();
+    frame.queryCount = 0;
+    frame.index = m_frameIndex;
+    frame.state = FrameState::Recording;
+    m_current = &frame;
+}
+
+void GpuProfiler::pushScope(WGPUCommandEncoder encoder, char const * label)
+{
+    wgpuCommandEncoderPushDebugGroup(encoder, label);
+    int record = allocateRecord(label);
+    if (record >= 0)
+    {
+        wgpuCommandEncoderWriteTimestamp(encoder, m_current->querySet, m_current->records[record].beginQuery);
+    }
+    m_stack.push_back(record);
+    m_pathStack.push_back(m_pathStack.empty() ? label : m_pathStack.back() + "/" + label);
+}
+
+void GpuProfiler::popScope(WGPUCommandEncoder encoder)
+{
+    if (m_stack.empty())
+    {
+        return;
+    }
+    int record = m_stack.back();
+    if (record >= 0 && m_current)
+    {
+        wgpuCommandEncoderWriteTimestamp(encoder, m_current->querySet, m_current->records[record].endQuery);
+    }
+    m_stack.pop_back();
+    m_pathStack.pop_back();
+    wgpuCommandEncoderPopDebugGroup(encoder);
+}
+
+WGPUComputePassTimestampWrites const * GpuProfiler::computePassTimestampWrites(char const * label)
+{
+    int record = allocateRecord(label);
+    if (record < 0)
+    {
+        return nullptr;
+    }
+    m_computeWrites.querySet = m_current->querySet;
+    m_computeWrites.beginningOfPassWriteIndex = m_current->records[record].beginQuery;
+    m_computeWrites.endOfPassWriteIndex = m_current->records[record].endQuery;
+    return &m_computeWrites;
+}
+
+WGPURenderPassTimestampWrites const * GpuProfiler::renderPassTimestampWrites(char const * label)
+{
+    int record = allocateRecord(label);
+    if (record < 0)
+    {
+        return nullptr;
+    }
+    m_renderWrites.querySet = m_current->querySet;
+    m_renderWrites.beginningOfPassWriteIndex = m_current->records[record].beginQuery;
+    m_renderWrites.endOfPassWriteIndex = m_current->records[record].endQuery;
+    return &m_renderWrites;
+}
+
+int GpuProfiler::allocateRecord(char const * label)
+{
+    if (m_current == nullptr || m_current->queryCount + 2 > m_maxQueries)
+    {
+        return -1;
+    }
+    Record record;
+    record.path = m_pathStack.empty() ? label : m_pathStack.back() + "/" + label;
+    record.depth = static_cast<uint32_t>(m_pathStack.size());
+    record.beginQuery = m_current->queryCount++;
+    record.endQuery = m_current->queryCount++;
+    m_current->records.push_back(std::move(record));
+    return static_cast<int>(m_current->records.size() - 1);
+}
+
+void GpuProfiler::resolve(WGPUCommandEncoder encoder)
+{
+    if (m_current == nullptr || m_current->queryCount == 0)
+    {
+        return;
+    }
+    uint64_t size = m_current->queryCount * sizeof(uint64_t);
+    wgpuCommandEncoderResolveQuerySet(encoder, m_current->querySet, 0, m_current->queryCount, m_current->resolveBuffer, 0);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, m_current->resolveBuffer, 0, m_current->readbackBuffer, 0, size);
+    m_current->state = FrameState::Resolved;
+}
+
+void GpuProfiler::endFrame()
+{
+    ++m_frameIndex;
+    Frame * frame = m_current;
+    m_current = nullptr;
+    if (frame == nullptr)
+    {
+        return;
+    }
+    if (frame->state != FrameState::Resolved)
+    {
+        // resolve() was not recorded, nothing to read back
+        frame->state = FrameState::Idle;
+        return;
+    }
+
+    auto onBufferMapped = [](WGPUBufferMapAsyncStatus status, void * pUserData)
+    {
+        Frame & frame = *reinterpret_cast<Frame *>(pUserData);
+        frame.state = status == WGPUBufferMapAsyncStatus_Success ? FrameState::Mapped : FrameState::Idle;
+    };
+    frame->state = FrameState::Mapping;
+    wgpuBufferMapAsync(frame->readbackBuffer, WGPUMapMode_Read, 0, frame->queryCount * sizeof(uint64_t), onBufferMapped, (void *)frame);
+}
+
+void GpuProfiler::collect()
+{
+    for (Frame & frame : m_frames)
+    {
+        if (frame.state != FrameState::Mapped)
+        {
+            continue;
+        }
+        auto const * timestamps = static_cast<uint64_t const *>(
+            wgpuBufferGetConstMappedRange(frame.readbackBuffer, 0, frame.queryCount * sizeof(uint64_t)));
+        for (Record const & record : frame.records)
+        {
+            uint64_t begin = timestamps[record.beginQuery];
+            uint64_t end = timestamps[record.endQuery];
+            // a scope left open or a reset counter gives no sample
+            if (end > begin)
+            {
+                addSample(record, (end - begin) * 1e-6);
+                if (m_listener) m_listener(record.path, begin, end, frame.index);
+            }
+        }
+        wgpuBufferUnmap(frame.readbackBuffer);
+        frame.state = FrameState::Idle;
+    }
+}
+
+void GpuProfiler::addSample(Record const & record, double milliseconds)
+{
+    auto it = m_statistics.find(record.path);
+    if (it == m_statistics.end())
+    {
+        m_order.push_back(record.path);
+        it = m_statistics.emplace(record.path, RollingStatistics()).first;
+        it->second.depth = record.depth;
+    }
+    RollingStatistics & stats = it->second;
+    if (stats.samples.size() < m_window)
+    {
+        stats.samples.push_back(milliseconds);
+    }
+    else
+    {
+        stats.samples[stats.next] = milliseconds;
+    }
+    stats.next = (stats.next + 1) % m_window;
+}
+
+std::vector<GpuProfiler::ScopeStatistics> GpuProfiler::statistics() const
+{
+    std::vector<ScopeStatistics> result;
+    for (auto const & path : m_order)
+    {
+        RollingStatistics const & stats = m_statistics.at(path);
+        ScopeStatistics scope;
+        scope.path = path;
+        scope.depth = stats.depth;
+        scope.sampleCount = stats.samples.size();
+        scope.lastMs = stats.samples[stats.next == 0 ? stats.samples.size() - 1 : stats.next - 1];
+        scope.minMs = *std::min_element(stats.samples.begin(), stats.samples.end());
+        scope.maxMs = *std::max_element(stats.samples.begin(), stats.samples.end());
+        for (double sample : stats.samples)
+        {
+            scope.meanMs += sample;
+        }
+        scope.meanMs /= stats.samples.size();
+        result.push_back(scope);
+    }
+    return result;
+}
+
+void GpuProfiler::report(std::ostream & out) const
+{
+    if (!enabled())
+    {
+        out << "GPU profiler: timestamp queries not supported" << std::endl;
+        return;
+    }
+    out << "GPU profiler (last " << m_window << " frames, " << m_droppedFrames << " dropped):" << std::endl;
+    for (auto const & scope : statistics())
+    {
+        std::string name = scope.path.substr(scope.path.find_last_of('/') + 1);
+        out << std::string(2 * scope.depth + 2, ' ') << name << std::fixed << std::setprecision(3)
+            << ": last " << scope.lastMs << " ms, mean " << scope.meanMs
+            << " ms, min " << scope.minMs << " ms, max " << scope.maxMs << " ms" << std::endl;
+        out << std::defaultfloat;
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Hierarchical GPU profiler: timestamps are written around debug groups and
+ * at pass boundaries, resolved at the end of each frame into a ring of
+ * readback buffers, and read back a few frames later without stalling.
+ *
+ *     profiler.beginFrame();
+ *     profiler.pushScope(encoder, "Simulation");   // also a debug group
+ *     passDesc.timestampWrites = profiler.computePassTimestampWrites("Fill");
+ *     ...
+ *     profiler.popScope(encoder);
+ *     profiler.resolve(encoder);                   // before finishing it
+ *     wgpuQueueSubmit(...);
+ *     profiler.endFrame();
+ *
+ * Scopes are identified by their path, e.g. "Simulation/Fill", and each
+ * gets rolling statistics over the last frames. Passes are leaves: scopes
+ * cannot be pushed on the encoder while a pass is open.
+ *
+ * Without the TimestampQuery feature, scopes are still debug groups but no
+ * timestamp is written and no statistics are produced.
+ */
+class GpuProfiler
+{
+public:
+    struct ScopeStatistics
+    {
+        std::string path;
+        uint32_t depth = 0;
+        double lastMs = 0.0;
+        double meanMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+        size_t sampleCount = 0;     // in the rolling window
+    };
+
+    /**
+     * maxScopes bounds the scopes and passes timed per frame; frames beyond
+     * framesInFlight still waiting for their results are not profiled.
+     */
+    GpuProfiler(WGPUDevice device, uint32_t maxScopes = 64, uint32_t framesInFlight = 3, uint32_t window = 120);
+    ~GpuProfiler();
+
+    GpuProfiler(GpuProfiler const &) = delete;
+    GpuProfiler & operator=(GpuProfiler const &) = delete;
+
+    bool enabled() const { return !m_frames.empty(); }
+
+    void beginFrame();
+    void pushScope(WGPUCommandEncoder encoder, char const * label);
+    void popScope(WGPUCommandEncoder encoder);
+
+    /**
+     * Timestamp writes timing a pass as a child of the current scope, or
+     * nullptr when not profiling. Valid until the next call.
+     */
+    WGPUComputePassTimestampWrites const * computePassTimestampWrites(char const * label);
+    WGPURenderPassTimestampWrites const * renderPassTimestampWrites(char const * label);
+
+    /**
+     * Copy the timestamps of the frame to its readback buffer; to be
+     * recorded once every scope is closed, in the last encoder of the frame.
+     */
+    void resolve(WGPUCommandEncoder encoder);
+
+    /**
+     * To be called after the submission holding resolve().
+     */
+    void endFrame();
+
+    /**
+     * Pick up the frames whose timestamps were read back. Called by
+     * beginFrame(), which relies on the device being polled meanwhile.
+     */
+    void collect();
+
+    /**
+     * Called by collect() with the raw GPU timestamps of every scope read
+     * back and the index of its frame (counting beginFrame() calls from 0),
+     * e.g. to put them on a trace timeline.
+     */
+    using TimestampListener = std::function<void(std::string const & path, uint64_t beginNs, uint64_t endNs, size_t frame)>;
+    void setTimestampListener(TimestampListener listener) { m_listener = std::move(listener); }
+
+    std::vector<ScopeStatistics> statistics() const;
+    void report(std::ostream & out) const;
+
+    size_t droppedFrameCount() const { return m_droppedFrames; }
+
+    /**
+     * Wait for the pending readbacks and release the GPU objects, before
+     * the device is released. Statistics are kept.
+     */
+    void release();
+
+    /**
+     * RAII helper around pushScope()/popScope().
+     */
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler & profiler, WGPUCommandEncoder encoder, char const * label)
+            : m_profiler(profiler)
+            , m_encoder(encoder)
+        {
+            m_profiler.pushScope(m_encoder, label);
+        }
+        ~Scope() { m_profiler.popScope(m_encoder); }
+
+        Scope(Scope const &) = delete;
+        Scope & operator=(Scope const &) = delete;
+
+    private:
+        GpuProfiler & m_profiler;
+        WGPUCommandEncoder m_encoder;
+    };
+
+private:
+    enum class FrameState
+    {
+        Idle,
+        Recording,
+        Resolved,
+        Mapping,
+        Mapped,
+    };
+
+    struct Record
+    {
+        std::string path;
+        uint32_t depth;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct Frame
+    {
+        WGPUQuerySet querySet = nullptr;
+        WGPUBuffer resolveBuffer = nullptr;
+        WGPUBuffer readbackBuffer = nullptr;
+        std::vector<Record> records;
+        uint32_t queryCount = 0;
+        size_t index = 0;
+        FrameState state = FrameState::Idle;
+    };
+
+    struct RollingStatistics
+    {
+        uint32_t depth = 0;
+        std::vector<double> samples;
+        size_t next = 0;
+    };
+
+    // index of the record, or -1 if the scope is not timed
+    int allocateRecord(char const * label);
+    void addSample(Record const & record, double milliseconds);
+
+    WGPUDevice m_device;
+    uint32_t m_maxQueries;
+    uint32_t m_window;
+    std::vector<Frame> m_frames;
+    Frame * m_current = nullptr;
+    size_t m_frameIndex = 0;
+    size_t m_droppedFrames = 0;
+    std::vector<int> m_stack;
+    std::vector<std::string> m_pathStack;
+    WGPUComputePassTimestampWrites m_computeWrites = {};
+    WGPURenderPassTimestampWrites m_renderWrites = {};
+
+    TimestampListener m_listener;
+    std::vector<std::string> m_order;   // scope paths, first seen first
+    std::map<std::string, RollingStatistics> m_statistics;
+};
@@ -0,0 +1,111 @@
+#include "gpu_timer.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+GpuTimer::GpuTimer(WGPUDevice device, WGPUQueue queue)
+    : m_device(device)
+    , m_queue(queue)
+{
+    if (!wgpuDeviceHasFeature(device, WGPUFeatureName_TimestampQuery))
+    {
+        return;
+    }
+
+    WGPUQuerySetDescriptor querySetDesc = {};
+    querySetDesc.nextInChain = nullptr;
+    querySetDesc.label = "GPU timer queries";
+    querySetDesc.type = WGPUQueryType_Timestamp;
+    querySetDesc.count = 2;
+    m_querySet = wgpuDeviceCreateQuerySet(device, &querySetDesc);
+
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "GPU timer resolve";
+    bufferDesc.usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+    bufferDesc.size = 2 * sizeof(uint64_t);
+    bufferDesc.mappedAtCreation = false;
+    m_resolveBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+    bufferDesc.label = "GPU timer readback";
+    bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    m_readbackBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+}
+
+GpuTimer::~GpuTimer()
+{
+    if (m_readbackBuffer) wgpuBufferRelease(m_readbackBuffer);
+    if (m_resolveBuffer) wgpuBufferRelease(m_resolveBuffer);
+    if (m_querySet) wgpuQuerySetRelease(m_querySet);
+}
+
+double GpuTimer::timeComputePass(PassRecorder const & record, int repetitions)
+{
+    std::vector<double> samples;
+    for (int i = 0; i < std::max(1, repetitions); ++i)
+    {
+        samples.push_back(timeOnce(record));
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+double GpuTimer::timeOnce(PassRecorder const & record)
+{
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = "GPU timer encoder";
+    WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &encoderDesc);
+
+    WGPUComputePassTimestampWrites timestampWrites = {};
+    timestampWrites.querySet = m_querySet;
+    timestampWrites.beginningOfPassWriteIndex = 0;
+    timestampWrites.endOfPassWriteIndex = 1;
+
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = "Timed pass";
+    passDesc.timestampWrites = hasTimestamps() ? &timestampWrites : nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    record(pass);
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+
+    if (hasTimestamps())
+    {
+        wgpuCommandEncoderResolveQuerySet(encoder, m_querySet, 0, 2, m_resolveBuffer, 0);
+        wgpuCommandEncoderCopyBufferToBuffer(encoder, m_resolveBuffer, 0, m_readbackBuffer, 0, 2 * sizeof(uint64_t));
+    }
+
+    WGPUCommandBufferDescriptor cmdBufferDesc = {};
+    cmdBufferDesc.nextInChain = nullptr;
+    cmdBufferDesc.label = "GPU timer commands";
+    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
+
+    auto start = std::chrono::steady_clock::now();
+    wgpuQueueSubmit(m_queue, 1, &command);
+    wgpuCommandBufferRelease(command);
+
+    if (!hasTimestamps())
+    {
+        waitForSubmittedWork(m_device, m_queue);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double milliseconds = 0.0;
+    if (mapBufferSync(m_device, m_readbackBuffer, WGPUMapMode_Read, 0, 2 * sizeof(uint64_t)))
+    {
+        // timestamps are in nanoseconds, as specified by WebGPU
+        auto const * timestamps = static_cast<uint64_t const *>(
+            wgpuBufferGetConstMappedRange(m_readbackBuffer, 0, 2 * sizeof(uint64_t)));
+        if (timestamps[1] > timestamps[0])
+        {
+            milliseconds = (timestamps[1] - timestamps[0]) * 1e-6;
+        }
+        wgpuBufferUnmap(m_readbackBuffer);
+    }
+    return milliseconds;
+}
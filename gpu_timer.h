@@ -0,0 +1,42 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <functional>
+
+/**
+ * One-shot GPU timing of a compute pass, for comparisons such as before
+ * and after a shader reload or between kernel variants.
+ *
+ * With the TimestampQuery feature the pass is timed on the GPU through its
+ * timestampWrites; without it the timer falls back to the CPU wall time
+ * from submit to completion, which includes the submission overhead.
+ */
+class GpuTimer
+{
+public:
+    using PassRecorder = std::function<void(WGPUComputePassEncoder pass)>;
+
+    GpuTimer(WGPUDevice device, WGPUQueue queue);
+    ~GpuTimer();
+
+    GpuTimer(GpuTimer const &) = delete;
+    GpuTimer & operator=(GpuTimer const &) = delete;
+
+    bool hasTimestamps() const { return m_querySet != nullptr; }
+
+    /**
+     * Record the pass `repetitions` times, one submission each, and return
+     * the median duration in milliseconds.
+     */
+    double timeComputePass(PassRecorder const & record, int repetitions = 5);
+
+private:
+    double timeOnce(PassRecorder const & record);
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    WGPUQuerySet m_querySet = nullptr;
+    WGPUBuffer m_resolveBuffer = nullptr;
+    WGPUBuffer m_readbackBuffer = nullptr;
+};
@@ -0,0 +1,741 @@
+#include "image_filters.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+constexpr uint32_t tileSize = 16;
+constexpr uint32_t lineSize = 256;
+
+char const * preludeSource = R"(
+@group(0) @binding(0) var inputImage: texture_2d<f32>;
+@group(0) @binding(1) var outputImage: texture_storage_2d<{FORMAT}, write>;
+
+// outside the image reads its nearest edge pixel
+fn load(p: vec2i) -> vec4f
+{
+    let size = vec2i(textureDimensions(inputImage));
+    return textureLoad(inputImage, clamp(p, vec2i(0), size - 1), 0);
+}
+)";
+
+char const * weightsSource = R"(
+@group(0) @binding(2) var<storage, read> weights: array<f32>;
+)";
+
+// a 16x16 tile of the output per workgroup, the input it needs loaded once
+// into workgroup memory with its halo
+char const * tiledSource = R"(
+const TILE = 16u;
+const RX = {RX}u;
+const RY = {RY}u;
+const W = TILE + 2u * RX;
+const H = TILE + 2u * RY;
+const PER_INVOCATION = (H * TILE + 255u) / 256u;
+
+var<workgroup> tile: array<vec4f, W * H>;
+
+@compute @workgroup_size(16, 16)
+fn main(
+    @builtin(workgroup_id) wid: vec3u,
+    @builtin(local_invocation_id) lid: vec3u,
+    @builtin(local_invocation_index) local: u32)
+{
+    let origin = vec2i(wid.xy * TILE) - vec2i(i32(RX), i32(RY));
+    for (var i = local; i < W * H; i += 256u)
+    {
+        tile[i] = load(origin + vec2i(i32(i % W), i32(i / W)));
+    }
+    workgroupBarrier();
+{FILTER}
+{STORE}
+}
+)";
+
+// horizontal pass over every row of the tile, halo rows included, written
+// back to the tile once every invocation read its inputs, then vertical
+char const * separableFilter = R"(
+    var horizontal: array<vec4f, PER_INVOCATION>;
+    for (var k = 0u; k < PER_INVOCATION; k++)
+    {
+        let i = local + k * 256u;
+        if (i < H * TILE)
+        {
+            var rowSum = vec4f(0.0);
+            for (var t = 0u; t <= 2u * RX; t++)
+            {
+                rowSum += weights[t] * tile[(i / TILE) * W + i % TILE + t];
+            }
+            horizontal[k] = rowSum;
+        }
+    }
+    workgroupBarrier();
+    for (var k = 0u; k < PER_INVOCATION; k++)
+    {
+        let i = local + k * 256u;
+        if (i < H * TILE)
+        {
+            tile[(i / TILE) * W + RX + i % TILE] = horizontal[k];
+        }
+    }
+    workgroupBarrier();
+    var sum = vec4f(0.0);
+    for (var t = 0u; t <= 2u * RY; t++)
+    {
+        sum += weights[2u * RX + 1u + t] * tile[(lid.y + t) * W + RX + lid.x];
+    }
+)";
+
+char const * convolutionFilter = R"(
+    var sum = vec4f(0.0);
+    for (var j = 0u; j <= 2u * RY; j++)
+    {
+        for (var i = 0u; i <= 2u * RX; i++)
+        {
+            sum += weights[j * (2u * RX + 1u) + i] * tile[(lid.y + j) * W + lid.x + i];
+        }
+    }
+)";
+
+char const * plainStore = R"(
+    let p = wid.xy * TILE + lid.xy;
+    if (all(p < textureDimensions(outputImage)))
+    {
+        textureStore(outputImage, p, sum);
+    }
+)";
+
+// 2x2 blocks never straddle tiles; pixels past the edge read the edge
+char const * downsampleStore = R"(
+    workgroupBarrier();
+    tile[local] = sum;
+    workgroupBarrier();
+    if (lid.x < TILE / 2u && lid.y < TILE / 2u)
+    {
+        let last = vec2i(textureDimensions(inputImage)) - 1 - vec2i(wid.xy * TILE);
+        var mean = vec4f(0.0);
+        for (var d = 0u; d < 4u; d++)
+        {
+            let q = min(vec2i(lid.xy * 2u + vec2u(d % 2u, d / 2u)), last);
+            mean += tile[u32(q.y) * TILE + u32(q.x)];
+        }
+        let p = wid.xy * (TILE / 2u) + lid.xy;
+        if (all(p < textureDimensions(outputImage)))
+        {
+            textureStore(outputImage, p, mean * 0.25);
+        }
+    }
+)";
+
+// 256 pixels of a row or a column per workgroup
+char const * lineSource = R"(
+const RADIUS = {R}u;
+const SPAN = 256u + 2u * RADIUS;
+
+var<workgroup> line: array<vec4f, SPAN>;
+
+@compute @workgroup_size(256)
+fn main(@builtin(workgroup_id) wid: vec3u, @builtin(local_invocation_index) local: u32)
+{
+    let first = {FIRST};
+    let axis = {AXIS};
+    for (var i = local; i < SPAN; i += 256u)
+    {
+        line[i] = load(first + axis * (i32(i) - i32(RADIUS)));
+    }
+    workgroupBarrier();
+    var sum = vec4f(0.0);
+    for (var t = 0u; t <= 2u * RADIUS; t++)
+    {
+        sum += weights[t] * line[local + t];
+    }
+    let p = first + axis * i32(local);
+    if (all(p < vec2i(textureDimensions(outputImage))))
+    {
+        textureStore(outputImage, p, sum);
+    }
+}
+)";
+
+// kernels too large for workgroup memory read the texture directly
+char const * directSource = R"(
+const RX = {RX}u;
+const RY = {RY}u;
+
+@compute @workgroup_size(16, 16)
+fn main(@builtin(global_invocation_id) id: vec3u)
+{
+    if (any(id.xy >= textureDimensions(outputImage)))
+    {
+        return;
+    }
+    var sum = vec4f(0.0);
+    for (var j = 0u; j <= 2u * RY; j++)
+    {
+        for (var i = 0u; i <= 2u * RX; i++)
+        {
+            let offset = vec2i(i32(i) - i32(RX), i32(j) - i32(RY));
+            sum += weights[j * (2u * RX + 1u) + i] * load(vec2i(id.xy) + offset);
+        }
+    }
+    textureStore(outputImage, id.xy, sum);
+}
+)";
+
+char const * downsampleSource = R"(
+@compute @workgroup_size(16, 16)
+fn main(@builtin(global_invocation_id) id: vec3u)
+{
+    if (any(id.xy >= textureDimensions(outputImage)))
+    {
+        return;
+    }
+    let p = vec2i(id.xy) * 2;
+    let mean = (load(p) + load(p + vec2i(1, 0)) + load(p + vec2i(0, 1)) + load(p + vec2i(1, 1))) * 0.25;
+    textureStore(outputImage, id.xy, mean);
+}
+)";
+
+char const * upsampleSource = R"(
+@compute @workgroup_size(16, 16)
+fn main(@builtin(global_invocation_id) id: vec3u)
+{
+    if (any(id.xy >= textureDimensions(outputImage)))
+    {
+        return;
+    }
+    let position = (vec2f(id.xy) + 0.5) * 0.5 - 0.5;
+    let base = floor(position);
+    let f = position - base;
+    let p = vec2i(base);
+    let top = mix(load(p), load(p + vec2i(1, 0)), f.x);
+    let bottom = mix(load(p + vec2i(0, 1)), load(p + vec2i(1, 1)), f.x);
+    textureStore(outputImage, id.xy, mix(top, bottom, f.y));
+}
+)";
+
+void replace(std::string & text, std::string const & key, std::string const & value)
+{
+    for (size_t at = text.find(key); at != std::string::npos; at = text.find(key, at + value.size()))
+    {
+        text.replace(at, key.size(), value);
+    }
+}
+
+char const * storageFormatName(WGPUTextureFormat format)
+{
+    switch (format)
+    {
+    case WGPUTextureFormat_RGBA8Unorm: return "rgba8unorm";
+    case WGPUTextureFormat_RGBA16Float: return "rgba16float";
+    case WGPUTextureFormat_RGBA32Float: return "rgba32float";
+    default: return nullptr;
+    }
+}
+
+uint32_t divideRoundingUp(uint32_t a, uint32_t b)
+{
+    return (a + b - 1) / b;
+}
+
+std::string kernelSize(uint32_t radiusX, uint32_t radiusY)
+{
+    return std::to_string(2 * radiusX + 1) + "x" + std::to_string(2 * radiusY + 1);
+}
+
+// a separable filter along one axis, edges clamped
+std::vector<float> cpuLine(std::vector<float> const & pixels, uint32_t width, uint32_t height, std::vector<float> const & kernel, bool vertical)
+{
+    std::vector<float> result(pixels.size(), 0.0f);
+    int radius = static_cast<int>(kernel.size() / 2);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            for (int t = -radius; t <= radius; ++t)
+            {
+                int sx = vertical ? int(x) : std::clamp(int(x) + t, 0, int(width) - 1);
+                int sy = vertical ? std::clamp(int(y) + t, 0, int(height) - 1) : int(y);
+                for (int c = 0; c < 4; ++c)
+                {
+                    result[(size_t(y) * width + x) * 4 + c] += kernel[t + radius] * pixels[(size_t(sy) * width + sx) * 4 + c];
+                }
+            }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+ImageFilterChain & ImageFilterChain::gaussian(float sigma)
+{
+    int radius = std::max(1, static_cast<int>(std::ceil(3.0f * sigma)));
+    std::vector<float> kernel(2 * radius + 1);
+    float sum = 0.0f;
+    for (int i = -radius; i <= radius; ++i)
+    {
+        kernel[i + radius] = std::exp(-float(i * i) / (2.0f * sigma * sigma));
+        sum += kernel[i + radius];
+    }
+    for (float & weight : kernel)
+    {
+        weight /= sum;
+    }
+    return separable(kernel, kernel);
+}
+
+ImageFilterChain & ImageFilterChain::box(uint32_t radius)
+{
+    std::vector<float> kernel(2 * radius + 1, 1.0f / (2 * radius + 1));
+    return separable(kernel, kernel);
+}
+
+ImageFilterChain & ImageFilterChain::separable(std::vector<float> horizontal, std::vector<float> vertical)
+{
+    Stage stage;
+    stage.kind = Stage::Kind::Separable;
+    stage.horizontal = std::move(horizontal);
+    stage.vertical = std::move(vertical);
+    m_stages.push_back(std::move(stage));
+    return *this;
+}
+
+ImageFilterChain & ImageFilterChain::convolve(std::vector<float> kernel, uint32_t width, uint32_t height)
+{
+    Stage stage;
+    stage.kind = Stage::Kind::Convolution;
+    stage.horizontal = std::move(kernel);
+    stage.width = width;
+    stage.height = height;
+    m_stages.push_back(std::move(stage));
+    return *this;
+}
+
+ImageFilterChain & ImageFilterChain::downsample()
+{
+    Stage stage;
+    stage.kind = Stage::Kind::Downsample;
+    m_stages.push_back(std::move(stage));
+    return *this;
+}
+
+ImageFilterChain & ImageFilterChain::upsample()
+{
+    Stage stage;
+    stage.kind = Stage::Kind::Upsample;
+    m_stages.push_back(std::move(stage));
+    return *this;
+}
+
+void ImageFilterChain::outputSize(uint32_t & width, uint32_t & height) const
+{
+    for (Stage const & stage : m_stages)
+    {
+        if (stage.kind == Stage::Kind::Downsample)
+        {
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+        else if (stage.kind == Stage::Kind::Upsample)
+        {
+            width *= 2;
+            height *= 2;
+        }
+    }
+}
+
+ImageFilters::ImageFilters(WGPUDevice device)
+    : m_device(device)
+{
+    WGPUSupportedLimits supported = {};
+    supported.nextInChain = nullptr;
+    wgpuDeviceGetLimits(device, &supported);
+    m_workgroupStorage = supported.limits.maxComputeWorkgroupStorageSize;
+    m_offsetAlignment = supported.limits.minStorageBufferOffsetAlignment;
+}
+
+ImageFilters::~ImageFilters()
+{
+    release();
+}
+
+void ImageFilters::release()
+{
+    for (auto & entry : m_pipelines)
+    {
+        wgpuComputePipelineRelease(entry.second);
+    }
+    m_pipelines.clear();
+    for (auto & entry : m_textures)
+    {
+        wgpuTextureViewRelease(entry.second.view);
+        wgpuTextureRelease(entry.second.texture);
+    }
+    m_textures.clear();
+}
+
+bool ImageFilters::tileFits(uint32_t radiusX, uint32_t radiusY) const
+{
+    return uint64_t(tileSize + 2 * radiusX) * (tileSize + 2 * radiusY) * 16 <= m_workgroupStorage;
+}
+
+std::vector<ImageFilters::Pass> ImageFilters::plan(ImageFilterChain const & chain, uint32_t width, uint32_t height) const
+{
+    using Stage = ImageFilterChain::Stage;
+    std::vector<Pass> passes;
+    std::string const prelude = std::string(preludeSource) + weightsSource;
+
+    // tiled kernel, the following downsample fused when there is one
+    auto addTiled = [&](std::string const & name, char const * filter, uint32_t rx, uint32_t ry, std::vector<float> weights, bool downsample) {
+        std::string source = prelude + tiledSource;
+        replace(source, "{FILTER}", filter);
+        replace(source, "{STORE}", downsample ? downsampleStore : plainStore);
+        replace(source, "{RX}", std::to_string(rx));
+        replace(source, "{RY}", std::to_string(ry));
+        uint32_t groupsX = divideRoundingUp(width, tileSize);
+        uint32_t groupsY = divideRoundingUp(height, tileSize);
+        if (downsample)
+        {
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+        }
+        passes.push_back({ name + (downsample ? " + downsample" : ""), source, std::move(weights), width, height, { groupsX, groupsY } });
+    };
+    auto addDirect = [&](std::string const & name, uint32_t rx, uint32_t ry, std::vector<float> weights) {
+        std::string source = prelude + directSource;
+        replace(source, "{RX}", std::to_string(rx));
+        replace(source, "{RY}", std::to_string(ry));
+        passes.push_back({ name, source, std::move(weights), width, height,
+            { divideRoundingUp(width, tileSize), divideRoundingUp(height, tileSize) } });
+    };
+    auto addLine = [&](std::vector<float> const & kernel, bool vertical) {
+        uint32_t radius = static_cast<uint32_t>(kernel.size() / 2);
+        if (uint64_t(lineSize + 2 * radius) * 16 > m_workgroupStorage)
+        {
+            addDirect(std::string(vertical ? "direct column " : "direct row ") + std::to_string(kernel.size()),
+                vertical ? 0 : radius, vertical ? radius : 0, kernel);
+            return;
+        }
+        std::string source = prelude + lineSource;
+        replace(source, "{R}", std::to_string(radius));
+        replace(source, "{FIRST}", vertical ? "vec2i(i32(wid.x), i32(wid.y * 256u))" : "vec2i(i32(wid.x * 256u), i32(wid.y))");
+        replace(source, "{AXIS}", vertical ? "vec2i(0, 1)" : "vec2i(1, 0)");
+        uint32_t groupsX = vertical ? width : divideRoundingUp(width, lineSize);
+        uint32_t groupsY = vertical ? divideRoundingUp(height, lineSize) : height;
+        passes.push_back({ std::string(vertical ? "column " : "row ") + std::to_string(kernel.size()), source, kernel, width, height,
+            { groupsX, groupsY } });
+    };
+
+    std::vector<Stage> const & stages = chain.m_stages;
+    for (size_t i = 0; i < stages.size(); ++i)
+    {
+        Stage const & stage = stages[i];
+        bool downsampleNext = m_fusion && i + 1 < stages.size() && stages[i + 1].kind == Stage::Kind::Downsample;
+        switch (stage.kind)
+        {
+        case Stage::Kind::Separable:
+        {
+            uint32_t rx = static_cast<uint32_t>(stage.horizontal.size() / 2);
+            uint32_t ry = static_cast<uint32_t>(stage.vertical.size() / 2);
+            if (m_fusion && tileFits(rx, ry))
+            {
+                std::vector<float> weights = stage.horizontal;
+                weights.insert(weights.end(), stage.vertical.begin(), stage.vertical.end());
+                addTiled("tiled separable " + kernelSize(rx, ry), separableFilter, rx, ry, std::move(weights), downsampleNext);
+                if (downsampleNext) ++i;
+            }
+            else
+            {
+                addLine(stage.horizontal, false);
+                addLine(stage.vertical, true);
+            }
+            break;
+        }
+        case Stage::Kind::Convolution:
+        {
+            uint32_t rx = stage.width / 2;
+            uint32_t ry = stage.height / 2;
+            if (tileFits(rx, ry))
+            {
+                addTiled("tiled convolution " + kernelSize(rx, ry), convolutionFilter, rx, ry, stage.horizontal, downsampleNext);
+                if (downsampleNext) ++i;
+            }
+            else
+            {
+                addDirect("direct convolution " + kernelSize(rx, ry), rx, ry, stage.horizontal);
+            }
+            break;
+        }
+        case Stage::Kind::Downsample:
+        case Stage::Kind::Upsample:
+        {
+            bool down = stage.kind == Stage::Kind::Downsample;
+            width = down ? (width + 1) / 2 : width * 2;
+            height = down ? (height + 1) / 2 : height * 2;
+            passes.push_back({ down ? "downsample" : "upsample", std::string(preludeSource) + (down ? downsampleSource : upsampleSource), {},
+                width, height, { divideRoundingUp(width, tileSize), divideRoundingUp(height, tileSize) } });
+            break;
+        }
+        }
+    }
+    return passes;
+}
+
+std::vector<std::string> ImageFilters::describe(ImageFilterChain const & chain, uint32_t width, uint32_t height) const
+{
+    std::vector<std::string> lines;
+    for (Pass const & pass : plan(chain, width, height))
+    {
+        lines.push_back(pass.description + " -> " + std::to_string(pass.width) + "x" + std::to_string(pass.height));
+    }
+    return lines;
+}
+
+WGPUComputePipeline ImageFilters::pipeline(std::string const & source)
+{
+    auto found = m_pipelines.find(source);
+    if (found != m_pipelines.end())
+    {
+        return found->second;
+    }
+    WGPUShaderModule module = createShaderModule(m_device, source.c_str(), "Image filter");
+    WGPUComputePipelineDescriptor pipelineDesc = {};
+    pipelineDesc.nextInChain = nullptr;
+    pipelineDesc.label = "Image filter";
+    pipelineDesc.layout = nullptr;
+    pipelineDesc.compute.module = module;
+    pipelineDesc.compute.entryPoint = "main";
+    WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+    wgpuShaderModuleRelease(module);
+    m_pipelines[source] = pipeline;
+    return pipeline;
+}
+
+WGPUTextureView ImageFilters::intermediate(uint32_t width, uint32_t height, WGPUTextureFormat format, uint32_t slot)
+{
+    auto key = std::make_tuple(width, height, format, slot);
+    auto found = m_textures.find(key);
+    if (found != m_textures.end())
+    {
+        return found->second.view;
+    }
+    WGPUTextureDescriptor textureDesc = {};
+    textureDesc.nextInChain = nullptr;
+    textureDesc.label = "Image filter intermediate";
+    textureDesc.usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_StorageBinding;
+    textureDesc.dimension = WGPUTextureDimension_2D;
+    textureDesc.size = { width, height, 1 };
+    textureDesc.format = format;
+    textureDesc.mipLevelCount = 1;
+    textureDesc.sampleCount = 1;
+    textureDesc.viewFormatCount = 0;
+    textureDesc.viewFormats = nullptr;
+    Texture texture;
+    texture.texture = wgpuDeviceCreateTexture(m_device, &textureDesc);
+    texture.view = wgpuTextureCreateView(texture.texture, nullptr);
+    m_textures[key] = texture;
+    return texture.view;
+}
+
+void ImageFilters::apply(WGPUCommandEncoder encoder, ImageFilterChain const & chain, WGPUTexture input, WGPUTexture output)
+{
+    uint32_t width = wgpuTextureGetWidth(input);
+    uint32_t height = wgpuTextureGetHeight(input);
+    uint32_t expectedWidth = width;
+    uint32_t expectedHeight = height;
+    chain.outputSize(expectedWidth, expectedHeight);
+    WGPUTextureFormat outputFormat = wgpuTextureGetFormat(output);
+    if (chain.empty())
+    {
+        logError() << "Image filters: empty chain";
+        return;
+    }
+    if (storageFormatName(outputFormat) == nullptr)
+    {
+        logError() << "Image filters: output format " << outputFormat << " is not rgba8unorm, rgba16float or rgba32float";
+        return;
+    }
+    if (wgpuTextureGetWidth(output) != expectedWidth || wgpuTextureGetHeight(output) != expectedHeight)
+    {
+        logError() << "Image filters: output should be " << expectedWidth << "x" << expectedHeight;
+        return;
+    }
+
+    std::vector<Pass> passes = plan(chain, width, height);
+    // 8-bit intermediates would round every pass
+    WGPUTextureFormat intermediateFormat = outputFormat == WGPUTextureFormat_RGBA32Float
+        ? WGPUTextureFormat_RGBA32Float : WGPUTextureFormat_RGBA16Float;
+
+    // the weights of every pass in one buffer, at the offset alignment
+    std::vector<uint64_t> offsets;
+    uint64_t weightBytes = 0;
+    for (Pass const & pass : passes)
+    {
+        offsets.push_back(weightBytes);
+        weightBytes += (pass.weights.size() * sizeof(float) + m_offsetAlignment - 1) / m_offsetAlignment * m_offsetAlignment;
+    }
+    WGPUBuffer weightBuffer = nullptr;
+    if (weightBytes > 0)
+    {
+        WGPUBufferDescriptor bufferDesc = {};
+        bufferDesc.nextInChain = nullptr;
+        bufferDesc.label = "Image filter weights";
+        bufferDesc.usage = WGPUBufferUsage_Storage;
+        bufferDesc.size = weightBytes;
+        bufferDesc.mappedAtCreation = true;
+        weightBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+        uint8_t * mapped = static_cast<uint8_t *>(wgpuBufferGetMappedRange(weightBuffer, 0, weightBytes));
+        for (size_t i = 0; i < passes.size(); ++i)
+        {
+            std::memcpy(mapped + offsets[i], passes[i].weights.data(), passes[i].weights.size() * sizeof(float));
+        }
+        wgpuBufferUnmap(weightBuffer);
+    }
+
+    WGPUTextureView inputView = wgpuTextureCreateView(input, nullptr);
+    WGPUTextureView outputView = wgpuTextureCreateView(output, nullptr);
+    std::vector<WGPUBindGroup> bindGroups;
+    std::vector<WGPUComputePipeline> pipelines;
+    WGPUTextureView previous = inputView;
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        Pass const & pass = passes[i];
+        bool last = i + 1 == passes.size();
+        // consecutive intermediates alternate between two slots
+        WGPUTextureView target = last ? outputView : intermediate(pass.width, pass.height, intermediateFormat, i % 2);
+        std::string source = pass.source;
+        replace(source, "{FORMAT}", storageFormatName(last ? outputFormat : intermediateFormat));
+        pipelines.push_back(pipeline(source));
+
+        WGPUBindGroupEntry entries[3] = {};
+        for (uint32_t b = 0; b < 3; ++b)
+        {
+            entries[b].nextInChain = nullptr;
+            entries[b].binding = b;
+        }
+        entries[0].textureView = previous;
+        entries[1].textureView = target;
+        entries[2].buffer = weightBuffer;
+        entries[2].offset = offsets[i];
+        entries[2].size = pass.weights.size() * sizeof(float);
+        WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(pipelines.back(), 0);
+        WGPUBindGroupDescriptor bindGroupDesc = {};
+        bindGroupDesc.nextInChain = nullptr;
+        bindGroupDesc.label = "Image filter";
+        bindGroupDesc.layout = layout;
+        bindGroupDesc.entryCount = pass.weights.empty() ? 2 : 3;
+        bindGroupDesc.entries = entries;
+        bindGroups.push_back(wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc));
+        wgpuBindGroupLayoutRelease(layout);
+        previous = target;
+    }
+
+    // usages are tracked per dispatch: a texture written by one dispatch can
+    // be read by the next in the same pass
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = "Image filters";
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder computePass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        wgpuComputePassEncoderSetPipeline(computePass, pipelines[i]);
+        wgpuComputePassEncoderSetBindGroup(computePass, 0, bindGroups[i], 0, nullptr);
+        wgpuComputePassEncoderDispatchWorkgroups(computePass, passes[i].groups[0], passes[i].groups[1], 1);
+    }
+    wgpuComputePassEncoderEnd(computePass);
+    wgpuComputePassEncoderRelease(computePass);
+
+    // the encoder keeps what the pass uses alive
+    for (WGPUBindGroup bindGroup : bindGroups)
+    {
+        wgpuBindGroupRelease(bindGroup);
+    }
+    wgpuTextureViewRelease(inputView);
+    wgpuTextureViewRelease(outputView);
+    if (weightBuffer) wgpuBufferRelease(weightBuffer);
+}
+
+std::vector<float> cpuImageFilter(ImageFilterChain const & chain, std::vector<float> const & pixels, uint32_t & width, uint32_t & height)
+{
+    using Stage = ImageFilterChain::Stage;
+    std::vector<float> image = pixels;
+    auto at = [&](int x, int y, int c) {
+        x = std::clamp(x, 0, int(width) - 1);
+        y = std::clamp(y, 0, int(height) - 1);
+        return image[(size_t(y) * width + x) * 4 + c];
+    };
+    for (Stage const & stage : chain.m_stages)
+    {
+        switch (stage.kind)
+        {
+        case Stage::Kind::Separable:
+            image = cpuLine(cpuLine(image, width, height, stage.horizontal, false), width, height, stage.vertical, true);
+            break;
+        case Stage::Kind::Convolution:
+        {
+            std::vector<float> result(image.size(), 0.0f);
+            int rx = int(stage.width / 2);
+            int ry = int(stage.height / 2);
+            for (uint32_t y = 0; y < height; ++y)
+                for (uint32_t x = 0; x < width; ++x)
+                    for (int j = -ry; j <= ry; ++j)
+                        for (int i = -rx; i <= rx; ++i)
+                            for (int c = 0; c < 4; ++c)
+                                result[(size_t(y) * width + x) * 4 + c] += stage.horizontal[(j + ry) * stage.width + i + rx] * at(x + i, y + j, c);
+            image.swap(result);
+            break;
+        }
+        case Stage::Kind::Downsample:
+        {
+            uint32_t w = (width + 1) / 2;
+            uint32_t h = (height + 1) / 2;
+            std::vector<float> result(size_t(w) * h * 4);
+            for (uint32_t y = 0; y < h; ++y)
+                for (uint32_t x = 0; x < w; ++x)
+                    for (int c = 0; c < 4; ++c)
+                        result[(size_t(y) * w + x) * 4 + c] = 0.25f * (at(2 * x, 2 * y, c) + at(2 * x + 1, 2 * y, c)
+                            + at(2 * x, 2 * y + 1, c) + at(2 * x + 1, 2 * y + 1, c));
+            image.swap(result);
+            width = w;
+            height = h;
+            break;
+        }
+        case Stage::Kind::Upsample:
+        {
+            uint32_t w = width * 2;
+            uint32_t h = height * 2;
+            std::vector<float> result(size_t(w) * h * 4);
+            for (uint32_t y = 0; y < h; ++y)
+            {
+                for (uint32_t x = 0; x < w; ++x)
+                {
+                    float px = (x + 0.5f) * 0.5f - 0.5f;
+                    float py = (y + 0.5f) * 0.5f - 0.5f;
+                    int bx = int(std::floor(px));
+                    int by = int(std::floor(py));
+                    float fx = px - bx;
+                    float fy = py - by;
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        float top = at(bx, by, c) * (1 - fx) + at(bx + 1, by, c) * fx;
+                        float bottom = at(bx, by + 1, c) * (1 - fx) + at(bx + 1, by + 1, c) * fx;
+                        result[(size_t(y) * w + x) * 4 + c] = top * (1 - fy) + bottom * fy;
+                    }
+                }
+            }
+            image.swap(result);
+            width = w;
+            height = h;
+            break;
+        }
+        }
+    }
+    return image;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * Sequence of image filters, applied in order by ImageFilters:
+ *     ImageFilterChain chain;
+ *     chain.gaussian(2.0f).downsample().box(1);
+ *
+ * Filters read outside the image as its nearest edge pixel.
+ */
+class ImageFilterChain
+{
+public:
+    /**
+     * Separable Gaussian blur, cut at 3 sigma.
+     */
+    ImageFilterChain & gaussian(float sigma);
+
+    /**
+     * Mean of the (2 radius + 1)^2 square around every pixel.
+     */
+    ImageFilterChain & box(uint32_t radius);
+
+    /**
+     * Horizontal then vertical 1D kernels, of odd sizes.
+     */
+    ImageFilterChain & separable(std::vector<float> horizontal, std::vector<float> vertical);
+
+    /**
+     * Arbitrary row-major kernel of odd width and height.
+     */
+    ImageFilterChain & convolve(std::vector<float> kernel, uint32_t width, uint32_t height);
+
+    /**
+     * Half the size, rounded up: the mean of every 2x2 block.
+     */
+    ImageFilterChain & downsample();
+
+    /**
+     * Twice the size, bilinear.
+     */
+    ImageFilterChain & upsample();
+
+    bool empty() const { return m_stages.empty(); }
+
+    /**
+     * Size of the result for an input of width x height.
+     */
+    void outputSize(uint32_t & width, uint32_t & height) const;
+
+private:
+    friend class ImageFilters;
+    friend std::vector<float> cpuImageFilter(ImageFilterChain const &, std::vector<float> const &, uint32_t &, uint32_t &);
+
+    struct Stage
+    {
+        enum class Kind { Separable, Convolution, Downsample, Upsample } kind;
+        std::vector<float> horizontal;      // separable, or the 2D kernel
+        std::vector<float> vertical;
+        uint32_t width = 1;                 // of the 2D kernel
+        uint32_t height = 1;
+    };
+
+    std::vector<Stage> m_stages;
+};
+
+/**
+ * Image filter chains on the GPU, from a texture with the TextureBinding
+ * usage to one with the StorageBinding usage, in rgba8unorm, rgba16float or
+ * rgba32float, of the chain's output size:
+ *     ImageFilters filters(device);
+ *     filters.apply(encoder, chain, frame, blurred);
+ *
+ * Filters work on tiles of 16x16 pixels with their halo loaded once into
+ * workgroup memory. Back to back work is fused into one dispatch where the
+ * halo fits workgroup memory: both directions of a separable filter, and a
+ * downsample following a filter, which then only writes the small image.
+ * Other filters get a pass of their own, through intermediate textures in
+ * rgba16float (rgba32float for an rgba32float output) owned by this
+ * object. Kernels are generated and compiled per filter size on first use.
+ */
+class ImageFilters
+{
+public:
+    explicit ImageFilters(WGPUDevice device);
+    ~ImageFilters();
+
+    ImageFilters(ImageFilters const &) = delete;
+    ImageFilters & operator=(ImageFilters const &) = delete;
+
+    /**
+     * Fusion is on by default; off, every filter gets its own passes,
+     * to measure what fusion saves.
+     */
+    void setFusion(bool enabled) { m_fusion = enabled; }
+
+    void apply(WGPUCommandEncoder encoder, ImageFilterChain const & chain, WGPUTexture input, WGPUTexture output);
+
+    /**
+     * One line per dispatch apply() records for this chain and input size.
+     */
+    std::vector<std::string> describe(ImageFilterChain const & chain, uint32_t width, uint32_t height) const;
+
+    size_t pipelineCount() const { return m_pipelines.size(); }
+
+    void release();
+
+private:
+    struct Pass
+    {
+        std::string description;
+        std::string source;             // WGSL without the storage format
+        std::vector<float> weights;
+        uint32_t width;                 // of the output
+        uint32_t height;
+        uint32_t groups[2];
+    };
+
+    struct Texture
+    {
+        WGPUTexture texture;
+        WGPUTextureView view;
+    };
+
+    std::vector<Pass> plan(ImageFilterChain const & chain, uint32_t width, uint32_t height) const;
+    bool tileFits(uint32_t radiusX, uint32_t radiusY) const;
+    WGPUComputePipeline pipeline(std::string const & source);
+    WGPUTextureView intermediate(uint32_t width, uint32_t height, WGPUTextureFormat format, uint32_t slot);
+
+    WGPUDevice m_device;
+    uint32_t m_workgroupStorage;
+    uint32_t m_offsetAlignment;
+    bool m_fusion = true;
+    std::map<std::string, WGPUComputePipeline> m_pipelines;
+    std::map<std::tuple<uint32_t, uint32_t, WGPUTextureFormat, uint32_t>, Texture> m_textures;
+};
+
+/**
+ * Reference of a chain on rgba f32 pixels, filter after filter, to verify
+ * the GPU results; width and height become the output size.
+ */
+std::vector<float> cpuImageFilter(ImageFilterChain const & chain, std::vector<float> const & pixels, uint32_t & width, uint32_t & height);
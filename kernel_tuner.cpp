@@ -0,0 +1,265 @@
+#include "kernel_tuner.h"
+#include "gpu_timer.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+KernelTuner::KernelTuner(WGPUDevice device, WGPUQueue queue, SpecializedPipelineCache & pipelines, TuningCache * cache)
+    : m_device(device)
+    , m_queue(queue)
+    , m_pipelines(pipelines)
+    , m_cache(cache)
+{
+    WGPUSupportedLimits supported = {};
+    supported.nextInChain = nullptr;
+    wgpuDeviceGetLimits(device, &supported);
+    m_limits = supported.limits;
+}
+
+KernelTuner::~KernelTuner()
+{
+    for (auto & entry : m_modules)
+    {
+        wgpuShaderModuleRelease(entry.second);
+    }
+}
+
+std::vector<KernelTuner::Configuration> KernelTuner::configurations(TunableKernel const & kernel) const
+{
+    std::vector<Configuration> result;
+    for (auto const & parameter : kernel.parameters)
+    {
+        if (parameter.values.empty())
+        {
+            return result;
+        }
+    }
+
+    // odometer over the value indices, the first parameter turning fastest
+    std::vector<size_t> indices(kernel.parameters.size(), 0);
+    while (true)
+    {
+        Configuration configuration;
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            configuration[kernel.parameters[i].name] = kernel.parameters[i].values[indices[i]];
+        }
+        if (fits(kernel, configuration))
+        {
+            result.push_back(configuration);
+        }
+
+        size_t i = 0;
+        while (i < indices.size() && ++indices[i] == kernel.parameters[i].values.size())
+        {
+            indices[i++] = 0;
+        }
+        if (i == indices.size())
+        {
+            return result;
+        }
+    }
+}
+
+bool KernelTuner::isTuned(TunableKernel const & kernel) const
+{
+    if (m_tuned.count(kernel.name))
+    {
+        return true;
+    }
+    std::string value;
+    Configuration configuration;
+    return m_cache && m_cache->find(cacheKey(kernel), value) && parse(kernel, value, configuration);
+}
+
+KernelTuner::Configuration KernelTuner::configuration(TunableKernel const & kernel) const
+{
+    auto tuned = m_tuned.find(kernel.name);
+    if (tuned != m_tuned.end())
+    {
+        return tuned->second;
+    }
+    std::string value;
+    Configuration configuration;
+    if (m_cache && m_cache->find(cacheKey(kernel), value) && parse(kernel, value, configuration))
+    {
+        return configuration;
+    }
+
+    configuration.clear();
+    for (auto const & parameter : kernel.parameters)
+    {
+        if (!parameter.values.empty())
+        {
+            configuration[parameter.name] = parameter.values.front();
+        }
+    }
+    return configuration;
+}
+
+WGPUComputePipeline KernelTuner::pipeline(TunableKernel const & kernel)
+{
+    return pipeline(kernel, configuration(kernel));
+}
+
+WGPUComputePipeline KernelTuner::pipeline(TunableKernel const & kernel, Configuration const & configuration)
+{
+    SpecializationConstants constants;
+    for (auto const & parameter : kernel.parameters)
+    {
+        auto value = configuration.find(parameter.name);
+        if (!parameter.inSource && value != configuration.end())
+        {
+            constants.set(parameter.name, value->second);
+        }
+    }
+    return m_pipelines.computePipeline(
+        module(kernel, configuration), kernel.entryPoint.c_str(), kernel.layout, constants, kernel.name.c_str());
+}
+
+WGPUShaderModule KernelTuner::module(TunableKernel const & kernel, Configuration const & configuration)
+{
+    if (kernel.source.empty())
+    {
+        return kernel.module;
+    }
+    std::string prelude;
+    for (auto const & parameter : kernel.parameters)
+    {
+        auto value = configuration.find(parameter.name);
+        if (parameter.inSource && value != configuration.end())
+        {
+            prelude += "const " + parameter.name + " = " + std::to_string(value->second) + "u;\n";
+        }
+    }
+    WGPUShaderModule & module = m_modules[kernel.name + "\n" + prelude];
+    if (module == nullptr)
+    {
+        module = createShaderModule(m_device, (prelude + kernel.source).c_str(), kernel.name.c_str());
+    }
+    return module;
+}
+
+KernelTuner::Configuration KernelTuner::tune(TunableKernel const & kernel, Recorder const & record, int repetitions)
+{
+    std::vector<Configuration> candidates = configurations(kernel);
+    if (candidates.empty())
+    {
+        logWarn() << "Tuner: no configuration of " << kernel.name << " fits the device";
+        return configuration(kernel);
+    }
+
+    GpuTimer timer(m_device, m_queue);
+    Configuration best;
+    double bestTime = std::numeric_limits<double>::infinity();
+    for (Configuration const & candidate : candidates)
+    {
+        WGPUComputePipeline pipeline = this->pipeline(kernel, candidate);
+        if (pipeline == nullptr)
+        {
+            continue;
+        }
+        double time = timer.timeComputePass([&](WGPUComputePassEncoder pass) {
+            record(pass, pipeline, candidate);
+        }, repetitions);
+        logDebug() << "Tuner: " << kernel.name << " " << format(candidate) << ": " << time << " ms";
+        // a failed readback reports zero, which must not win
+        if (time > 0.0 && time < bestTime)
+        {
+            bestTime = time;
+            best = candidate;
+        }
+    }
+    if (best.empty())
+    {
+        logWarn() << "Tuner: could not time " << kernel.name << ", keeping its configuration";
+        return configuration(kernel);
+    }
+
+    m_tuned[kernel.name] = best;
+    if (m_cache && !m_cache->store(cacheKey(kernel), format(best)))
+    {
+        logWarn() << "Tuner: could not write the tuning cache";
+    }
+    logInfo() << "Tuner: " << kernel.name << ": " << format(best) << " (" << bestTime << " ms, "
+        << candidates.size() << " configurations)";
+    return best;
+}
+
+std::string KernelTuner::format(Configuration const & configuration)
+{
+    std::string text;
+    for (auto const & value : configuration)
+    {
+        if (!text.empty()) text += ",";
+        text += value.first + "=" + std::to_string(value.second);
+    }
+    return text;
+}
+
+std::string KernelTuner::cacheKey(TunableKernel const & kernel)
+{
+    return "kernel/" + kernel.name;
+}
+
+bool KernelTuner::parse(TunableKernel const & kernel, std::string const & text, Configuration & configuration) const
+{
+    // entries of an older version of the kernel are ignored, not trusted
+    configuration.clear();
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        size_t equal = item.find('=');
+        if (equal == std::string::npos)
+        {
+            return false;
+        }
+        std::string name = item.substr(0, equal);
+        auto parameter = std::find_if(kernel.parameters.begin(), kernel.parameters.end(),
+            [&](TunableKernel::Parameter const & p) { return p.name == name; });
+        if (parameter == kernel.parameters.end())
+        {
+            return false;
+        }
+        uint32_t value = static_cast<uint32_t>(std::strtoul(item.c_str() + equal + 1, nullptr, 10));
+        if (std::find(parameter->values.begin(), parameter->values.end(), value) == parameter->values.end())
+        {
+            return false;
+        }
+        configuration[name] = value;
+    }
+    return configuration.size() == kernel.parameters.size() && fits(kernel, configuration);
+}
+
+bool KernelTuner::fits(TunableKernel const & kernel, Configuration const & configuration) const
+{
+    uint64_t size[3] = { 1, 1, 1 };
+    for (auto const & parameter : kernel.parameters)
+    {
+        auto value = configuration.find(parameter.name);
+        if (value == configuration.end())
+        {
+            continue;
+        }
+        switch (parameter.role)
+        {
+        case TunableKernel::Role::WorkgroupSizeX: size[0] *= value->second; break;
+        case TunableKernel::Role::WorkgroupSizeY: size[1] *= value->second; break;
+        case TunableKernel::Role::WorkgroupSizeZ: size[2] *= value->second; break;
+        default: break;
+        }
+    }
+    if (size[0] > m_limits.maxComputeWorkgroupSizeX
+        || size[1] > m_limits.maxComputeWorkgroupSizeY
+        || size[2] > m_limits.maxComputeWorkgroupSizeZ
+        || size[0] * size[1] * size[2] > m_limits.maxComputeInvocationsPerWorkgroup)
+    {
+        return false;
+    }
+    return !kernel.constraint || kernel.constraint(configuration, m_limits);
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "pipeline_specialization.h"
+#include "tuning_cache.h"
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * A kernel whose dispatch parameters are WGSL override constants, e.g.
+ *     override ITEMS_PER_THREAD: u32 = 1;
+ * or, for what naga in wgpu-native 0.19 cannot take from an override
+ * (@workgroup_size and array sizes), constants written into its source,
+ * which is then compiled once per value:
+ *     @compute @workgroup_size(WORKGROUP_SIZE) fn main(...)
+ * with WORKGROUP_SIZE an inSource parameter. The first value of every
+ * parameter is the default configuration, the one used before the kernel
+ * is tuned.
+ */
+struct TunableKernel
+{
+    enum class Role
+    {
+        WorkgroupSizeX,     // checked against the device limits
+        WorkgroupSizeY,
+        WorkgroupSizeZ,
+        ItemsPerThread,
+        TileSize,
+        Other,
+    };
+
+    struct Parameter
+    {
+        std::string name;               // of the override or source constant
+        std::vector<uint32_t> values;
+        Role role = Role::Other;
+        bool inSource = false;          // prepended to source as `const NAME = value;`
+    };
+
+    using Configuration = std::map<std::string, uint32_t>;
+
+    /**
+     * Extra validity check, e.g. of the workgroup memory a tile size needs.
+     */
+    using Constraint = std::function<bool(Configuration const & configuration, WGPULimits const & limits)>;
+
+    /**
+     * Cache key, which should include the problem size class when the best
+     * configuration depends on it, e.g. "saxpy/1M".
+     */
+    std::string name;
+    WGPUShaderModule module = nullptr;
+    std::string source;                 // WGSL, in place of module with inSource parameters
+    std::string entryPoint = "main";
+    WGPUPipelineLayout layout = nullptr;
+    std::vector<Parameter> parameters;
+    Constraint constraint;
+};
+
+/**
+ * Picks the constants of tunable kernels by timing every valid
+ * combination on the GPU, keeps the fastest per adapter and driver in a
+ * TuningCache, and creates pipelines with it:
+ *     KernelTuner tuner(device, queue, pipelines, &cache);
+ *     if (!tuner.isTuned(kernel)) tuner.tune(kernel, recordDispatch);
+ *     wgpuComputePassEncoderSetPipeline(pass, tuner.pipeline(kernel));
+ * Dispatch sizes depend on the configuration, so recorders and callers get
+ * it to compute their workgroup counts.
+ */
+class KernelTuner
+{
+public:
+    using Configuration = TunableKernel::Configuration;
+
+    /**
+     * Record the dispatches of one representative run. With an explicit
+     * layout on the kernel a single bind group serves every configuration.
+     */
+    using Recorder = std::function<void(WGPUComputePassEncoder pass, WGPUComputePipeline pipeline, Configuration const & configuration)>;
+
+    /**
+     * The pipelines are owned by `pipelines`; the cache may be null, results
+     * then only last as long as the tuner.
+     */
+    KernelTuner(WGPUDevice device, WGPUQueue queue, SpecializedPipelineCache & pipelines, TuningCache * cache = nullptr);
+    ~KernelTuner();
+
+    KernelTuner(KernelTuner const &) = delete;
+    KernelTuner & operator=(KernelTuner const &) = delete;
+
+    /**
+     * Every combination of the parameter values that fits the device limits
+     * and the constraint of the kernel.
+     */
+    std::vector<Configuration> configurations(TunableKernel const & kernel) const;
+
+    bool isTuned(TunableKernel const & kernel) const;
+
+    /**
+     * The tuned configuration if any, else the default one.
+     */
+    Configuration configuration(TunableKernel const & kernel) const;
+
+    /**
+     * Pipeline specialized with configuration(kernel).
+     */
+    WGPUComputePipeline pipeline(TunableKernel const & kernel);
+
+    /**
+     * Pipeline of any configuration, e.g. to compare with the tuned one.
+     */
+    WGPUComputePipeline pipeline(TunableKernel const & kernel, Configuration const & configuration);
+
+    /**
+     * Time every configuration, median of `repetitions` runs each, and keep
+     * the fastest. Uses timestamp queries when the device has them.
+     */
+    Configuration tune(TunableKernel const & kernel, Recorder const & record, int repetitions = 5);
+
+    static std::string format(Configuration const & configuration);
+
+private:
+    static std::string cacheKey(TunableKernel const & kernel);
+    bool parse(TunableKernel const & kernel, std::string const & text, Configuration & configuration) const;
+    bool fits(TunableKernel const & kernel, Configuration const & configuration) const;
+    WGPUShaderModule module(TunableKernel const & kernel, Configuration const & configuration);
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    SpecializedPipelineCache & m_pipelines;
+    TuningCache * m_cache;
+    WGPULimits m_limits = {};
+    std::map<std::string, Configuration> m_tuned;
+    std::map<std::string, WGPUShaderModule> m_modules;     // by kernel name and source constants
+};
@@ -0,0 +1,252 @@
+#include "logger.h"
+
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif // WEBGPU_BACKEND_WGPU
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+constexpr auto wakeInterval = std::chrono::milliseconds(10);
+
+char const * levelName(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::Error: return "error";
+    case LogLevel::Warn: return "warn ";
+    case LogLevel::Info: return "info ";
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Trace: return "trace";
+    default: return "     ";
+    }
+}
+
+} // namespace
+
+Logger & Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : m_slots(new std::array<Slot, SlotCount>())
+    , m_output(&std::cout)
+{
+    // a slot is free for the producer at position p when its sequence is p,
+    // and holds a record for the consumer when it is p + 1
+    for (size_t i = 0; i < SlotCount; ++i)
+    {
+        (*m_slots)[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    m_thread = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+    m_stop.store(true, std::memory_order_release);
+    m_wake.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+#ifdef WEBGPU_BACKEND_WGPU
+    // a late native message must not reach a destroyed logger
+    wgpuSetLogCallback(nullptr, nullptr);
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+void Logger::setLevel(LogLevel level)
+{
+    m_level.store(static_cast<uint32_t>(level), std::memory_order_relaxed);
+#ifdef WEBGPU_BACKEND_WGPU
+    wgpuSetLogLevel(static_cast<WGPULogLevel>(level));
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+void Logger::setRateLimit(uint32_t messagesPerSecond)
+{
+    m_rateLimit.store(messagesPerSecond, std::memory_order_relaxed);
+}
+
+void Logger::captureWebGPULog()
+{
+#ifdef WEBGPU_BACKEND_WGPU
+    // called from whichever thread wgpu-native logs on, possibly while it
+    // holds internal locks: the message is only copied into the ring
+    wgpuSetLogCallback([](WGPULogLevel level, char const * message, void * /* pUserData */)
+    {
+        if (message)
+        {
+            Logger::instance().log(static_cast<LogLevel>(level), "wgpu", message, std::strlen(message));
+        }
+    }, nullptr);
+    wgpuSetLogLevel(static_cast<WGPULogLevel>(level()));
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+void Logger::setOutput(std::ostream & output)
+{
+    flush();
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_output = &output;
+}
+
+void Logger::log(LogLevel level, char const * source, char const * message, size_t length)
+{
+    if (!enabled(level) || !allowedByRate(level))
+    {
+        return;
+    }
+    // one record per line, so that multi-line reports keep their shape
+    bool enqueued = false;
+    size_t begin = 0;
+    do
+    {
+        size_t end = begin;
+        while (end < length && message[end] != '\n') ++end;
+        if (end > begin || length == 0)
+        {
+            enqueued |= tryEnqueue(level, source, message + begin, end - begin);
+        }
+        begin = end + 1;
+    } while (begin < length);
+
+    if (enqueued)
+    {
+        m_wake.notify_one();
+    }
+}
+
+bool Logger::allowedByRate(LogLevel level)
+{
+    uint32_t limit = m_rateLimit.load(std::memory_order_relaxed);
+    if (limit == 0 || level == LogLevel::Error)
+    {
+        return true;
+    }
+    int64_t window = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t current = m_rateWindow.load(std::memory_order_relaxed);
+    if (window != current && m_rateWindow.compare_exchange_strong(current, window, std::memory_order_relaxed))
+    {
+        m_rateCount.store(0, std::memory_order_relaxed);
+    }
+    if (m_rateCount.fetch_add(1, std::memory_order_relaxed) < limit)
+    {
+        return true;
+    }
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool Logger::tryEnqueue(LogLevel level, char const * source, char const * message, size_t length)
+{
+    size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+    Slot * slot = nullptr;
+    for (;;)
+    {
+        slot = &(*m_slots)[position % SlotCount];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0)
+        {
+            if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // the consumer is a whole ring behind
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->source = source;
+    slot->time = std::chrono::system_clock::now();
+    slot->length = static_cast<uint32_t>(std::min(length, MessageCapacity));
+    std::memcpy(slot->message, message, slot->length);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void Logger::flush()
+{
+    size_t target = m_enqueuePosition.load(std::memory_order_acquire);
+    while (m_written.load(std::memory_order_acquire) < target && m_thread.joinable())
+    {
+        m_wake.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Logger::run()
+{
+    for (;;)
+    {
+        bool stopping = m_stop.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        bool wroteAny = false;
+        for (;;)
+        {
+            Slot & slot = (*m_slots)[m_dequeuePosition % SlotCount];
+            if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1)
+            {
+                break;
+            }
+            write(slot);
+            slot.sequence.store(m_dequeuePosition + SlotCount, std::memory_order_release);
+            ++m_dequeuePosition;
+            m_written.store(m_dequeuePosition, std::memory_order_release);
+            wroteAny = true;
+        }
+
+        size_t dropped = m_dropped.load(std::memory_order_relaxed);
+        if (dropped != m_reportedDropped)
+        {
+            *m_output << levelName(LogLevel::Warn) << " Logger: " << dropped - m_reportedDropped
+                << " message(s) dropped" << '\n';
+            m_reportedDropped = dropped;
+            wroteAny = true;
+        }
+        if (wroteAny)
+        {
+            m_output->flush();
+        }
+        if (stopping)
+        {
+            return;
+        }
+        m_wake.wait_for(lock, wakeInterval);
+    }
+}
+
+void Logger::write(Slot const & slot)
+{
+    std::time_t seconds = std::chrono::system_clock::to_time_t(slot.time);
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(slot.time.time_since_epoch()).count() % 1000;
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else // _WIN32
+    localtime_r(&seconds, &local);
+#endif // _WIN32
+    std::ostream & out = *m_output;
+    out << std::put_time(&local, "%H:%M:%S") << '.' << std::setfill('0') << std::setw(3) << milliseconds << std::setfill(' ')
+        << ' ' << levelName(slot.level) << ' ' << slot.source << ": ";
+    out.write(slot.message, slot.length);
+    out << '\n';
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/**
+ * Levels, in the same order as WGPULogLevel so they map one to one.
+ */
+enum class LogLevel : uint32_t
+{
+    Off = 0,
+    Error = 1,
+    Warn = 2,
+    Info = 3,
+    Debug = 4,
+    Trace = 5,
+};
+
+/**
+ * Asynchronous logger for the App and wgpu-native messages.
+ *
+ * Producers copy their message into a slot of a bounded lock-free MPSC
+ * ring and return; a background thread formats and writes the records.
+ * Nothing on the producer side waits: when the ring is full or the rate
+ * limit is exceeded the message is dropped, and the number of dropped
+ * messages is logged once there is room again. Errors bypass the rate
+ * limit, not the ring capacity.
+ *
+ *     logInfo() << "Got device: " << device;
+ *
+ * Messages longer than a slot are split by line and lines truncated.
+ */
+class Logger
+{
+public:
+    static Logger & instance();
+
+    /**
+     * Messages above the level are discarded before being formatted. With
+     * wgpu-native this also sets wgpuSetLogLevel, so that filtered native
+     * messages are not even produced.
+     */
+    void setLevel(LogLevel level);
+    LogLevel level() const { return static_cast<LogLevel>(m_level.load(std::memory_order_relaxed)); }
+    bool enabled(LogLevel level) const { return level != LogLevel::Off && level <= this->level(); }
+
+    /**
+     * At most `messagesPerSecond` non-error messages per second, 0 for no limit.
+     */
+    void setRateLimit(uint32_t messagesPerSecond);
+
+    /**
+     * Route wgpu-native's own log through this logger.
+     */
+    void captureWebGPULog();
+
+    /**
+     * Where records are written by the background thread, std::cout by
+     * default. The stream must outlive the logger.
+     */
+    void setOutput(std::ostream & output);
+
+    /**
+     * Never blocks. `source` must be a string literal, e.g. "App" or "wgpu".
+     */
+    void log(LogLevel level, char const * source, char const * message, size_t length);
+    void log(LogLevel level, char const * source, std::string const & message)
+    {
+        log(level, source, message.data(), message.size());
+    }
+
+    /**
+     * Block until every record logged so far is written.
+     */
+    void flush();
+
+    size_t droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    ~Logger();
+
+private:
+    static constexpr size_t SlotCount = 1024;
+    static constexpr size_t MessageCapacity = 240;
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence{ 0 };
+        LogLevel level = LogLevel::Info;
+        char const * source = "";
+        std::chrono::system_clock::time_point time;
+        uint32_t length = 0;
+        char message[MessageCapacity];
+    };
+
+    Logger();
+    bool tryEnqueue(LogLevel level, char const * source, char const * message, size_t length);
+    bool allowedByRate(LogLevel level);
+    void run();
+    void write(Slot const & slot);
+
+    std::unique_ptr<std::array<Slot, SlotCount>> m_slots;
+    alignas(64) std::atomic<size_t> m_enqueuePosition{ 0 };
+    alignas(64) size_t m_dequeuePosition = 0;
+
+    std::atomic<uint32_t> m_level{ static_cast<uint32_t>(LogLevel::Info) };
+    std::atomic<uint32_t> m_rateLimit{ 0 };
+    std::atomic<int64_t> m_rateWindow{ 0 };
+    std::atomic<uint32_t> m_rateCount{ 0 };
+    std::atomic<size_t> m_dropped{ 0 };
+    size_t m_reportedDropped = 0;
+
+    std::ostream * m_output;
+    std::atomic<bool> m_stop{ false };
+    std::atomic<size_t> m_written{ 0 };
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::thread m_thread;
+};
+
+/**
+ * One message built with operator<<, logged when the line goes out of
+ * scope. Nothing is formatted when the level is filtered out.
+ */
+class LogLine
+{
+public:
+    LogLine(LogLevel level, char const * source = "App")
+        : m_level(level)
+        , m_source(source)
+        , m_enabled(Logger::instance().enabled(level))
+    {
+    }
+    ~LogLine()
+    {
+        if (m_enabled)
+        {
+            Logger::instance().log(m_level, m_source, m_stream.str());
+        }
+    }
+
+    LogLine(LogLine const &) = delete;
+    LogLine & operator=(LogLine const &) = delete;
+
+    template <typename T>
+    LogLine & operator<<(T const & value)
+    {
+        if (m_enabled) m_stream << value;
+        return *this;
+    }
+
+    /**
+     * For functions writing to a stream, e.g. report(logInfo().stream()).
+     */
+    std::ostream & stream() { return m_stream; }
+
+private:
+    LogLevel m_level;
+    char const * m_source;
+    bool m_enabled;
+    std::ostringstream m_stream;
+};
+
+inline LogLine logError() { return LogLine(LogLevel::Error); }
+inline LogLine logWarn() { return LogLine(LogLevel::Warn); }
+inline LogLine logInfo() { return LogLine(LogLevel::Info); }
+inline LogLine logDebug() { return LogLine(LogLevel::Debug); }
@@ -1,14 +1,134 @@
 #include "utility.h"
+#ifdef WEBGPU_INTERPOSE
+#include "api_interpose.h"
+#endif // WEBGPU_INTERPOSE
+#include "bind_group_layout_cache.h"
+#include "error_tracker.h"
+#include "gpu_profiler.h"
+#include "gpu_timer.h"
+#include "logger.h"
+#include "pipeline_statistics.h"
+#include "registry_metrics.h"
+#include "shader_hot_reload.h"
+#include "shader_library.h"
+#include "shader_module_cache.h"
+#include "trace_recorder.h"
 
 #include <webgpu/webgpu.h>
 #ifdef WEBGPU_BACKEND_WGPU
 #include <webgpu/wgpu.h>
 #endif // WEBGPU_BACKEND_WGPU
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
 #include <vector>
 
-int main()
+namespace
 {
+volatile std::sig_atomic_t stopRequested = 0;
+
+// a whole decimal number that fits a uint32_t; std::stoul would throw on
+// anything else, or take the leading digits of "10x"
+bool parseUInt32(char const * text, uint32_t & value)
+{
+    char * end = nullptr;
+    errno = 0;
+    unsigned long parsed = std::strtoul(text, &end, 10);
+    if (!std::isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' || errno == ERANGE || parsed > UINT32_MAX)
+    {
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+void printUsage(char const * program)
+{
+    std::cerr << "Usage: " << program << " [--watch] [--trace=<file>] [--trace-sample=<n>] [--metrics=<file.csv>]"
+        << " [--log-level=<0-5>] [--log-rate=<n>]" << std::endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    // --watch keeps the App running and reloads shaders edited in shaders/
+    // --trace=<file> writes a CPU+GPU timeline (.json for Chrome, else Perfetto),
+    //     with --watch also <file>.1, .2... whenever a capture fills up
+    // --trace-sample=<n> only traces one frame out of n
+    // --metrics=<file.csv> appends the resource registry counts every second
+    // --log-level=<0-5> from off to trace, also applied to wgpu-native (3, info)
+    // --log-rate=<n> logs at most n messages per second, errors excepted
+    bool watchShaders = false;
+    std::string tracePath;
+    uint32_t traceSamplePeriod = 1;
+    std::string metricsPath;
+    Logger & logger = Logger::instance();
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--watch") == 0) watchShaders = true;
+        else if (std::strncmp(argv[i], "--trace=", 8) == 0) tracePath = argv[i] + 8;
+        else if (std::strncmp(argv[i], "--trace-sample=", 15) == 0)
+        {
+            if (!parseUInt32(argv[i] + 15, traceSamplePeriod))
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (std::strncmp(argv[i], "--metrics=", 10) == 0) metricsPath = argv[i] + 10;
+        else if (std::strncmp(argv[i], "--log-level=", 12) == 0)
+        {
+            uint32_t level = 0;
+            if (!parseUInt32(argv[i] + 12, level))
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            logger.setLevel(static_cast<LogLevel>(std::min(level, 5u)));
+        }
+        else if (std::strncmp(argv[i], "--log-rate=", 11) == 0)
+        {
+            uint32_t rate = 0;
+            if (!parseUInt32(argv[i] + 11, rate))
+            {
+                printUsage(argv[0]);
+                return 1;
+            }
+            logger.setRateLimit(rate);
+        }
+    }
+    logger.captureWebGPULog();
+#ifdef WEBGPU_INTERPOSE
+    // the App reports the hottest API calls itself, framed by its own loop
+    ApiInterposer::instance().setExitReport(false);
+#endif // WEBGPU_INTERPOSE
+    TraceRecorder & trace = TraceRecorder::instance();
+    trace.setSamplePeriod(tracePath.empty() ? 0 : traceSamplePeriod);
+    trace.setThreadName("Main thread");
+    // written captures start over in the same buffers
+    auto flushTrace = [&trace](std::string const & path) {
+        if (trace.write(path))
+        {
+            logInfo() << "Trace written to " << path << " (" << trace.droppedEventCount() << " events dropped)";
+        }
+        else
+        {
+            logError() << "Could not write trace " << path;
+        }
+        trace.clear();
+    };
+    size_t traceSegments = 0;
+
     WGPUInstanceDescriptor desc = {};
     desc.nextInChain = nullptr;
 
@@ -20,24 +140,51 @@ int main()
 
     if (instance == nullptr)
     {
-        std::cerr << "Could not initialize WebGPU!" << std::endl;
+        logError() << "Could not initialize WebGPU!";
         return 1;
     }
 
-    std::cout << "WGPU instance: " << instance << std::endl;
+    logInfo() << "WGPU instance: " << instance;
 
     // finished getting instance, start requesting adapter.
 
-    std::cout << "Requesting adapter..." << std::endl;
+    logInfo() << "Requesting adapter...";
 
     WGPURequestAdapterOptions adapterOpts = {};
     adapterOpts.nextInChain = nullptr;
     WGPUAdapter adapter = requestAdapterSync(instance, &adapterOpts);
 
-    std::cout << "Got adapter: " << adapter << std::endl;
+    logInfo() << "Got adapter: " << adapter;
 
-    // instance is no longer used once the adapter is selected.
-    wgpuInstanceRelease(instance);
+    // the instance is kept until the end: resource registry reports are
+    // generated from it.
+    RegistryMetricsSampler registryMetrics(instance);
+    std::ofstream metricsFile;
+    if (!metricsPath.empty())
+    {
+        metricsFile.open(metricsPath);
+    }
+    auto sampleRegistries = [&](bool force)
+    {
+        if (!registryMetrics.supported())
+        {
+            return false;
+        }
+        if (force)
+        {
+            registryMetrics.sample();
+        }
+        else if (!registryMetrics.poll())
+        {
+            return false;
+        }
+        if (metricsFile)
+        {
+            registryMetrics.appendCsv(metricsFile, registryMetrics.sampleCount() == 1);
+            metricsFile.flush();
+        }
+        return true;
+    };
 
     // finished requesting adapter, start querying limits.
 
@@ -53,11 +200,11 @@ int main()
 
     if (success)
     {
-        std::cout << "Adapter limits:" << std::endl;
-        std::cout << " - maxTextureDimension1D: " << supportedLimits.limits.maxTextureDimension1D << std::endl;
-        std::cout << " - maxTextureDimension2D: " << supportedLimits.limits.maxTextureDimension2D << std::endl;
-        std::cout << " - maxTextureDimension3D: " << supportedLimits.limits.maxTextureDimension3D << std::endl;
-        std::cout << " - maxTextureArrayLayers: " << supportedLimits.limits.maxTextureArrayLayers << std::endl;
+        logInfo() << "Adapter limits:"
+            << "\n - maxTextureDimension1D: " << supportedLimits.limits.maxTextureDimension1D
+            << "\n - maxTextureDimension2D: " << supportedLimits.limits.maxTextureDimension2D
+            << "\n - maxTextureDimension3D: " << supportedLimits.limits.maxTextureDimension3D
+            << "\n - maxTextureArrayLayers: " << supportedLimits.limits.maxTextureArrayLayers;
     }
 #endif // NOT __EMSCRIPTEN__
 
@@ -74,100 +221,269 @@ int main()
     // Call the function a second time, with a non-null return address
     wgpuAdapterEnumerateFeatures(adapter, features.data());
 
-    std::cout << "Adapter features:" << std::endl;
-    std::cout << std::hex; // write integers as hexadecimal to ease comparison with webgpu.h literals
-    for (auto f: features)
     {
-        std::cout << " - 0x" << f << std::endl;
+        LogLine featureLog(LogLevel::Info);
+        featureLog << "Adapter features:";
+        featureLog.stream() << std::hex; // write integers as hexadecimal to ease comparison with webgpu.h literals
+        for (auto f: features)
+        {
+            featureLog << "\n - 0x" << f;
+        }
     }
-    std::cout << std::dec; // Restore decimal numbers
 
     // querying properties
     WGPUAdapterProperties properties = {};
     properties.nextInChain = nullptr;
     wgpuAdapterGetProperties(adapter, &properties);
-    std::cout << "Adapter properties:" << std::endl;
-    std::cout << " - vendorID: " << properties.vendorID << std::endl;
-    if (properties.vendorName)
-    {
-        std::cout << " - vendorName: " << properties.vendorName << std::endl;
-    }
-    if (properties.architecture)
     {
-        std::cout << " - architecture: " << properties.architecture << std::endl;
+        LogLine propertyLog(LogLevel::Info);
+        propertyLog << "Adapter properties:";
+        propertyLog << "\n - vendorID: " << properties.vendorID;
+        if (properties.vendorName)
+        {
+            propertyLog << "\n - vendorName: " << properties.vendorName;
+        }
+        if (properties.architecture)
+        {
+            propertyLog << "\n - architecture: " << properties.architecture;
+        }
+        propertyLog << "\n - deviceID: " << properties.deviceID;
+        if (properties.name)
+        {
+            propertyLog << "\n - name: " << properties.name;
+        }
+        if (properties.driverDescription)
+        {
+            propertyLog << "\n - driverDescription: " << properties.driverDescription;
+        }
+        propertyLog.stream() << std::hex;
+        propertyLog << "\n - adapterType: 0x" << properties.adapterType;
+        propertyLog << "\n - backendType: 0x" << properties.backendType;
     }
-    std::cout << " - deviceID: " << properties.deviceID << std::endl;
-    if (properties.name)
-    {
-        std::cout << " - name: " << properties.name << std::endl;
-    }
-    if (properties.driverDescription)
-    {
-        std::cout << " - driverDescription: " << properties.driverDescription << std::endl;
-    }
-    std::cout << std::hex;
-    std::cout << " - adapterType: 0x" << properties.adapterType << std::endl;
-    std::cout << " - backendType: 0x" << properties.backendType << std::endl;
-    std::cout << std::dec; // Restore decimal numbers
 
-    std::cout << "Requesting device..." << std::endl;
+    logInfo() << "Requesting device...";
 
     WGPUDeviceDescriptor deviceDesc = {};
     
     deviceDesc.nextInChain = nullptr;
     deviceDesc.label = "My Device"; // anything works here, that's your call
-    deviceDesc.requiredFeatureCount = 0; // we do not require any specific feature
+    // timestamp queries are optional, they let us measure GPU time when available
+    std::vector<WGPUFeatureName> requiredFeatures;
+    if (std::find(features.begin(), features.end(), WGPUFeatureName_TimestampQuery) != features.end())
+    {
+        requiredFeatures.push_back(WGPUFeatureName_TimestampQuery);
+    }
+#ifdef WEBGPU_BACKEND_WGPU
+    // as are pipeline statistics queries, which count shader invocations
+    auto pipelineStatisticsFeature = static_cast<WGPUFeatureName>(WGPUNativeFeature_PipelineStatisticsQuery);
+    if (std::find(features.begin(), features.end(), pipelineStatisticsFeature) != features.end())
+    {
+        requiredFeatures.push_back(pipelineStatisticsFeature);
+    }
+#endif // WEBGPU_BACKEND_WGPU
+    deviceDesc.requiredFeatureCount = requiredFeatures.size();
+    deviceDesc.requiredFeatures = requiredFeatures.data();
     deviceDesc.requiredLimits = nullptr; // we do not require any specific limit
     deviceDesc.defaultQueue.nextInChain = nullptr;
     deviceDesc.defaultQueue.label = "The default queue";
     deviceDesc.deviceLostCallback = [](WGPUDeviceLostReason reason, char const* message, void* /* pUserData */)
     {
-        std::cout << "Device lost: reason " << reason;
-        if (message) std::cout << " (" << message << ")";
-        std::cout << std::endl;
+        // may be called from a wgpu-native thread, the logger never blocks it
+        LogLine line(LogLevel::Error);
+        line << "Device lost: reason " << reason;
+        if (message) line << " (" << message << ")";
     };
 
     WGPUDevice device = requestDeviceSync(adapter, &deviceDesc);
 
-    std::cout << "Got device: " << device << std::endl;
+    logInfo() << "Got device: " << device;
+
+    // validation errors are counted per call site instead of being lost
+    ErrorTracker errors(device);
 
     // adapter can be released before the device and
     // we never use it again after getting device.
     wgpuAdapterRelease(adapter);
 
+    // loading shaders from the pack built by ShaderPackTool, the pack is
+    // memory-mapped and modules are created straight from its bytes.
+    ShaderModuleCache moduleCache(device);
+    ShaderLibrary shaderLibrary;
+    auto loadStart = std::chrono::steady_clock::now();
+    if (shaderLibrary.load(moduleCache, "shaders.pack"))
+    {
+        std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+        logInfo() << "Loaded " << shaderLibrary.moduleCount() << " shader modules in " << loadTime.count() << " ms";
+    }
+    else
+    {
+        logError() << "Could not load shaders.pack";
+    }
+
     // querying queue
     WGPUQueue queue = wgpuDeviceGetQueue(device);
 
     auto onQueueWorkDone = [](WGPUQueueWorkDoneStatus status, void* /* pUserData */)
     {
-        std::cout << "Queued work finished with status: " << status << std::endl;
+        logInfo() << "Queued work finished with status: " << status;
     };
     wgpuQueueOnSubmittedWorkDone(queue, onQueueWorkDone, nullptr /* pUserData */);
 
+    // compute pipelines with explicit layouts built from the reflection data
+    // of the pack. fill.wgsl and scale.comp declare the same bindings, so
+    // they get the same bind group layout and can share one bind group.
+    BindGroupLayoutCache layoutCache(device);
+    std::vector<WGPUComputePipeline> pipelines;
+    std::vector<char const *> pipelineShaders;
+    WGPUBindGroupLayout sharedLayout = nullptr;
+    for (char const * name : { "fill.wgsl", "scale.comp" })
+    {
+        WGPU_ERROR_SCOPE(errors, "Create pipeline");
+        ShaderPack::Shader shader;
+        WGPUShaderModule module = shaderLibrary.module(name);
+        if (module == nullptr || !shaderLibrary.pack().find(name, shader))
+        {
+            continue;
+        }
+        std::vector<ShaderBindingLayout> bindings = shader.bindingLayouts();
+
+        WGPUComputePipelineDescriptor pipelineDesc = {};
+        pipelineDesc.nextInChain = nullptr;
+        pipelineDesc.label = name;
+        pipelineDesc.layout = layoutCache.pipelineLayout(bindings);
+        pipelineDesc.compute.module = module;
+        pipelineDesc.compute.entryPoint = "main";
+        pipelines.push_back(wgpuDeviceCreateComputePipeline(device, &pipelineDesc));
+        pipelineShaders.push_back(name);
+        sharedLayout = layoutCache.bindGroupLayout(bindings, 0);
+    }
+    logInfo() << "Created " << pipelines.size() << " compute pipelines sharing "
+        << layoutCache.bindGroupLayoutCount() << " bind group layout(s)";
+
+    constexpr uint32_t valueCount = 64;
+    struct FillParams
+    {
+        uint32_t count;
+        uint32_t gridWidth;
+        float scale;
+        float offset;
+    };
+    FillParams params = { valueCount, valueCount, 0.5f, 1.0f };
+
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Values";
+    bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc;
+    bufferDesc.size = valueCount * sizeof(float);
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer valueBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+    bufferDesc.label = "Fill parameters";
+    bufferDesc.usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = sizeof(FillParams);
+    WGPUBuffer paramBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    wgpuQueueWriteBuffer(queue, paramBuffer, 0, &params, sizeof(params));
+
+    WGPUBindGroup bindGroup = nullptr;
+    if (sharedLayout)
+    {
+        WGPU_ERROR_SCOPE(errors, "Create bind group");
+        WGPUBindGroupEntry entries[2] = {};
+        entries[0].binding = 0;
+        entries[0].buffer = valueBuffer;
+        entries[0].size = valueCount * sizeof(float);
+        entries[1].binding = 1;
+        entries[1].buffer = paramBuffer;
+        entries[1].size = sizeof(FillParams);
+
+        WGPUBindGroupDescriptor bindGroupDesc = {};
+        bindGroupDesc.nextInChain = nullptr;
+        bindGroupDesc.label = "Shared bind group";
+        bindGroupDesc.layout = sharedLayout;
+        bindGroupDesc.entryCount = 2;
+        bindGroupDesc.entries = entries;
+        bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDesc);
+    }
+
+    // GPU timestamps go on the CPU timeline of the trace once calibrated
+    int64_t gpuClockOffset = 0;
+    int64_t gpuClockUncertainty = 0;
+    if (!tracePath.empty() && calibrateGpuClock(device, queue, gpuClockOffset, gpuClockUncertainty))
+    {
+        trace.setGpuClockOffset(gpuClockOffset);
+        logInfo() << "GPU clock calibrated to +/- " << gpuClockUncertainty / 1000 << " us";
+    }
+
+    // GPU time of debug groups and passes, read back a few frames later
+    GpuProfiler profiler(device);
+    profiler.setTimestampListener([&trace](std::string const & path, uint64_t begin, uint64_t end, size_t frame) {
+        trace.addGpuEvent(path, begin, end, frame);
+    });
+    trace.beginFrame();
+    profiler.beginFrame();
+    uint64_t encodeStart = TraceRecorder::nowNs();
+
     WGPUCommandEncoderDescriptor encoderDesc = {};
     encoderDesc.nextInChain = nullptr;
     encoderDesc.label = "My command encoder";
     WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
 
+    PipelineStatisticsCollector pipelineStatistics(device);
+    pipelineStatistics.beginFrame();
+
     wgpuCommandEncoderInsertDebugMarker(encoder, "Do one thing");
+    if (bindGroup)
+    {
+        WGPU_ERROR_SCOPE(errors, "Encode compute pass");
+        GpuProfiler::Scope scope(profiler, encoder, "Compute");
+        WGPUComputePassDescriptor passDesc = {};
+        passDesc.nextInChain = nullptr;
+        passDesc.label = "Fill then scale";
+        passDesc.timestampWrites = profiler.computePassTimestampWrites(passDesc.label);
+        WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+        // each pipeline only needs one invocation per value
+        pipelineStatistics.beginComputePass(pass, passDesc.label, valueCount * pipelines.size());
+        for (WGPUComputePipeline pipeline : pipelines)
+        {
+            // the bind group is set once per pipeline, never rebuilt
+            wgpuComputePassEncoderSetPipeline(pass, pipeline);
+            wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+            wgpuComputePassEncoderDispatchWorkgroups(pass, (valueCount + 63) / 64, 1, 1);
+        }
+        pipelineStatistics.endComputePass(pass);
+        wgpuComputePassEncoderEnd(pass);
+        wgpuComputePassEncoderRelease(pass);
+    }
     wgpuCommandEncoderInsertDebugMarker(encoder, "Do another thing");
+    profiler.resolve(encoder);
+    pipelineStatistics.resolve(encoder);
 
     WGPUCommandBufferDescriptor cmdBufferDescriptor = {};
     cmdBufferDescriptor.nextInChain = nullptr;
     cmdBufferDescriptor.label = "Command buffer";
-    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDescriptor);
+    WGPUCommandBuffer command = nullptr;
+    {
+        WGPU_ERROR_SCOPE(errors, "Finish commands");
+        command = wgpuCommandEncoderFinish(encoder, &cmdBufferDescriptor);
+    }
     wgpuCommandEncoderRelease(encoder); // release encoder after it's finished
+    trace.addCpuEvent("Encode", "cpu", encodeStart, TraceRecorder::nowNs());
 
     // Finally submit the command queue
-    std::cout << "Submitting command..." << std::endl;
-    wgpuQueueSubmit(queue, 1, &command);
+    logInfo() << "Submitting command...";
+    {
+        TraceScope scope("Submit");
+        WGPU_ERROR_SCOPE(errors, "Submit");
+        wgpuQueueSubmit(queue, 1, &command);
+    }
     // release command buffer once submitted
     wgpuCommandBufferRelease(command);
-    std::cout << "Command submitted." << std::endl;
+    profiler.endFrame();
+    logInfo() << "Command submitted.";
 
     for (int i = 0 ; i < 5 ; ++i)
     {
-        std::cout << "Tick/Poll device..." << std::endl;
+        logDebug() << "Tick/Poll device...";
 #if defined(WEBGPU_BACKEND_DAWN)
         wgpuDeviceTick(device);
 #elif defined(WEBGPU_BACKEND_WGPU)
@@ -177,8 +493,200 @@ int main()
 #endif
     }
 
+    {
+        TraceScope scope("Wait for GPU");
+        pollDevice(device, true);
+    }
+    profiler.collect();
+    profiler.report(logInfo().stream());
+    pipelineStatistics.report(logInfo().stream());
+    if (sampleRegistries(true))
+    {
+        registryMetrics.report(logInfo().stream());
+    }
+
+    // the ported GLSL kernel side by side with its WGSL counterpart, for
+    // every define permutation of the GLSL one.
+    ShaderPack::Shader glslShader;
+    if (bindGroup && shaderLibrary.pack().find("scale.comp", glslShader))
+    {
+        GpuTimer timer(device, queue);
+        auto timeKernel = [&](char const * name, WGPUComputePipeline pipeline)
+        {
+            double ms = timer.timeComputePass([&](WGPUComputePassEncoder pass)
+            {
+                wgpuComputePassEncoderSetPipeline(pass, pipeline);
+                wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+                wgpuComputePassEncoderDispatchWorkgroups(pass, (valueCount + 63) / 64, 1, 1);
+            });
+            logInfo() << " - " << name << ": " << ms << " ms";
+        };
+
+        logInfo() << "Kernel " << (timer.hasTimestamps() ? "GPU" : "wall") << " times:";
+        for (size_t i = 0; i < pipelines.size(); ++i)
+        {
+            timeKernel(pipelineShaders[i], pipelines[i]);
+        }
+        for (ShaderDefines const & defines : expandDefinePermutations({ { "CLAMP_OUTPUT", { "0", "1" } } }))
+        {
+            std::string name = permutationName(glslShader.name, defines);
+            WGPUComputePipelineDescriptor pipelineDesc = {};
+            pipelineDesc.nextInChain = nullptr;
+            pipelineDesc.label = name.c_str();
+            pipelineDesc.layout = layoutCache.pipelineLayout(glslShader.bindingLayouts());
+            pipelineDesc.compute.module = moduleCache.module(glslShader, defines);
+            pipelineDesc.compute.entryPoint = "main";
+            if (pipelineDesc.compute.module == nullptr)
+            {
+                continue;
+            }
+            WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(device, &pipelineDesc);
+            timeKernel(name.c_str(), pipeline);
+            wgpuComputePipelineRelease(pipeline);
+        }
+        logInfo() << "Shader module cache: " << moduleCache.moduleCount() << " modules, "
+            << moduleCache.hitCount() << " hits";
+    }
+
+    if (watchShaders && bindGroup)
+    {
+        // frame loop: pipelines are rebuilt in the background when their
+        // sources change and swapped in at the start of a frame.
+        ShaderHotReloader reloader(device, queue, layoutCache);
+        if (!reloader.start(SHADER_SOURCE_DIR "/"))
+        {
+            logWarn() << "Shader hot-reload is not supported on this platform";
+        }
+        auto recordDispatch = [bindGroup](WGPUComputePassEncoder pass, WGPUComputePipeline pipeline)
+        {
+            wgpuComputePassEncoderSetPipeline(pass, pipeline);
+            wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+            wgpuComputePassEncoderDispatchWorkgroups(pass, (valueCount + 63) / 64, 1, 1);
+        };
+        std::vector<size_t> slots;
+        for (size_t i = 0; i < pipelines.size(); ++i)
+        {
+            slots.push_back(reloader.addComputePipeline(pipelineShaders[i], "main", pipelines[i], recordDispatch));
+        }
+
+        logInfo() << "Watching " << SHADER_SOURCE_DIR << ", press Ctrl+C to quit.";
+        std::signal(SIGINT, [](int) { stopRequested = 1; });
+        for (size_t frame = 1; !stopRequested; ++frame)
+        {
+            trace.beginFrame();
+            TraceScope frameScope("Frame");
+            {
+                TraceScope scope("Reload");
+                reloader.beginFrame();
+            }
+            profiler.beginFrame();
+
+            // error scopes are one stack per device: none on this thread
+            // while the reloader's worker pushes and pops its own
+            static ErrorTracker::Site frameSite{ "Frame commands", __FILE__, __LINE__ };
+            std::optional<ErrorTracker::Scope> frameErrors;
+            if (!reloader.isBuilding())
+            {
+                frameErrors.emplace(errors, frameSite);
+            }
+            WGPUCommandEncoder frameEncoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+            {
+                TraceScope encodeScope("Encode");
+                GpuProfiler::Scope scope(profiler, frameEncoder, "Frame");
+                WGPUComputePassDescriptor passDesc = {};
+                passDesc.nextInChain = nullptr;
+                passDesc.label = "Reloadable kernels";
+                passDesc.timestampWrites = profiler.computePassTimestampWrites(passDesc.label);
+                WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(frameEncoder, &passDesc);
+                for (size_t slot : slots)
+                {
+                    recordDispatch(pass, reloader.pipeline(slot));
+                }
+                wgpuComputePassEncoderEnd(pass);
+                wgpuComputePassEncoderRelease(pass);
+            }
+            profiler.resolve(frameEncoder);
+            WGPUCommandBuffer frameCommand = wgpuCommandEncoderFinish(frameEncoder, &cmdBufferDescriptor);
+            wgpuCommandEncoderRelease(frameEncoder);
+            {
+                TraceScope scope("Submit");
+                wgpuQueueSubmit(queue, 1, &frameCommand);
+            }
+            wgpuCommandBufferRelease(frameCommand);
+            frameErrors.reset();
+            profiler.endFrame();
+            errors.endFrame();
+
+            {
+                // map callbacks of the profiler run in there
+                TraceScope scope("Poll");
+                pollDevice(device, false);
+            }
+#ifdef WEBGPU_INTERPOSE
+            ApiInterposer::instance().endFrame();
+#endif // WEBGPU_INTERPOSE
+            if (frame % 120 == 0)
+            {
+                profiler.report(logInfo().stream());
+                if (errors.errorCount() > 0)
+                {
+                    errors.report(logWarn().stream());
+                }
+#ifdef WEBGPU_INTERPOSE
+                ApiInterposer::instance().report(logInfo().stream(), 10);
+#endif // WEBGPU_INTERPOSE
+            }
+            if (sampleRegistries(false) && !registryMetrics.growingRegistries().empty())
+            {
+                registryMetrics.report(logInfo().stream());
+            }
+            if (!tracePath.empty() && trace.droppedEventCount() > 0)
+            {
+                // trace.json becomes trace.1.json, trace.2.json...
+                size_t slash = tracePath.find_last_of("/\\");
+                size_t dot = tracePath.rfind('.');
+                if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+                {
+                    dot = tracePath.size();
+                }
+                flushTrace(tracePath.substr(0, dot) + "." + std::to_string(++traceSegments) + tracePath.substr(dot));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+    }
+
+    if (!tracePath.empty())
+    {
+        flushTrace(tracePath);
+    }
+
+    if (bindGroup) wgpuBindGroupRelease(bindGroup);
+    wgpuBufferRelease(paramBuffer);
+    wgpuBufferRelease(valueBuffer);
+    for (WGPUComputePipeline pipeline : pipelines)
+    {
+        wgpuComputePipelineRelease(pipeline);
+    }
+    pipelineStatistics.release();
+    profiler.release();
+    layoutCache.release();
+    shaderLibrary.release();
+    moduleCache.release();
+    errors.report(logInfo().stream());
+    errors.release();
     wgpuQueueRelease(queue);
     wgpuDeviceRelease(device);
 
+    // whatever is still allocated now was leaked
+    if (sampleRegistries(true))
+    {
+        registryMetrics.report(logInfo().stream());
+    }
+    wgpuInstanceRelease(instance);
+
+#ifdef WEBGPU_INTERPOSE
+    ApiInterposer::instance().report(logInfo().stream());
+#endif // WEBGPU_INTERPOSE
+
     return 0;
 }
\ No newline at end of file
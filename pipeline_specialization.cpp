@@ -0,0 +1,66 @@
+#include "pipeline_specialization.h"
+
+std::vector<WGPUConstantEntry> SpecializationConstants::entries() const
+{
+    std::vector<WGPUConstantEntry> entries;
+    for (auto const & value : m_values)
+    {
+        WGPUConstantEntry entry = {};
+        entry.nextInChain = nullptr;
+        entry.key = value.first.c_str();
+        entry.value = value.second;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+SpecializedPipelineCache::SpecializedPipelineCache(WGPUDevice device)
+    : m_device(device)
+{
+}
+
+SpecializedPipelineCache::~SpecializedPipelineCache()
+{
+    release();
+}
+
+WGPUComputePipeline SpecializedPipelineCache::computePipeline(
+    WGPUShaderModule module,
+    char const * entryPoint,
+    WGPUPipelineLayout layout,
+    SpecializationConstants const & constants,
+    char const * label)
+{
+    Key key(module, entryPoint, layout, constants);
+    auto it = m_pipelines.find(key);
+    if (it != m_pipelines.end())
+    {
+        ++m_hits;
+        return it->second;
+    }
+
+    std::vector<WGPUConstantEntry> entries = constants.entries();
+    WGPUComputePipelineDescriptor pipelineDesc = {};
+    pipelineDesc.nextInChain = nullptr;
+    pipelineDesc.label = label;
+    pipelineDesc.layout = layout;
+    pipelineDesc.compute.module = module;
+    pipelineDesc.compute.entryPoint = entryPoint;
+    pipelineDesc.compute.constantCount = entries.size();
+    pipelineDesc.compute.constants = entries.data();
+    WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+    if (pipeline)
+    {
+        m_pipelines[key] = pipeline;
+    }
+    return pipeline;
+}
+
+void SpecializedPipelineCache::release()
+{
+    for (auto & entry : m_pipelines)
+    {
+        wgpuComputePipelineRelease(entry.second);
+    }
+    m_pipelines.clear();
+}
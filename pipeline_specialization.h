@@ -0,0 +1,121 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Values of the pipeline-overridable constants of a shader, i.e. its WGSL
+ * `override` declarations, ready to be passed as the `constants` of a
+ * WGPUProgrammableStageDescriptor:
+ *     SpecializationConstants constants;
+ *     constants.set("ITERATIONS", 16u).set("SCALE", 0.5f);
+ *
+ * Constants are doubles on the API side whatever their WGSL type (bool,
+ * i32, u32, f32 or f16), the typed setter only checks that the C++ value
+ * makes sense for one of those.
+ */
+class SpecializationConstants
+{
+public:
+    template <typename T>
+    SpecializationConstants & set(std::string const & key, T value)
+    {
+        static_assert(std::is_arithmetic<T>::value, "override constants are scalars");
+        static_assert(sizeof(T) <= 4 || std::is_floating_point<T>::value, "override constants are 32-bit at most");
+        m_values[key] = static_cast<double>(value);
+        return *this;
+    }
+
+    bool empty() const { return m_values.empty(); }
+
+    /**
+     * Entries sorted by key, pointing into this object: they stay valid
+     * as long as it is alive and not modified.
+     */
+    std::vector<WGPUConstantEntry> entries() const;
+
+    bool operator<(SpecializationConstants const & other) const { return m_values < other.m_values; }
+
+private:
+    std::map<std::string, double> m_values;
+};
+
+/**
+ * Compute pipelines specialized by constants, created on first use and
+ * kept for the lifetime of the cache, which owns them.
+ */
+class SpecializedPipelineCache
+{
+public:
+    explicit SpecializedPipelineCache(WGPUDevice device);
+    ~SpecializedPipelineCache();
+
+    SpecializedPipelineCache(SpecializedPipelineCache const &) = delete;
+    SpecializedPipelineCache & operator=(SpecializedPipelineCache const &) = delete;
+
+    WGPUComputePipeline computePipeline(
+        WGPUShaderModule module,
+        char const * entryPoint,
+        WGPUPipelineLayout layout,
+        SpecializationConstants const & constants,
+        char const * label = nullptr);
+
+    size_t pipelineCount() const { return m_pipelines.size(); }
+    size_t hitCount() const { return m_hits; }
+
+    void release();
+
+private:
+    using Key = std::tuple<WGPUShaderModule, std::string, WGPUPipelineLayout, SpecializationConstants>;
+
+    WGPUDevice m_device;
+    std::map<Key, WGPUComputePipeline> m_pipelines;
+    size_t m_hits = 0;
+};
+
+/**
+ * A compute kernel specialized from runtime parameters. The selector turns
+ * parameters into constants and should bucket them (e.g. round a loop
+ * count up to a power of two) so that only a few pipelines get created:
+ *     SpecializedKernel<uint32_t> kernel(cache, module, "main", layout,
+ *         [](uint32_t n) { return SpecializationConstants().set("N", n); });
+ *     wgpuComputePassEncoderSetPipeline(pass, kernel.pipeline(n));
+ */
+template <typename Params>
+class SpecializedKernel
+{
+public:
+    using Selector = std::function<SpecializationConstants(Params const & params)>;
+
+    SpecializedKernel(
+        SpecializedPipelineCache & cache,
+        WGPUShaderModule module,
+        std::string entryPoint,
+        WGPUPipelineLayout layout,
+        Selector selector)
+        : m_cache(cache)
+        , m_module(module)
+        , m_entryPoint(std::move(entryPoint))
+        , m_layout(layout)
+        , m_selector(std::move(selector))
+    {
+    }
+
+    WGPUComputePipeline pipeline(Params const & params)
+    {
+        return m_cache.computePipeline(m_module, m_entryPoint.c_str(), m_layout, m_selector(params), m_entryPoint.c_str());
+    }
+
+private:
+    SpecializedPipelineCache & m_cache;
+    WGPUShaderModule m_module;
+    std::string m_entryPoint;
+    WGPUPipelineLayout m_layout;
+    Selector m_selector;
+};
@@ -0,0 +1,224 @@
+#include "pipeline_statistics.h"
+#include "utility.h"
+
+namespace
+{
+
+#ifdef WEBGPU_BACKEND_WGPU
+// wgpu resolves the statistics of a query in this order, whatever the
+// order they were requested in
+WGPUPipelineStatisticName const statisticNames[] = {
+    WGPUPipelineStatisticName_VertexShaderInvocations,
+    WGPUPipelineStatisticName_ClipperInvocations,
+    WGPUPipelineStatisticName_ClipperPrimitivesOut,
+    WGPUPipelineStatisticName_FragmentShaderInvocations,
+    WGPUPipelineStatisticName_ComputeShaderInvocations,
+};
+#endif // WEBGPU_BACKEND_WGPU
+
+constexpr uint32_t statisticCount = 5;
+constexpr uint64_t queryStride = statisticCount * sizeof(uint64_t);
+
+} // namespace
+
+PipelineStatisticsCollector::PipelineStatisticsCollector(WGPUDevice device, uint32_t maxPasses)
+    : m_device(device)
+    , m_maxPasses(maxPasses)
+{
+#ifdef WEBGPU_BACKEND_WGPU
+    auto feature = static_cast<WGPUFeatureName>(WGPUNativeFeature_PipelineStatisticsQuery);
+    if (!wgpuDeviceHasFeature(device, feature) || maxPasses == 0)
+    {
+        return;
+    }
+
+    WGPUQuerySetDescriptorExtras querySetExtras = {};
+    querySetExtras.chain.next = nullptr;
+    querySetExtras.chain.sType = static_cast<WGPUSType>(WGPUSType_QuerySetDescriptorExtras);
+    querySetExtras.pipelineStatistics = statisticNames;
+    querySetExtras.pipelineStatisticCount = statisticCount;
+
+    WGPUQuerySetDescriptor querySetDesc = {};
+    querySetDesc.nextInChain = &querySetExtras.chain;
+    querySetDesc.label = "Pipeline statistics queries";
+    querySetDesc.type = static_cast<WGPUQueryType>(WGPUNativeQueryType_PipelineStatistics);
+    querySetDesc.count = maxPasses;
+    m_querySet = wgpuDeviceCreateQuerySet(device, &querySetDesc);
+
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Pipeline statistics resolve";
+    bufferDesc.usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+    bufferDesc.size = maxPasses * queryStride;
+    bufferDesc.mappedAtCreation = false;
+    m_resolveBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+    bufferDesc.label = "Pipeline statistics readback";
+    bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    m_readbackBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+PipelineStatisticsCollector::~PipelineStatisticsCollector()
+{
+    release();
+}
+
+void PipelineStatisticsCollector::release()
+{
+    if (m_readbackBuffer) wgpuBufferRelease(m_readbackBuffer);
+    if (m_resolveBuffer) wgpuBufferRelease(m_resolveBuffer);
+    if (m_querySet) wgpuQuerySetRelease(m_querySet);
+    m_readbackBuffer = nullptr;
+    m_resolveBuffer = nullptr;
+    m_querySet = nullptr;
+}
+
+void PipelineStatisticsCollector::beginFrame()
+{
+    m_passes.clear();
+    m_resolved = false;
+}
+
+int PipelineStatisticsCollector::allocateQuery(char const * label, uint64_t usefulInvocations)
+{
+    if (!enabled() || m_resolved || m_passes.size() >= m_maxPasses)
+    {
+        return -1;
+    }
+    PassStatistics pass;
+    pass.label = label ? label : "";
+    pass.usefulInvocations = usefulInvocations;
+    m_passes.push_back(pass);
+    return static_cast<int>(m_passes.size() - 1);
+}
+
+void PipelineStatisticsCollector::beginComputePass(WGPUComputePassEncoder pass, char const * label, uint64_t usefulInvocations)
+{
+    int query = allocateQuery(label, usefulInvocations);
+    if (query < 0)
+    {
+        return;
+    }
+    m_passOpen = true;
+#ifdef WEBGPU_BACKEND_WGPU
+    wgpuComputePassEncoderBeginPipelineStatisticsQuery(pass, m_querySet, static_cast<uint32_t>(query));
+#else // WEBGPU_BACKEND_WGPU
+    (void)pass;
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+void PipelineStatisticsCollector::endComputePass(WGPUComputePassEncoder pass)
+{
+    if (!m_passOpen)
+    {
+        return;
+    }
+    m_passOpen = false;
+#ifdef WEBGPU_BACKEND_WGPU
+    wgpuComputePassEncoderEndPipelineStatisticsQuery(pass);
+#else // WEBGPU_BACKEND_WGPU
+    (void)pass;
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+void PipelineStatisticsCollector::beginRenderPass(WGPURenderPassEncoder pass, char const * label, uint64_t usefulInvocations)
+{
+    int query = allocateQuery(label, usefulInvocations);
+    if (query < 0)
+    {
+        return;
+    }
+    m_passOpen = true;
+#ifdef WEBGPU_BACKEND_WGPU
+    wgpuRenderPassEncoderBeginPipelineStatisticsQuery(pass, m_querySet, static_cast<uint32_t>(query));
+#else // WEBGPU_BACKEND_WGPU
+    (void)pass;
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+void PipelineStatisticsCollector::endRenderPass(WGPURenderPassEncoder pass)
+{
+    if (!m_passOpen)
+    {
+        return;
+    }
+    m_passOpen = false;
+#ifdef WEBGPU_BACKEND_WGPU
+    wgpuRenderPassEncoderEndPipelineStatisticsQuery(pass);
+#else // WEBGPU_BACKEND_WGPU
+    (void)pass;
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+void PipelineStatisticsCollector::resolve(WGPUCommandEncoder encoder)
+{
+    if (!enabled() || m_passes.empty())
+    {
+        return;
+    }
+    uint32_t count = static_cast<uint32_t>(m_passes.size());
+    wgpuCommandEncoderResolveQuerySet(encoder, m_querySet, 0, count, m_resolveBuffer, 0);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, m_resolveBuffer, 0, m_readbackBuffer, 0, count * queryStride);
+    m_resolved = true;
+}
+
+std::vector<PipelineStatisticsCollector::PassStatistics> PipelineStatisticsCollector::collect()
+{
+    if (!m_resolved)
+    {
+        return {};
+    }
+    size_t size = m_passes.size() * queryStride;
+    if (!mapBufferSync(m_device, m_readbackBuffer, WGPUMapMode_Read, 0, size))
+    {
+        return {};
+    }
+    auto const * values = static_cast<uint64_t const *>(wgpuBufferGetConstMappedRange(m_readbackBuffer, 0, size));
+    for (size_t i = 0; i < m_passes.size(); ++i)
+    {
+        uint64_t const * query = values + i * statisticCount;
+        m_passes[i].vertexShaderInvocations = query[0];
+        m_passes[i].clipperInvocations = query[1];
+        m_passes[i].clipperPrimitivesOut = query[2];
+        m_passes[i].fragmentShaderInvocations = query[3];
+        m_passes[i].computeShaderInvocations = query[4];
+    }
+    wgpuBufferUnmap(m_readbackBuffer);
+    m_resolved = false;
+    return m_passes;
+}
+
+void PipelineStatisticsCollector::report(std::ostream & out)
+{
+    if (!enabled())
+    {
+        out << "Pipeline statistics: PipelineStatisticsQuery not supported" << std::endl;
+        return;
+    }
+    out << "Pipeline statistics:" << std::endl;
+    for (auto const & pass : collect())
+    {
+        out << "  " << pass.label << ":";
+        uint64_t invocations = 0;
+        if (pass.computeShaderInvocations > 0)
+        {
+            out << " " << pass.computeShaderInvocations << " compute invocations";
+            invocations = pass.computeShaderInvocations;
+        }
+        if (pass.vertexShaderInvocations > 0 || pass.fragmentShaderInvocations > 0)
+        {
+            out << " " << pass.vertexShaderInvocations << " vertex, "
+                << pass.clipperInvocations << " clipper in, "
+                << pass.clipperPrimitivesOut << " clipper out, "
+                << pass.fragmentShaderInvocations << " fragment invocations";
+            invocations = pass.fragmentShaderInvocations;
+        }
+        if (pass.usefulInvocations > 0 && invocations > 0)
+        {
+            // above 1 means overdraw, or threads dispatched past the data
+            out << " (" << static_cast<double>(invocations) / pass.usefulInvocations << "x the useful work)";
+        }
+        out << std::endl;
+    }
+}
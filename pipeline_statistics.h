@@ -0,0 +1,96 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Per-pass pipeline statistics (shader invocations and clipper counts),
+ * from wgpu-native's PipelineStatisticsQuery feature, to spot overdraw and
+ * compute invocations that do no useful work.
+ *
+ *     collector.beginFrame();
+ *     collector.beginComputePass(pass, "Fill", usefulInvocations);
+ *     ... dispatches ...
+ *     collector.endComputePass(pass);
+ *     collector.resolve(encoder);
+ *     wgpuQueueSubmit(...);
+ *     collector.report(std::cout);
+ *
+ * Reading the results waits for the submitted work, so the collector is
+ * meant for analysis runs rather than every frame. Without the feature (or
+ * on other backends than wgpu-native) every call is a no-op.
+ */
+class PipelineStatisticsCollector
+{
+public:
+    struct PassStatistics
+    {
+        std::string label;
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t clipperInvocations = 0;
+        uint64_t clipperPrimitivesOut = 0;
+        uint64_t fragmentShaderInvocations = 0;
+        uint64_t computeShaderInvocations = 0;
+        uint64_t usefulInvocations = 0;     // as declared when beginning the pass, 0 if unknown
+    };
+
+    PipelineStatisticsCollector(WGPUDevice device, uint32_t maxPasses = 32);
+    ~PipelineStatisticsCollector();
+
+    PipelineStatisticsCollector(PipelineStatisticsCollector const &) = delete;
+    PipelineStatisticsCollector & operator=(PipelineStatisticsCollector const &) = delete;
+
+    bool enabled() const { return m_querySet != nullptr; }
+
+    /**
+     * Forget the passes of the previous frame.
+     */
+    void beginFrame();
+
+    /**
+     * usefulInvocations is the number of invocations (vertices, fragments
+     * or compute threads) actually needed, used to report the waste.
+     */
+    void beginComputePass(WGPUComputePassEncoder pass, char const * label, uint64_t usefulInvocations = 0);
+    void endComputePass(WGPUComputePassEncoder pass);
+    void beginRenderPass(WGPURenderPassEncoder pass, char const * label, uint64_t usefulInvocations = 0);
+    void endRenderPass(WGPURenderPassEncoder pass);
+
+    /**
+     * Copy the statistics of the frame to the readback buffer, once all
+     * its passes ended.
+     */
+    void resolve(WGPUCommandEncoder encoder);
+
+    /**
+     * Wait for the statistics resolved by the last submission.
+     */
+    std::vector<PassStatistics> collect();
+
+    /**
+     * collect() and print one line per pass.
+     */
+    void report(std::ostream & out);
+
+    /**
+     * Release the GPU objects, before the device is released.
+     */
+    void release();
+
+private:
+    // index of the query of the pass, or -1 if it is not measured
+    int allocateQuery(char const * label, uint64_t usefulInvocations);
+
+    WGPUDevice m_device;
+    uint32_t m_maxPasses;
+    WGPUQuerySet m_querySet = nullptr;
+    WGPUBuffer m_resolveBuffer = nullptr;
+    WGPUBuffer m_readbackBuffer = nullptr;
+    std::vector<PassStatistics> m_passes;
+    bool m_passOpen = false;
+    bool m_resolved = false;
+};
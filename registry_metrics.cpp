@@ -0,0 +1,235 @@
+#include "registry_metrics.h"
+
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif // WEBGPU_BACKEND_WGPU
+
+namespace
+{
+
+constexpr size_t historySize = 64;
+
+#ifdef WEBGPU_BACKEND_WGPU
+void appendRegistry(std::vector<RegistryMetricsSampler::Registry> & registries, char const * name, WGPURegistryReport const & report)
+{
+    RegistryMetricsSampler::Registry registry;
+    registry.name = name;
+    registry.allocated = report.numAllocated;
+    registry.keptFromUser = report.numKeptFromUser;
+    registry.releasedFromUser = report.numReleasedFromUser;
+    registry.error = report.numError;
+    registry.elementSize = report.elementSize;
+    registries.push_back(registry);
+}
+
+void appendHub(std::vector<RegistryMetricsSampler::Registry> & registries, WGPUHubReport const & hub)
+{
+    appendRegistry(registries, "adapters", hub.adapters);
+    appendRegistry(registries, "devices", hub.devices);
+    appendRegistry(registries, "queues", hub.queues);
+    appendRegistry(registries, "pipelineLayouts", hub.pipelineLayouts);
+    appendRegistry(registries, "shaderModules", hub.shaderModules);
+    appendRegistry(registries, "bindGroupLayouts", hub.bindGroupLayouts);
+    appendRegistry(registries, "bindGroups", hub.bindGroups);
+    appendRegistry(registries, "commandBuffers", hub.commandBuffers);
+    appendRegistry(registries, "renderBundles", hub.renderBundles);
+    appendRegistry(registries, "renderPipelines", hub.renderPipelines);
+    appendRegistry(registries, "computePipelines", hub.computePipelines);
+    appendRegistry(registries, "querySets", hub.querySets);
+    appendRegistry(registries, "buffers", hub.buffers);
+    appendRegistry(registries, "textures", hub.textures);
+    appendRegistry(registries, "textureViews", hub.textureViews);
+    appendRegistry(registries, "samplers", hub.samplers);
+}
+#endif // WEBGPU_BACKEND_WGPU
+
+} // namespace
+
+RegistryMetricsSampler::RegistryMetricsSampler(WGPUInstance instance, std::chrono::milliseconds interval)
+    : m_instance(instance)
+    , m_interval(interval)
+    , m_start(std::chrono::steady_clock::now())
+    , m_history(1)
+{
+}
+
+bool RegistryMetricsSampler::supported() const
+{
+#ifdef WEBGPU_BACKEND_WGPU
+    return m_instance != nullptr;
+#else // WEBGPU_BACKEND_WGPU
+    return false;
+#endif // WEBGPU_BACKEND_WGPU
+}
+
+bool RegistryMetricsSampler::poll()
+{
+    if (!supported() || (m_sampleCount > 0 && std::chrono::steady_clock::now() - m_lastSample < m_interval))
+    {
+        return false;
+    }
+    sample();
+    return true;
+}
+
+RegistryMetricsSampler::Snapshot const & RegistryMetricsSampler::sample()
+{
+    if (!supported())
+    {
+        return m_history.back();
+    }
+
+    m_lastSample = std::chrono::steady_clock::now();
+    Snapshot snapshot;
+    snapshot.seconds = std::chrono::duration<double>(m_lastSample - m_start).count();
+#ifdef WEBGPU_BACKEND_WGPU
+    WGPUGlobalReport report = {};
+    wgpuGenerateReport(m_instance, &report);
+    appendRegistry(snapshot.registries, "surfaces", report.surfaces);
+    // only the hub of the backend in use is populated
+    switch (report.backendType)
+    {
+    case WGPUBackendType_Vulkan:
+        snapshot.backend = "vulkan";
+        appendHub(snapshot.registries, report.vulkan);
+        break;
+    case WGPUBackendType_Metal:
+        snapshot.backend = "metal";
+        appendHub(snapshot.registries, report.metal);
+        break;
+    case WGPUBackendType_D3D12:
+        snapshot.backend = "dx12";
+        appendHub(snapshot.registries, report.dx12);
+        break;
+    case WGPUBackendType_OpenGL:
+    case WGPUBackendType_OpenGLES:
+        snapshot.backend = "gl";
+        appendHub(snapshot.registries, report.gl);
+        break;
+    default:
+        snapshot.backend = "unknown";
+        break;
+    }
+#endif // WEBGPU_BACKEND_WGPU
+
+    // the first sample has no previous one and reports no delta
+    Snapshot const & previous = m_history.back();
+    for (size_t i = 0; m_sampleCount > 0 && i < snapshot.registries.size() && i < previous.registries.size(); ++i)
+    {
+        Registry & registry = snapshot.registries[i];
+        Registry const & before = previous.registries[i];
+        registry.allocatedDelta = static_cast<int64_t>(registry.allocated - before.allocated);
+        registry.keptFromUserDelta = static_cast<int64_t>(registry.keptFromUser - before.keptFromUser);
+        registry.releasedFromUserDelta = static_cast<int64_t>(registry.releasedFromUser - before.releasedFromUser);
+    }
+
+    if (m_sampleCount == 0) m_history.clear();
+    m_history.push_back(std::move(snapshot));
+    if (m_history.size() > historySize) m_history.pop_front();
+    ++m_sampleCount;
+    return m_history.back();
+}
+
+std::vector<char const *> RegistryMetricsSampler::growingRegistries(size_t samples) const
+{
+    std::vector<char const *> growing;
+    if (samples == 0 || m_sampleCount <= samples || m_history.size() <= samples)
+    {
+        return growing;
+    }
+    for (size_t r = 0; r < last().registries.size(); ++r)
+    {
+        bool grew = true;
+        for (size_t s = m_history.size() - samples; grew && s < m_history.size(); ++s)
+        {
+            grew = m_history[s].registries[r].allocated > m_history[s - 1].registries[r].allocated;
+        }
+        if (grew)
+        {
+            growing.push_back(last().registries[r].name);
+        }
+    }
+    return growing;
+}
+
+void RegistryMetricsSampler::report(std::ostream & out) const
+{
+    if (m_sampleCount == 0)
+    {
+        out << "Registry metrics: no sample" << std::endl;
+        return;
+    }
+    Snapshot const & snapshot = last();
+    out << "Registries (" << snapshot.backend << ", t=" << snapshot.seconds << " s):" << std::endl;
+    for (auto const & registry : snapshot.registries)
+    {
+        if (registry.allocated == 0 && registry.allocatedDelta == 0)
+        {
+            continue;
+        }
+        out << " - " << registry.name << ": " << registry.allocated << " allocated ("
+            << (registry.allocatedDelta >= 0 ? "+" : "") << registry.allocatedDelta << "), "
+            << registry.keptFromUser << " kept, " << registry.releasedFromUser << " released";
+        if (registry.error > 0)
+        {
+            out << ", " << registry.error << " errors";
+        }
+        out << std::endl;
+    }
+    for (char const * name : growingRegistries())
+    {
+        out << "Warning: " << name << " grew at every recent sample, possible leak" << std::endl;
+    }
+}
+
+void RegistryMetricsSampler::writePrometheus(std::ostream & out) const
+{
+    if (m_sampleCount == 0)
+    {
+        return;
+    }
+    Snapshot const & snapshot = last();
+    struct Field
+    {
+        char const * metric;
+        char const * help;
+        uint64_t Registry::*value;
+    };
+    Field const fields[] = {
+        { "wgpu_registry_allocated", "Objects allocated in the registry", &Registry::allocated },
+        { "wgpu_registry_kept_from_user", "Objects released by the user but still kept alive", &Registry::keptFromUser },
+        { "wgpu_registry_released_from_user", "Objects released by the user", &Registry::releasedFromUser },
+        { "wgpu_registry_error", "Objects in error state", &Registry::error },
+        { "wgpu_registry_element_size_bytes", "Size of one registry element", &Registry::elementSize },
+    };
+    for (auto const & field : fields)
+    {
+        out << "# HELP " << field.metric << " " << field.help << "\n";
+        out << "# TYPE " << field.metric << " gauge\n";
+        for (auto const & registry : snapshot.registries)
+        {
+            out << field.metric << "{backend=\"" << snapshot.backend << "\",registry=\"" << registry.name << "\"} "
+                << registry.*field.value << "\n";
+        }
+    }
+}
+
+void RegistryMetricsSampler::appendCsv(std::ostream & out, bool header) const
+{
+    if (header)
+    {
+        out << "seconds,backend,registry,allocated,allocated_delta,kept_from_user,released_from_user,error,element_size\n";
+    }
+    if (m_sampleCount == 0)
+    {
+        return;
+    }
+    Snapshot const & snapshot = last();
+    for (auto const & registry : snapshot.registries)
+    {
+        out << snapshot.seconds << "," << snapshot.backend << "," << registry.name << ","
+            << registry.allocated << "," << registry.allocatedDelta << ","
+            << registry.keptFromUser << "," << registry.releasedFromUser << ","
+            << registry.error << "," << registry.elementSize << "\n";
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Periodic snapshots of wgpu-native's resource registries, from
+ * wgpuGenerateReport, with deltas between samples to catch leaks and object
+ * churn in long-running processes:
+ *     RegistryMetricsSampler metrics(instance, std::chrono::seconds(1));
+ *     if (metrics.poll()) metrics.report(std::cout);  // once per frame
+ *
+ * The instance must stay alive as long as the sampler. On other backends
+ * than wgpu-native the sampler is not supported and never samples.
+ */
+class RegistryMetricsSampler
+{
+public:
+    struct Registry
+    {
+        char const * name;              // e.g. "buffers"
+        uint64_t allocated = 0;
+        uint64_t keptFromUser = 0;
+        uint64_t releasedFromUser = 0;
+        uint64_t error = 0;
+        uint64_t elementSize = 0;       // bytes per registry slot
+        int64_t allocatedDelta = 0;     // since the previous sample
+        int64_t keptFromUserDelta = 0;
+        int64_t releasedFromUserDelta = 0;
+    };
+
+    struct Snapshot
+    {
+        double seconds = 0.0;           // since the sampler was created
+        char const * backend = "";
+        std::vector<Registry> registries;
+    };
+
+    RegistryMetricsSampler(WGPUInstance instance, std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+    bool supported() const;
+
+    /**
+     * Take a snapshot if the interval elapsed since the last one.
+     * Returns true if it did.
+     */
+    bool poll();
+    Snapshot const & sample();
+
+    Snapshot const & last() const { return m_history.back(); }
+    size_t sampleCount() const { return m_sampleCount; }
+
+    /**
+     * Registries whose allocated count grew at each of the last `samples`
+     * samples, the usual sign of a leak.
+     */
+    std::vector<char const *> growingRegistries(size_t samples = 5) const;
+
+    /**
+     * Human-readable summary of the last sample, non-empty registries only.
+     */
+    void report(std::ostream & out) const;
+
+    /**
+     * Last sample in Prometheus text exposition format.
+     */
+    void writePrometheus(std::ostream & out) const;
+
+    /**
+     * One CSV row per registry of the last sample, with a header before
+     * the first row if asked, for time series over a whole run.
+     */
+    void appendCsv(std::ostream & out, bool header) const;
+
+private:
+    WGPUInstance m_instance;
+    std::chrono::milliseconds m_interval;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_lastSample;
+    std::deque<Snapshot> m_history;     // bounded, last one always present
+    size_t m_sampleCount = 0;
+};
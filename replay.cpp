@@ -0,0 +1,652 @@
+#include "capture_format.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif // WEBGPU_BACKEND_WGPU
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+
+struct Options
+{
+    std::string capturePath;
+    bool recordedPacing = false;
+    uint32_t repeat = 1;
+    bool fallbackAdapter = false;
+    std::string backend;
+};
+
+struct Statistics
+{
+    size_t records = 0;
+    size_t submits = 0;
+    size_t dispatches = 0;
+    uint64_t bytesWritten = 0;
+    double cpuMilliseconds = 0.0;       // until the last record was replayed
+    double totalMilliseconds = 0.0;     // until the GPU was done with it
+};
+
+/**
+ * Plays a capture back on one device, mapping capture ids to the objects
+ * it creates. Objects still alive at the end are released in creation order.
+ */
+class Replayer
+{
+public:
+    Replayer(WGPUAdapter adapter)
+        : m_adapter(adapter)
+    {
+    }
+
+    ~Replayer()
+    {
+        releaseObjects();
+        if (m_queue) wgpuQueueRelease(m_queue);
+        if (m_device) wgpuDeviceRelease(m_device);
+    }
+
+    bool run(CaptureReader & reader, bool recordedPacing, Statistics & statistics, std::string & error)
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool first = true;
+        uint64_t firstTime = 0;
+        while (reader.next())
+        {
+            if (first)
+            {
+                firstTime = reader.timeNs();
+                first = false;
+            }
+            if (recordedPacing)
+            {
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(reader.timeNs() - firstTime));
+            }
+            if (reader.command() != CaptureCommand::RequestDevice && !ensureDevice(nullptr))
+            {
+                error = "could not create a device";
+                return false;
+            }
+            if (!replay(reader, statistics, error))
+            {
+                return false;
+            }
+            if (!reader.ok())
+            {
+                error = "truncated record " + std::to_string(reader.recordCount());
+                return false;
+            }
+            ++statistics.records;
+        }
+        statistics.cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (m_device)
+        {
+            waitForSubmittedWork(m_device, m_queue);
+        }
+        statistics.totalMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        releaseObjects();
+        return true;
+    }
+
+private:
+    struct Object
+    {
+        CaptureCommand kind;    // the command that created it
+        void * handle;
+    };
+
+    bool ensureDevice(WGPUDeviceDescriptor const * descriptor)
+    {
+        if (m_device)
+        {
+            return true;
+        }
+        WGPUDeviceDescriptor defaultDescriptor = {};
+        defaultDescriptor.nextInChain = nullptr;
+        defaultDescriptor.label = "Replay device";
+        m_device = requestDeviceSync(m_adapter, descriptor ? descriptor : &defaultDescriptor);
+        if (m_device)
+        {
+            m_queue = wgpuDeviceGetQueue(m_device);
+        }
+        return m_device != nullptr;
+    }
+
+    template <typename Handle>
+    Handle get(uint64_t id) const
+    {
+        auto found = m_objects.find(id);
+        return found == m_objects.end() ? nullptr : static_cast<Handle>(found->second.handle);
+    }
+
+    void add(uint64_t id, CaptureCommand kind, void * handle)
+    {
+        m_objects[id] = { kind, handle };
+        m_order.push_back(id);
+    }
+
+    void release(uint64_t id)
+    {
+        auto found = m_objects.find(id);
+        if (found == m_objects.end())
+        {
+            return;
+        }
+        void * handle = found->second.handle;
+        switch (found->second.kind)
+        {
+        case CaptureCommand::CreateBuffer: wgpuBufferRelease(static_cast<WGPUBuffer>(handle)); break;
+        case CaptureCommand::CreateShaderModule: wgpuShaderModuleRelease(static_cast<WGPUShaderModule>(handle)); break;
+        case CaptureCommand::CreateBindGroupLayout:
+        case CaptureCommand::GetBindGroupLayout: wgpuBindGroupLayoutRelease(static_cast<WGPUBindGroupLayout>(handle)); break;
+        case CaptureCommand::CreatePipelineLayout: wgpuPipelineLayoutRelease(static_cast<WGPUPipelineLayout>(handle)); break;
+        case CaptureCommand::CreateComputePipeline: wgpuComputePipelineRelease(static_cast<WGPUComputePipeline>(handle)); break;
+        case CaptureCommand::CreateBindGroup: wgpuBindGroupRelease(static_cast<WGPUBindGroup>(handle)); break;
+        case CaptureCommand::CreateCommandEncoder: wgpuCommandEncoderRelease(static_cast<WGPUCommandEncoder>(handle)); break;
+        case CaptureCommand::BeginComputePass: wgpuComputePassEncoderRelease(static_cast<WGPUComputePassEncoder>(handle)); break;
+        case CaptureCommand::Finish: wgpuCommandBufferRelease(static_cast<WGPUCommandBuffer>(handle)); break;
+        default: break;
+        }
+        m_objects.erase(found);
+        m_mapped.erase(id);
+    }
+
+    void releaseObjects()
+    {
+        for (uint64_t id : m_order)
+        {
+            release(id);
+        }
+        m_order.clear();
+    }
+
+    bool replay(CaptureReader & reader, Statistics & statistics, std::string & error);
+
+    WGPUAdapter m_adapter;
+    WGPUDevice m_device = nullptr;
+    WGPUQueue m_queue = nullptr;
+    std::unordered_map<uint64_t, Object> m_objects;
+    std::vector<uint64_t> m_order;
+    std::unordered_map<uint64_t, bool> m_mapped;    // buffers currently mapped
+};
+
+bool Replayer::replay(CaptureReader & reader, Statistics & statistics, std::string & error)
+{
+    switch (reader.command())
+    {
+    case CaptureCommand::RequestDevice:
+    {
+        std::vector<WGPUFeatureName> features(reader.count(sizeof(uint32_t)));
+        for (auto & feature : features)
+        {
+            feature = static_cast<WGPUFeatureName>(reader.u32());
+        }
+        WGPURequiredLimits limits = {};
+        limits.nextInChain = nullptr;
+        bool hasLimits = reader.u32() != 0;
+        if (hasLimits)
+        {
+            std::vector<uint8_t> bytes = reader.bytes();
+            std::memcpy(&limits.limits, bytes.data(), std::min(bytes.size(), sizeof(WGPULimits)));
+        }
+        WGPUDeviceDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.label = "Replay device";
+        descriptor.requiredFeatureCount = features.size();
+        descriptor.requiredFeatures = features.data();
+        descriptor.requiredLimits = hasLimits ? &limits : nullptr;
+        // replaying again reuses the device of the first run
+        if (!ensureDevice(&descriptor))
+        {
+            error = "could not create the captured device";
+            return false;
+        }
+        break;
+    }
+    case CaptureCommand::CreateBuffer:
+    {
+        uint64_t id = reader.u64();
+        WGPUBufferDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.size = reader.u64();
+        descriptor.usage = reader.u32();
+        descriptor.mappedAtCreation = reader.u32() != 0;
+        std::string label = reader.string();
+        descriptor.label = label.empty() ? nullptr : label.c_str();
+        add(id, CaptureCommand::CreateBuffer, wgpuDeviceCreateBuffer(m_device, &descriptor));
+        if (descriptor.mappedAtCreation) m_mapped[id] = true;
+        break;
+    }
+    case CaptureCommand::WriteBuffer:
+    {
+        uint64_t id = reader.u64();
+        uint64_t offset = reader.u64();
+        bool mapped = reader.u32() != 0;
+        std::vector<uint8_t> data = reader.bytes();
+        WGPUBuffer buffer = get<WGPUBuffer>(id);
+        if (buffer == nullptr || data.empty())
+        {
+            break;
+        }
+        if (!mapped)
+        {
+            wgpuQueueWriteBuffer(m_queue, buffer, offset, data.data(), data.size());
+        }
+        else
+        {
+            // buffers mapped for writing with mapAsync are mapped on the spot
+            if (!m_mapped[id] && !mapBufferSync(m_device, buffer, WGPUMapMode_Write, 0, wgpuBufferGetSize(buffer)))
+            {
+                error = "could not map a buffer for writing";
+                return false;
+            }
+            m_mapped[id] = true;
+            void * range = wgpuBufferGetMappedRange(buffer, offset, data.size());
+            if (range) std::memcpy(range, data.data(), data.size());
+        }
+        statistics.bytesWritten += data.size();
+        break;
+    }
+    case CaptureCommand::UnmapBuffer:
+    {
+        uint64_t id = reader.u64();
+        WGPUBuffer buffer = get<WGPUBuffer>(id);
+        if (buffer && m_mapped[id])
+        {
+            wgpuBufferUnmap(buffer);
+        }
+        m_mapped.erase(id);
+        break;
+    }
+    case CaptureCommand::CreateShaderModule:
+    {
+        uint64_t id = reader.u64();
+        auto kind = static_cast<CaptureShaderKind>(reader.u32());
+        auto stage = static_cast<WGPUShaderStage>(reader.u32());
+        std::vector<uint8_t> code = reader.bytes();
+        // a name and a value per define, each at least its size prefix
+        std::vector<std::string> defineStrings(2 * reader.count(2 * sizeof(uint32_t)));
+        for (auto & text : defineStrings)
+        {
+            text = reader.string();
+        }
+        std::string label = reader.string();
+        std::string source(code.begin(), code.end());
+
+        WGPUShaderModule module = nullptr;
+        if (kind == CaptureShaderKind::WGSL)
+        {
+            module = createShaderModule(m_device, source.c_str(), label.c_str());
+        }
+        else if (kind == CaptureShaderKind::SPIRV)
+        {
+            WGPUShaderModuleSPIRVDescriptor spirvDesc = {};
+            spirvDesc.chain.next = nullptr;
+            spirvDesc.chain.sType = WGPUSType_ShaderModuleSPIRVDescriptor;
+            spirvDesc.codeSize = static_cast<uint32_t>(code.size() / sizeof(uint32_t));
+            std::vector<uint32_t> words(spirvDesc.codeSize);
+            std::memcpy(words.data(), code.data(), words.size() * sizeof(uint32_t));
+            spirvDesc.code = words.data();
+            WGPUShaderModuleDescriptor moduleDesc = {};
+            moduleDesc.nextInChain = &spirvDesc.chain;
+            moduleDesc.label = label.c_str();
+            module = wgpuDeviceCreateShaderModule(m_device, &moduleDesc);
+        }
+#ifdef WEBGPU_BACKEND_WGPU
+        else if (kind == CaptureShaderKind::GLSL)
+        {
+            std::vector<WGPUShaderDefine> defines;
+            for (size_t i = 0; i + 1 < defineStrings.size(); i += 2)
+            {
+                defines.push_back({ defineStrings[i].c_str(), defineStrings[i + 1].c_str() });
+            }
+            module = createGLSLShaderModule(m_device, stage, source.c_str(), label.c_str(), defines.size(), defines.data());
+        }
+#endif // WEBGPU_BACKEND_WGPU
+        (void)stage;
+        add(id, CaptureCommand::CreateShaderModule, module);
+        break;
+    }
+    case CaptureCommand::CreateBindGroupLayout:
+    {
+        uint64_t id = reader.u64();
+        // eleven u32 and one u64 per entry
+        std::vector<WGPUBindGroupLayoutEntry> entries(reader.count(11 * sizeof(uint32_t) + sizeof(uint64_t)));
+        for (auto & entry : entries)
+        {
+            entry = {};
+            entry.nextInChain = nullptr;
+            entry.binding = reader.u32();
+            entry.visibility = reader.u32();
+            entry.buffer.type = static_cast<WGPUBufferBindingType>(reader.u32());
+            entry.buffer.hasDynamicOffset = reader.u32();
+            entry.buffer.minBindingSize = reader.u64();
+            entry.sampler.type = static_cast<WGPUSamplerBindingType>(reader.u32());
+            entry.texture.sampleType = static_cast<WGPUTextureSampleType>(reader.u32());
+            entry.texture.viewDimension = static_cast<WGPUTextureViewDimension>(reader.u32());
+            entry.texture.multisampled = reader.u32();
+            entry.storageTexture.access = static_cast<WGPUStorageTextureAccess>(reader.u32());
+            entry.storageTexture.format = static_cast<WGPUTextureFormat>(reader.u32());
+            entry.storageTexture.viewDimension = static_cast<WGPUTextureViewDimension>(reader.u32());
+        }
+        std::string label = reader.string();
+        WGPUBindGroupLayoutDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.label = label.empty() ? nullptr : label.c_str();
+        descriptor.entryCount = entries.size();
+        descriptor.entries = entries.data();
+        add(id, CaptureCommand::CreateBindGroupLayout, wgpuDeviceCreateBindGroupLayout(m_device, &descriptor));
+        break;
+    }
+    case CaptureCommand::CreatePipelineLayout:
+    {
+        uint64_t id = reader.u64();
+        std::vector<WGPUBindGroupLayout> layouts(reader.count(sizeof(uint64_t)));
+        for (auto & layout : layouts)
+        {
+            layout = get<WGPUBindGroupLayout>(reader.u64());
+        }
+        WGPUPipelineLayoutDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.bindGroupLayoutCount = layouts.size();
+        descriptor.bindGroupLayouts = layouts.data();
+        add(id, CaptureCommand::CreatePipelineLayout, wgpuDeviceCreatePipelineLayout(m_device, &descriptor));
+        break;
+    }
+    case CaptureCommand::CreateComputePipeline:
+    {
+        uint64_t id = reader.u64();
+        WGPUPipelineLayout layout = get<WGPUPipelineLayout>(reader.u64());
+        WGPUShaderModule module = get<WGPUShaderModule>(reader.u64());
+        std::string entryPoint = reader.string();
+        std::vector<std::string> keys(reader.count(sizeof(uint32_t) + sizeof(double)));
+        std::vector<WGPUConstantEntry> constants(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i] = reader.string();
+            constants[i] = {};
+            constants[i].nextInChain = nullptr;
+            constants[i].key = keys[i].c_str();
+            constants[i].value = reader.f64();
+        }
+        std::string label = reader.string();
+        WGPUComputePipelineDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.label = label.empty() ? nullptr : label.c_str();
+        descriptor.layout = layout;
+        descriptor.compute.nextInChain = nullptr;
+        descriptor.compute.module = module;
+        descriptor.compute.entryPoint = entryPoint.c_str();
+        descriptor.compute.constantCount = constants.size();
+        descriptor.compute.constants = constants.data();
+        add(id, CaptureCommand::CreateComputePipeline, wgpuDeviceCreateComputePipeline(m_device, &descriptor));
+        break;
+    }
+    case CaptureCommand::GetBindGroupLayout:
+    {
+        uint64_t id = reader.u64();
+        WGPUComputePipeline pipeline = get<WGPUComputePipeline>(reader.u64());
+        uint32_t groupIndex = reader.u32();
+        add(id, CaptureCommand::GetBindGroupLayout, pipeline ? wgpuComputePipelineGetBindGroupLayout(pipeline, groupIndex) : nullptr);
+        break;
+    }
+    case CaptureCommand::CreateBindGroup:
+    {
+        uint64_t id = reader.u64();
+        WGPUBindGroupLayout layout = get<WGPUBindGroupLayout>(reader.u64());
+        std::vector<WGPUBindGroupEntry> entries(reader.count(sizeof(uint32_t) + 3 * sizeof(uint64_t)));
+        for (auto & entry : entries)
+        {
+            entry = {};
+            entry.nextInChain = nullptr;
+            entry.binding = reader.u32();
+            entry.buffer = get<WGPUBuffer>(reader.u64());
+            entry.offset = reader.u64();
+            entry.size = reader.u64();
+        }
+        WGPUBindGroupDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.layout = layout;
+        descriptor.entryCount = entries.size();
+        descriptor.entries = entries.data();
+        add(id, CaptureCommand::CreateBindGroup, wgpuDeviceCreateBindGroup(m_device, &descriptor));
+        break;
+    }
+    case CaptureCommand::CreateCommandEncoder:
+    {
+        uint64_t id = reader.u64();
+        WGPUCommandEncoderDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.label = "Replay encoder";
+        add(id, CaptureCommand::CreateCommandEncoder, wgpuDeviceCreateCommandEncoder(m_device, &descriptor));
+        break;
+    }
+    case CaptureCommand::BeginComputePass:
+    {
+        uint64_t id = reader.u64();
+        WGPUCommandEncoder encoder = get<WGPUCommandEncoder>(reader.u64());
+        WGPUComputePassDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.timestampWrites = nullptr;
+        add(id, CaptureCommand::BeginComputePass, encoder ? wgpuCommandEncoderBeginComputePass(encoder, &descriptor) : nullptr);
+        break;
+    }
+    case CaptureCommand::SetPipeline:
+    {
+        WGPUComputePassEncoder pass = get<WGPUComputePassEncoder>(reader.u64());
+        WGPUComputePipeline pipeline = get<WGPUComputePipeline>(reader.u64());
+        if (pass) wgpuComputePassEncoderSetPipeline(pass, pipeline);
+        break;
+    }
+    case CaptureCommand::SetBindGroup:
+    {
+        WGPUComputePassEncoder pass = get<WGPUComputePassEncoder>(reader.u64());
+        uint32_t groupIndex = reader.u32();
+        WGPUBindGroup group = get<WGPUBindGroup>(reader.u64());
+        std::vector<uint8_t> bytes = reader.bytes();
+        std::vector<uint32_t> offsets(bytes.size() / sizeof(uint32_t));
+        if (!offsets.empty()) std::memcpy(offsets.data(), bytes.data(), offsets.size() * sizeof(uint32_t));
+        if (pass) wgpuComputePassEncoderSetBindGroup(pass, groupIndex, group, offsets.size(), offsets.data());
+        break;
+    }
+    case CaptureCommand::DispatchWorkgroups:
+    {
+        WGPUComputePassEncoder pass = get<WGPUComputePassEncoder>(reader.u64());
+        uint32_t x = reader.u32();
+        uint32_t y = reader.u32();
+        uint32_t z = reader.u32();
+        if (pass) wgpuComputePassEncoderDispatchWorkgroups(pass, x, y, z);
+        ++statistics.dispatches;
+        break;
+    }
+    case CaptureCommand::DispatchWorkgroupsIndirect:
+    {
+        WGPUComputePassEncoder pass = get<WGPUComputePassEncoder>(reader.u64());
+        WGPUBuffer buffer = get<WGPUBuffer>(reader.u64());
+        uint64_t offset = reader.u64();
+        if (pass) wgpuComputePassEncoderDispatchWorkgroupsIndirect(pass, buffer, offset);
+        ++statistics.dispatches;
+        break;
+    }
+    case CaptureCommand::EndComputePass:
+    {
+        WGPUComputePassEncoder pass = get<WGPUComputePassEncoder>(reader.u64());
+        if (pass) wgpuComputePassEncoderEnd(pass);
+        break;
+    }
+    case CaptureCommand::CopyBufferToBuffer:
+    {
+        WGPUCommandEncoder encoder = get<WGPUCommandEncoder>(reader.u64());
+        WGPUBuffer source = get<WGPUBuffer>(reader.u64());
+        uint64_t sourceOffset = reader.u64();
+        WGPUBuffer destination = get<WGPUBuffer>(reader.u64());
+        uint64_t destinationOffset = reader.u64();
+        uint64_t size = reader.u64();
+        if (encoder) wgpuCommandEncoderCopyBufferToBuffer(encoder, source, sourceOffset, destination, destinationOffset, size);
+        break;
+    }
+    case CaptureCommand::ClearBuffer:
+    {
+        WGPUCommandEncoder encoder = get<WGPUCommandEncoder>(reader.u64());
+        WGPUBuffer buffer = get<WGPUBuffer>(reader.u64());
+        uint64_t offset = reader.u64();
+        uint64_t size = reader.u64();
+        if (encoder) wgpuCommandEncoderClearBuffer(encoder, buffer, offset, size);
+        break;
+    }
+    case CaptureCommand::Finish:
+    {
+        uint64_t id = reader.u64();
+        WGPUCommandEncoder encoder = get<WGPUCommandEncoder>(reader.u64());
+        WGPUCommandBufferDescriptor descriptor = {};
+        descriptor.nextInChain = nullptr;
+        descriptor.label = "Replay command buffer";
+        add(id, CaptureCommand::Finish, encoder ? wgpuCommandEncoderFinish(encoder, &descriptor) : nullptr);
+        break;
+    }
+    case CaptureCommand::Submit:
+    {
+        std::vector<WGPUCommandBuffer> commands(reader.count(sizeof(uint64_t)));
+        for (auto & command : commands)
+        {
+            command = get<WGPUCommandBuffer>(reader.u64());
+        }
+        wgpuQueueSubmit(m_queue, commands.size(), commands.data());
+        ++statistics.submits;
+        // let the device run its callbacks, as the captured process did
+        pollDevice(m_device, false);
+        break;
+    }
+    case CaptureCommand::Release:
+        release(reader.u64());
+        break;
+    default:
+        error = "unknown command " + std::to_string(static_cast<uint32_t>(reader.command()));
+        return false;
+    }
+    return true;
+}
+
+// a whole decimal number that fits a uint32_t; std::stoul would throw on
+// anything else, or take the leading digits of "10x"
+bool parseUInt32(char const * text, uint32_t & value)
+{
+    char * end = nullptr;
+    errno = 0;
+    unsigned long parsed = std::strtoul(text, &end, 10);
+    if (!std::isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' || errno == ERANGE || parsed > UINT32_MAX)
+    {
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+bool parseOptions(int argc, char * argv[], Options & options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--pacing=fast") == 0) options.recordedPacing = false;
+        else if (std::strcmp(argv[i], "--pacing=recorded") == 0) options.recordedPacing = true;
+        else if (std::strncmp(argv[i], "--repeat=", 9) == 0)
+        {
+            if (!parseUInt32(argv[i] + 9, options.repeat)) return false;
+            options.repeat = std::max(1u, options.repeat);
+        }
+        else if (std::strcmp(argv[i], "--fallback") == 0) options.fallbackAdapter = true;
+        else if (std::strncmp(argv[i], "--backend=", 10) == 0) options.backend = argv[i] + 10;
+        else if (argv[i][0] != '-' && options.capturePath.empty()) options.capturePath = argv[i];
+        else return false;
+    }
+    return !options.capturePath.empty();
+}
+
+} // namespace
+
+/**
+ * Replays a capture recorded by WebGPUCapture, to reproduce a workload
+ * offline and compare backends, adapters or library versions on it:
+ *     Replay <capture> [--pacing=fast|recorded] [--repeat=<n>] [--fallback]
+ *            [--backend=vulkan|metal|dx12|gl]
+ * Fast pacing issues the commands back to back; recorded pacing waits
+ * until each one is due at the time it was captured.
+ */
+int main(int argc, char * argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cerr << "Usage: " << argv[0] << " <capture> [--pacing=fast|recorded] [--repeat=<n>] [--fallback]"
+            << " [--backend=vulkan|metal|dx12|gl]" << std::endl;
+        return 1;
+    }
+
+    WGPUInstanceDescriptor desc = {};
+    desc.nextInChain = nullptr;
+#ifdef WEBGPU_BACKEND_WGPU
+    WGPUInstanceExtras extras = {};
+    extras.chain.next = nullptr;
+    extras.chain.sType = static_cast<WGPUSType>(WGPUSType_InstanceExtras);
+    extras.backends = WGPUInstanceBackend_All;
+    if (options.backend == "vulkan") extras.backends = WGPUInstanceBackend_Vulkan;
+    else if (options.backend == "metal") extras.backends = WGPUInstanceBackend_Metal;
+    else if (options.backend == "dx12") extras.backends = WGPUInstanceBackend_DX12;
+    else if (options.backend == "gl") extras.backends = WGPUInstanceBackend_GL;
+    desc.nextInChain = &extras.chain;
+#endif // WEBGPU_BACKEND_WGPU
+    WGPUInstance instance = wgpuCreateInstance(&desc);
+    if (instance == nullptr)
+    {
+        std::cerr << "Could not initialize WebGPU!" << std::endl;
+        return 1;
+    }
+
+    WGPURequestAdapterOptions adapterOpts = {};
+    adapterOpts.nextInChain = nullptr;
+    adapterOpts.forceFallbackAdapter = options.fallbackAdapter;
+    WGPUAdapter adapter = requestAdapterSync(instance, &adapterOpts);
+    if (adapter == nullptr)
+    {
+        wgpuInstanceRelease(instance);
+        return 1;
+    }
+
+    int result = 0;
+    {
+        Replayer replayer(adapter);
+        for (uint32_t run = 0; run < options.repeat; ++run)
+        {
+            CaptureReader reader;
+            Statistics statistics;
+            std::string error;
+            if (!reader.open(options.capturePath, error) || !replayer.run(reader, options.recordedPacing, statistics, error))
+            {
+                std::cerr << options.capturePath << ": " << error << std::endl;
+                result = 1;
+                break;
+            }
+            std::cout << "Run " << run + 1 << ": " << statistics.records << " records, "
+                << statistics.submits << " submits, " << statistics.dispatches << " dispatches, "
+                << statistics.bytesWritten / 1024 << " KiB written, "
+                << statistics.cpuMilliseconds << " ms issued, " << statistics.totalMilliseconds << " ms completed" << std::endl;
+        }
+    }
+
+    wgpuAdapterRelease(adapter);
+    wgpuInstanceRelease(instance);
+    return result;
+}
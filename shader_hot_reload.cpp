@@ -0,0 +1,250 @@
+#include "shader_hot_reload.h"
+#include "bind_group_layout_cache.h"
+#include "glsl_frontend.h"
+#include "logger.h"
+#include "shader_library.h"
+#include "shader_pack.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+ShaderHotReloader::ShaderHotReloader(WGPUDevice device, WGPUQueue queue, BindGroupLayoutCache & layoutCache)
+    : m_device(device)
+    , m_layoutCache(layoutCache)
+    , m_timer(device, queue)
+{
+}
+
+ShaderHotReloader::~ShaderHotReloader()
+{
+    if (m_pending.valid())
+    {
+        for (auto & result : m_pending.get())
+        {
+            if (result.pipeline) wgpuComputePipelineRelease(result.pipeline);
+        }
+    }
+    for (auto & slot : m_slots)
+    {
+        if (slot.pipeline) wgpuComputePipelineRelease(slot.pipeline);
+    }
+}
+
+bool ShaderHotReloader::start(std::string const & shaderRoot)
+{
+    m_root = shaderRoot;
+    return m_watcher.start(shaderRoot);
+}
+
+size_t ShaderHotReloader::addComputePipeline(
+    std::string const & shaderName,
+    std::string const & entryPoint,
+    WGPUComputePipeline pipeline,
+    DispatchRecorder recorder)
+{
+    Slot slot;
+    slot.shaderName = shaderName;
+    slot.entryPoint = entryPoint;
+    slot.pipeline = pipeline;
+    slot.recorder = std::move(recorder);
+    wgpuComputePipelineReference(pipeline);
+    m_slots.push_back(std::move(slot));
+
+    // dependencies and layout are only known once the source is processed
+    BuildRequest request;
+    if (prepareRequest(m_slots.size() - 1, request))
+    {
+        m_slots.back().dependencies = std::move(request.dependencies);
+        m_slots.back().layout = request.layout;
+    }
+    return m_slots.size() - 1;
+}
+
+bool ShaderHotReloader::beginFrame()
+{
+    for (auto const & path : m_watcher.poll())
+    {
+        for (size_t s = 0; s < m_slots.size(); ++s)
+        {
+            auto const & dependencies = m_slots[s].dependencies;
+            if (std::find(dependencies.begin(), dependencies.end(), path) != dependencies.end())
+            {
+                m_dirty.insert(s);
+            }
+        }
+    }
+
+    bool swapped = false;
+    if (m_pending.valid() && m_pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        for (auto & result : m_pending.get())
+        {
+            swapped |= apply(result);
+        }
+    }
+
+    if (!m_pending.valid() && !m_dirty.empty())
+    {
+        std::vector<BuildRequest> requests;
+        for (size_t slot : m_dirty)
+        {
+            BuildRequest request;
+            if (prepareRequest(slot, request))
+            {
+                requests.push_back(std::move(request));
+            }
+        }
+        m_dirty.clear();
+        if (!requests.empty())
+        {
+            m_pending = std::async(std::launch::async, &ShaderHotReloader::build, this, std::move(requests));
+        }
+    }
+    return swapped;
+}
+
+// Preprocessing and reflection are cheap and touch the layout cache, which
+// is not thread-safe, so they run on the calling thread.
+bool ShaderHotReloader::prepareRequest(size_t slot, BuildRequest & request)
+{
+    Slot const & current = m_slots[slot];
+    request.slot = slot;
+    request.shaderName = current.shaderName;
+    request.entryPoint = current.entryPoint;
+
+    std::string error;
+    std::vector<ShaderBindingInfo> bindings;
+    if (!shaderLanguageFromPath(current.shaderName, request.language, request.glslStage)
+        || !preprocessShaderFile(m_root + current.shaderName, request.code, error, &request.dependencies)
+        || (request.language == ShaderLanguage::GLSL && !selectGLSLStage(request.code, request.glslStage, error))
+        || !reflectShaderBindings(request.code, request.language, request.glslStage, bindings, error))
+    {
+        logError() << "Reload of " << current.shaderName << " failed: " << error;
+        return false;
+    }
+
+    std::vector<ShaderBindingLayout> layouts;
+    for (auto const & binding : bindings)
+    {
+        layouts.push_back(binding.layout);
+    }
+    request.layout = m_layoutCache.pipelineLayout(layouts);
+    return true;
+}
+
+std::vector<ShaderHotReloader::BuildResult> ShaderHotReloader::build(std::vector<BuildRequest> requests)
+{
+    struct ErrorCapture
+    {
+        WGPUErrorType type = WGPUErrorType_NoError;
+        std::string message;
+    };
+
+    // one module per shader, shared by the pipelines of every slot using it
+    std::map<std::string, WGPUShaderModule> modules;
+    std::vector<BuildResult> results;
+    for (auto const & request : requests)
+    {
+        auto start = std::chrono::steady_clock::now();
+        ErrorCapture capture;
+        wgpuDevicePushErrorScope(m_device, WGPUErrorFilter_Validation);
+
+        WGPUShaderModule & module = modules[request.shaderName];
+        if (module == nullptr)
+        {
+            ShaderPack::Shader shader;
+            shader.name = request.shaderName.c_str();
+            shader.code = request.code.c_str();
+            shader.language = request.language;
+            shader.stageMask = request.glslStage;
+            module = createShaderModule(m_device, shader);
+        }
+
+        WGPUComputePipelineDescriptor pipelineDesc = {};
+        pipelineDesc.nextInChain = nullptr;
+        pipelineDesc.label = request.shaderName.c_str();
+        pipelineDesc.layout = request.layout;
+        pipelineDesc.compute.module = module;
+        pipelineDesc.compute.entryPoint = request.entryPoint.c_str();
+        WGPUComputePipeline pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+
+        auto onError = [](WGPUErrorType type, char const * message, void * pUserData)
+        {
+            ErrorCapture & capture = *reinterpret_cast<ErrorCapture *>(pUserData);
+            capture.type = type;
+            capture.message = message ? message : "";
+        };
+        wgpuDevicePopErrorScope(m_device, onError, (void *)&capture);
+
+        BuildResult result;
+        result.slot = request.slot;
+        result.layout = request.layout;
+        result.dependencies = request.dependencies;
+        result.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (capture.type == WGPUErrorType_NoError && pipeline != nullptr)
+        {
+            result.pipeline = pipeline;
+        }
+        else
+        {
+            result.error = capture.message.empty() ? "pipeline creation failed" : capture.message;
+            if (pipeline) wgpuComputePipelineRelease(pipeline);
+        }
+        results.push_back(std::move(result));
+    }
+
+    // pipelines keep what they need from their module
+    for (auto & entry : modules)
+    {
+        if (entry.second) wgpuShaderModuleRelease(entry.second);
+    }
+    return results;
+}
+
+bool ShaderHotReloader::apply(BuildResult & result)
+{
+    Slot & slot = m_slots[result.slot];
+    if (result.pipeline == nullptr)
+    {
+        logError() << "Reload of " << slot.shaderName << " failed, keeping the previous pipeline:\n"
+            << result.error;
+        return false;
+    }
+    // the owner's bind groups were made for the old layout, they would fail
+    // validation with the new pipeline from now on
+    if (result.layout != slot.layout && slot.layout != nullptr)
+    {
+        logError() << "Bindings of " << slot.shaderName << " changed, keeping the previous pipeline;"
+            << " restart to pick up the new bindings";
+        wgpuComputePipelineRelease(result.pipeline);
+        slot.dependencies = std::move(result.dependencies);
+        return false;
+    }
+
+    {
+        LogLine line(LogLevel::Info);
+        line << "Reloaded " << slot.shaderName << ":" << slot.entryPoint
+            << " (built in " << result.buildMilliseconds << " ms)";
+        if (slot.recorder)
+        {
+            auto timeWith = [&](WGPUComputePipeline pipeline) {
+                return m_timer.timeComputePass([&](WGPUComputePassEncoder pass) { slot.recorder(pass, pipeline); });
+            };
+            double before = timeWith(slot.pipeline);
+            double after = timeWith(result.pipeline);
+            line << ", " << (m_timer.hasTimestamps() ? "GPU" : "wall") << " time " << before << " ms -> " << after << " ms";
+            if (before > 0.0)
+            {
+                line << " (" << (after - before) / before * 100.0 << "%)";
+            }
+        }
+    }
+
+    wgpuComputePipelineRelease(slot.pipeline);
+    slot.pipeline = result.pipeline;
+    slot.layout = result.layout;
+    slot.dependencies = std::move(result.dependencies);
+    return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "gpu_timer.h"
+#include "shader_reflection.h"
+#include "shader_watcher.h"
+
+#include <webgpu/webgpu.h>
+
+#include <functional>
+#include <future>
+#include <set>
+#include <string>
+#include <vector>
+
+class BindGroupLayoutCache;
+
+/**
+ * Rebuilds compute pipelines when their shader sources change on disk.
+ *
+ * Only the shaders whose source or #include dependencies changed are
+ * recompiled, on a worker thread, so that frames keep going with the old
+ * pipelines meanwhile. Finished pipelines are swapped in by beginFrame(),
+ * i.e. always between two frames, and each swap prints the GPU time of the
+ * old and new pipeline when a dispatch recorder was given. A rebuild whose
+ * bindings changed is rejected, the bind groups of the owner being made for
+ * the layout of the old pipeline.
+ *
+ * Build errors are caught with a validation error scope on the worker. As
+ * wgpu-native scopes are per device, the render thread should not rely on
+ * error scopes of its own while a rebuild is in flight, see isBuilding().
+ */
+class ShaderHotReloader
+{
+public:
+    using DispatchRecorder = std::function<void(WGPUComputePassEncoder pass, WGPUComputePipeline pipeline)>;
+
+    ShaderHotReloader(WGPUDevice device, WGPUQueue queue, BindGroupLayoutCache & layoutCache);
+    ~ShaderHotReloader();
+
+    ShaderHotReloader(ShaderHotReloader const &) = delete;
+    ShaderHotReloader & operator=(ShaderHotReloader const &) = delete;
+
+    /**
+     * Start watching the shader sources; root must end with a separator.
+     * Returns false where file watching is not supported.
+     */
+    bool start(std::string const & shaderRoot);
+
+    /**
+     * Track a compute pipeline built from a shader of the root, e.g.
+     * "fill.wgsl", once start() was called. The reloader takes its own
+     * reference on the pipeline. Returns the slot to query it with.
+     */
+    size_t addComputePipeline(
+        std::string const & shaderName,
+        std::string const & entryPoint,
+        WGPUComputePipeline pipeline,
+        DispatchRecorder recorder = nullptr);
+
+    WGPUComputePipeline pipeline(size_t slot) const { return m_slots[slot].pipeline; }
+
+    /**
+     * To be called between frames: picks up file changes, starts rebuilds
+     * and swaps the finished ones. Returns true if any pipeline changed.
+     */
+    bool beginFrame();
+
+    /**
+     * True from the beginFrame() that starts a rebuild to the one that
+     * swaps it in, while the worker may push error scopes.
+     */
+    bool isBuilding() const { return m_pending.valid(); }
+
+private:
+    struct Slot
+    {
+        std::string shaderName;
+        std::string entryPoint;
+        std::vector<std::string> dependencies;
+        WGPUComputePipeline pipeline = nullptr;
+        WGPUPipelineLayout layout = nullptr;
+        DispatchRecorder recorder;
+    };
+
+    struct BuildRequest
+    {
+        size_t slot;
+        std::string shaderName;
+        std::string code;
+        ShaderLanguage language;
+        WGPUShaderStage glslStage;
+        std::string entryPoint;
+        WGPUPipelineLayout layout;
+        std::vector<std::string> dependencies;
+    };
+
+    struct BuildResult
+    {
+        size_t slot;
+        WGPUComputePipeline pipeline = nullptr;
+        WGPUPipelineLayout layout = nullptr;
+        std::vector<std::string> dependencies;
+        std::string error;
+        double buildMilliseconds = 0.0;
+    };
+
+    bool prepareRequest(size_t slot, BuildRequest & request);
+    std::vector<BuildResult> build(std::vector<BuildRequest> requests);
+    bool apply(BuildResult & result);     // true if the pipeline was swapped
+
+    WGPUDevice m_device;
+    BindGroupLayoutCache & m_layoutCache;
+    std::string m_root;
+    ShaderWatcher m_watcher;
+    GpuTimer m_timer;
+    std::vector<Slot> m_slots;
+    std::set<size_t> m_dirty;
+    std::future<std::vector<BuildResult>> m_pending;
+};
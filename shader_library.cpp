@@ -0,0 +1,53 @@
+#include "shader_library.h"
+#include "shader_module_cache.h"
+#include "utility.h"
+
+ShaderLibrary::~ShaderLibrary()
+{
+    release();
+}
+
+bool ShaderLibrary::load(ShaderModuleCache & moduleCache, std::string const & packPath)
+{
+    release();
+    if (!m_pack.open(packPath))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m_pack.shaderCount(); ++i)
+    {
+        ShaderPack::Shader shader = m_pack.shader(i);
+        if (WGPUShaderModule module = moduleCache.module(shader))
+        {
+            m_modules[shader.name] = module;
+        }
+    }
+    return true;
+}
+
+void ShaderLibrary::release()
+{
+    m_modules.clear();
+    m_pack.close();
+}
+
+WGPUShaderModule ShaderLibrary::module(std::string const & name) const
+{
+    auto it = m_modules.find(name);
+    return it == m_modules.end() ? nullptr : it->second;
+}
+
+WGPUShaderModule createShaderModule(WGPUDevice device, ShaderPack::Shader const & shader)
+{
+    if (shader.language == ShaderLanguage::WGSL)
+    {
+        return createShaderModule(device, shader.code, shader.name);
+    }
+#ifdef WEBGPU_BACKEND_WGPU
+    // a GLSL module holds a single stage
+    return createGLSLShaderModule(device, static_cast<WGPUShaderStage>(shader.stageMask), shader.code, shader.name);
+#else // WEBGPU_BACKEND_WGPU
+    return nullptr;
+#endif // WEBGPU_BACKEND_WGPU
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "shader_pack.h"
+
+class ShaderModuleCache;
+
+#include <webgpu/webgpu.h>
+
+#include <string>
+#include <unordered_map>
+
+/**
+ * Shader modules of the App, created straight from a mapped shader pack:
+ * the pack stays mapped and no source is copied. Modules are owned by the
+ * ShaderModuleCache they were created with, shared with non-pack shaders.
+ */
+class ShaderLibrary
+{
+public:
+    ShaderLibrary() = default;
+    ~ShaderLibrary();
+
+    ShaderLibrary(ShaderLibrary const &) = delete;
+    ShaderLibrary & operator=(ShaderLibrary const &) = delete;
+
+    /**
+     * Map the pack at the given path and create one module per shader.
+     * Returns false if the pack is missing or invalid.
+     */
+    bool load(ShaderModuleCache & moduleCache, std::string const & packPath);
+    void release();
+
+    /**
+     * Module for a shader, by its path relative to the shader root
+     * (e.g. "fill.wgsl"), or nullptr.
+     */
+    WGPUShaderModule module(std::string const & name) const;
+
+    ShaderPack const & pack() const { return m_pack; }
+    size_t moduleCount() const { return m_modules.size(); }
+
+private:
+    ShaderPack m_pack;
+    std::unordered_map<std::string, WGPUShaderModule> m_modules;
+};
+
+/**
+ * Create the module of one shader of a pack, WGSL or GLSL.
+ */
+WGPUShaderModule createShaderModule(WGPUDevice device, ShaderPack::Shader const & shader);
@@ -0,0 +1,130 @@
+#include "shader_module_cache.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// FNV-1a continued over the key fields, starting from the source hash
+uint64_t combineHash(uint64_t hash, void const * data, size_t size)
+{
+    auto const * bytes = static_cast<unsigned char const *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool sameDefines(ShaderDefines const & a, ShaderDefines const & b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](ShaderDefine const & x, ShaderDefine const & y) {
+        return x.name == y.name && x.value == y.value;
+    });
+}
+
+} // namespace
+
+ShaderModuleCache::ShaderModuleCache(WGPUDevice device)
+    : m_device(device)
+{
+}
+
+ShaderModuleCache::~ShaderModuleCache()
+{
+    release();
+}
+
+WGPUShaderModule ShaderModuleCache::wgslModule(char const * code, char const * label)
+{
+    return findOrCreate(ShaderLanguage::WGSL, WGPUShaderStage_None, code, hashShaderSource(code, std::strlen(code)), {}, label);
+}
+
+WGPUShaderModule ShaderModuleCache::glslModule(
+    WGPUShaderStage stage,
+    char const * code,
+    ShaderDefines const & defines,
+    char const * label)
+{
+    return findOrCreate(ShaderLanguage::GLSL, stage, code, hashShaderSource(code, std::strlen(code)), defines, label);
+}
+
+WGPUShaderModule ShaderModuleCache::module(ShaderPack::Shader const & shader, ShaderDefines const & defines)
+{
+    if (shader.language == ShaderLanguage::WGSL)
+    {
+        return findOrCreate(ShaderLanguage::WGSL, WGPUShaderStage_None, shader.code, shader.sourceHash, {}, shader.name);
+    }
+    // a GLSL module holds a single stage
+    auto stage = static_cast<WGPUShaderStage>(shader.stageMask);
+    return findOrCreate(ShaderLanguage::GLSL, stage, shader.code, shader.sourceHash, defines, shader.name);
+}
+
+void ShaderModuleCache::release()
+{
+    for (auto & entry : m_modules)
+    {
+        wgpuShaderModuleRelease(entry.second.module);
+    }
+    m_modules.clear();
+}
+
+WGPUShaderModule ShaderModuleCache::findOrCreate(
+    ShaderLanguage language,
+    WGPUShaderStage stage,
+    char const * code,
+    uint64_t sourceHash,
+    ShaderDefines const & defines,
+    char const * label)
+{
+    uint64_t key = combineHash(sourceHash, &language, sizeof(language));
+    key = combineHash(key, &stage, sizeof(stage));
+    for (auto const & define : defines)
+    {
+        // the terminating NULs keep "AB"="" and "A"="B" apart
+        key = combineHash(key, define.name.c_str(), define.name.size() + 1);
+        key = combineHash(key, define.value.c_str(), define.value.size() + 1);
+    }
+
+    auto range = m_modules.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        Entry const & entry = it->second;
+        if (entry.language == language && entry.stage == stage && entry.code == code && sameDefines(entry.defines, defines))
+        {
+            ++m_hits;
+            return entry.module;
+        }
+    }
+
+    WGPUShaderModule module = nullptr;
+    if (language == ShaderLanguage::WGSL)
+    {
+        module = createShaderModule(m_device, code, label);
+    }
+    else
+    {
+#ifdef WEBGPU_BACKEND_WGPU
+        std::string name = permutationName(label ? label : "", defines);
+        std::vector<WGPUShaderDefine> glslDefines;
+        for (auto const & define : defines)
+        {
+            glslDefines.push_back({ define.name.c_str(), define.value.c_str() });
+        }
+        module = createGLSLShaderModule(m_device, stage, code, name.c_str(), glslDefines.size(), glslDefines.data());
+#endif // WEBGPU_BACKEND_WGPU
+    }
+
+    if (module == nullptr)
+    {
+        logError() << "Could not create shader module " << (label ? label : "");
+        ++m_failures;
+        return nullptr;
+    }
+    m_modules.emplace(key, Entry{ language, stage, code, defines, module });
+    return module;
+}
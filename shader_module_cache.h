@@ -0,0 +1,77 @@
+#pragma once
+
+#include "glsl_frontend.h"
+#include "shader_pack.h"
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Shader modules of a device, WGSL and GLSL alike, keyed by language,
+ * stage, source hash and defines. Asking twice for the same source returns
+ * the same module, so GLSL permutations and ported WGSL kernels can be
+ * requested freely by the code that builds pipelines. Entries keep their
+ * source and defines, and a hit compares them, so that two sources whose
+ * hashes collide never share a module.
+ *
+ * The cache owns its modules; it is not thread-safe.
+ */
+class ShaderModuleCache
+{
+public:
+    explicit ShaderModuleCache(WGPUDevice device);
+    ~ShaderModuleCache();
+
+    ShaderModuleCache(ShaderModuleCache const &) = delete;
+    ShaderModuleCache & operator=(ShaderModuleCache const &) = delete;
+
+    WGPUShaderModule wgslModule(char const * code, char const * label = nullptr);
+
+    /**
+     * GLSL module of one stage and one define permutation. Only supported
+     * by wgpu-native, returns nullptr on other backends.
+     */
+    WGPUShaderModule glslModule(
+        WGPUShaderStage stage,
+        char const * code,
+        ShaderDefines const & defines = {},
+        char const * label = nullptr);
+
+    /**
+     * Module of a pack shader, reusing the source hash stored in the pack.
+     * Defines only apply to GLSL shaders.
+     */
+    WGPUShaderModule module(ShaderPack::Shader const & shader, ShaderDefines const & defines = {});
+
+    void release();
+
+    size_t moduleCount() const { return m_modules.size(); }
+    size_t hitCount() const { return m_hits; }
+    size_t missCount() const { return m_modules.size() + m_failures; }
+
+private:
+    struct Entry
+    {
+        ShaderLanguage language;
+        WGPUShaderStage stage;
+        std::string code;
+        ShaderDefines defines;
+        WGPUShaderModule module;
+    };
+
+    WGPUShaderModule findOrCreate(
+        ShaderLanguage language,
+        WGPUShaderStage stage,
+        char const * code,
+        uint64_t sourceHash,
+        ShaderDefines const & defines,
+        char const * label);
+
+    WGPUDevice m_device;
+    std::unordered_multimap<uint64_t, Entry> m_modules;
+    size_t m_hits = 0;
+    size_t m_failures = 0;
+};
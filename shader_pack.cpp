@@ -0,0 +1,444 @@
+#include "shader_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else // _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace
+{
+
+std::string directoryOf(std::string const & path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+bool readFile(std::string const & path, std::string & content)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    content = stream.str();
+    return true;
+}
+
+bool preprocessRecursive(
+    std::string const & path,
+    std::vector<std::string> & visited,
+    int depth,
+    std::string & output,
+    std::string & error)
+{
+    if (depth > 32)
+    {
+        error = path + ": #include nested too deeply";
+        return false;
+    }
+    if (std::find(visited.begin(), visited.end(), path) != visited.end())
+    {
+        // already spliced in, behaves like #pragma once
+        return true;
+    }
+    visited.push_back(path);
+
+    std::string source;
+    if (!readFile(path, source))
+    {
+        error = "could not read " + path;
+        return false;
+    }
+
+    std::istringstream lines(source);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line))
+    {
+        ++lineNumber;
+        size_t first = line.find_first_not_of(" \t");
+        if (first != std::string::npos && line.compare(first, 8, "#include") == 0)
+        {
+            size_t open = line.find('"', first + 8);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos)
+            {
+                error = path + ":" + std::to_string(lineNumber) + ": malformed #include";
+                return false;
+            }
+            std::string included = directoryOf(path) + line.substr(open + 1, close - open - 1);
+            if (!preprocessRecursive(included, visited, depth + 1, output, error))
+            {
+                return false;
+            }
+            continue;
+        }
+        output += line;
+        output += '\n';
+    }
+    return true;
+}
+
+template <typename T>
+void appendPod(std::vector<uint8_t> & out, T const & value)
+{
+    uint8_t const * bytes = reinterpret_cast<uint8_t const *>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void alignTo8(std::vector<uint8_t> & out)
+{
+    out.resize((out.size() + 7) & ~size_t(7), 0);
+}
+
+} // namespace
+
+uint64_t hashShaderSource(char const * data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool shaderLanguageFromPath(
+    std::string const & path,
+    ShaderLanguage & language,
+    WGPUShaderStage & glslStage)
+{
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    glslStage = WGPUShaderStage_None;
+    if (extension == "wgsl")
+    {
+        language = ShaderLanguage::WGSL;
+        return true;
+    }
+    language = ShaderLanguage::GLSL;
+    if (extension == "comp") glslStage = WGPUShaderStage_Compute;
+    else if (extension == "vert") glslStage = WGPUShaderStage_Vertex;
+    else if (extension == "frag") glslStage = WGPUShaderStage_Fragment;
+    return glslStage != WGPUShaderStage_None || extension == "glsl";
+}
+
+bool preprocessShaderFile(
+    std::string const & path,
+    std::string & output,
+    std::string & error,
+    std::vector<std::string> * dependencies)
+{
+    std::vector<std::string> visited;
+    output.clear();
+    bool success = preprocessRecursive(path, visited, 0, output, error);
+    if (dependencies)
+    {
+        *dependencies = std::move(visited);
+    }
+    return success;
+}
+
+ShaderPack::~ShaderPack()
+{
+    close();
+}
+
+bool ShaderPack::open(std::string const & path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<uint8_t const *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = static_cast<size_t>(size.QuadPart);
+#else // _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void * data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid once the descriptor is closed
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    m_data = static_cast<uint8_t const *>(data);
+    m_size = static_cast<size_t>(info.st_size);
+#endif // _WIN32
+
+    if (m_data == nullptr || !validate())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ShaderPack::close()
+{
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file) CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else // _WIN32
+    if (m_data) munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif // _WIN32
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool ShaderPack::validate()
+{
+    if (m_size < sizeof(ShaderPackHeader))
+    {
+        return false;
+    }
+    auto const & header = *reinterpret_cast<ShaderPackHeader const *>(m_data);
+    if (std::memcmp(header.magic, ShaderPackMagic, sizeof(ShaderPackMagic)) != 0
+        || header.version != ShaderPackVersion
+        || header.fileSize != m_size)
+    {
+        return false;
+    }
+    if (header.entriesOffset + uint64_t(header.entryCount) * sizeof(ShaderPackEntry) > m_size
+        || header.entryPointsOffset + uint64_t(header.entryPointCount) * sizeof(ShaderPackEntryPoint) > m_size
+        || header.bindingsOffset + uint64_t(header.bindingCount) * sizeof(ShaderPackBinding) > m_size
+        || header.stringsOffset > m_size)
+    {
+        return false;
+    }
+
+    // Check every string once here so that accessors can stay unchecked.
+    uint64_t stringsSize = m_size - header.stringsOffset;
+    auto stringFits = [&](uint32_t offset, uint32_t length) {
+        return uint64_t(offset) + length < stringsSize && string(offset)[length] == '\0';
+    };
+    auto const * entries = reinterpret_cast<ShaderPackEntry const *>(m_data + header.entriesOffset);
+    auto const * entryPoints = reinterpret_cast<ShaderPackEntryPoint const *>(m_data + header.entryPointsOffset);
+    auto const * bindings = reinterpret_cast<ShaderPackBinding const *>(m_data + header.bindingsOffset);
+    for (uint32_t i = 0; i < header.entryCount; ++i)
+    {
+        ShaderPackEntry const & entry = entries[i];
+        if (!stringFits(entry.nameOffset, entry.nameLength)
+            || !stringFits(entry.codeOffset, entry.codeLength)
+            || uint64_t(entry.firstEntryPoint) + entry.entryPointCount > header.entryPointCount
+            || uint64_t(entry.firstBinding) + entry.bindingCount > header.bindingCount)
+        {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.entryPointCount; ++i)
+    {
+        if (!stringFits(entryPoints[i].nameOffset, entryPoints[i].nameLength))
+        {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.bindingCount; ++i)
+    {
+        if (!stringFits(bindings[i].nameOffset, bindings[i].nameLength))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t ShaderPack::shaderCount() const
+{
+    return m_data ? reinterpret_cast<ShaderPackHeader const *>(m_data)->entryCount : 0;
+}
+
+ShaderPack::Shader ShaderPack::shader(uint32_t index) const
+{
+    auto const & header = *reinterpret_cast<ShaderPackHeader const *>(m_data);
+    auto const & entry = reinterpret_cast<ShaderPackEntry const *>(m_data + header.entriesOffset)[index];
+    Shader shader;
+    shader.name = string(entry.nameOffset);
+    shader.code = string(entry.codeOffset);
+    shader.codeLength = entry.codeLength;
+    shader.sourceHash = entry.sourceHash;
+    shader.language = static_cast<ShaderLanguage>(entry.language);
+    shader.stageMask = entry.stageMask;
+    shader.entryPoints = reinterpret_cast<ShaderPackEntryPoint const *>(m_data + header.entryPointsOffset) + entry.firstEntryPoint;
+    shader.entryPointCount = entry.entryPointCount;
+    shader.bindings = reinterpret_cast<ShaderPackBinding const *>(m_data + header.bindingsOffset) + entry.firstBinding;
+    shader.bindingCount = entry.bindingCount;
+    return shader;
+}
+
+std::vector<ShaderBindingLayout> ShaderPack::Shader::bindingLayouts() const
+{
+    std::vector<ShaderBindingLayout> layouts;
+    for (uint32_t i = 0; i < bindingCount; ++i)
+    {
+        layouts.push_back(bindings[i].layout);
+    }
+    return layouts;
+}
+
+bool ShaderPack::find(char const * name, Shader & shader) const
+{
+    if (!m_data)
+    {
+        return false;
+    }
+    auto const & header = *reinterpret_cast<ShaderPackHeader const *>(m_data);
+    auto const * entries = reinterpret_cast<ShaderPackEntry const *>(m_data + header.entriesOffset);
+    uint64_t hash = hashShaderSource(name, std::strlen(name));
+    auto const * end = entries + header.entryCount;
+    auto const * it = std::lower_bound(entries, end, hash, [](ShaderPackEntry const & entry, uint64_t h) { return entry.nameHash < h; });
+    for (; it != end && it->nameHash == hash; ++it)
+    {
+        if (std::strcmp(string(it->nameOffset), name) == 0)
+        {
+            shader = this->shader(static_cast<uint32_t>(it - entries));
+            return true;
+        }
+    }
+    return false;
+}
+
+char const * ShaderPack::string(uint32_t offset) const
+{
+    auto const & header = *reinterpret_cast<ShaderPackHeader const *>(m_data);
+    return reinterpret_cast<char const *>(m_data + header.stringsOffset + offset);
+}
+
+void ShaderPackWriter::add(
+    std::string const & name,
+    ShaderLanguage language,
+    std::string const & code,
+    std::vector<ShaderEntryPointInfo> const & entryPoints,
+    std::vector<ShaderBindingInfo> const & bindings)
+{
+    m_shaders.push_back({ name, language, code, entryPoints, bindings });
+}
+
+bool ShaderPackWriter::write(std::string const & path, std::string & error) const
+{
+    std::vector<Pending const *> sorted;
+    for (auto const & shader : m_shaders) sorted.push_back(&shader);
+    std::sort(sorted.begin(), sorted.end(), [](Pending const * a, Pending const * b) {
+        return hashShaderSource(a->name.data(), a->name.size()) < hashShaderSource(b->name.data(), b->name.size());
+    });
+
+    std::string strings;
+    auto addString = [&strings](std::string const & s) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings += s;
+        strings += '\0';
+        return offset;
+    };
+
+    std::vector<ShaderPackEntry> entries;
+    std::vector<ShaderPackEntryPoint> entryPoints;
+    std::vector<ShaderPackBinding> bindings;
+    for (Pending const * shader : sorted)
+    {
+        ShaderPackEntry entry = {};
+        entry.nameHash = hashShaderSource(shader->name.data(), shader->name.size());
+        entry.sourceHash = hashShaderSource(shader->code.data(), shader->code.size());
+        entry.nameOffset = addString(shader->name);
+        entry.nameLength = static_cast<uint32_t>(shader->name.size());
+        entry.codeOffset = addString(shader->code);
+        entry.codeLength = static_cast<uint32_t>(shader->code.size());
+        entry.language = static_cast<uint32_t>(shader->language);
+        entry.firstEntryPoint = static_cast<uint32_t>(entryPoints.size());
+        entry.entryPointCount = static_cast<uint32_t>(shader->entryPoints.size());
+        for (auto const & info : shader->entryPoints)
+        {
+            ShaderPackEntryPoint entryPoint = {};
+            entryPoint.nameOffset = addString(info.name);
+            entryPoint.nameLength = static_cast<uint32_t>(info.name.size());
+            entryPoint.stage = info.stage;
+            std::copy(info.workgroupSize, info.workgroupSize + 3, entryPoint.workgroupSize);
+            entryPoints.push_back(entryPoint);
+            entry.stageMask |= info.stage;
+        }
+        entry.firstBinding = static_cast<uint32_t>(bindings.size());
+        entry.bindingCount = static_cast<uint32_t>(shader->bindings.size());
+        for (auto const & info : shader->bindings)
+        {
+            ShaderPackBinding binding = {};
+            binding.layout = info.layout;
+            binding.nameOffset = addString(info.name);
+            binding.nameLength = static_cast<uint32_t>(info.name.size());
+            bindings.push_back(binding);
+        }
+        entries.push_back(entry);
+    }
+
+    std::vector<uint8_t> out;
+    ShaderPackHeader header = {};
+    std::memcpy(header.magic, ShaderPackMagic, sizeof(ShaderPackMagic));
+    header.version = ShaderPackVersion;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.entryPointCount = static_cast<uint32_t>(entryPoints.size());
+    header.bindingCount = static_cast<uint32_t>(bindings.size());
+    appendPod(out, header);
+    alignTo8(out);
+    header.entriesOffset = out.size();
+    for (auto const & entry : entries) appendPod(out, entry);
+    alignTo8(out);
+    header.entryPointsOffset = out.size();
+    for (auto const & entryPoint : entryPoints) appendPod(out, entryPoint);
+    alignTo8(out);
+    header.bindingsOffset = out.size();
+    for (auto const & binding : bindings) appendPod(out, binding);
+    alignTo8(out);
+    header.stringsOffset = out.size();
+    out.insert(out.end(), strings.begin(), strings.end());
+    header.fileSize = out.size();
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<char const *>(out.data()), out.size()))
+    {
+        error = "could not write " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "shader_reflection.h"
+
+#include <webgpu/webgpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Binary shader pack, produced at build time by ShaderPackTool from the
+ * sources in shaders/ and loaded by the App at runtime.
+ *
+ * Layout (little-endian, every section 8-byte aligned):
+ *     ShaderPackHeader
+ *     ShaderPackEntry[entryCount]            sorted by nameHash
+ *     ShaderPackEntryPoint[entryPointCount]
+ *     ShaderPackBinding[bindingCount]
+ *     string blob                            names and NUL-terminated code
+ *
+ * Sources are stored already preprocessed (#include resolved) and followed
+ * by a NUL byte, so a mapped pack can hand its code pointers straight to
+ * wgpuDeviceCreateShaderModule without any copy.
+ */
+
+constexpr char ShaderPackMagic[8] = { 'W', 'G', 'S', 'P', 'A', 'C', 'K', '\0' };
+constexpr uint32_t ShaderPackVersion = 2;
+
+struct ShaderPackHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t entryPointCount;
+    uint32_t bindingCount;
+    uint64_t entriesOffset;
+    uint64_t entryPointsOffset;
+    uint64_t bindingsOffset;
+    uint64_t stringsOffset;
+    uint64_t fileSize;
+};
+
+struct ShaderPackEntry
+{
+    uint64_t nameHash;
+    uint64_t sourceHash;
+    uint32_t nameOffset;        // relative to stringsOffset
+    uint32_t nameLength;
+    uint32_t codeOffset;        // relative to stringsOffset
+    uint32_t codeLength;        // excluding the trailing NUL
+    uint32_t language;          // ShaderLanguage
+    uint32_t stageMask;         // WGPUShaderStageFlags of all entry points
+    uint32_t firstEntryPoint;
+    uint32_t entryPointCount;
+    uint32_t firstBinding;
+    uint32_t bindingCount;
+};
+
+struct ShaderPackEntryPoint
+{
+    uint32_t nameOffset;        // relative to stringsOffset
+    uint32_t nameLength;
+    uint32_t stage;             // WGPUShaderStage
+    uint32_t workgroupSize[3];  // 0 when not a literal (e.g. an override)
+};
+
+struct ShaderPackBinding
+{
+    ShaderBindingLayout layout;
+    uint32_t nameOffset;        // relative to stringsOffset
+    uint32_t nameLength;
+};
+
+/**
+ * 64-bit FNV-1a, used both for pack lookups and source hashes.
+ */
+uint64_t hashShaderSource(char const * data, size_t size);
+
+/**
+ * Guess the language and, for GLSL, the stage from the file extension:
+ * .wgsl is WGSL, .comp/.vert/.frag are GLSL. Generic .glsl files are GLSL
+ * with no stage, see selectGLSLStage() to read it from the source.
+ * Returns false for unknown extensions.
+ */
+bool shaderLanguageFromPath(
+    std::string const & path,
+    ShaderLanguage & language,
+    WGPUShaderStage & glslStage);
+
+/**
+ * Read a shader file and recursively splice its `#include "file"` lines,
+ * relative to the including file. Each file is included at most once.
+ * If requested, dependencies receives every file read, the shader first.
+ */
+bool preprocessShaderFile(
+    std::string const & path,
+    std::string & output,
+    std::string & error,
+    std::vector<std::string> * dependencies = nullptr);
+
+/**
+ * Read-only view over a memory-mapped shader pack.
+ */
+class ShaderPack
+{
+public:
+    struct Shader
+    {
+        char const * name = nullptr;
+        char const * code = nullptr;   // NUL-terminated, points into the mapping
+        size_t codeLength = 0;
+        uint64_t sourceHash = 0;
+        ShaderLanguage language = ShaderLanguage::WGSL;
+        WGPUShaderStageFlags stageMask = WGPUShaderStage_None;
+        ShaderPackEntryPoint const * entryPoints = nullptr;
+        uint32_t entryPointCount = 0;
+        ShaderPackBinding const * bindings = nullptr;   // sorted by group, binding
+        uint32_t bindingCount = 0;
+
+        std::vector<ShaderBindingLayout> bindingLayouts() const;
+    };
+
+    ShaderPack() = default;
+    ~ShaderPack();
+
+    ShaderPack(ShaderPack const &) = delete;
+    ShaderPack & operator=(ShaderPack const &) = delete;
+
+    bool open(std::string const & path);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    uint32_t shaderCount() const;
+    Shader shader(uint32_t index) const;
+
+    /**
+     * Binary search on the name hash; returns false if absent.
+     */
+    bool find(char const * name, Shader & shader) const;
+
+    char const * string(uint32_t offset) const;
+
+private:
+    bool validate();
+
+    uint8_t const * m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void * m_file = nullptr;
+    void * m_mapping = nullptr;
+#endif // _WIN32
+};
+
+/**
+ * Accumulates shaders and serializes them into the pack layout above.
+ */
+class ShaderPackWriter
+{
+public:
+    void add(
+        std::string const & name,
+        ShaderLanguage language,
+        std::string const & code,
+        std::vector<ShaderEntryPointInfo> const & entryPoints,
+        std::vector<ShaderBindingInfo> const & bindings);
+
+    bool write(std::string const & path, std::string & error) const;
+
+private:
+    struct Pending
+    {
+        std::string name;
+        ShaderLanguage language;
+        std::string code;
+        std::vector<ShaderEntryPointInfo> entryPoints;
+        std::vector<ShaderBindingInfo> bindings;
+    };
+    std::vector<Pending> m_shaders;
+};
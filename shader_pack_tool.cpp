@@ -0,0 +1,75 @@
+#include "glsl_frontend.h"
+#include "shader_pack.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Build step turning the loose shader sources into a single shader pack:
+ *     ShaderPackTool <output.pack> <shader root> <relative path>...
+ * Each shader is stored under its path relative to the shader root.
+ */
+int main(int argc, char * argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <output.pack> <shader root> <shader>..." << std::endl;
+        return 1;
+    }
+
+    std::string output = argv[1];
+    std::string root = argv[2];
+    if (!root.empty() && root.back() != '/' && root.back() != '\\')
+    {
+        root += '/';
+    }
+
+    ShaderPackWriter writer;
+    bool failed = false;
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string name = argv[i];
+        std::string path = root + name;
+
+        ShaderLanguage language;
+        WGPUShaderStage glslStage;
+        if (!shaderLanguageFromPath(name, language, glslStage))
+        {
+            std::cerr << path << ": unknown shader extension" << std::endl;
+            failed = true;
+            continue;
+        }
+
+        std::string code;
+        std::string error;
+        std::vector<ShaderEntryPointInfo> entryPoints;
+        std::vector<ShaderBindingInfo> bindings;
+        if (!preprocessShaderFile(path, code, error)
+            || (language == ShaderLanguage::GLSL && !selectGLSLStage(code, glslStage, error))
+            || !reflectShaderEntryPoints(code, language, glslStage, entryPoints, error)
+            || !reflectShaderBindings(code, language, glslStage, bindings, error))
+        {
+            std::cerr << path << ": " << error << std::endl;
+            failed = true;
+            continue;
+        }
+
+        writer.add(name, language, code, entryPoints, bindings);
+        std::cout << "Packed " << name << " (" << code.size() << " bytes, "
+            << entryPoints.size() << " entry points, " << bindings.size() << " bindings)" << std::endl;
+    }
+
+    if (failed)
+    {
+        return 1;
+    }
+
+    std::string error;
+    if (!writer.write(output, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,689 @@
+#include "shader_reflection.h"
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <sstream>
+
+namespace
+{
+
+// Replace comments by spaces so that offsets and line numbers are kept.
+std::string stripComments(std::string const & source)
+{
+    std::string out = source;
+    size_t i = 0;
+    while (i < out.size())
+    {
+        if (out.compare(i, 2, "//") == 0)
+        {
+            while (i < out.size() && out[i] != '\n') out[i++] = ' ';
+        }
+        else if (out.compare(i, 2, "/*") == 0)
+        {
+            // WGSL block comments nest
+            int nesting = 0;
+            do
+            {
+                if (out.compare(i, 2, "/*") == 0) { ++nesting; out[i] = out[i + 1] = ' '; i += 2; }
+                else if (out.compare(i, 2, "*/") == 0) { --nesting; out[i] = out[i + 1] = ' '; i += 2; }
+                else { if (out[i] != '\n') out[i] = ' '; ++i; }
+            } while (nesting > 0 && i < out.size());
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return out;
+}
+
+bool checkBrackets(std::string const & source, std::string & error)
+{
+    std::vector<std::pair<char, int>> stack;
+    int line = 1;
+    bool lineStart = true;
+    bool directive = false;
+    for (char c : source)
+    {
+        if (c == '\n') { ++line; lineStart = true; directive = false; continue; }
+        if (lineStart && c == '#') directive = true;
+        if (!std::isspace(static_cast<unsigned char>(c))) lineStart = false;
+        if (directive) continue;
+
+        if (c == '(' || c == '[' || c == '{')
+        {
+            stack.emplace_back(c, line);
+        }
+        else if (c == ')' || c == ']' || c == '}')
+        {
+            char expected = c == ')' ? '(' : c == ']' ? '[' : '{';
+            if (stack.empty() || stack.back().first != expected)
+            {
+                error = "line " + std::to_string(line) + ": unbalanced '" + c + "'";
+                return false;
+            }
+            stack.pop_back();
+        }
+    }
+    if (!stack.empty())
+    {
+        error = "line " + std::to_string(stack.back().second) + ": unclosed '" + stack.back().first + "'";
+        return false;
+    }
+    return true;
+}
+
+bool isIdentifierChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+void skipSpaces(std::string const & source, size_t & i)
+{
+    while (i < source.size() && std::isspace(static_cast<unsigned char>(source[i]))) ++i;
+}
+
+std::string readIdentifier(std::string const & source, size_t & i)
+{
+    skipSpaces(source, i);
+    size_t start = i;
+    while (i < source.size() && isIdentifierChar(source[i])) ++i;
+    return source.substr(start, i - start);
+}
+
+// Returns the text between the brackets opening at (or after) i.
+std::string readEnclosed(std::string const & source, size_t & i, char open, char close)
+{
+    skipSpaces(source, i);
+    if (i >= source.size() || source[i] != open) return {};
+    size_t start = ++i;
+    int depth = 1;
+    while (i < source.size() && depth > 0)
+    {
+        if (source[i] == open) ++depth;
+        else if (source[i] == close) --depth;
+        ++i;
+    }
+    return source.substr(start, i - start - 1);
+}
+
+std::string trim(std::string const & text)
+{
+    size_t first = text.find_first_not_of(" \t\r\n");
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return first == std::string::npos ? std::string() : text.substr(first, last - first + 1);
+}
+
+std::vector<std::string> splitArguments(std::string const & text)
+{
+    std::vector<std::string> arguments;
+    std::istringstream stream(text);
+    std::string argument;
+    while (std::getline(stream, argument, ','))
+    {
+        arguments.push_back(trim(argument));
+    }
+    return arguments;
+}
+
+uint32_t parseLiteral(std::string text)
+{
+    text = trim(text);
+    while (!text.empty() && (text.back() == 'u' || text.back() == 'i')) text.pop_back();
+    if (text.empty() || !std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+    {
+        // override expression or constant, only known at pipeline creation
+        return 0;
+    }
+    return static_cast<uint32_t>(std::stoul(text));
+}
+
+std::set<std::string> identifiersIn(std::string const & source, size_t begin, size_t end)
+{
+    std::set<std::string> identifiers;
+    size_t i = begin;
+    while (i < end)
+    {
+        if (isIdentifierChar(source[i]) && !std::isdigit(static_cast<unsigned char>(source[i])))
+        {
+            size_t start = i;
+            while (i < end && isIdentifierChar(source[i])) ++i;
+            identifiers.insert(source.substr(start, i - start));
+        }
+        else
+        {
+            // skip numbers like 1u or 0x10 as a whole
+            while (i < end && isIdentifierChar(source[i])) ++i;
+            ++i;
+        }
+    }
+    return identifiers;
+}
+
+WGPUTextureFormat storageFormatFromName(std::string const & name)
+{
+    static struct { char const * wgsl; char const * glsl; WGPUTextureFormat format; } const formats[] = {
+        { "rgba8unorm", "rgba8", WGPUTextureFormat_RGBA8Unorm },
+        { "rgba8snorm", "rgba8_snorm", WGPUTextureFormat_RGBA8Snorm },
+        { "rgba8uint", "rgba8ui", WGPUTextureFormat_RGBA8Uint },
+        { "rgba8sint", "rgba8i", WGPUTextureFormat_RGBA8Sint },
+        { "bgra8unorm", "", WGPUTextureFormat_BGRA8Unorm },
+        { "rgba16uint", "rgba16ui", WGPUTextureFormat_RGBA16Uint },
+        { "rgba16sint", "rgba16i", WGPUTextureFormat_RGBA16Sint },
+        { "rgba16float", "rgba16f", WGPUTextureFormat_RGBA16Float },
+        { "r32uint", "r32ui", WGPUTextureFormat_R32Uint },
+        { "r32sint", "r32i", WGPUTextureFormat_R32Sint },
+        { "r32float", "r32f", WGPUTextureFormat_R32Float },
+        { "rg32uint", "rg32ui", WGPUTextureFormat_RG32Uint },
+        { "rg32sint", "rg32i", WGPUTextureFormat_RG32Sint },
+        { "rg32float", "rg32f", WGPUTextureFormat_RG32Float },
+        { "rgba32uint", "rgba32ui", WGPUTextureFormat_RGBA32Uint },
+        { "rgba32sint", "rgba32i", WGPUTextureFormat_RGBA32Sint },
+        { "rgba32float", "rgba32f", WGPUTextureFormat_RGBA32Float },
+    };
+    for (auto const & entry : formats)
+    {
+        if (name == entry.wgsl || name == entry.glsl) return entry.format;
+    }
+    return WGPUTextureFormat_Undefined;
+}
+
+WGPUTextureViewDimension viewDimensionFromSuffix(std::string const & type)
+{
+    auto endsWith = [&type](char const * suffix) {
+        std::string s = suffix;
+        return type.size() >= s.size() && type.compare(type.size() - s.size(), s.size(), s) == 0;
+    };
+    if (endsWith("cube_array") || endsWith("CubeArray")) return WGPUTextureViewDimension_CubeArray;
+    if (endsWith("2d_array") || endsWith("2DArray")) return WGPUTextureViewDimension_2DArray;
+    if (endsWith("cube") || endsWith("Cube")) return WGPUTextureViewDimension_Cube;
+    if (endsWith("1d") || endsWith("1D")) return WGPUTextureViewDimension_1D;
+    if (endsWith("3d") || endsWith("3D")) return WGPUTextureViewDimension_3D;
+    return WGPUTextureViewDimension_2D;
+}
+
+WGPUTextureSampleType sampleTypeFromScalar(std::string const & scalar)
+{
+    if (scalar == "i32") return WGPUTextureSampleType_Sint;
+    if (scalar == "u32") return WGPUTextureSampleType_Uint;
+    return WGPUTextureSampleType_Float;
+}
+
+bool classifyWGSLBinding(
+    std::string const & addressSpace,
+    std::string const & access,
+    std::string const & type,
+    ShaderBindingLayout & layout,
+    std::string & error)
+{
+    if (addressSpace == "uniform")
+    {
+        layout.kind = static_cast<uint32_t>(ShaderBindingKind::UniformBuffer);
+        return true;
+    }
+    if (addressSpace == "storage")
+    {
+        layout.kind = static_cast<uint32_t>(access == "read_write" ? ShaderBindingKind::StorageBuffer : ShaderBindingKind::ReadOnlyStorageBuffer);
+        return true;
+    }
+
+    size_t open = type.find('<');
+    std::string base = trim(type.substr(0, open));
+    std::vector<std::string> arguments;
+    if (open != std::string::npos)
+    {
+        arguments = splitArguments(type.substr(open + 1, type.rfind('>') - open - 1));
+    }
+
+    if (base == "sampler")
+    {
+        layout.kind = static_cast<uint32_t>(ShaderBindingKind::Sampler);
+    }
+    else if (base == "sampler_comparison")
+    {
+        layout.kind = static_cast<uint32_t>(ShaderBindingKind::ComparisonSampler);
+    }
+    else if (base.compare(0, 16, "texture_storage_") == 0)
+    {
+        layout.kind = static_cast<uint32_t>(ShaderBindingKind::StorageTexture);
+        layout.viewDimension = viewDimensionFromSuffix(base);
+        layout.storageFormat = arguments.size() > 0 ? storageFormatFromName(arguments[0]) : WGPUTextureFormat_Undefined;
+        std::string mode = arguments.size() > 1 ? arguments[1] : "write";
+        layout.storageAccess = mode == "read" ? WGPUStorageTextureAccess_ReadOnly
+            : mode == "read_write" ? WGPUStorageTextureAccess_ReadWrite
+            : WGPUStorageTextureAccess_WriteOnly;
+        if (layout.storageFormat == WGPUTextureFormat_Undefined)
+        {
+            error = "unsupported storage texture format in '" + type + "'";
+            return false;
+        }
+    }
+    else if (base.compare(0, 8, "texture_") == 0)
+    {
+        layout.kind = static_cast<uint32_t>(ShaderBindingKind::Texture);
+        layout.viewDimension = viewDimensionFromSuffix(base);
+        layout.multisampled = base.find("multisampled") != std::string::npos;
+        layout.sampleType = base.find("depth") != std::string::npos
+            ? WGPUTextureSampleType_Depth
+            : sampleTypeFromScalar(arguments.empty() ? std::string("f32") : arguments[0]);
+    }
+    else
+    {
+        error = "unsupported binding type '" + type + "'";
+        return false;
+    }
+    return true;
+}
+
+struct WGSLFunction
+{
+    std::string name;
+    size_t bodyBegin = 0;
+    size_t bodyEnd = 0;
+};
+
+struct WGSLModule
+{
+    std::vector<ShaderEntryPointInfo> entryPoints;
+    std::vector<WGSLFunction> functions;     // entry points included
+    std::vector<ShaderBindingInfo> bindings;
+};
+
+bool scanWGSL(std::string const & source, WGSLModule & module, std::string & error)
+{
+    ShaderEntryPointInfo pending;
+    int group = -1;
+    int binding = -1;
+    auto resetPending = [&]() {
+        pending = ShaderEntryPointInfo();
+        group = binding = -1;
+    };
+
+    size_t i = 0;
+    while (i < source.size())
+    {
+        char c = source[i];
+        if (c == '@')
+        {
+            ++i;
+            std::string attribute = readIdentifier(source, i);
+            if (attribute == "compute") pending.stage = WGPUShaderStage_Compute;
+            else if (attribute == "vertex") pending.stage = WGPUShaderStage_Vertex;
+            else if (attribute == "fragment") pending.stage = WGPUShaderStage_Fragment;
+            else if (attribute == "workgroup_size")
+            {
+                std::vector<std::string> arguments = splitArguments(readEnclosed(source, i, '(', ')'));
+                for (size_t d = 0; d < 3; ++d)
+                {
+                    pending.workgroupSize[d] = d < arguments.size() ? parseLiteral(arguments[d]) : 1;
+                }
+            }
+            else if (attribute == "group") group = static_cast<int>(parseLiteral(readEnclosed(source, i, '(', ')')));
+            else if (attribute == "binding") binding = static_cast<int>(parseLiteral(readEnclosed(source, i, '(', ')')));
+            continue;
+        }
+        if (isIdentifierChar(c))
+        {
+            bool boundary = i == 0 || !isIdentifierChar(source[i - 1]);
+            std::string word = readIdentifier(source, i);
+            if (boundary && word == "fn")
+            {
+                WGSLFunction function;
+                function.name = readIdentifier(source, i);
+                size_t open = source.find('{', i);
+                if (open == std::string::npos)
+                {
+                    error = "function '" + function.name + "' has no body";
+                    return false;
+                }
+                i = open;
+                readEnclosed(source, i, '{', '}');
+                function.bodyBegin = open + 1;
+                function.bodyEnd = i - 1;
+                if (pending.stage != WGPUShaderStage_None)
+                {
+                    pending.name = function.name;
+                    module.entryPoints.push_back(pending);
+                }
+                module.functions.push_back(function);
+                resetPending();
+            }
+            else if (boundary && word == "var" && group >= 0 && binding >= 0)
+            {
+                std::vector<std::string> qualifiers;
+                skipSpaces(source, i);
+                if (i < source.size() && source[i] == '<')
+                {
+                    qualifiers = splitArguments(readEnclosed(source, i, '<', '>'));
+                }
+                ShaderBindingInfo info;
+                info.name = readIdentifier(source, i);
+                size_t colon = source.find(':', i);
+                size_t end = source.find(';', i);
+                if (colon == std::string::npos || end == std::string::npos || colon > end)
+                {
+                    error = "malformed declaration of '" + info.name + "'";
+                    return false;
+                }
+                info.type = trim(source.substr(colon + 1, end - colon - 1));
+                info.layout.group = static_cast<uint32_t>(group);
+                info.layout.binding = static_cast<uint32_t>(binding);
+                std::string addressSpace = qualifiers.size() > 0 ? qualifiers[0] : std::string();
+                std::string access = qualifiers.size() > 1 ? qualifiers[1] : std::string();
+                if (!classifyWGSLBinding(addressSpace, access, info.type, info.layout, error))
+                {
+                    error = info.name + ": " + error;
+                    return false;
+                }
+                module.bindings.push_back(info);
+                i = end;
+                resetPending();
+            }
+            continue;
+        }
+        if (c == ';' || c == '}')
+        {
+            resetPending();
+        }
+        ++i;
+    }
+    return true;
+}
+
+// A binding is visible to a stage when one of its entry points uses it,
+// possibly through the functions it calls.
+void resolveVisibility(std::string const & source, WGSLModule & module)
+{
+    std::vector<std::set<std::string>> identifiers;
+    for (auto const & function : module.functions)
+    {
+        identifiers.push_back(identifiersIn(source, function.bodyBegin, function.bodyEnd));
+    }
+    auto functionIndex = [&module](std::string const & name) {
+        for (size_t f = 0; f < module.functions.size(); ++f)
+        {
+            if (module.functions[f].name == name) return static_cast<int>(f);
+        }
+        return -1;
+    };
+
+    for (auto const & entryPoint : module.entryPoints)
+    {
+        std::set<std::string> used;
+        std::vector<int> stack = { functionIndex(entryPoint.name) };
+        std::set<int> visited;
+        while (!stack.empty())
+        {
+            int f = stack.back();
+            stack.pop_back();
+            if (f < 0 || !visited.insert(f).second) continue;
+            for (auto const & identifier : identifiers[f])
+            {
+                used.insert(identifier);
+                int callee = functionIndex(identifier);
+                if (callee >= 0) stack.push_back(callee);
+            }
+        }
+        for (auto & binding : module.bindings)
+        {
+            if (used.count(binding.name)) binding.layout.visibility |= entryPoint.stage;
+        }
+    }
+
+    module.bindings.erase(
+        std::remove_if(module.bindings.begin(), module.bindings.end(), [](ShaderBindingInfo const & b) { return b.layout.visibility == 0; }),
+        module.bindings.end());
+}
+
+void reflectGLSLEntryPoint(std::string const & source, WGPUShaderStage stage, std::vector<ShaderEntryPointInfo> & entryPoints)
+{
+    ShaderEntryPointInfo entryPoint;
+    entryPoint.name = "main";
+    entryPoint.stage = stage;
+    if (stage == WGPUShaderStage_Compute)
+    {
+        static char const * const axes[3] = { "local_size_x", "local_size_y", "local_size_z" };
+        for (int d = 0; d < 3; ++d)
+        {
+            entryPoint.workgroupSize[d] = 1;
+            size_t at = source.find(axes[d]);
+            if (at == std::string::npos) continue;
+            size_t equal = source.find('=', at);
+            size_t end = source.find_first_of(",)", equal);
+            if (equal != std::string::npos && end != std::string::npos)
+            {
+                entryPoint.workgroupSize[d] = parseLiteral(source.substr(equal + 1, end - equal - 1));
+            }
+        }
+    }
+    entryPoints.push_back(entryPoint);
+}
+
+bool reflectGLSLBindings(std::string const & source, WGPUShaderStage stage, std::vector<ShaderBindingInfo> & bindings, std::string & error)
+{
+    size_t i = 0;
+    while ((i = source.find("layout", i)) != std::string::npos)
+    {
+        if (i > 0 && isIdentifierChar(source[i - 1]))
+        {
+            ++i;
+            continue;
+        }
+        i += 6;
+        std::vector<std::string> arguments = splitArguments(readEnclosed(source, i, '(', ')'));
+        int set = 0;
+        int binding = -1;
+        std::string format;
+        for (auto const & argument : arguments)
+        {
+            size_t equal = argument.find('=');
+            std::string key = trim(argument.substr(0, equal));
+            std::string value = equal == std::string::npos ? std::string() : trim(argument.substr(equal + 1));
+            if (key == "set") set = static_cast<int>(parseLiteral(value));
+            else if (key == "binding") binding = static_cast<int>(parseLiteral(value));
+            else if (equal == std::string::npos) format = key;
+        }
+        if (binding < 0)
+        {
+            continue;
+        }
+
+        // qualifiers and type up to the block or the declaration end
+        size_t end = source.find_first_of("{;", i);
+        std::istringstream words(source.substr(i, end - i));
+        std::vector<std::string> qualifiers;
+        std::string word;
+        while (words >> word) qualifiers.push_back(word);
+        auto has = [&qualifiers](char const * q) { return std::find(qualifiers.begin(), qualifiers.end(), q) != qualifiers.end(); };
+        std::string type = qualifiers.size() >= 2 ? qualifiers[qualifiers.size() - 2] : std::string();
+
+        ShaderBindingInfo info;
+        info.name = qualifiers.empty() ? std::string() : qualifiers.back();
+        info.type = type;
+        info.layout.group = static_cast<uint32_t>(set);
+        info.layout.binding = static_cast<uint32_t>(binding);
+        info.layout.visibility = stage;
+        if (has("buffer"))
+        {
+            info.layout.kind = static_cast<uint32_t>(has("readonly") ? ShaderBindingKind::ReadOnlyStorageBuffer : ShaderBindingKind::StorageBuffer);
+        }
+        else if (type == "sampler")
+        {
+            info.layout.kind = static_cast<uint32_t>(ShaderBindingKind::Sampler);
+        }
+        else if (type == "samplerShadow")
+        {
+            info.layout.kind = static_cast<uint32_t>(ShaderBindingKind::ComparisonSampler);
+        }
+        else if (type.find("sampler") != std::string::npos)
+        {
+            // sampler2D and the like, which uniform would otherwise take for a block
+            error = info.name + ": combined image sampler " + type + " has no WebGPU binding, use a texture and a sampler";
+            return false;
+        }
+        else if (type.find("image") != std::string::npos)
+        {
+            info.layout.kind = static_cast<uint32_t>(ShaderBindingKind::StorageTexture);
+            info.layout.viewDimension = viewDimensionFromSuffix(type);
+            info.layout.storageFormat = storageFormatFromName(format);
+            info.layout.storageAccess = has("readonly") ? WGPUStorageTextureAccess_ReadOnly
+                : has("writeonly") ? WGPUStorageTextureAccess_WriteOnly
+                : WGPUStorageTextureAccess_ReadWrite;
+            if (info.layout.storageFormat == WGPUTextureFormat_Undefined)
+            {
+                error = info.name + ": missing or unsupported image format";
+                return false;
+            }
+        }
+        else if (type.find("texture") != std::string::npos)
+        {
+            info.layout.kind = static_cast<uint32_t>(ShaderBindingKind::Texture);
+            info.layout.viewDimension = viewDimensionFromSuffix(type);
+            info.layout.multisampled = type.find("MS") != std::string::npos;
+            info.layout.sampleType = type[0] == 'i' ? WGPUTextureSampleType_Sint
+                : type[0] == 'u' ? WGPUTextureSampleType_Uint
+                : WGPUTextureSampleType_Float;
+        }
+        else if (has("uniform") && end != std::string::npos && source[end] == '{')
+        {
+            // uniform block, named after the block
+            info.layout.kind = static_cast<uint32_t>(ShaderBindingKind::UniformBuffer);
+        }
+        else if (has("uniform"))
+        {
+            error = info.name + ": unsupported uniform type " + type;
+            return false;
+        }
+        else
+        {
+            continue;
+        }
+        bindings.push_back(info);
+        i = end;
+    }
+    return true;
+}
+
+} // namespace
+
+bool reflectShaderEntryPoints(
+    std::string const & source,
+    ShaderLanguage language,
+    WGPUShaderStage glslStage,
+    std::vector<ShaderEntryPointInfo> & entryPoints,
+    std::string & error)
+{
+    std::string code = stripComments(source);
+    if (!checkBrackets(code, error))
+    {
+        return false;
+    }
+
+    entryPoints.clear();
+    if (language == ShaderLanguage::WGSL)
+    {
+        WGSLModule module;
+        if (!scanWGSL(code, module, error))
+        {
+            return false;
+        }
+        entryPoints = module.entryPoints;
+    }
+    else
+    {
+        if (code.find("#version") == std::string::npos)
+        {
+            error = "missing #version directive";
+            return false;
+        }
+        if (code.find("void main") == std::string::npos)
+        {
+            error = "missing 'void main' entry point";
+            return false;
+        }
+        reflectGLSLEntryPoint(code, glslStage, entryPoints);
+    }
+
+    if (entryPoints.empty())
+    {
+        error = "no entry point found";
+        return false;
+    }
+    return true;
+}
+
+bool reflectShaderBindings(
+    std::string const & source,
+    ShaderLanguage language,
+    WGPUShaderStage glslStage,
+    std::vector<ShaderBindingInfo> & bindings,
+    std::string & error)
+{
+    std::string code = stripComments(source);
+    bindings.clear();
+    if (language == ShaderLanguage::WGSL)
+    {
+        WGSLModule module;
+        if (!scanWGSL(code, module, error))
+        {
+            return false;
+        }
+        resolveVisibility(code, module);
+        bindings = std::move(module.bindings);
+    }
+    else if (!reflectGLSLBindings(code, glslStage, bindings, error))
+    {
+        return false;
+    }
+
+    std::sort(bindings.begin(), bindings.end(), [](ShaderBindingInfo const & a, ShaderBindingInfo const & b) {
+        return a.layout.group != b.layout.group ? a.layout.group < b.layout.group : a.layout.binding < b.layout.binding;
+    });
+    for (size_t b = 1; b < bindings.size(); ++b)
+    {
+        if (bindings[b].layout.group == bindings[b - 1].layout.group && bindings[b].layout.binding == bindings[b - 1].layout.binding)
+        {
+            error = "'" + bindings[b - 1].name + "' and '" + bindings[b].name + "' share the same group and binding";
+            return false;
+        }
+    }
+    return true;
+}
+
+WGPUBindGroupLayoutEntry toBindGroupLayoutEntry(ShaderBindingLayout const & layout)
+{
+    WGPUBindGroupLayoutEntry entry = {};
+    entry.nextInChain = nullptr;
+    entry.binding = layout.binding;
+    entry.visibility = layout.visibility;
+    switch (static_cast<ShaderBindingKind>(layout.kind))
+    {
+    case ShaderBindingKind::UniformBuffer:
+        entry.buffer.type = WGPUBufferBindingType_Uniform;
+        break;
+    case ShaderBindingKind::StorageBuffer:
+        entry.buffer.type = WGPUBufferBindingType_Storage;
+        break;
+    case ShaderBindingKind::ReadOnlyStorageBuffer:
+        entry.buffer.type = WGPUBufferBindingType_ReadOnlyStorage;
+        break;
+    case ShaderBindingKind::Sampler:
+        entry.sampler.type = WGPUSamplerBindingType_Filtering;
+        break;
+    case ShaderBindingKind::ComparisonSampler:
+        entry.sampler.type = WGPUSamplerBindingType_Comparison;
+        break;
+    case ShaderBindingKind::Texture:
+        entry.texture.sampleType = static_cast<WGPUTextureSampleType>(layout.sampleType);
+        entry.texture.viewDimension = static_cast<WGPUTextureViewDimension>(layout.viewDimension);
+        entry.texture.multisampled = layout.multisampled;
+        break;
+    case ShaderBindingKind::StorageTexture:
+        entry.storageTexture.access = static_cast<WGPUStorageTextureAccess>(layout.storageAccess);
+        entry.storageTexture.format = static_cast<WGPUTextureFormat>(layout.storageFormat);
+        entry.storageTexture.viewDimension = static_cast<WGPUTextureViewDimension>(layout.viewDimension);
+        break;
+    }
+    return entry;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Source-level reflection of WGSL and GLSL shaders, precise enough to
+ * validate shaders at pack time and to build explicit bind group layouts
+ * instead of relying on the implicit "auto" layout of each pipeline.
+ */
+
+enum class ShaderLanguage : uint32_t
+{
+    WGSL = 0,
+    GLSL = 1,
+};
+
+enum class ShaderBindingKind : uint32_t
+{
+    UniformBuffer = 0,
+    StorageBuffer = 1,
+    ReadOnlyStorageBuffer = 2,
+    Sampler = 3,
+    ComparisonSampler = 4,
+    Texture = 5,
+    StorageTexture = 6,
+};
+
+/**
+ * Plain-old-data description of one binding, stored as is in shader packs.
+ * Fields that do not apply to the binding kind are left to 0 (Undefined).
+ */
+struct ShaderBindingLayout
+{
+    uint32_t group;
+    uint32_t binding;
+    uint32_t kind;              // ShaderBindingKind
+    uint32_t visibility;        // WGPUShaderStageFlags
+    uint32_t sampleType;        // WGPUTextureSampleType
+    uint32_t viewDimension;     // WGPUTextureViewDimension
+    uint32_t multisampled;
+    uint32_t storageAccess;     // WGPUStorageTextureAccess
+    uint32_t storageFormat;     // WGPUTextureFormat
+};
+
+struct ShaderBindingInfo
+{
+    std::string name;
+    std::string type;
+    ShaderBindingLayout layout = {};
+};
+
+/**
+ * Entry point found while scanning a shader source.
+ */
+struct ShaderEntryPointInfo
+{
+    std::string name;
+    WGPUShaderStage stage = WGPUShaderStage_None;
+    uint32_t workgroupSize[3] = { 0, 0, 0 };
+};
+
+/**
+ * Light-weight validation and reflection: comments are skipped, brackets
+ * must balance and at least one entry point must exist. For GLSL the single
+ * entry point is `main` with the given stage.
+ */
+bool reflectShaderEntryPoints(
+    std::string const & source,
+    ShaderLanguage language,
+    WGPUShaderStage glslStage,
+    std::vector<ShaderEntryPointInfo> & entryPoints,
+    std::string & error);
+
+/**
+ * Extract the resource bindings (@group/@binding in WGSL, layout(set,
+ * binding) in GLSL) with their type and access mode. A WGSL binding is
+ * visible to the stages of the entry points that reference it, directly or
+ * through the functions they call; unreferenced bindings are dropped like
+ * the implicit layout does. Bindings are sorted by group then binding.
+ * GLSL combined image samplers (sampler2D...) are an error, WebGPU only
+ * binds textures and samplers separately.
+ */
+bool reflectShaderBindings(
+    std::string const & source,
+    ShaderLanguage language,
+    WGPUShaderStage glslStage,
+    std::vector<ShaderBindingInfo> & bindings,
+    std::string & error);
+
+/**
+ * Translate a reflected binding into a bind group layout entry.
+ * minBindingSize is left to 0, i.e. checked at draw/dispatch time.
+ */
+WGPUBindGroupLayoutEntry toBindGroupLayoutEntry(ShaderBindingLayout const & layout);
@@ -0,0 +1,125 @@
+#include "shader_watcher.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // __linux__
+
+ShaderWatcher::~ShaderWatcher()
+{
+    stop();
+}
+
+#ifdef __linux__
+
+bool ShaderWatcher::start(std::string const & root)
+{
+    stop();
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    addDirectory(root);
+    return !m_directories.empty();
+}
+
+void ShaderWatcher::stop()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+    m_fd = -1;
+    m_directories.clear();
+}
+
+void ShaderWatcher::addDirectory(std::string const & directory)
+{
+    // editors often save by writing a new file then renaming it over the
+    // old one, hence IN_MOVED_TO besides IN_CLOSE_WRITE.
+    int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0)
+    {
+        return;
+    }
+    m_directories.emplace_back(wd, directory);
+
+    DIR * dir = opendir(directory.c_str());
+    if (dir == nullptr)
+    {
+        return;
+    }
+    while (dirent * entry = readdir(dir))
+    {
+        std::string name = entry->d_name;
+        if (entry->d_type == DT_DIR && name != "." && name != "..")
+        {
+            addDirectory(directory + name + "/");
+        }
+    }
+    closedir(dir);
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+    std::vector<std::string> changed;
+    if (m_fd < 0)
+    {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            // EAGAIN: nothing left to read
+            break;
+        }
+        for (char * p = buffer; p < buffer + length;)
+        {
+            auto const * event = reinterpret_cast<inotify_event const *>(p);
+            p += sizeof(inotify_event) + event->len;
+            auto dir = std::find_if(m_directories.begin(), m_directories.end(), [event](auto const & d) { return d.first == event->wd; });
+            if (dir == m_directories.end() || event->len == 0)
+            {
+                continue;
+            }
+            std::string path = dir->second + event->name;
+            if (event->mask & IN_ISDIR)
+            {
+                if (event->mask & IN_CREATE) addDirectory(path + "/");
+                continue;
+            }
+            if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                && std::find(changed.begin(), changed.end(), path) == changed.end())
+            {
+                changed.push_back(path);
+            }
+        }
+    }
+    return changed;
+}
+
+#else // __linux__
+
+bool ShaderWatcher::start(std::string const & /* root */)
+{
+    return false;
+}
+
+void ShaderWatcher::stop()
+{
+}
+
+std::vector<std::string> ShaderWatcher::poll()
+{
+    return {};
+}
+
+#endif // __linux__
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * Watches a shader directory and its subdirectories for modified files.
+ * Backed by inotify, so only available on Linux: start() returns false
+ * elsewhere and the watcher never reports anything.
+ */
+class ShaderWatcher
+{
+public:
+    ShaderWatcher() = default;
+    ~ShaderWatcher();
+
+    ShaderWatcher(ShaderWatcher const &) = delete;
+    ShaderWatcher & operator=(ShaderWatcher const &) = delete;
+
+    /**
+     * Start watching; root must end with a path separator.
+     */
+    bool start(std::string const & root);
+    void stop();
+
+    /**
+     * Non-blocking: paths (root + relative path) of the files written or
+     * replaced since the last call, without duplicates.
+     */
+    std::vector<std::string> poll();
+
+private:
+#ifdef __linux__
+    void addDirectory(std::string const & directory);
+
+    int m_fd = -1;
+    std::vector<std::pair<int, std::string>> m_directories;
+#endif // __linux__
+};
@@ -0,0 +1,21 @@
+#include "include/common.wgsl"
+
+struct FillParams {
+    count: u32,
+    gridWidth: u32,
+    scale: f32,
+    offset: f32,
+}
+
+@group(0) @binding(0) var<storage, read_write> values: array<f32>;
+@group(0) @binding(1) var<uniform> params: FillParams;
+
+// values[i] = i * scale + offset
+@compute @workgroup_size(64)
+fn main(@builtin(global_invocation_id) id: vec3<u32>) {
+    let i = linearIndex(id, params.gridWidth);
+    if (i >= params.count) {
+        return;
+    }
+    values[i] = f32(i) * params.scale + params.offset;
+}
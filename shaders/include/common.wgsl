@@ -0,0 +1,5 @@
+// Helpers shared by the compute shaders, spliced in by #include.
+
+fn linearIndex(id: vec3<u32>, gridWidth: u32) -> u32 {
+    return id.y * gridWidth + id.x;
+}
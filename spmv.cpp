@@ -0,0 +1,487 @@
+#include "spmv.h"
+#include "thread_pool.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+
+constexpr uint32_t rowsPerWorkgroup = 256;
+constexpr uint32_t vectorRowsPerWorkgroup = 8;      // 32 invocations each
+constexpr uint32_t noRow = 0xffffffffu;
+
+// the padded layouts store padding entries as column 0 with a 0 value,
+// cheaper to multiply than to skip
+char const * spmvSource = R"(
+struct Params
+{
+    rows: u32,
+    width: u32,
+    padding0: u32,
+    padding1: u32,
+}
+
+@group(0) @binding(0) var<storage, read> offsets: array<u32>;
+@group(0) @binding(1) var<storage, read> columns: array<u32>;
+@group(0) @binding(2) var<storage, read> values: array<f32>;
+@group(0) @binding(3) var<storage, read> x: array<f32>;
+@group(0) @binding(4) var<storage, read_write> y: array<f32>;
+@group(0) @binding(5) var<uniform> params: Params;
+@group(0) @binding(6) var<storage, read> permutation: array<u32>;
+
+const SLICE_HEIGHT = 32u;
+
+var<workgroup> partial: array<f32, 256>;
+
+fn groupIndex(group: vec3u, groups: vec3u) -> u32
+{
+    return group.y * groups.x + group.x;
+}
+
+@compute @workgroup_size(256)
+fn csrScalar(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(num_workgroups) groups: vec3u,
+    @builtin(local_invocation_index) local: u32)
+{
+    let row = groupIndex(group, groups) * 256u + local;
+    if (row >= params.rows)
+    {
+        return;
+    }
+    var sum = 0.0;
+    let end = offsets[row + 1u];
+    for (var i = offsets[row]; i < end; i++)
+    {
+        sum += values[i] * x[columns[i]];
+    }
+    y[row] = sum;
+}
+
+@compute @workgroup_size(256)
+fn csrVector(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(num_workgroups) groups: vec3u,
+    @builtin(local_invocation_index) local: u32)
+{
+    let row = groupIndex(group, groups) * 8u + local / 32u;
+    let lane = local % 32u;
+    var sum = 0.0;
+    if (row < params.rows)
+    {
+        // consecutive lanes read consecutive entries of the row
+        let end = offsets[row + 1u];
+        for (var i = offsets[row] + lane; i < end; i += 32u)
+        {
+            sum += values[i] * x[columns[i]];
+        }
+    }
+    partial[local] = sum;
+    workgroupBarrier();
+    for (var stride = 16u; stride > 0u; stride >>= 1u)
+    {
+        if (lane < stride)
+        {
+            partial[local] += partial[local + stride];
+        }
+        workgroupBarrier();
+    }
+    if (lane == 0u && row < params.rows)
+    {
+        y[row] = partial[local];
+    }
+}
+
+@compute @workgroup_size(256)
+fn ell(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(num_workgroups) groups: vec3u,
+    @builtin(local_invocation_index) local: u32)
+{
+    let row = groupIndex(group, groups) * 256u + local;
+    if (row >= params.rows)
+    {
+        return;
+    }
+    var sum = 0.0;
+    for (var k = 0u; k < params.width; k++)
+    {
+        let index = k * params.rows + row;
+        sum += values[index] * x[columns[index]];
+    }
+    y[row] = sum;
+}
+
+@compute @workgroup_size(256)
+fn sell(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(num_workgroups) groups: vec3u,
+    @builtin(local_invocation_index) local: u32)
+{
+    let sorted = groupIndex(group, groups) * 256u + local;
+    if (sorted >= params.rows || permutation[sorted] == 0xffffffffu)
+    {
+        return;
+    }
+    let slice = sorted / SLICE_HEIGHT;
+    let begin = offsets[slice] + sorted % SLICE_HEIGHT;
+    let width = (offsets[slice + 1u] - offsets[slice]) / SLICE_HEIGHT;
+    var sum = 0.0;
+    for (var k = 0u; k < width; k++)
+    {
+        let index = begin + k * SLICE_HEIGHT;
+        sum += values[index] * x[columns[index]];
+    }
+    y[permutation[sorted]] = sum;
+}
+)";
+
+char const * entryPoints[] = { "csrScalar", "csrVector", "ell", "sell" };
+
+uint32_t rowLength(CsrMatrix const & matrix, uint32_t row)
+{
+    return matrix.rowOffsets[row + 1] - matrix.rowOffsets[row];
+}
+
+/**
+ * Rows in SELL-C-sigma order: by decreasing length within every window of
+ * sigma rows, ties kept in row order.
+ */
+std::vector<uint32_t> sellOrder(CsrMatrix const & matrix)
+{
+    std::vector<uint32_t> order(matrix.rows);
+    std::iota(order.begin(), order.end(), 0u);
+    for (uint32_t first = 0; first < matrix.rows; first += GpuSparseMatrix::sortWindow)
+    {
+        uint32_t last = std::min(first + GpuSparseMatrix::sortWindow, matrix.rows);
+        std::stable_sort(order.begin() + first, order.begin() + last, [&](uint32_t a, uint32_t b) {
+            return rowLength(matrix, a) > rowLength(matrix, b);
+        });
+    }
+    return order;
+}
+
+/**
+ * Width of every slice of SELL-C-sigma, the longest row it holds.
+ */
+std::vector<uint32_t> sliceWidths(CsrMatrix const & matrix, std::vector<uint32_t> const & order)
+{
+    uint32_t const c = GpuSparseMatrix::sliceHeight;
+    std::vector<uint32_t> widths((matrix.rows + c - 1) / c, 0);
+    for (uint32_t sorted = 0; sorted < matrix.rows; ++sorted)
+    {
+        widths[sorted / c] = std::max(widths[sorted / c], rowLength(matrix, order[sorted]));
+    }
+    return widths;
+}
+
+} // namespace
+
+char const * sparseFormatName(SparseFormat format)
+{
+    switch (format)
+    {
+    case SparseFormat::CsrVector: return "csr_vector";
+    case SparseFormat::Ell: return "ell";
+    case SparseFormat::SellCSigma: return "sell_c_sigma";
+    default: return "csr_scalar";
+    }
+}
+
+SparseRowStats analyzeSparseRows(CsrMatrix const & matrix)
+{
+    SparseRowStats stats;
+    uint32_t nonZeros = matrix.nonZeros();
+    if (matrix.rows == 0 || nonZeros == 0)
+    {
+        return stats;
+    }
+
+    stats.minLength = rowLength(matrix, 0);
+    double sumOfSquares = 0.0;
+    for (uint32_t row = 0; row < matrix.rows; ++row)
+    {
+        uint32_t length = rowLength(matrix, row);
+        stats.minLength = std::min(stats.minLength, length);
+        stats.maxLength = std::max(stats.maxLength, length);
+        sumOfSquares += double(length) * length;
+    }
+    stats.meanLength = double(nonZeros) / matrix.rows;
+    stats.stddevLength = std::sqrt(std::max(0.0, sumOfSquares / matrix.rows - stats.meanLength * stats.meanLength));
+    stats.ellFill = double(matrix.rows) * stats.maxLength / nonZeros;
+    uint64_t sellEntries = 0;
+    for (uint32_t width : sliceWidths(matrix, sellOrder(matrix)))
+    {
+        sellEntries += uint64_t(width) * GpuSparseMatrix::sliceHeight;
+    }
+    stats.sellFill = double(sellEntries) / nonZeros;
+
+    // padding costs bandwidth like real entries, a little of it buys
+    // coalesced reads; long rows keep 32 invocations busy each
+    if (stats.ellFill <= 1.2)
+    {
+        stats.recommended = SparseFormat::Ell;
+    }
+    else if (stats.meanLength >= 16.0)
+    {
+        stats.recommended = SparseFormat::CsrVector;
+    }
+    else if (stats.sellFill <= 1.5)
+    {
+        stats.recommended = SparseFormat::SellCSigma;
+    }
+    else
+    {
+        stats.recommended = stats.maxLength >= 64 ? SparseFormat::CsrVector : SparseFormat::CsrScalar;
+    }
+    return stats;
+}
+
+void cpuSpmv(CsrMatrix const & matrix, float const * x, float * y, ThreadPool * pool)
+{
+    ThreadPool & threads = pool ? *pool : ThreadPool::shared();
+    threads.parallelFor(matrix.rows, 1024, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+        {
+            float sum = 0.0f;
+            for (uint32_t i = matrix.rowOffsets[row]; i < matrix.rowOffsets[row + 1]; ++i)
+            {
+                sum += matrix.values[i] * x[matrix.columns[i]];
+            }
+            y[row] = sum;
+        }
+    });
+}
+
+GpuSparseMatrix::GpuSparseMatrix(WGPUDevice device, WGPUQueue queue, CsrMatrix const & matrix, SparseFormat format)
+    : m_device(device)
+    , m_queue(queue)
+    , m_format(format)
+    , m_rows(matrix.rows)
+    , m_cols(matrix.cols)
+    , m_invocationRows(matrix.rows)
+{
+    WGPUBufferUsageFlags storage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopyDst;
+    Params params = { matrix.rows, 0, { 0, 0 } };
+
+    switch (format)
+    {
+    case SparseFormat::CsrScalar:
+    case SparseFormat::CsrVector:
+        m_storedEntries = matrix.nonZeros();
+        m_offsets = createBuffer("Sparse row offsets", storage, matrix.rowOffsets.data(), matrix.rowOffsets.size() * 4);
+        m_columns = createBuffer("Sparse columns", storage, matrix.columns.data(), m_storedEntries * 4);
+        m_values = createBuffer("Sparse values", storage, matrix.values.data(), m_storedEntries * 4);
+        break;
+
+    case SparseFormat::Ell:
+    {
+        uint32_t width = 0;
+        for (uint32_t row = 0; row < matrix.rows; ++row)
+        {
+            width = std::max(width, rowLength(matrix, row));
+        }
+        // column-major: entry k of every row, then entry k + 1
+        m_storedEntries = uint64_t(width) * matrix.rows;
+        std::vector<uint32_t> columns(m_storedEntries, 0);
+        std::vector<float> values(m_storedEntries, 0.0f);
+        for (uint32_t row = 0; row < matrix.rows; ++row)
+        {
+            for (uint32_t k = 0; k < rowLength(matrix, row); ++k)
+            {
+                uint32_t source = matrix.rowOffsets[row] + k;
+                columns[uint64_t(k) * matrix.rows + row] = matrix.columns[source];
+                values[uint64_t(k) * matrix.rows + row] = matrix.values[source];
+            }
+        }
+        params.width = width;
+        m_columns = createBuffer("Sparse columns", storage, columns.data(), m_storedEntries * 4);
+        m_values = createBuffer("Sparse values", storage, values.data(), m_storedEntries * 4);
+        break;
+    }
+
+    case SparseFormat::SellCSigma:
+    {
+        std::vector<uint32_t> order = sellOrder(matrix);
+        std::vector<uint32_t> widths = sliceWidths(matrix, order);
+        std::vector<uint32_t> sliceOffsets(widths.size() + 1, 0);
+        for (size_t slice = 0; slice < widths.size(); ++slice)
+        {
+            sliceOffsets[slice + 1] = sliceOffsets[slice] + widths[slice] * sliceHeight;
+        }
+        m_storedEntries = sliceOffsets.back();
+        m_invocationRows = static_cast<uint32_t>(widths.size()) * sliceHeight;
+        std::vector<uint32_t> permutation(m_invocationRows, noRow);
+        std::vector<uint32_t> columns(m_storedEntries, 0);
+        std::vector<float> values(m_storedEntries, 0.0f);
+        for (uint32_t sorted = 0; sorted < matrix.rows; ++sorted)
+        {
+            uint32_t row = order[sorted];
+            permutation[sorted] = row;
+            uint32_t begin = sliceOffsets[sorted / sliceHeight] + sorted % sliceHeight;
+            for (uint32_t k = 0; k < rowLength(matrix, row); ++k)
+            {
+                uint32_t source = matrix.rowOffsets[row] + k;
+                columns[begin + k * sliceHeight] = matrix.columns[source];
+                values[begin + k * sliceHeight] = matrix.values[source];
+            }
+        }
+        params.rows = m_invocationRows;
+        m_offsets = createBuffer("Sparse slice offsets", storage, sliceOffsets.data(), sliceOffsets.size() * 4);
+        m_columns = createBuffer("Sparse columns", storage, columns.data(), m_storedEntries * 4);
+        m_values = createBuffer("Sparse values", storage, values.data(), m_storedEntries * 4);
+        m_permutation = createBuffer("Sparse row permutation", storage, permutation.data(), permutation.size() * 4);
+        break;
+    }
+    }
+
+    m_params = createBuffer("Sparse params", WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst, &params, sizeof(params));
+}
+
+GpuSparseMatrix::~GpuSparseMatrix()
+{
+    release();
+}
+
+void GpuSparseMatrix::release()
+{
+    for (WGPUBuffer * buffer : { &m_offsets, &m_columns, &m_values, &m_permutation, &m_params })
+    {
+        if (*buffer)
+        {
+            wgpuBufferRelease(*buffer);
+            *buffer = nullptr;
+        }
+    }
+}
+
+uint64_t GpuSparseMatrix::trafficBytes() const
+{
+    // a column and a value per entry, x once at least, y, and the offsets
+    uint64_t offsets = m_format == SparseFormat::Ell ? 0 : uint64_t(m_invocationRows) * 4;
+    return m_storedEntries * 8 + uint64_t(m_cols) * 4 + uint64_t(m_rows) * 4 + offsets;
+}
+
+WGPUBuffer GpuSparseMatrix::createBuffer(char const * label, WGPUBufferUsageFlags usage, void const * data, uint64_t size)
+{
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = label;
+    bufferDesc.usage = usage;
+    bufferDesc.size = std::max<uint64_t>(size, 16);
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    if (size > 0)
+    {
+        wgpuQueueWriteBuffer(m_queue, buffer, 0, data, size);
+    }
+    return buffer;
+}
+
+Spmv::Spmv(WGPUDevice device)
+    : m_device(device)
+{
+    WGPUSupportedLimits supported = {};
+    supported.nextInChain = nullptr;
+    wgpuDeviceGetLimits(device, &supported);
+    m_maxGroupsPerDimension = supported.limits.maxComputeWorkgroupsPerDimension;
+}
+
+Spmv::~Spmv()
+{
+    release();
+}
+
+void Spmv::release()
+{
+    for (WGPUComputePipeline & pipeline : m_pipelines)
+    {
+        if (pipeline)
+        {
+            wgpuComputePipelineRelease(pipeline);
+            pipeline = nullptr;
+        }
+    }
+    if (m_module)
+    {
+        wgpuShaderModuleRelease(m_module);
+        m_module = nullptr;
+    }
+}
+
+WGPUComputePipeline Spmv::pipeline(SparseFormat format)
+{
+    WGPUComputePipeline & pipeline = m_pipelines[static_cast<int>(format)];
+    if (pipeline == nullptr)
+    {
+        if (m_module == nullptr)
+        {
+            m_module = createShaderModule(m_device, spmvSource, "SpMV");
+        }
+        WGPUComputePipelineDescriptor pipelineDesc = {};
+        pipelineDesc.nextInChain = nullptr;
+        pipelineDesc.label = entryPoints[static_cast<int>(format)];
+        pipelineDesc.layout = nullptr;
+        pipelineDesc.compute.module = m_module;
+        pipelineDesc.compute.entryPoint = entryPoints[static_cast<int>(format)];
+        pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+    }
+    return pipeline;
+}
+
+void Spmv::multiply(WGPUCommandEncoder encoder, GpuSparseMatrix const & matrix, WGPUBuffer x, WGPUBuffer y)
+{
+    uint32_t perGroup = matrix.m_format == SparseFormat::CsrVector ? vectorRowsPerWorkgroup : rowsPerWorkgroup;
+    uint32_t groups = (matrix.m_invocationRows + perGroup - 1) / perGroup;
+    if (groups == 0)
+    {
+        return;
+    }
+    WGPUComputePipeline computePipeline = pipeline(matrix.m_format);
+
+    // auto layouts only hold the bindings the entry point uses
+    std::vector<WGPUBindGroupEntry> entries;
+    auto bind = [&](uint32_t binding, WGPUBuffer buffer) {
+        WGPUBindGroupEntry entry = {};
+        entry.nextInChain = nullptr;
+        entry.binding = binding;
+        entry.buffer = buffer;
+        entry.offset = 0;
+        entry.size = WGPU_WHOLE_SIZE;
+        entries.push_back(entry);
+    };
+    if (matrix.m_format != SparseFormat::Ell) bind(0, matrix.m_offsets);
+    bind(1, matrix.m_columns);
+    bind(2, matrix.m_values);
+    bind(3, x);
+    bind(4, y);
+    bind(5, matrix.m_params);
+    if (matrix.m_format == SparseFormat::SellCSigma) bind(6, matrix.m_permutation);
+
+    WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(computePipeline, 0);
+    WGPUBindGroupDescriptor bindGroupDesc = {};
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label = "SpMV";
+    bindGroupDesc.layout = layout;
+    bindGroupDesc.entryCount = entries.size();
+    bindGroupDesc.entries = entries.data();
+    WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc);
+    wgpuBindGroupLayoutRelease(layout);
+
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = "SpMV";
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    wgpuComputePassEncoderSetPipeline(pass, computePipeline);
+    wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+    // groups beyond the per-dimension limit go along y
+    uint32_t groupsX = std::min(groups, m_maxGroupsPerDimension);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, groupsX, (groups + groupsX - 1) / groupsX, 1);
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+    wgpuBindGroupRelease(bindGroup);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * Sparse f32 matrix in compressed sparse row form, the host-side format
+ * every GPU layout is converted from: the entries of row r are at
+ * [rowOffsets[r], rowOffsets[r + 1]) of columns and values.
+ */
+struct CsrMatrix
+{
+    uint32_t rows = 0;
+    uint32_t cols = 0;
+    std::vector<uint32_t> rowOffsets;   // rows + 1
+    std::vector<uint32_t> columns;
+    std::vector<float> values;
+
+    uint32_t nonZeros() const { return rowOffsets.empty() ? 0 : rowOffsets.back(); }
+};
+
+/**
+ * GPU layouts of a sparse matrix, each one best for some distribution of
+ * the row lengths:
+ *  - CsrScalar: one invocation per row, for short rows of any length.
+ *  - CsrVector: 32 invocations per row, for long rows.
+ *  - Ell: rows padded to the longest one, stored column-major so that
+ *    neighbouring invocations read neighbouring entries, for rows of
+ *    nearly equal lengths.
+ *  - SellCSigma: rows sorted by length within windows of sigma rows, then
+ *    ELL by slices of C rows, for rows of varying lengths.
+ */
+enum class SparseFormat { CsrScalar, CsrVector, Ell, SellCSigma };
+
+char const * sparseFormatName(SparseFormat format);
+
+/**
+ * Row length distribution of a matrix and the padding each padded layout
+ * would need, as stored entries per nonzero (1 is no padding).
+ */
+struct SparseRowStats
+{
+    uint32_t minLength = 0;
+    uint32_t maxLength = 0;
+    double meanLength = 0.0;
+    double stddevLength = 0.0;
+    double ellFill = 1.0;
+    double sellFill = 1.0;
+    SparseFormat recommended = SparseFormat::CsrScalar;
+};
+
+SparseRowStats analyzeSparseRows(CsrMatrix const & matrix);
+
+/**
+ * y = A x on the CPU, rows spread over the pool (the shared one if null):
+ * the baseline of the GPU kernels and their reference.
+ */
+void cpuSpmv(CsrMatrix const & matrix, float const * x, float * y, ThreadPool * pool = nullptr);
+
+/**
+ * A sparse matrix converted to one of the GPU layouts and uploaded:
+ *     GpuSparseMatrix matrix(device, queue, csr, analyzeSparseRows(csr).recommended);
+ *     spmv.multiply(encoder, matrix, x, y);
+ */
+class GpuSparseMatrix
+{
+public:
+    static constexpr uint32_t sliceHeight = 32;     // C of SELL-C-sigma
+    static constexpr uint32_t sortWindow = 256;     // sigma of SELL-C-sigma
+
+    GpuSparseMatrix(WGPUDevice device, WGPUQueue queue, CsrMatrix const & matrix, SparseFormat format);
+    ~GpuSparseMatrix();
+
+    GpuSparseMatrix(GpuSparseMatrix const &) = delete;
+    GpuSparseMatrix & operator=(GpuSparseMatrix const &) = delete;
+
+    SparseFormat format() const { return m_format; }
+    uint32_t rows() const { return m_rows; }
+    uint32_t cols() const { return m_cols; }
+
+    /**
+     * Entries in the layout, padding included.
+     */
+    uint64_t storedEntries() const { return m_storedEntries; }
+
+    /**
+     * Bytes a multiplication reads and writes at least, x and y included.
+     */
+    uint64_t trafficBytes() const;
+
+    void release();
+
+private:
+    friend class Spmv;
+
+    struct Params
+    {
+        uint32_t rows;          // padded to whole slices for SELL-C-sigma
+        uint32_t width;         // entries per row for ELL
+        uint32_t padding[2];
+    };
+
+    WGPUBuffer createBuffer(char const * label, WGPUBufferUsageFlags usage, void const * data, uint64_t size);
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    SparseFormat m_format;
+    uint32_t m_rows;
+    uint32_t m_cols;
+    uint32_t m_invocationRows = 0;
+    uint64_t m_storedEntries = 0;
+    WGPUBuffer m_offsets = nullptr;         // row offsets for CSR, slice offsets for SELL-C-sigma
+    WGPUBuffer m_columns = nullptr;
+    WGPUBuffer m_values = nullptr;
+    WGPUBuffer m_permutation = nullptr;     // original row of every sorted row, SELL-C-sigma only
+    WGPUBuffer m_params = nullptr;
+};
+
+/**
+ * Sparse matrix-vector products y = A x on the GPU, x and y being f32
+ * storage buffers of cols and rows elements. Each call records one compute
+ * pass with one dispatch; kernels are compiled on first use.
+ */
+class Spmv
+{
+public:
+    explicit Spmv(WGPUDevice device);
+    ~Spmv();
+
+    Spmv(Spmv const &) = delete;
+    Spmv & operator=(Spmv const &) = delete;
+
+    void multiply(WGPUCommandEncoder encoder, GpuSparseMatrix const & matrix, WGPUBuffer x, WGPUBuffer y);
+
+    void release();
+
+private:
+    WGPUComputePipeline pipeline(SparseFormat format);
+
+    WGPUDevice m_device;
+    uint32_t m_maxGroupsPerDimension;
+    WGPUShaderModule m_module = nullptr;
+    WGPUComputePipeline m_pipelines[4] = {};
+};
@@ -0,0 +1,563 @@
+#include "statistics.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace
+{
+
+constexpr uint32_t workgroupSize = 256;
+constexpr uint32_t maxGroups = 256;             // partials merged by one workgroup
+constexpr uint32_t valuesPerInvocation = 16;    // at least, before more workgroups
+
+char const * bufferInputSource = R"(
+@group(0) @binding(0) var<storage, read> values: array<f32>;
+
+fn loadValue(i: u32) -> f32
+{
+    return values[i];
+}
+)";
+
+char const * textureInputSource = R"(
+@group(0) @binding(0) var image: texture_2d<f32>;
+
+fn loadValue(i: u32) -> f32
+{
+    return textureLoad(image, vec2u(i % params.width, i / params.width), 0)[params.channel];
+}
+)";
+
+char const * paramsSource = R"(
+struct Params
+{
+    count: u32,
+    width: u32,
+    channel: u32,
+    groups: u32,
+    low: f32,
+    high: f32,
+    fixedRange: u32,
+    padding: u32,
+}
+
+@group(0) @binding(3) var<uniform> params: Params;
+)";
+
+char const * statisticsSource = R"(
+const WORKGROUP = 256u;
+
+// Welford state of a set of values
+struct Partial
+{
+    count: u32,
+    mean: f32,
+    m2: f32,
+    minimum: f32,
+    maximum: f32,
+}
+
+struct Result
+{
+    count: u32,
+    minimum: f32,
+    maximum: f32,
+    mean: f32,
+    m2: f32,
+    low: f32,
+    high: f32,
+    padding: u32,
+    bins: array<atomic<u32>>,
+}
+
+@group(0) @binding(1) var<storage, read_write> partials: array<Partial>;
+@group(0) @binding(2) var<storage, read_write> result: Result;
+
+var<workgroup> scratch: array<Partial, WORKGROUP>;
+var<workgroup> localBins: array<atomic<u32>, BINS>;
+
+fn emptyPartial() -> Partial
+{
+    return Partial(0u, 0.0, 0.0, 3.40282347e38, -3.40282347e38);
+}
+
+// Chan et al. merge of two Welford states
+fn combine(a: Partial, b: Partial) -> Partial
+{
+    if (a.count == 0u)
+    {
+        return b;
+    }
+    if (b.count == 0u)
+    {
+        return a;
+    }
+    let na = f32(a.count);
+    let nb = f32(b.count);
+    let n = na + nb;
+    let delta = b.mean - a.mean;
+    return Partial(
+        a.count + b.count,
+        a.mean + delta * nb / n,
+        a.m2 + b.m2 + delta * delta * na * nb / n,
+        min(a.minimum, b.minimum),
+        max(a.maximum, b.maximum));
+}
+
+fn reduceWorkgroup(local: u32, value: Partial) -> Partial
+{
+    scratch[local] = value;
+    workgroupBarrier();
+    for (var stride = WORKGROUP / 2u; stride > 0u; stride /= 2u)
+    {
+        if (local < stride)
+        {
+            scratch[local] = combine(scratch[local], scratch[local + stride]);
+        }
+        workgroupBarrier();
+    }
+    return scratch[0];
+}
+
+// one partial per workgroup, over a grid-strided slice of the values
+@compute @workgroup_size(256)
+fn moments(@builtin(workgroup_id) wid: vec3u, @builtin(local_invocation_index) local: u32)
+{
+    var p = emptyPartial();
+    for (var i = wid.x * WORKGROUP + local; i < params.count; i += params.groups * WORKGROUP)
+    {
+        let x = loadValue(i);
+        p.count += 1u;
+        let delta = x - p.mean;
+        p.mean += delta / f32(p.count);
+        p.m2 += delta * (x - p.mean);
+        p.minimum = min(p.minimum, x);
+        p.maximum = max(p.maximum, x);
+    }
+    let total = reduceWorkgroup(local, p);
+    if (local == 0u)
+    {
+        partials[wid.x] = total;
+    }
+}
+
+// a single workgroup merges the partials and sets the histogram range
+@compute @workgroup_size(256)
+fn merge(@builtin(local_invocation_index) local: u32)
+{
+    var p = emptyPartial();
+    if (local < params.groups)
+    {
+        p = partials[local];
+    }
+    let total = reduceWorkgroup(local, p);
+    if (local == 0u)
+    {
+        result.count = total.count;
+        result.minimum = total.minimum;
+        result.maximum = total.maximum;
+        result.mean = total.mean;
+        result.m2 = total.m2;
+        result.low = select(total.minimum, params.low, params.fixedRange != 0u);
+        result.high = select(total.maximum, params.high, params.fixedRange != 0u);
+    }
+}
+
+@compute @workgroup_size(256)
+fn histogram(@builtin(workgroup_id) wid: vec3u, @builtin(local_invocation_index) local: u32)
+{
+    for (var b = local; b < BINS; b += WORKGROUP)
+    {
+        atomicStore(&localBins[b], 0u);
+    }
+    workgroupBarrier();
+    let low = result.low;
+    let scale = f32(BINS) / max(result.high - low, 1e-30);
+    for (var i = wid.x * WORKGROUP + local; i < params.count; i += params.groups * WORKGROUP)
+    {
+        let bin = u32(clamp((loadValue(i) - low) * scale, 0.0, f32(BINS - 1u)));
+        atomicAdd(&localBins[bin], 1u);
+    }
+    workgroupBarrier();
+    for (var b = local; b < BINS; b += WORKGROUP)
+    {
+        let n = atomicLoad(&localBins[b]);
+        if (n != 0u)
+        {
+            atomicAdd(&result.bins[b], n);
+        }
+    }
+}
+)";
+
+uint32_t divideRoundingUp(uint32_t a, uint32_t b)
+{
+    return (a + b - 1) / b;
+}
+
+// same f32 arithmetic as the kernel, for the bins to match
+uint32_t histogramBin(float value, float low, float scale, uint32_t bins)
+{
+    return static_cast<uint32_t>(std::clamp((value - low) * scale, 0.0f, float(bins - 1)));
+}
+
+} // namespace
+
+float StatisticsSummary::percentile(double p) const
+{
+    if (count == 0 || histogram.empty())
+    {
+        return 0.0f;
+    }
+    double target = std::clamp(p, 0.0, 1.0) * count;
+    double width = double(high - low) / histogram.size();
+    double below = 0.0;
+    for (size_t b = 0; b < histogram.size(); ++b)
+    {
+        if (histogram[b] > 0 && below + histogram[b] >= target)
+        {
+            double value = low + (b + (target - below) / histogram[b]) * width;
+            return std::clamp(static_cast<float>(value), minimum, maximum);
+        }
+        below += histogram[b];
+    }
+    return maximum;
+}
+
+Statistics::Statistics(WGPUDevice device, WGPUQueue queue)
+    : m_device(device)
+    , m_queue(queue)
+{
+    WGPUSupportedLimits supported = {};
+    supported.nextInChain = nullptr;
+    wgpuDeviceGetLimits(device, &supported);
+    m_maxBins = supported.limits.maxComputeWorkgroupStorageSize / sizeof(uint32_t);
+}
+
+Statistics::~Statistics()
+{
+    release();
+}
+
+void Statistics::release()
+{
+    for (auto & entry : m_pipelines)
+    {
+        wgpuComputePipelineRelease(entry.second);
+    }
+    m_pipelines.clear();
+    for (auto & entry : m_modules)
+    {
+        wgpuShaderModuleRelease(entry.second);
+    }
+    m_modules.clear();
+    for (WGPUBuffer * buffer : { &m_partials, &m_result, &m_readback })
+    {
+        if (*buffer) wgpuBufferRelease(*buffer);
+        *buffer = nullptr;
+    }
+    m_partialsSize = m_resultSize = m_readbackSize = 0;
+    for (WGPUBuffer buffer : m_retired)
+    {
+        wgpuBufferRelease(buffer);
+    }
+    m_retired.clear();
+    m_recordedBins = 0;
+}
+
+WGPUComputePipeline Statistics::pipeline(bool texture, uint32_t bins, char const * entryPoint)
+{
+    WGPUComputePipeline & pipeline = m_pipelines[{ texture, bins, entryPoint }];
+    if (pipeline != nullptr)
+    {
+        return pipeline;
+    }
+    WGPUShaderModule & module = m_modules[{ texture, bins }];
+    if (module == nullptr)
+    {
+        // the bin count sizes a workgroup array, which overrides cannot do
+        std::string source = "const BINS = " + std::to_string(bins) + "u;\n";
+        source += std::string(paramsSource) + (texture ? textureInputSource : bufferInputSource) + statisticsSource;
+        module = createShaderModule(m_device, source.c_str(), "Statistics");
+    }
+    WGPUComputePipelineDescriptor pipelineDesc = {};
+    pipelineDesc.nextInChain = nullptr;
+    pipelineDesc.label = entryPoint;
+    pipelineDesc.layout = nullptr;
+    pipelineDesc.compute.module = module;
+    pipelineDesc.compute.entryPoint = entryPoint;
+    pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+    return pipeline;
+}
+
+WGPUBuffer Statistics::buffer(WGPUBuffer & buffer, uint64_t & capacity, uint64_t size, WGPUBufferUsageFlags usage, char const * label)
+{
+    if (capacity < size)
+    {
+        // a recorded pass may still use the old one
+        if (buffer) m_retired.push_back(buffer);
+        WGPUBufferDescriptor bufferDesc = {};
+        bufferDesc.nextInChain = nullptr;
+        bufferDesc.label = label;
+        bufferDesc.usage = usage;
+        bufferDesc.size = size;
+        bufferDesc.mappedAtCreation = false;
+        buffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+        capacity = size;
+    }
+    return buffer;
+}
+
+void Statistics::record(WGPUCommandEncoder encoder, WGPUBuffer values, uint32_t count, StatisticsOptions const & options)
+{
+    WGPUBindGroupEntry input = {};
+    input.nextInChain = nullptr;
+    input.binding = 0;
+    input.buffer = values;
+    input.offset = 0;
+    input.size = std::max<uint64_t>(uint64_t(count) * sizeof(float), 4);
+    Params params = {};
+    params.count = count;
+    params.width = 1;
+    params.low = options.low;
+    params.high = options.high;
+    params.fixedRange = options.low < options.high;
+    run(encoder, false, input, params, options.bins);
+}
+
+void Statistics::record(WGPUCommandEncoder encoder, WGPUTexture texture, uint32_t channel, StatisticsOptions const & options)
+{
+    if (channel > 3)
+    {
+        logError() << "Statistics: channel " << channel << " of a texture, channels are 0 to 3";
+        m_recordedBins = 0;
+        return;
+    }
+    WGPUTextureViewDescriptor viewDesc = {};
+    viewDesc.nextInChain = nullptr;
+    viewDesc.label = "Statistics input";
+    viewDesc.format = wgpuTextureGetFormat(texture);
+    viewDesc.dimension = WGPUTextureViewDimension_2D;
+    viewDesc.baseMipLevel = 0;
+    viewDesc.mipLevelCount = 1;
+    viewDesc.baseArrayLayer = 0;
+    viewDesc.arrayLayerCount = 1;
+    viewDesc.aspect = WGPUTextureAspect_All;
+    WGPUBindGroupEntry input = {};
+    input.nextInChain = nullptr;
+    input.binding = 0;
+    input.textureView = wgpuTextureCreateView(texture, &viewDesc);
+    Params params = {};
+    params.width = wgpuTextureGetWidth(texture);
+    params.count = params.width * wgpuTextureGetHeight(texture);
+    params.channel = channel;
+    params.low = options.low;
+    params.high = options.high;
+    params.fixedRange = options.low < options.high;
+    run(encoder, true, input, params, options.bins);
+    wgpuTextureViewRelease(input.textureView);
+}
+
+void Statistics::run(WGPUCommandEncoder encoder, bool texture, WGPUBindGroupEntry input, Params params, uint32_t bins)
+{
+    if (bins == 0 || bins > m_maxBins)
+    {
+        logError() << "Statistics: " << bins << " histogram bins, this device supports 1 to " << m_maxBins;
+        m_recordedBins = 0;
+        return;
+    }
+    params.groups = std::clamp(divideRoundingUp(params.count, workgroupSize * valuesPerInvocation), 1u, maxGroups);
+
+    uint64_t resultBytes = sizeof(Header) + uint64_t(bins) * sizeof(uint32_t);
+    WGPUBuffer partials = buffer(m_partials, m_partialsSize, maxGroups * 5 * sizeof(float), WGPUBufferUsage_Storage, "Statistics partials");
+    WGPUBuffer result = buffer(m_result, m_resultSize, resultBytes,
+        WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst, "Statistics result");
+    WGPUBuffer readback = buffer(m_readback, m_readbackSize, resultBytes, WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst, "Statistics readback");
+    wgpuCommandEncoderClearBuffer(encoder, result, 0, resultBytes);
+
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Statistics params";
+    bufferDesc.usage = WGPUBufferUsage_Uniform;
+    bufferDesc.size = sizeof(Params);
+    bufferDesc.mappedAtCreation = true;
+    WGPUBuffer paramBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    std::memcpy(wgpuBufferGetMappedRange(paramBuffer, 0, sizeof(Params)), &params, sizeof(Params));
+    wgpuBufferUnmap(paramBuffer);
+
+    WGPUBindGroupEntry entries[4] = {};
+    entries[0] = input;
+    WGPUBuffer buffers[] = { nullptr, partials, result, paramBuffer };
+    uint64_t sizes[] = { 0, m_partialsSize, resultBytes, sizeof(Params) };
+    for (uint32_t b = 1; b < 4; ++b)
+    {
+        entries[b].nextInChain = nullptr;
+        entries[b].binding = b;
+        entries[b].buffer = buffers[b];
+        entries[b].offset = 0;
+        entries[b].size = sizes[b];
+    }
+
+    // every kernel uses three of the four bindings
+    struct Step
+    {
+        WGPUComputePipeline pipeline;
+        uint32_t bindings[3];
+        uint32_t groups;
+    };
+    Step const steps[] = {
+        { pipeline(texture, bins, "moments"), { 0, 1, 3 }, params.groups },
+        { pipeline(texture, bins, "merge"), { 1, 2, 3 }, 1 },
+        { pipeline(texture, bins, "histogram"), { 0, 2, 3 }, params.groups },
+    };
+    std::vector<WGPUBindGroup> bindGroups;
+    for (Step const & step : steps)
+    {
+        WGPUBindGroupEntry used[3] = { entries[step.bindings[0]], entries[step.bindings[1]], entries[step.bindings[2]] };
+        WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(step.pipeline, 0);
+        WGPUBindGroupDescriptor bindGroupDesc = {};
+        bindGroupDesc.nextInChain = nullptr;
+        bindGroupDesc.label = "Statistics";
+        bindGroupDesc.layout = layout;
+        bindGroupDesc.entryCount = 3;
+        bindGroupDesc.entries = used;
+        bindGroups.push_back(wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc));
+        wgpuBindGroupLayoutRelease(layout);
+    }
+
+    // dispatches of a pass see the writes of the previous ones
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = "Statistics";
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    for (size_t i = 0; i < bindGroups.size(); ++i)
+    {
+        wgpuComputePassEncoderSetPipeline(pass, steps[i].pipeline);
+        wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroups[i], 0, nullptr);
+        wgpuComputePassEncoderDispatchWorkgroups(pass, steps[i].groups, 1, 1);
+    }
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, result, 0, readback, 0, resultBytes);
+    m_recordedBins = bins;
+
+    // the encoder keeps what the pass uses alive
+    for (WGPUBindGroup bindGroup : bindGroups)
+    {
+        wgpuBindGroupRelease(bindGroup);
+    }
+    wgpuBufferRelease(paramBuffer);
+    for (WGPUBuffer retired : m_retired)
+    {
+        wgpuBufferRelease(retired);
+    }
+    m_retired.clear();
+}
+
+StatisticsSummary Statistics::read()
+{
+    StatisticsSummary summary;
+    if (m_recordedBins == 0)
+    {
+        logError() << "Statistics: nothing recorded to read";
+        return summary;
+    }
+    uint64_t size = sizeof(Header) + uint64_t(m_recordedBins) * sizeof(uint32_t);
+    if (!mapBufferSync(m_device, m_readback, WGPUMapMode_Read, 0, size))
+    {
+        logError() << "Statistics: could not map the result";
+        return summary;
+    }
+    auto const * mapped = static_cast<uint8_t const *>(wgpuBufferGetConstMappedRange(m_readback, 0, size));
+    Header header;
+    std::memcpy(&header, mapped, sizeof(Header));
+    summary.histogram.resize(m_recordedBins);
+    std::memcpy(summary.histogram.data(), mapped + sizeof(Header), m_recordedBins * sizeof(uint32_t));
+    wgpuBufferUnmap(m_readback);
+
+    summary.count = header.count;
+    if (header.count > 0)
+    {
+        summary.minimum = header.minimum;
+        summary.maximum = header.maximum;
+        summary.mean = header.mean;
+        summary.variance = header.m2 / header.count;
+        summary.low = header.low;
+        summary.high = header.high;
+    }
+    return summary;
+}
+
+StatisticsSummary Statistics::submit(WGPUCommandEncoder encoder)
+{
+    WGPUCommandBufferDescriptor cmdBufferDesc = {};
+    cmdBufferDesc.nextInChain = nullptr;
+    cmdBufferDesc.label = nullptr;
+    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
+    wgpuQueueSubmit(m_queue, 1, &command);
+    wgpuCommandBufferRelease(command);
+    return read();
+}
+
+StatisticsSummary Statistics::compute(WGPUBuffer values, uint32_t count, StatisticsOptions const & options)
+{
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = "Statistics";
+    WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &encoderDesc);
+    record(encoder, values, count, options);
+    return submit(encoder);
+}
+
+StatisticsSummary Statistics::compute(WGPUTexture texture, uint32_t channel, StatisticsOptions const & options)
+{
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = "Statistics";
+    WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &encoderDesc);
+    record(encoder, texture, channel, options);
+    return submit(encoder);
+}
+
+StatisticsSummary cpuStatistics(std::vector<float> const & values, StatisticsOptions const & options)
+{
+    StatisticsSummary summary;
+    summary.count = static_cast<uint32_t>(values.size());
+    summary.histogram.assign(options.bins, 0);
+    if (values.empty() || options.bins == 0)
+    {
+        return summary;
+    }
+    auto range = std::minmax_element(values.begin(), values.end());
+    summary.minimum = *range.first;
+    summary.maximum = *range.second;
+    double sum = 0.0;
+    for (float value : values)
+    {
+        sum += value;
+    }
+    summary.mean = sum / values.size();
+    double squares = 0.0;
+    for (float value : values)
+    {
+        squares += (value - summary.mean) * (value - summary.mean);
+    }
+    summary.variance = squares / values.size();
+
+    bool fixedRange = options.low < options.high;
+    summary.low = fixedRange ? options.low : summary.minimum;
+    summary.high = fixedRange ? options.high : summary.maximum;
+    float scale = float(options.bins) / std::max(summary.high - summary.low, 1e-30f);
+    for (float value : values)
+    {
+        ++summary.histogram[histogramBin(value, summary.low, scale, options.bins)];
+    }
+    return summary;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * Histogram range and resolution of a statistics computation.
+ */
+struct StatisticsOptions
+{
+    uint32_t bins = 256;        // up to maxComputeWorkgroupStorageSize / 4
+    float low = 0.0f;           // values outside [low, high] count in the end bins;
+    float high = 0.0f;          // low >= high uses the minimum and maximum of the values
+};
+
+/**
+ * Summary statistics of a set of values.
+ */
+struct StatisticsSummary
+{
+    uint32_t count = 0;
+    float minimum = 0.0f;
+    float maximum = 0.0f;
+    double mean = 0.0;
+    double variance = 0.0;          // population variance
+    float low = 0.0f;               // range of the histogram
+    float high = 0.0f;
+    std::vector<uint32_t> histogram;
+
+    /**
+     * Value below which a fraction p (0 to 1) of the values fall,
+     * interpolated within its histogram bin: exact to a bin width.
+     */
+    float percentile(double p) const;
+};
+
+/**
+ * Count, minimum, maximum, mean, variance and histogram of f32 values on
+ * the GPU, from a storage buffer or one channel of a float or unorm
+ * texture, read back as a single transfer of a few hundred bytes instead of
+ * the whole data:
+ *     Statistics statistics(device, queue);
+ *     StatisticsSummary summary = statistics.compute(frame, 0);
+ *     float median = summary.percentile(0.5);
+ *
+ * Each workgroup runs Welford's algorithm over a strided slice of the
+ * values, merged pairwise in workgroup memory then across workgroups.
+ * Histograms are counted in workgroup-private bins with workgroup atomics,
+ * added to the global bins once per workgroup. Without a fixed range, the
+ * histogram spans [minimum, maximum], computed by the earlier dispatches of
+ * the same pass. Mean and variance are accumulated in f32. Kernels are
+ * compiled per bin count on first use.
+ */
+class Statistics
+{
+public:
+    Statistics(WGPUDevice device, WGPUQueue queue);
+    ~Statistics();
+
+    Statistics(Statistics const &) = delete;
+    Statistics & operator=(Statistics const &) = delete;
+
+    /**
+     * Record the computation over the `count` first values of a storage
+     * buffer, read back by read() once the encoder is submitted. A later
+     * record() replaces the one before.
+     */
+    void record(WGPUCommandEncoder encoder, WGPUBuffer values, uint32_t count, StatisticsOptions const & options = {});
+
+    /**
+     * Same over one channel (0 to 3) of the first mip level of a texture
+     * with the TextureBinding usage.
+     */
+    void record(WGPUCommandEncoder encoder, WGPUTexture texture, uint32_t channel, StatisticsOptions const & options = {});
+
+    /**
+     * Wait for the recorded computation and map its result.
+     */
+    StatisticsSummary read();
+
+    /**
+     * Record, submit and read in one call.
+     */
+    StatisticsSummary compute(WGPUBuffer values, uint32_t count, StatisticsOptions const & options = {});
+    StatisticsSummary compute(WGPUTexture texture, uint32_t channel, StatisticsOptions const & options = {});
+
+    size_t pipelineCount() const { return m_pipelines.size(); }
+
+    void release();
+
+private:
+    struct Params
+    {
+        uint32_t count;
+        uint32_t width;             // of the texture
+        uint32_t channel;
+        uint32_t groups;
+        float low;
+        float high;
+        uint32_t fixedRange;
+        uint32_t padding;
+    };
+
+    // layout of the front of the result buffer, the bins follow
+    struct Header
+    {
+        uint32_t count;
+        float minimum;
+        float maximum;
+        float mean;
+        float m2;                   // sum of squared differences to the mean
+        float low;
+        float high;
+        uint32_t padding;
+    };
+
+    void run(WGPUCommandEncoder encoder, bool texture, WGPUBindGroupEntry input, Params params, uint32_t bins);
+    WGPUComputePipeline pipeline(bool texture, uint32_t bins, char const * entryPoint);
+    WGPUBuffer buffer(WGPUBuffer & buffer, uint64_t & capacity, uint64_t size, WGPUBufferUsageFlags usage, char const * label);
+    StatisticsSummary submit(WGPUCommandEncoder encoder);
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    uint32_t m_maxBins;
+    std::map<std::pair<bool, uint32_t>, WGPUShaderModule> m_modules;     // by texture input and bin count
+    std::map<std::tuple<bool, uint32_t, std::string>, WGPUComputePipeline> m_pipelines;
+    WGPUBuffer m_partials = nullptr;
+    uint64_t m_partialsSize = 0;
+    WGPUBuffer m_result = nullptr;
+    uint64_t m_resultSize = 0;
+    WGPUBuffer m_readback = nullptr;
+    uint64_t m_readbackSize = 0;
+    uint32_t m_recordedBins = 0;            // 0 when nothing is recorded
+    std::vector<WGPUBuffer> m_retired;     // replaced buffers, released once recorded
+};
+
+/**
+ * Reference of the statistics in double precision, to verify the GPU
+ * results; histogram bins are computed as on the GPU.
+ */
+StatisticsSummary cpuStatistics(std::vector<float> const & values, StatisticsOptions const & options = {});
@@ -0,0 +1,349 @@
+#include "tensor.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <algorithm>
+
+namespace
+{
+
+constexpr uint32_t workgroupSize = 256;
+
+// uniform layout, in vec4u: output shape, element count, strides of each
+// input, then the scalars packed four by four
+constexpr uint32_t stridesSlot = 2;
+constexpr uint32_t scalarsSlot = stridesSlot + FusedExpression::maxInputs;
+constexpr uint32_t metaSlots = scalarsSlot + FusedExpression::maxScalars / 4;
+
+char const * const components[] = { "x", "y", "z", "w" };
+
+} // namespace
+
+FusedExpression::FusedExpression(char const * type, WGPUBuffer output, std::vector<uint32_t> const & shape)
+    : m_type(type)
+    , m_output(output)
+{
+    if (output == nullptr)
+    {
+        m_error = "the result of a tensor expression must be contiguous";
+    }
+    if (shape.size() > maxRank)
+    {
+        m_error = "tensors have at most " + std::to_string(maxRank) + " dimensions";
+        return;
+    }
+    // aligned on the last dimension, leading ones padded
+    std::copy(shape.begin(), shape.end(), m_shape + maxRank - shape.size());
+    for (uint32_t extent : m_shape)
+    {
+        m_count *= extent;
+    }
+}
+
+std::string FusedExpression::load(WGPUBuffer buffer, std::vector<uint32_t> const & shape, std::vector<uint32_t> const & strides)
+{
+    if (shape.size() > maxRank)
+    {
+        m_error = "tensors have at most " + std::to_string(maxRank) + " dimensions";
+        return "T(0)";
+    }
+
+    std::vector<uint32_t> effective(maxRank, 0);
+    size_t padding = maxRank - shape.size();
+    for (size_t d = 0; d < shape.size(); ++d)
+    {
+        uint32_t extent = m_shape[padding + d];
+        if (shape[d] == extent)
+        {
+            effective[padding + d] = extent == 1 ? 0 : strides[d];
+        }
+        else if (shape[d] != 1)
+        {
+            m_error = "operand shapes do not broadcast to the result shape";
+            return "T(0)";
+        }
+    }
+
+    // row-major operands are read at the output index, no coordinates needed
+    bool contiguous = true;
+    uint64_t stride = 1;
+    for (size_t d = maxRank; d-- > 0;)
+    {
+        if (m_shape[d] != 1 && effective[d] != stride) contiguous = false;
+        stride *= m_shape[d];
+    }
+
+    if (buffer == m_output)
+    {
+        if (!contiguous)
+        {
+            // other invocations would read elements already overwritten
+            m_error = "the result is also read in another layout, assign to a temporary first";
+        }
+        return "result[i]";
+    }
+
+    size_t input = 0;
+    while (input < m_inputs.size() && !(m_inputs[input] == buffer && m_strides[input] == effective))
+    {
+        ++input;
+    }
+    if (input == m_inputs.size())
+    {
+        if (m_inputs.size() == maxInputs)
+        {
+            m_error = "tensor expressions read at most " + std::to_string(maxInputs) + " tensors";
+            return "T(0)";
+        }
+        m_inputs.push_back(buffer);
+        m_strides.push_back(effective);
+    }
+    std::string name = "in" + std::to_string(input);
+    if (contiguous)
+    {
+        return name + "[i]";
+    }
+    m_needsCoordinates = true;
+    return name + "[at(" + std::to_string(stridesSlot + input) + "u, c)]";
+}
+
+std::string FusedExpression::scalar(uint32_t bits)
+{
+    if (m_scalars.size() == maxScalars)
+    {
+        m_error = "tensor expressions use at most " + std::to_string(maxScalars) + " scalars";
+        return "T(0)";
+    }
+    size_t index = m_scalars.size();
+    m_scalars.push_back(bits);
+    return "bitcast<T>(info[" + std::to_string(scalarsSlot + index / 4) + "]." + components[index % 4] + ")";
+}
+
+std::string FusedExpression::source(std::string const & body) const
+{
+    std::string source = "alias T = " + m_type + ";\n\n";
+    source += "@group(0) @binding(0) var<uniform> info: array<vec4u, " + std::to_string(metaSlots) + ">;\n";
+    source += "@group(0) @binding(1) var<storage, read_write> result: array<T>;\n";
+    for (size_t i = 0; i < m_inputs.size(); ++i)
+    {
+        source += "@group(0) @binding(" + std::to_string(i + 2) + ") var<storage, read> in" + std::to_string(i) + ": array<T>;\n";
+    }
+    if (m_needsCoordinates)
+    {
+        source += R"(
+fn at(slot: u32, c: vec4u) -> u32
+{
+    let s = info[slot];
+    return c.x * s.x + c.y * s.y + c.z * s.z + c.w * s.w;
+}
+)";
+    }
+    source += R"(
+@compute @workgroup_size()" + std::to_string(workgroupSize) + R"()
+fn main(@builtin(global_invocation_id) id: vec3u, @builtin(num_workgroups) groups: vec3u)
+{
+    let i = id.y * groups.x * )" + std::to_string(workgroupSize) + R"(u + id.x;
+    if (i >= info[1].x)
+    {
+        return;
+    }
+)";
+    if (m_needsCoordinates)
+    {
+        source += R"(    let shape = info[0];
+    var c: vec4u;
+    var r = i;
+    c.w = r % shape.w;
+    r /= shape.w;
+    c.z = r % shape.z;
+    r /= shape.z;
+    c.y = r % shape.y;
+    c.x = r / shape.y;
+)";
+    }
+    source += "    result[i] = " + body + ";\n}\n";
+    return source;
+}
+
+std::vector<uint32_t> FusedExpression::meta() const
+{
+    std::vector<uint32_t> meta(metaSlots * 4, 0);
+    std::copy(m_shape, m_shape + maxRank, meta.begin());
+    meta[4] = static_cast<uint32_t>(m_count);
+    for (size_t i = 0; i < m_strides.size(); ++i)
+    {
+        std::copy(m_strides[i].begin(), m_strides[i].end(), meta.begin() + (stridesSlot + i) * 4);
+    }
+    std::copy(m_scalars.begin(), m_scalars.end(), meta.begin() + scalarsSlot * 4);
+    return meta;
+}
+
+TensorContext::TensorContext(WGPUDevice device, WGPUQueue queue)
+    : m_device(device)
+    , m_queue(queue)
+{
+}
+
+TensorContext::~TensorContext()
+{
+    release();
+}
+
+void TensorContext::release()
+{
+    for (auto & entry : m_pipelines)
+    {
+        wgpuComputePipelineRelease(entry.second);
+    }
+    m_pipelines.clear();
+}
+
+WGPUBuffer TensorContext::createBuffer(uint64_t size)
+{
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Tensor";
+    bufferDesc.usage = WGPUBufferUsage_Storage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = std::max<uint64_t>((size + 3) & ~uint64_t(3), 16);
+    bufferDesc.mappedAtCreation = false;
+    return wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+}
+
+WGPUComputePipeline TensorContext::pipeline(std::string const & source)
+{
+    WGPUComputePipeline & pipeline = m_pipelines[source];
+    if (pipeline == nullptr)
+    {
+        WGPUShaderModule module = createShaderModule(m_device, source.c_str(), "Fused tensor kernel");
+        WGPUComputePipelineDescriptor pipelineDesc = {};
+        pipelineDesc.nextInChain = nullptr;
+        pipelineDesc.label = "Fused tensor kernel";
+        pipelineDesc.layout = nullptr;
+        pipelineDesc.compute.module = module;
+        pipelineDesc.compute.entryPoint = "main";
+        pipeline = wgpuDeviceCreateComputePipeline(m_device, &pipelineDesc);
+        wgpuShaderModuleRelease(module);
+    }
+    return pipeline;
+}
+
+bool TensorContext::evaluate(WGPUCommandEncoder encoder, FusedExpression const & expression, std::string const & body)
+{
+    if (!expression.error().empty())
+    {
+        logError() << "Tensor: " << expression.error();
+        return false;
+    }
+    if (expression.count() == 0)
+    {
+        return true;
+    }
+    if (expression.count() > 0xffffffffull)
+    {
+        logError() << "Tensor: more than 2^32 elements";
+        return false;
+    }
+
+    WGPUComputePipeline kernel = pipeline(expression.source(body));
+    if (kernel == nullptr)
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> meta = expression.meta();
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Tensor meta";
+    bufferDesc.usage = WGPUBufferUsage_Uniform;
+    bufferDesc.size = meta.size() * sizeof(uint32_t);
+    bufferDesc.mappedAtCreation = true;
+    WGPUBuffer metaBuffer = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+    std::memcpy(wgpuBufferGetMappedRange(metaBuffer, 0, bufferDesc.size), meta.data(), bufferDesc.size);
+    wgpuBufferUnmap(metaBuffer);
+
+    std::vector<WGPUBuffer> buffers = { metaBuffer, expression.output() };
+    buffers.insert(buffers.end(), expression.inputs().begin(), expression.inputs().end());
+    std::vector<WGPUBindGroupEntry> entries(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        entries[i] = {};
+        entries[i].nextInChain = nullptr;
+        entries[i].binding = static_cast<uint32_t>(i);
+        entries[i].buffer = buffers[i];
+        entries[i].offset = 0;
+        entries[i].size = WGPU_WHOLE_SIZE;
+    }
+    WGPUBindGroupLayout layout = wgpuComputePipelineGetBindGroupLayout(kernel, 0);
+    WGPUBindGroupDescriptor bindGroupDesc = {};
+    bindGroupDesc.nextInChain = nullptr;
+    bindGroupDesc.label = "Fused tensor kernel";
+    bindGroupDesc.layout = layout;
+    bindGroupDesc.entryCount = entries.size();
+    bindGroupDesc.entries = entries.data();
+    WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(m_device, &bindGroupDesc);
+    wgpuBindGroupLayoutRelease(layout);
+
+    uint32_t groups = static_cast<uint32_t>((expression.count() + workgroupSize - 1) / workgroupSize);
+    uint32_t x = std::min(groups, 65535u);
+    WGPUComputePassDescriptor passDesc = {};
+    passDesc.nextInChain = nullptr;
+    passDesc.label = "Fused tensor kernel";
+    passDesc.timestampWrites = nullptr;
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &passDesc);
+    wgpuComputePassEncoderSetPipeline(pass, kernel);
+    wgpuComputePassEncoderSetBindGroup(pass, 0, bindGroup, 0, nullptr);
+    wgpuComputePassEncoderDispatchWorkgroups(pass, x, (groups + x - 1) / x, 1);
+    wgpuComputePassEncoderEnd(pass);
+    wgpuComputePassEncoderRelease(pass);
+
+    // the encoder keeps what the pass uses alive
+    wgpuBindGroupRelease(bindGroup);
+    wgpuBufferRelease(metaBuffer);
+    return true;
+}
+
+bool TensorContext::submit(std::function<bool(WGPUCommandEncoder encoder)> const & record)
+{
+    WGPUCommandEncoderDescriptor encoderDesc = {};
+    encoderDesc.nextInChain = nullptr;
+    encoderDesc.label = "Tensor";
+    WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(m_device, &encoderDesc);
+    bool ok = record(encoder);
+    WGPUCommandBufferDescriptor cmdBufferDesc = {};
+    cmdBufferDesc.nextInChain = nullptr;
+    cmdBufferDesc.label = nullptr;
+    WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
+    if (ok)
+    {
+        wgpuQueueSubmit(m_queue, 1, &command);
+    }
+    wgpuCommandBufferRelease(command);
+    return ok;
+}
+
+std::vector<uint8_t> TensorContext::read(WGPUBuffer buffer, uint64_t size)
+{
+    uint64_t alignedSize = std::max<uint64_t>((size + 3) & ~uint64_t(3), 4);
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Tensor readback";
+    bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    bufferDesc.size = alignedSize;
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer readback = wgpuDeviceCreateBuffer(m_device, &bufferDesc);
+
+    submit([&](WGPUCommandEncoder encoder) {
+        wgpuCommandEncoderCopyBufferToBuffer(encoder, buffer, 0, readback, 0, alignedSize);
+        return true;
+    });
+
+    std::vector<uint8_t> bytes(size);
+    if (mapBufferSync(m_device, readback, WGPUMapMode_Read, 0, alignedSize))
+    {
+        std::memcpy(bytes.data(), wgpuBufferGetConstMappedRange(readback, 0, alignedSize), size);
+        wgpuBufferUnmap(readback);
+    }
+    wgpuBufferRelease(readback);
+    return bytes;
+}
@@ -0,0 +1,481 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Typed device tensors whose elementwise expressions run as one fused
+ * kernel each:
+ *     TensorContext context(device, queue);
+ *     Tensor<float> a(context, { 1024, 1024 }, values), b(...), c(...), d(context, { 1024, 1024 });
+ *     d = a * b + c;                       // one dispatch, no intermediate buffer
+ *     d.assign(encoder, exp(-a) * 0.5f);   // recorded into an existing encoder
+ *
+ * Expressions are C++ expression templates turned into WGSL when assigned.
+ * Kernels are cached by their source, so the same expression over other
+ * tensors of the same element type reuses its pipeline; scalars are read
+ * from a uniform buffer and do not take part in the signature.
+ *
+ * Operands broadcast like numpy: shapes are aligned on their last dimension
+ * and dimensions of size 1 repeat. Tensors have at most 4 dimensions, an
+ * expression reads at most 7 distinct tensors and 16 scalars. The result
+ * must be contiguous; it may also be an operand if it is read in the same
+ * layout, as in `a = a * 2.0f`.
+ */
+
+template <typename T>
+class Tensor;
+
+/**
+ * One fused kernel being generated: the bindings of the tensors an expression
+ * reads and the scalars it uses. Filled by the expression nodes.
+ */
+class FusedExpression
+{
+public:
+    static constexpr uint32_t maxRank = 4;
+    static constexpr uint32_t maxInputs = 7;
+    static constexpr uint32_t maxScalars = 16;
+
+    FusedExpression(char const * type, WGPUBuffer output, std::vector<uint32_t> const & shape);
+
+    /**
+     * WGSL expression reading the element of a tensor that matches the
+     * current output element.
+     */
+    std::string load(WGPUBuffer buffer, std::vector<uint32_t> const & shape, std::vector<uint32_t> const & strides);
+
+    /**
+     * WGSL expression of a scalar given by its 32-bit pattern.
+     */
+    std::string scalar(uint32_t bits);
+
+    /**
+     * Complete kernel computing `body` for every output element.
+     */
+    std::string source(std::string const & body) const;
+
+    std::string const & error() const { return m_error; }
+    WGPUBuffer output() const { return m_output; }
+    std::vector<WGPUBuffer> const & inputs() const { return m_inputs; }
+    uint64_t count() const { return m_count; }
+
+    /**
+     * Uniform contents: output shape, count, strides per input, scalars.
+     */
+    std::vector<uint32_t> meta() const;
+
+private:
+    std::string m_type;
+    WGPUBuffer m_output;
+    uint32_t m_shape[maxRank] = { 1, 1, 1, 1 };
+    uint64_t m_count = 1;
+    std::vector<WGPUBuffer> m_inputs;
+    std::vector<std::vector<uint32_t>> m_strides;   // maxRank per input, 0 where broadcast
+    std::vector<uint32_t> m_scalars;
+    bool m_needsCoordinates = false;
+    std::string m_error;
+};
+
+/**
+ * Device, queue and fused kernels shared by the tensors created from it,
+ * which must not outlive it.
+ */
+class TensorContext
+{
+public:
+    TensorContext(WGPUDevice device, WGPUQueue queue);
+    ~TensorContext();
+
+    TensorContext(TensorContext const &) = delete;
+    TensorContext & operator=(TensorContext const &) = delete;
+
+    WGPUDevice device() const { return m_device; }
+    WGPUQueue queue() const { return m_queue; }
+    size_t kernelCount() const { return m_pipelines.size(); }
+
+    WGPUBuffer createBuffer(uint64_t size);
+
+    /**
+     * Record one compute pass computing the expression into its output.
+     * Logs and returns false if the expression cannot be fused.
+     */
+    bool evaluate(WGPUCommandEncoder encoder, FusedExpression const & expression, std::string const & body);
+
+    /**
+     * Record with a new encoder and submit, without waiting.
+     */
+    bool submit(std::function<bool(WGPUCommandEncoder encoder)> const & record);
+
+    /**
+     * Synchronous readback of the first `size` bytes of a buffer.
+     */
+    std::vector<uint8_t> read(WGPUBuffer buffer, uint64_t size);
+
+    void release();
+
+private:
+    WGPUComputePipeline pipeline(std::string const & source);
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    std::map<std::string, WGPUComputePipeline> m_pipelines;    // by kernel source
+};
+
+/**
+ * Buffer shared by a tensor and its views, released with the last of them.
+ */
+struct TensorStorage
+{
+    explicit TensorStorage(WGPUBuffer buffer) : buffer(buffer) {}
+    ~TensorStorage() { if (buffer) wgpuBufferRelease(buffer); }
+
+    TensorStorage(TensorStorage const &) = delete;
+    TensorStorage & operator=(TensorStorage const &) = delete;
+
+    WGPUBuffer buffer;
+};
+
+template <typename T>
+struct TensorType;
+
+template <> struct TensorType<float> { static char const * name() { return "f32"; } };
+template <> struct TensorType<int32_t> { static char const * name() { return "i32"; } };
+template <> struct TensorType<uint32_t> { static char const * name() { return "u32"; } };
+
+/**
+ * Base of the expression nodes, E being the node type.
+ */
+template <typename E>
+struct TensorExpression
+{
+    E const & self() const { return static_cast<E const &>(*this); }
+};
+
+template <typename T>
+class TensorLeaf : public TensorExpression<TensorLeaf<T>>
+{
+public:
+    using Value = T;
+
+    explicit TensorLeaf(Tensor<T> const & tensor) : m_tensor(&tensor) {}
+
+    std::string emit(FusedExpression & expression) const
+    {
+        return expression.load(m_tensor->buffer(), m_tensor->shape(), m_tensor->strides());
+    }
+
+private:
+    Tensor<T> const * m_tensor;
+};
+
+template <typename T>
+class ScalarLeaf : public TensorExpression<ScalarLeaf<T>>
+{
+public:
+    using Value = T;
+
+    explicit ScalarLeaf(T value) : m_value(value) {}
+
+    std::string emit(FusedExpression & expression) const
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &m_value, sizeof(bits));
+        return expression.scalar(bits);
+    }
+
+private:
+    T m_value;
+};
+
+template <typename Op, typename A>
+class UnaryExpression : public TensorExpression<UnaryExpression<Op, A>>
+{
+public:
+    using Value = typename A::Value;
+
+    explicit UnaryExpression(A a) : m_a(std::move(a)) {}
+
+    std::string emit(FusedExpression & expression) const
+    {
+        return Op::apply(m_a.emit(expression));
+    }
+
+private:
+    A m_a;
+};
+
+template <typename Op, typename A, typename B>
+class BinaryExpression : public TensorExpression<BinaryExpression<Op, A, B>>
+{
+public:
+    using Value = typename A::Value;
+
+    BinaryExpression(A a, B b) : m_a(std::move(a)), m_b(std::move(b)) {}
+
+    std::string emit(FusedExpression & expression) const
+    {
+        std::string a = m_a.emit(expression);
+        return Op::apply(a, m_b.emit(expression));
+    }
+
+private:
+    A m_a;
+    B m_b;
+};
+
+/**
+ * A tensor of T, row-major unless it is a transposed view. Copies are views
+ * sharing the same buffer, elementwise copies go through assign().
+ */
+template <typename T>
+class Tensor
+{
+    static_assert(std::is_same<T, float>::value || std::is_same<T, int32_t>::value || std::is_same<T, uint32_t>::value,
+        "tensors hold f32, i32 or u32");
+
+public:
+    using Value = T;
+
+    Tensor() = default;
+
+    Tensor(TensorContext & context, std::vector<uint32_t> shape)
+        : m_context(&context)
+        , m_shape(std::move(shape))
+    {
+        m_strides.resize(m_shape.size());
+        uint64_t stride = 1;
+        for (size_t i = m_shape.size(); i-- > 0;)
+        {
+            m_strides[i] = static_cast<uint32_t>(stride);
+            stride *= m_shape[i];
+        }
+        m_storage = std::make_shared<TensorStorage>(context.createBuffer(stride * sizeof(T)));
+    }
+
+    Tensor(TensorContext & context, std::vector<uint32_t> shape, std::vector<T> const & values)
+        : Tensor(context, std::move(shape))
+    {
+        upload(values);
+    }
+
+    std::vector<uint32_t> const & shape() const { return m_shape; }
+    std::vector<uint32_t> const & strides() const { return m_strides; }
+    uint32_t rank() const { return static_cast<uint32_t>(m_shape.size()); }
+    WGPUBuffer buffer() const { return m_storage ? m_storage->buffer : nullptr; }
+
+    uint64_t size() const
+    {
+        uint64_t size = 1;
+        for (uint32_t extent : m_shape) size *= extent;
+        return size;
+    }
+
+    bool isContiguous() const
+    {
+        uint64_t stride = 1;
+        for (size_t i = m_shape.size(); i-- > 0;)
+        {
+            if (m_shape[i] != 1 && m_strides[i] != stride) return false;
+            stride *= m_shape[i];
+        }
+        return true;
+    }
+
+    /**
+     * View with two dimensions swapped, by default the last two.
+     */
+    Tensor transposed() const { return transposed(rank() - 2, rank() - 1); }
+
+    Tensor transposed(uint32_t first, uint32_t second) const
+    {
+        Tensor view = *this;
+        std::swap(view.m_shape[first], view.m_shape[second]);
+        std::swap(view.m_strides[first], view.m_strides[second]);
+        return view;
+    }
+
+    /**
+     * Contiguous tensors only, `values` holding size() elements.
+     */
+    void upload(std::vector<T> const & values)
+    {
+        wgpuQueueWriteBuffer(m_context->queue(), buffer(), 0, values.data(), size() * sizeof(T));
+    }
+
+    /**
+     * Elements in row-major order of the shape, views included. Waits for
+     * the submitted work.
+     */
+    std::vector<T> download() const
+    {
+        uint64_t extent = 1;
+        for (size_t i = 0; i < m_shape.size(); ++i)
+        {
+            extent += uint64_t(m_shape[i] - 1) * m_strides[i];
+        }
+        std::vector<uint8_t> bytes = m_context->read(buffer(), extent * sizeof(T));
+        T const * elements = reinterpret_cast<T const *>(bytes.data());
+
+        std::vector<T> values(size());
+        std::vector<uint32_t> coordinates(m_shape.size(), 0);
+        for (uint64_t i = 0; i < values.size(); ++i)
+        {
+            uint64_t offset = 0;
+            for (size_t d = 0; d < m_shape.size(); ++d)
+            {
+                offset += uint64_t(coordinates[d]) * m_strides[d];
+            }
+            values[i] = elements[offset];
+            for (size_t d = m_shape.size(); d-- > 0 && ++coordinates[d] == m_shape[d];)
+            {
+                coordinates[d] = 0;
+            }
+        }
+        return values;
+    }
+
+    /**
+     * Record the evaluation of an expression into this tensor, in one
+     * compute pass.
+     */
+    template <typename E>
+    bool assign(WGPUCommandEncoder encoder, TensorExpression<E> const & expression) const
+    {
+        static_assert(std::is_same<typename E::Value, T>::value, "expressions do not convert element types");
+        FusedExpression fused(TensorType<T>::name(), isContiguous() ? buffer() : nullptr, m_shape);
+        std::string body = expression.self().emit(fused);
+        return m_context->evaluate(encoder, fused, body);
+    }
+
+    bool assign(WGPUCommandEncoder encoder, Tensor const & source) const
+    {
+        return assign(encoder, TensorLeaf<T>(source));
+    }
+
+    /**
+     * Evaluate in a submission of its own.
+     */
+    template <typename E>
+    Tensor & operator=(TensorExpression<E> const & expression)
+    {
+        m_context->submit([&](WGPUCommandEncoder encoder) { return assign(encoder, expression); });
+        return *this;
+    }
+
+private:
+    TensorContext * m_context = nullptr;
+    std::shared_ptr<TensorStorage> m_storage;
+    std::vector<uint32_t> m_shape;
+    std::vector<uint32_t> m_strides;
+};
+
+/**
+ * Operand conversion: tensors become leaves, expressions stay as they are,
+ * arithmetic values become scalars of the element type of the other side.
+ */
+template <typename X, typename = void>
+struct TensorOperand
+{
+    static constexpr bool isTensor = false;
+    using Value = void;
+};
+
+template <typename T>
+struct TensorOperand<Tensor<T>>
+{
+    static constexpr bool isTensor = true;
+    using Value = T;
+    static TensorLeaf<T> make(Tensor<T> const & tensor) { return TensorLeaf<T>(tensor); }
+};
+
+template <typename E>
+struct TensorOperand<E, std::enable_if_t<std::is_base_of<TensorExpression<E>, E>::value>>
+{
+    static constexpr bool isTensor = true;
+    using Value = typename E::Value;
+    static E make(E const & expression) { return expression; }
+};
+
+template <typename T, typename X>
+auto makeTensorOperand(X const & x)
+{
+    if constexpr (TensorOperand<X>::isTensor)
+    {
+        static_assert(std::is_same<typename TensorOperand<X>::Value, T>::value, "operands of different element types");
+        return TensorOperand<X>::make(x);
+    }
+    else
+    {
+        return ScalarLeaf<T>(static_cast<T>(x));
+    }
+}
+
+template <typename A, typename B>
+struct TensorOperands
+{
+    static constexpr bool valid = (TensorOperand<A>::isTensor && (TensorOperand<B>::isTensor || std::is_arithmetic<B>::value))
+        || (TensorOperand<B>::isTensor && std::is_arithmetic<A>::value);
+    using Value = std::conditional_t<TensorOperand<A>::isTensor, typename TensorOperand<A>::Value, typename TensorOperand<B>::Value>;
+};
+
+template <typename Op, typename A, typename B>
+auto makeTensorBinary(A const & a, B const & b)
+{
+    using T = typename TensorOperands<A, B>::Value;
+    using Left = decltype(makeTensorOperand<T>(a));
+    using Right = decltype(makeTensorOperand<T>(b));
+    return BinaryExpression<Op, Left, Right>(makeTensorOperand<T>(a), makeTensorOperand<T>(b));
+}
+
+template <typename Op, typename A>
+auto makeTensorUnary(A const & a)
+{
+    using T = typename TensorOperand<A>::Value;
+    Op::template check<T>();
+    using Operand = decltype(makeTensorOperand<T>(a));
+    return UnaryExpression<Op, Operand>(makeTensorOperand<T>(a));
+}
+
+#define TENSOR_BINARY_OPERATOR(Name, function, open, separator, close) \
+    struct Name \
+    { \
+        static std::string apply(std::string const & a, std::string const & b) { return open + a + separator + b + close; } \
+    }; \
+    template <typename A, typename B, typename = std::enable_if_t<TensorOperands<A, B>::valid>> \
+    auto function(A const & a, B const & b) { return makeTensorBinary<Name>(a, b); }
+
+TENSOR_BINARY_OPERATOR(TensorAdd, operator+, "(", " + ", ")")
+TENSOR_BINARY_OPERATOR(TensorSubtract, operator-, "(", " - ", ")")
+TENSOR_BINARY_OPERATOR(TensorMultiply, operator*, "(", " * ", ")")
+TENSOR_BINARY_OPERATOR(TensorDivide, operator/, "(", " / ", ")")
+TENSOR_BINARY_OPERATOR(TensorMinimum, minimum, "min(", ", ", ")")
+TENSOR_BINARY_OPERATOR(TensorMaximum, maximum, "max(", ", ", ")")
+
+#undef TENSOR_BINARY_OPERATOR
+
+// float-only functions check their element type, WGSL would reject the kernel
+#define TENSOR_UNARY_FUNCTION(Name, function, open, requirement) \
+    struct Name \
+    { \
+        template <typename T> static void check() { static_assert(requirement, #function " does not apply to this element type"); } \
+        static std::string apply(std::string const & a) { return open + a + ")"; } \
+    }; \
+    template <typename A, typename = std::enable_if_t<TensorOperand<A>::isTensor>> \
+    auto function(A const & a) { return makeTensorUnary<Name>(a); }
+
+TENSOR_UNARY_FUNCTION(TensorNegate, operator-, "(-", std::is_signed<T>::value)
+TENSOR_UNARY_FUNCTION(TensorAbs, abs, "abs(", true)
+TENSOR_UNARY_FUNCTION(TensorSqrt, sqrt, "sqrt(", std::is_floating_point<T>::value)
+TENSOR_UNARY_FUNCTION(TensorExp, exp, "exp(", std::is_floating_point<T>::value)
+TENSOR_UNARY_FUNCTION(TensorLog, log, "log(", std::is_floating_point<T>::value)
+
+#undef TENSOR_UNARY_FUNCTION
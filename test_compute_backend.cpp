@@ -0,0 +1,114 @@
+#include "compute_backend.h"
+#include "utility.h"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Stream compaction of the compute backends with flags other than 0 and 1,
+ * which the ComputeBackend contract keeps like 1. The CPU backend is checked
+ * against the expected output, the GPU backend, when the host has an
+ * adapter, against the CPU backend. Returns non-zero on the first failure.
+ */
+
+namespace
+{
+
+int failures = 0;
+
+void check(bool ok, std::string const & what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// every element kept by a non-zero flag, from 1 to well above 1
+void testCompact(ComputeBackend & backend, ComputeBackend * oracle)
+{
+    for (uint32_t count : { 0u, 1u, 1000u, 100000u })
+    {
+        std::vector<uint32_t> input(count);
+        std::vector<uint32_t> flags(count);
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            input[i] = i * 7 + 3;
+            flags[i] = i % 3 == 0 ? 0 : i % 5 == 0 ? 0xffffffffu : 1 + i % 4;
+            if (flags[i] != 0) expected.push_back(input[i]);
+        }
+        std::string what = std::string(backend.name()) + " compact of " + std::to_string(count) + " elements";
+
+        std::vector<uint32_t> output(count);
+        uint32_t kept = backend.compact(input.data(), flags.data(), count, output.data());
+        output.resize(std::min(kept, count));
+        if (oracle)
+        {
+            std::vector<uint32_t> reference(count);
+            reference.resize(oracle->compact(input.data(), flags.data(), count, reference.data()));
+            check(kept == reference.size() && output == reference, what + " matches the CPU backend");
+        }
+        else
+        {
+            check(kept == expected.size() && output == expected, what + " keeps every non-zero flag");
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    CpuComputeBackend cpu;
+    testCompact(cpu, nullptr);
+
+    WGPUInstanceDescriptor desc = {};
+    desc.nextInChain = nullptr;
+    WGPUInstance instance = wgpuCreateInstance(&desc);
+    WGPUAdapter adapter = nullptr;
+    WGPUDevice device = nullptr;
+    if (instance)
+    {
+        WGPURequestAdapterOptions adapterOpts = {};
+        adapterOpts.nextInChain = nullptr;
+        adapter = requestAdapterSync(instance, &adapterOpts);
+    }
+    if (adapter)
+    {
+        WGPUDeviceDescriptor deviceDesc = {};
+        deviceDesc.nextInChain = nullptr;
+        deviceDesc.label = "Test device";
+        deviceDesc.defaultQueue.nextInChain = nullptr;
+        deviceDesc.defaultQueue.label = "Test queue";
+        device = requestDeviceSync(adapter, &deviceDesc);
+    }
+    if (device)
+    {
+        WGPUQueue queue = wgpuDeviceGetQueue(device);
+        {
+            GpuComputeBackend gpu(device, queue);
+            testCompact(gpu, &cpu);
+        }
+        wgpuQueueRelease(queue);
+        wgpuDeviceRelease(device);
+    }
+    else
+    {
+        std::cout << "No device, GPU backend not tested" << std::endl;
+    }
+    if (adapter) wgpuAdapterRelease(adapter);
+    if (instance) wgpuInstanceRelease(instance);
+
+    if (failures == 0)
+    {
+        std::cout << "All compute backend checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
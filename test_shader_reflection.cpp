@@ -0,0 +1,87 @@
+#include "shader_reflection.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * GLSL binding reflection, in particular that opaque uniforms are not
+ * taken for uniform blocks. Returns non-zero on the first failure.
+ */
+
+namespace
+{
+
+int failures = 0;
+
+void check(bool ok, char const * what)
+{
+    if (!ok)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+bool reflect(std::string const & source, std::vector<ShaderBindingInfo> & bindings, std::string & error)
+{
+    return reflectShaderBindings(source, ShaderLanguage::GLSL, WGPUShaderStage_Compute, bindings, error);
+}
+
+ShaderBindingKind kind(ShaderBindingInfo const & info)
+{
+    return static_cast<ShaderBindingKind>(info.layout.kind);
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<ShaderBindingInfo> bindings;
+    std::string error;
+
+    std::string const separate = R"(
+        #version 450
+        layout(local_size_x = 64) in;
+        layout(set = 0, binding = 0) uniform Params { float scale; } params;
+        layout(set = 0, binding = 1) uniform texture2D image;
+        layout(set = 0, binding = 2) uniform sampler linearSampler;
+        layout(set = 0, binding = 3) uniform samplerShadow shadowSampler;
+        layout(set = 0, binding = 4, rgba8) uniform writeonly image2D target;
+        void main() {}
+    )";
+    check(reflect(separate, bindings, error), "separate textures and samplers reflect");
+    check(bindings.size() == 5, "one binding per declaration");
+    if (bindings.size() == 5)
+    {
+        check(kind(bindings[0]) == ShaderBindingKind::UniformBuffer, "uniform block is a uniform buffer");
+        check(kind(bindings[1]) == ShaderBindingKind::Texture, "texture2D is a texture");
+        check(kind(bindings[2]) == ShaderBindingKind::Sampler, "sampler is a sampler");
+        check(kind(bindings[3]) == ShaderBindingKind::ComparisonSampler, "samplerShadow is a comparison sampler");
+        check(kind(bindings[4]) == ShaderBindingKind::StorageTexture, "image2D is a storage texture");
+    }
+
+    std::string const combined = R"(
+        #version 450
+        layout(local_size_x = 64) in;
+        layout(set = 0, binding = 0) uniform sampler2D tex;
+        void main() {}
+    )";
+    error.clear();
+    check(!reflect(combined, bindings, error), "sampler2D is rejected, not reflected as a uniform buffer");
+    check(error.find("sampler2D") != std::string::npos, "the error names the combined sampler type");
+
+    std::string const integer = R"(
+        #version 450
+        layout(local_size_x = 64) in;
+        layout(binding = 3) uniform usampler3D volume;
+        void main() {}
+    )";
+    check(!reflect(integer, bindings, error), "usampler3D is rejected");
+
+    if (failures == 0)
+    {
+        std::cout << "All shader reflection checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
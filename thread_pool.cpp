@@ -0,0 +1,154 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// worker identity of the current thread, -1 outside of any pool
+thread_local ThreadPool const * currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    unsigned workers = threadCount - 1;
+    for (unsigned i = 0; i <= workers; ++i)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < workers; ++i)
+    {
+        m_threads.emplace_back([this, i]() { workerLoop(static_cast<int>(i)); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread & thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+ThreadPool & ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::push(Task task)
+{
+    // a worker keeps what it spawns, others spread their tasks
+    size_t index = currentPool == this ? static_cast<size_t>(currentWorker)
+        : m_threads.empty() ? m_queues.size() - 1
+        : m_nextQueue++ % m_threads.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+    m_pending++;
+    {
+        // taken so that a worker checking m_pending cannot miss the notification
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::runOne(int self)
+{
+    Task task;
+    if (self >= 0)
+    {
+        Queue & own = *m_queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (size_t i = 1; !task && i <= m_queues.size(); ++i)
+    {
+        // oldest tasks first, usually the largest remaining ones
+        Queue & other = *m_queues[(self + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty())
+        {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+        }
+    }
+    if (!task)
+    {
+        return false;
+    }
+    m_pending--;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+    currentPool = this;
+    currentWorker = index;
+    while (true)
+    {
+        if (runOne(index))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this]() { return m_stop || m_pending > 0; });
+        if (m_stop && m_pending == 0)
+        {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, std::function<void(size_t begin, size_t end)> const & body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    // a few chunks per thread balance uneven chunks without much overhead
+    size_t maxChunks = size_t(concurrency()) * 4;
+    size_t chunkSize = std::max(std::max<size_t>(grain, 1), (count + maxChunks - 1) / maxChunks);
+    size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    std::atomic<size_t> remaining(chunkCount - 1);
+    for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+    {
+        push([&, chunk]() {
+            body(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize));
+            remaining--;
+        });
+    }
+    body(0, chunkSize);
+
+    int self = currentPool == this ? currentWorker : -1;
+    while (remaining > 0)
+    {
+        if (!runOne(self))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool for data-parallel CPU jobs. Every worker has
+ * its own task deque, taking new work from its back and stealing from the
+ * front of the others when empty, so that chunks spawned by a busy worker
+ * spread to idle ones:
+ *     ThreadPool & pool = ThreadPool::shared();
+ *     pool.parallelFor(count, 4096, [&](size_t begin, size_t end) { ... });
+ *
+ * The thread calling parallelFor runs chunks too until all are done, which
+ * makes nested parallelFor calls from inside a chunk safe.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * 0 threads means one per hardware thread, the caller included.
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool & operator=(ThreadPool const &) = delete;
+
+    /**
+     * Pool of the whole process, created on first use.
+     */
+    static ThreadPool & shared();
+
+    /**
+     * Threads running chunks, the caller of parallelFor included.
+     */
+    unsigned concurrency() const { return static_cast<unsigned>(m_threads.size()) + 1; }
+
+    /**
+     * Call body(begin, end) on disjoint ranges covering [0, count), each of
+     * at least `grain` items but the last, and return once all returned.
+     */
+    void parallelFor(size_t count, size_t grain, std::function<void(size_t begin, size_t end)> const & body);
+
+private:
+    using Task = std::function<void()>;
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool runOne(int self);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;   // one per worker, the last one for other threads
+    std::vector<std::thread> m_threads;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_pending { 0 };
+    std::atomic<unsigned> m_nextQueue { 0 };
+    bool m_stop = false;
+};
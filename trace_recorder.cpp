@@ -0,0 +1,434 @@
+#include "trace_recorder.h"
+#include "utility.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace
+{
+
+std::string jsonEscape(char const * text)
+{
+    std::string escaped;
+    for (char const * c = text; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\') escaped += '\\';
+        if (static_cast<unsigned char>(*c) < 0x20) continue;
+        escaped += *c;
+    }
+    return escaped;
+}
+
+// Minimal protobuf encoding, enough for the few Perfetto messages we write.
+class ProtoWriter
+{
+public:
+    void varint(uint32_t field, uint64_t value)
+    {
+        tag(field, 0);
+        raw(value);
+    }
+    void bytes(uint32_t field, std::string const & value)
+    {
+        tag(field, 2);
+        raw(value.size());
+        m_data += value;
+    }
+    void message(uint32_t field, ProtoWriter const & nested) { bytes(field, nested.m_data); }
+    std::string const & data() const { return m_data; }
+
+private:
+    void tag(uint32_t field, uint32_t wireType) { raw((uint64_t(field) << 3) | wireType); }
+    void raw(uint64_t value)
+    {
+        do
+        {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            m_data += static_cast<char>(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+
+    std::string m_data;
+};
+
+// field numbers from perfetto/trace/*.proto
+namespace perfetto
+{
+constexpr uint32_t TracePacket = 1;             // in Trace
+constexpr uint32_t Timestamp = 8;               // in TracePacket
+constexpr uint32_t TrustedPacketSequenceId = 10;
+constexpr uint32_t TrackEvent = 11;
+constexpr uint32_t TrackDescriptor = 60;
+constexpr uint32_t TrackUuid = 1;               // in TrackDescriptor
+constexpr uint32_t TrackName = 2;
+constexpr uint32_t TrackThread = 4;
+constexpr uint32_t ThreadPid = 1;               // in ThreadDescriptor
+constexpr uint32_t ThreadTid = 2;
+constexpr uint32_t ThreadName = 5;
+constexpr uint32_t EventType = 9;               // in TrackEvent
+constexpr uint32_t EventTrackUuid = 11;
+constexpr uint32_t EventCategories = 22;
+constexpr uint32_t EventName = 23;
+constexpr uint64_t SliceBegin = 1;              // TrackEvent.Type
+constexpr uint64_t SliceEnd = 2;
+constexpr uint64_t Instant = 3;
+constexpr uint32_t SequenceId = 1;
+constexpr uint32_t ProcessId = 1;
+} // namespace perfetto
+
+} // namespace
+
+TraceRecorder & TraceRecorder::instance()
+{
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+    : m_originNs(nowNs())
+{
+}
+
+uint64_t TraceRecorder::nowNs()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void TraceRecorder::setSamplePeriod(uint32_t period)
+{
+    m_samplePeriod.store(period, std::memory_order_relaxed);
+    m_active.store(period == 1, std::memory_order_relaxed);
+}
+
+void TraceRecorder::beginFrame()
+{
+    uint32_t period = m_samplePeriod.load(std::memory_order_relaxed);
+    m_active.store(period != 0 && m_frame % period == 0, std::memory_order_relaxed);
+    ++m_frame;
+}
+
+TraceRecorder::ThreadBuffer & TraceRecorder::threadBuffer()
+{
+    // registered once per thread, the only lock on the recording path
+    thread_local ThreadBuffer * buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_threadsMutex);
+        m_threads.push_back(std::make_unique<ThreadBuffer>());
+        buffer = m_threads.back().get();
+        buffer->id = static_cast<uint32_t>(m_threads.size());
+        buffer->name = "Thread " + std::to_string(buffer->id);
+        buffer->capture.store(m_capture.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    return *buffer;
+}
+
+void TraceRecorder::push(Event const & event)
+{
+    ThreadBuffer & buffer = threadBuffer();
+    uint64_t capture = m_capture.load(std::memory_order_relaxed);
+    if (buffer.capture.load(std::memory_order_relaxed) != capture)
+    {
+        // only the owning thread writes its buffer, snapshot() skips it
+        // until the capture published here matches
+        buffer.count.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.capture.store(capture, std::memory_order_release);
+    }
+    size_t count = buffer.count.load(std::memory_order_relaxed);
+    if (count == ThreadCapacity)
+    {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[count] = event;
+    // publishes the event to write(), which only reads below count
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void TraceRecorder::addCpuEvent(char const * name, char const * category, uint64_t beginNs, uint64_t endNs)
+{
+    if (active())
+    {
+        push({ name, category, beginNs, endNs, false });
+    }
+}
+
+void TraceRecorder::addInstant(char const * name, char const * category)
+{
+    if (active())
+    {
+        uint64_t now = nowNs();
+        push({ name, category, now, now, false });
+    }
+}
+
+void TraceRecorder::addGpuEvent(std::string const & name, uint64_t gpuBeginNs, uint64_t gpuEndNs, size_t frame)
+{
+    uint32_t period = m_samplePeriod.load(std::memory_order_relaxed);
+    if (period == 0 || frame % period != 0)
+    {
+        return;
+    }
+    char const * interned;
+    {
+        std::lock_guard<std::mutex> lock(m_gpuNamesMutex);
+        interned = m_gpuNames.insert(name).first->c_str();
+    }
+    push({ interned, "gpu", gpuBeginNs + m_gpuOffsetNs, gpuEndNs + m_gpuOffsetNs, true });
+}
+
+void TraceRecorder::setThreadName(char const * name)
+{
+    ThreadBuffer & buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    buffer.name = name;
+}
+
+void TraceRecorder::clear()
+{
+    m_capture.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t TraceRecorder::droppedEventCount() const
+{
+    uint64_t capture = m_capture.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    size_t dropped = 0;
+    for (auto const & thread : m_threads)
+    {
+        if (thread->capture.load(std::memory_order_acquire) == capture)
+        {
+            dropped += thread->dropped.load(std::memory_order_relaxed);
+        }
+    }
+    return dropped;
+}
+
+std::vector<TraceRecorder::Track> TraceRecorder::snapshot() const
+{
+    std::vector<Track> tracks(1);
+    tracks[0].uuid = 1;
+    tracks[0].name = "GPU";
+    tracks[0].tid = 0;
+
+    uint64_t capture = m_capture.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_threadsMutex);
+    for (auto const & thread : m_threads)
+    {
+        Track track;
+        track.uuid = 100 + thread->id;
+        track.name = thread->name;
+        track.tid = thread->id;
+        // a thread that has not recorded since clear() holds the last capture
+        bool current = thread->capture.load(std::memory_order_acquire) == capture;
+        size_t count = current ? thread->count.load(std::memory_order_acquire) : 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            Event const & event = thread->events[i];
+            (event.gpu ? tracks[0] : track).events.push_back(event);
+        }
+        tracks.push_back(std::move(track));
+    }
+
+    // parents first: by begin time, the longest first on ties
+    for (Track & track : tracks)
+    {
+        std::sort(track.events.begin(), track.events.end(), [](Event const & a, Event const & b) {
+            return a.beginNs != b.beginNs ? a.beginNs < b.beginNs : a.endNs > b.endNs;
+        });
+    }
+    return tracks;
+}
+
+bool TraceRecorder::write(std::string const & path) const
+{
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    return json ? writeChromeJson(path) : writePerfetto(path);
+}
+
+bool TraceRecorder::writeChromeJson(std::string const & path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() -> std::ofstream & {
+        file << (first ? "\n" : ",\n");
+        first = false;
+        return file;
+    };
+    for (Track const & track : snapshot())
+    {
+        separator() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << track.tid
+            << ",\"args\":{\"name\":\"" << jsonEscape(track.name.c_str()) << "\"}}";
+        for (Event const & event : track.events)
+        {
+            // microseconds since the recorder started
+            double ts = (static_cast<int64_t>(event.beginNs - m_originNs)) * 1e-3;
+            separator() << "{\"name\":\"" << jsonEscape(event.name) << "\",\"cat\":\"" << jsonEscape(event.category)
+                << "\",\"pid\":1,\"tid\":" << track.tid << ",\"ts\":" << std::fixed << ts;
+            if (event.endNs == event.beginNs)
+            {
+                file << ",\"ph\":\"i\",\"s\":\"t\"}";
+            }
+            else
+            {
+                file << ",\"ph\":\"X\",\"dur\":" << (event.endNs - event.beginNs) * 1e-3 << "}";
+            }
+            file << std::defaultfloat;
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+bool TraceRecorder::writePerfetto(std::string const & path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    ProtoWriter trace;
+    auto packet = [&](uint64_t timestamp, ProtoWriter const & content, uint32_t field) {
+        ProtoWriter p;
+        if (timestamp) p.varint(perfetto::Timestamp, timestamp);
+        p.varint(perfetto::TrustedPacketSequenceId, perfetto::SequenceId);
+        p.message(field, content);
+        trace.message(perfetto::TracePacket, p);
+    };
+    auto slice = [&](Track const & track, uint64_t type, Event const * event, uint64_t timestamp) {
+        ProtoWriter e;
+        e.varint(perfetto::EventType, type);
+        e.varint(perfetto::EventTrackUuid, track.uuid);
+        if (event)
+        {
+            e.bytes(perfetto::EventCategories, event->category);
+            e.bytes(perfetto::EventName, event->name);
+        }
+        packet(timestamp, e, perfetto::TrackEvent);
+    };
+
+    for (Track const & track : snapshot())
+    {
+        ProtoWriter descriptor;
+        descriptor.varint(perfetto::TrackUuid, track.uuid);
+        descriptor.bytes(perfetto::TrackName, track.name);
+        if (track.tid != 0)
+        {
+            ProtoWriter thread;
+            thread.varint(perfetto::ThreadPid, perfetto::ProcessId);
+            thread.varint(perfetto::ThreadTid, track.tid);
+            thread.bytes(perfetto::ThreadName, track.name);
+            descriptor.message(perfetto::TrackThread, thread);
+        }
+        packet(0, descriptor, perfetto::TrackDescriptor);
+
+        // complete events become begin/end pairs, properly nested per track
+        std::vector<uint64_t> openEnds;
+        for (Event const & event : track.events)
+        {
+            while (!openEnds.empty() && openEnds.back() <= event.beginNs)
+            {
+                slice(track, perfetto::SliceEnd, nullptr, openEnds.back());
+                openEnds.pop_back();
+            }
+            if (event.endNs == event.beginNs)
+            {
+                slice(track, perfetto::Instant, &event, event.beginNs);
+                continue;
+            }
+            slice(track, perfetto::SliceBegin, &event, event.beginNs);
+            // a child overlapping its parent end is clipped to it
+            openEnds.push_back(openEnds.empty() ? event.endNs : std::min(event.endNs, openEnds.back()));
+        }
+        while (!openEnds.empty())
+        {
+            slice(track, perfetto::SliceEnd, nullptr, openEnds.back());
+            openEnds.pop_back();
+        }
+    }
+
+    file.write(trace.data().data(), trace.data().size());
+    return static_cast<bool>(file);
+}
+
+bool calibrateGpuClock(
+    WGPUDevice device,
+    WGPUQueue queue,
+    int64_t & offsetNs,
+    int64_t & uncertaintyNs,
+    int samples)
+{
+    if (!wgpuDeviceHasFeature(device, WGPUFeatureName_TimestampQuery))
+    {
+        return false;
+    }
+
+    WGPUQuerySetDescriptor querySetDesc = {};
+    querySetDesc.nextInChain = nullptr;
+    querySetDesc.label = "Clock calibration query";
+    querySetDesc.type = WGPUQueryType_Timestamp;
+    querySetDesc.count = 1;
+    WGPUQuerySet querySet = wgpuDeviceCreateQuerySet(device, &querySetDesc);
+
+    WGPUBufferDescriptor bufferDesc = {};
+    bufferDesc.nextInChain = nullptr;
+    bufferDesc.label = "Clock calibration resolve";
+    bufferDesc.usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc;
+    bufferDesc.size = sizeof(uint64_t);
+    bufferDesc.mappedAtCreation = false;
+    WGPUBuffer resolveBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    bufferDesc.label = "Clock calibration readback";
+    bufferDesc.usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst;
+    WGPUBuffer readbackBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+
+    bool calibrated = false;
+    for (int i = 0; i < samples; ++i)
+    {
+        WGPUCommandEncoderDescriptor encoderDesc = {};
+        encoderDesc.nextInChain = nullptr;
+        encoderDesc.label = "Clock calibration";
+        WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, &encoderDesc);
+        wgpuCommandEncoderWriteTimestamp(encoder, querySet, 0);
+        wgpuCommandEncoderResolveQuerySet(encoder, querySet, 0, 1, resolveBuffer, 0);
+        wgpuCommandEncoderCopyBufferToBuffer(encoder, resolveBuffer, 0, readbackBuffer, 0, sizeof(uint64_t));
+        WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, nullptr);
+        wgpuCommandEncoderRelease(encoder);
+
+        uint64_t before = TraceRecorder::nowNs();
+        wgpuQueueSubmit(queue, 1, &command);
+        waitForSubmittedWork(device, queue);
+        uint64_t after = TraceRecorder::nowNs();
+        wgpuCommandBufferRelease(command);
+
+        if (!mapBufferSync(device, readbackBuffer, WGPUMapMode_Read, 0, sizeof(uint64_t)))
+        {
+            continue;
+        }
+        uint64_t gpu = *static_cast<uint64_t const *>(wgpuBufferGetConstMappedRange(readbackBuffer, 0, sizeof(uint64_t)));
+        wgpuBufferUnmap(readbackBuffer);
+
+        int64_t halfWindow = static_cast<int64_t>(after - before) / 2;
+        if (!calibrated || halfWindow < uncertaintyNs)
+        {
+            offsetNs = static_cast<int64_t>(before + halfWindow) - static_cast<int64_t>(gpu);
+            uncertaintyNs = halfWindow;
+            calibrated = true;
+        }
+    }
+
+    wgpuBufferRelease(readbackBuffer);
+    wgpuBufferRelease(resolveBuffer);
+    wgpuQuerySetRelease(querySet);
+    return calibrated;
+}
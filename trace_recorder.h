@@ -0,0 +1,168 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * Process-wide timeline of CPU scopes and GPU timestamps, exported as a
+ * Chrome JSON trace (chrome://tracing, ui.perfetto.dev) or as a Perfetto
+ * protobuf trace.
+ *
+ * Each thread records into its own fixed-size buffer: recording an event
+ * is a few stores and one release store, no lock, so tracing can stay on in
+ * production. With a sample period of N only one frame out of N records
+ * anything; events past the buffer capacity are dropped and counted until
+ * clear() starts a new capture in the same buffers.
+ *
+ * GPU events come in GPU clock nanoseconds and are moved onto the CPU
+ * timeline by the offset measured by calibrateGpuClock().
+ */
+class TraceRecorder
+{
+public:
+    static TraceRecorder & instance();
+
+    /**
+     * Decide whether the frame starting is recorded; the first frame of
+     * each period is. A period of 0 disables tracing.
+     */
+    void beginFrame();
+    void setSamplePeriod(uint32_t period);
+    bool active() const { return m_active.load(std::memory_order_relaxed); }
+
+    /**
+     * Names and categories must outlive the recorder, e.g. literals.
+     */
+    void addCpuEvent(char const * name, char const * category, uint64_t beginNs, uint64_t endNs);
+    void addInstant(char const * name, char const * category);
+
+    /**
+     * GPU scope, in GPU timestamps; the name is copied. GPU results come
+     * back frames later, hence the frame index (counting beginFrame() calls
+     * from 0) to tell whether their frame was sampled.
+     */
+    void addGpuEvent(std::string const & name, uint64_t gpuBeginNs, uint64_t gpuEndNs, size_t frame);
+
+    void setGpuClockOffset(int64_t offsetNs) { m_gpuOffsetNs = offsetNs; }
+    void setThreadName(char const * name);
+
+    /**
+     * Export what was recorded so far; the format follows the extension,
+     * .json for Chrome JSON and anything else for Perfetto protobuf.
+     * Safe while other threads keep recording.
+     */
+    bool write(std::string const & path) const;
+    bool writeChromeJson(std::string const & path) const;
+    bool writePerfetto(std::string const & path) const;
+
+    /**
+     * Start a new capture, e.g. once the last one is written: each thread
+     * empties its buffer when it next records. Not concurrent with write().
+     */
+    void clear();
+
+    /**
+     * Events of the current capture that did not fit a thread buffer.
+     */
+    size_t droppedEventCount() const;
+
+    static uint64_t nowNs();
+
+private:
+    struct Event
+    {
+        char const * name;
+        char const * category;
+        uint64_t beginNs;
+        uint64_t endNs;     // equal to beginNs for instants
+        bool gpu;           // already moved to the CPU timeline
+    };
+
+    static constexpr size_t ThreadCapacity = 1 << 16;
+
+    struct ThreadBuffer
+    {
+        uint32_t id = 0;
+        std::string name;
+        std::unique_ptr<Event[]> events{ new Event[ThreadCapacity] };
+        std::atomic<size_t> count{ 0 };
+        std::atomic<size_t> dropped{ 0 };
+        std::atomic<uint64_t> capture{ 0 };     // that count and dropped belong to
+    };
+
+    struct Track
+    {
+        uint64_t uuid;
+        std::string name;
+        uint32_t tid;       // 0 for the GPU track
+        std::vector<Event> events;
+    };
+
+    TraceRecorder();
+    ThreadBuffer & threadBuffer();
+    void push(Event const & event);
+    std::vector<Track> snapshot() const;
+
+    std::atomic<bool> m_active{ true };
+    std::atomic<uint32_t> m_samplePeriod{ 1 };
+    std::atomic<uint64_t> m_capture{ 0 };
+    size_t m_frame = 0;
+    int64_t m_gpuOffsetNs = 0;
+    uint64_t m_originNs;
+
+    mutable std::mutex m_threadsMutex;      // registration and export only
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+    // GPU scope names are interned, set nodes never move
+    std::mutex m_gpuNamesMutex;
+    std::set<std::string> m_gpuNames;
+};
+
+/**
+ * Records a CPU event covering its lifetime, if the frame is sampled.
+ */
+class TraceScope
+{
+public:
+    TraceScope(char const * name, char const * category = "cpu")
+        : m_name(name)
+        , m_category(category)
+        , m_beginNs(TraceRecorder::instance().active() ? TraceRecorder::nowNs() : 0)
+    {
+    }
+    ~TraceScope()
+    {
+        if (m_beginNs != 0)
+        {
+            TraceRecorder::instance().addCpuEvent(m_name, m_category, m_beginNs, TraceRecorder::nowNs());
+        }
+    }
+
+    TraceScope(TraceScope const &) = delete;
+    TraceScope & operator=(TraceScope const &) = delete;
+
+private:
+    char const * m_name;
+    char const * m_category;
+    uint64_t m_beginNs;
+};
+
+/**
+ * Measure the offset to add to GPU timestamps to get TraceRecorder::nowNs()
+ * time: a timestamp is written by a tiny submission, which must have run
+ * between the CPU times of its submit and of its completion. The tightest
+ * of a few such windows is kept, its half-width is the uncertainty.
+ * Returns false without the TimestampQuery feature.
+ */
+bool calibrateGpuClock(
+    WGPUDevice device,
+    WGPUQueue queue,
+    int64_t & offsetNs,
+    int64_t & uncertaintyNs,
+    int samples = 8);
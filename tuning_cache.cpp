@@ -0,0 +1,97 @@
+#include "tuning_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif // _WIN32
+
+namespace
+{
+
+// tabs and newlines would break the line format
+std::string sanitize(char const * text)
+{
+    std::string result = text ? text : "";
+    for (char & c : result)
+    {
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+    }
+    return result;
+}
+
+} // namespace
+
+TuningCache::TuningCache(std::string const & path, WGPUAdapter adapter)
+    : m_path(path)
+    , m_adapterKey(adapterKey(adapter))
+{
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t first = line.find('\t');
+        size_t second = first == std::string::npos ? first : line.find('\t', first + 1);
+        if (second == std::string::npos)
+        {
+            continue;
+        }
+        m_entries[{ line.substr(0, first), line.substr(first + 1, second - first - 1) }] = line.substr(second + 1);
+    }
+}
+
+std::string TuningCache::adapterKey(WGPUAdapter adapter)
+{
+    WGPUAdapterProperties properties = {};
+    properties.nextInChain = nullptr;
+    wgpuAdapterGetProperties(adapter, &properties);
+    std::ostringstream key;
+    key << std::hex << properties.vendorID << ":" << properties.deviceID << std::dec
+        << ":" << properties.backendType << ":" << sanitize(properties.driverDescription);
+    return key.str();
+}
+
+bool TuningCache::find(std::string const & key, std::string & value) const
+{
+    auto found = m_entries.find({ m_adapterKey, key });
+    if (found == m_entries.end())
+    {
+        return false;
+    }
+    value = found->second;
+    return true;
+}
+
+bool TuningCache::store(std::string const & key, std::string const & value)
+{
+    m_entries[{ m_adapterKey, sanitize(key.c_str()) }] = sanitize(value.c_str());
+    return save();
+}
+
+bool TuningCache::save() const
+{
+    // written aside then renamed, so that an interrupted run keeps the old file
+    std::string temporary = m_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        for (auto const & entry : m_entries)
+        {
+            file << entry.first.first << '\t' << entry.first.second << '\t' << entry.second << '\n';
+        }
+        // closed first, so that a failed flush of the buffered lines is seen
+        file.close();
+        if (!file)
+        {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename fails there when the target exists
+    return MoveFileExA(temporary.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else // _WIN32
+    return std::rename(temporary.c_str(), m_path.c_str()) == 0;
+#endif // _WIN32
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <map>
+#include <string>
+
+/**
+ * Persisted autotuning results, one text line per entry:
+ *     <adapter key>\t<kernel key>\t<value>
+ * Results of one adapter are never used on another: the adapter key holds
+ * the vendor and device ids, the backend and the driver description, so
+ * that a driver update tunes again.
+ *     TuningCache cache("tuning.cache", adapter);
+ *     std::string best;
+ *     if (!cache.find("gemm/f32/1024x1024x1024", best)) { ...; cache.store(key, best); }
+ */
+class TuningCache
+{
+public:
+    TuningCache(std::string const & path, WGPUAdapter adapter);
+
+    static std::string adapterKey(WGPUAdapter adapter);
+
+    std::string const & adapterKey() const { return m_adapterKey; }
+
+    bool find(std::string const & key, std::string & value) const;
+
+    /**
+     * Record a result and write the file, entries of other adapters kept.
+     * Returns false if the file could not be written.
+     */
+    bool store(std::string const & key, std::string const & value);
+
+    size_t size() const { return m_entries.size(); }
+
+private:
+    bool save() const;
+
+    std::string m_path;
+    std::string m_adapterKey;
+    std::map<std::pair<std::string, std::string>, std::string> m_entries;  // (adapter, kernel) -> value
+};
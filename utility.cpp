@@ -1,6 +1,10 @@
 #include "utility.h"
+#include "logger.h"
+
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif // WEBGPU_BACKEND_WGPU
 
-#include <iostream>
 #include <cassert>
 #include <vector>
 
@@ -38,7 +42,7 @@ WGPUAdapter requestAdapterSync(
         }
         else
         {
-            std::cout << "Could not get WebGPU adapter: " << message << std::endl;
+            logError() << "Could not get WebGPU adapter: " << message;
         }
         userData.requestEnded = true;
     };
@@ -91,7 +95,7 @@ WGPUDevice requestDeviceSync(
         }
         else
         {
-            std::cout << "Could not get WebGPU device: " << message << std::endl;
+            logError() << "Could not get WebGPU device: " << message;
         }
         userData.requestEnded = true;
     };
@@ -121,13 +125,13 @@ void inspectDevice(WGPUDevice device)
     features.resize(featureCount);
     wgpuDeviceEnumerateFeatures(device, features.data());
 
-    std::cout << "Device features:" << std::endl;
-    std::cout << std::hex;
+    LogLine featureLog(LogLevel::Info);
+    featureLog << "Device features:";
+    featureLog.stream() << std::hex;
     for (auto f : features)
     {
-        std::cout << " - 0x" << f << std::endl;
+        featureLog << "\n - 0x" << f;
     }
-    std::cout << std::dec;
 
     WGPUSupportedLimits limits = {};
     limits.nextInChain = nullptr;
@@ -140,10 +144,115 @@ void inspectDevice(WGPUDevice device)
 
     if (success)
     {
-        std::cout << "Device limits:" << std::endl;
-        std::cout << " - maxTextureDimension1D: " << limits.limits.maxTextureDimension1D << std::endl;
-        std::cout << " - maxTextureDimension2D: " << limits.limits.maxTextureDimension2D << std::endl;
-        std::cout << " - maxTextureDimension3D: " << limits.limits.maxTextureDimension3D << std::endl;
-        std::cout << " - maxTextureArrayLayers: " << limits.limits.maxTextureArrayLayers << std::endl;
+        logInfo() << "Device limits:"
+            << "\n - maxTextureDimension1D: " << limits.limits.maxTextureDimension1D
+            << "\n - maxTextureDimension2D: " << limits.limits.maxTextureDimension2D
+            << "\n - maxTextureDimension3D: " << limits.limits.maxTextureDimension3D
+            << "\n - maxTextureArrayLayers: " << limits.limits.maxTextureArrayLayers;
     }
-}
\ No newline at end of file
+}
+
+void pollDevice(WGPUDevice device, bool wait)
+{
+#if defined(WEBGPU_BACKEND_DAWN)
+    (void)wait;
+    wgpuDeviceTick(device);
+#elif defined(WEBGPU_BACKEND_WGPU)
+    wgpuDevicePoll(device, wait, nullptr);
+#elif defined(WEBGPU_BACKEND_EMSCRIPTEN)
+    (void)device;
+    emscripten_sleep(wait ? 10 : 0);
+#endif
+}
+
+void waitForSubmittedWork(WGPUDevice device, WGPUQueue queue)
+{
+    bool done = false;
+    auto onQueueWorkDone = [](WGPUQueueWorkDoneStatus /* status */, void* pUserData)
+    {
+        *reinterpret_cast<bool*>(pUserData) = true;
+    };
+    wgpuQueueOnSubmittedWorkDone(queue, onQueueWorkDone, (void*)&done);
+    while (!done)
+    {
+        pollDevice(device, true);
+    }
+}
+
+bool mapBufferSync(
+    WGPUDevice device,
+    WGPUBuffer buffer,
+    WGPUMapModeFlags mode,
+    size_t offset,
+    size_t size)
+{
+    struct UserData
+    {
+        WGPUBufferMapAsyncStatus status = WGPUBufferMapAsyncStatus_Unknown;
+        bool requestEnded = false;
+    };
+    UserData userData;
+
+    auto onBufferMapped = [](WGPUBufferMapAsyncStatus status, void* pUserData)
+    {
+        UserData& userData = *reinterpret_cast<UserData*>(pUserData);
+        userData.status = status;
+        userData.requestEnded = true;
+    };
+    wgpuBufferMapAsync(buffer, mode, offset, size, onBufferMapped, (void*)&userData);
+
+    while (!userData.requestEnded)
+    {
+        pollDevice(device, true);
+    }
+
+    if (userData.status != WGPUBufferMapAsyncStatus_Success)
+    {
+        logError() << "Could not map buffer: status " << userData.status;
+        return false;
+    }
+    return true;
+}
+
+WGPUShaderModule createShaderModule(
+    WGPUDevice device,
+    char const * wgslCode,
+    char const * label)
+{
+    WGPUShaderModuleWGSLDescriptor wgslDesc = {};
+    wgslDesc.chain.next = nullptr;
+    wgslDesc.chain.sType = WGPUSType_ShaderModuleWGSLDescriptor;
+    wgslDesc.code = wgslCode;
+
+    WGPUShaderModuleDescriptor moduleDesc = {};
+    moduleDesc.nextInChain = &wgslDesc.chain;
+    moduleDesc.label = label;
+    moduleDesc.hintCount = 0;
+    moduleDesc.hints = nullptr;
+    return wgpuDeviceCreateShaderModule(device, &moduleDesc);
+}
+
+#ifdef WEBGPU_BACKEND_WGPU
+WGPUShaderModule createGLSLShaderModule(
+    WGPUDevice device,
+    WGPUShaderStage stage,
+    char const * glslCode,
+    char const * label,
+    uint32_t defineCount,
+    WGPUShaderDefine const * defines)
+{
+    WGPUShaderModuleGLSLDescriptor glslDesc = {};
+    glslDesc.chain.next = nullptr;
+    glslDesc.chain.sType = static_cast<WGPUSType>(WGPUSType_ShaderModuleGLSLDescriptor);
+    glslDesc.stage = stage;
+    glslDesc.code = glslCode;
+    glslDesc.defineCount = defineCount;
+    // not written by wgpu-native, the descriptor just lacks the const
+    glslDesc.defines = const_cast<WGPUShaderDefine *>(defines);
+
+    WGPUShaderModuleDescriptor moduleDesc = {};
+    moduleDesc.nextInChain = &glslDesc.chain;
+    moduleDesc.label = label;
+    return wgpuDeviceCreateShaderModule(device, &moduleDesc);
+}
+#endif // WEBGPU_BACKEND_WGPU
\ No newline at end of file
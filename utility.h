@@ -1,5 +1,9 @@
 #include <webgpu/webgpu.h>
 
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif // WEBGPU_BACKEND_WGPU
+
 /**
  * Utility function to get a WebGPU adapter, so that
  *     WGPUAdapter adapter = requestAdapterSync(options);
@@ -21,4 +25,53 @@ WGPUDevice requestDeviceSync(
     WGPUAdapter adapter,
     WGPUDeviceDescriptor const * descriptor);
 
-void inspectDevice(WGPUDevice device);
\ No newline at end of file
+void inspectDevice(WGPUDevice device);
+
+/**
+ * Let the device process its callbacks. With wait set, wgpu-native also
+ * blocks until the submitted work is done; other backends just tick.
+ */
+void pollDevice(WGPUDevice device, bool wait);
+
+/**
+ * Block until all the work submitted to the queue so far is done.
+ */
+void waitForSubmittedWork(WGPUDevice device, WGPUQueue queue);
+
+/**
+ * Utility function to map a buffer synchronously, so that
+ *     bool ok = mapBufferSync(device, buffer, WGPUMapMode_Read, 0, size);
+ * is roughly equivalent to
+ *     await buffer.mapAsync(GPUMapMode.READ, 0, size);
+ * The caller unmaps the buffer once done with its content.
+ */
+bool mapBufferSync(
+    WGPUDevice device,
+    WGPUBuffer buffer,
+    WGPUMapModeFlags mode,
+    size_t offset,
+    size_t size);
+
+/**
+ * Utility function to create a shader module from WGSL source, which
+ * only needs to stay alive for the duration of the call.
+ */
+WGPUShaderModule createShaderModule(
+    WGPUDevice device,
+    char const * wgslCode,
+    char const * label);
+
+#ifdef WEBGPU_BACKEND_WGPU
+/**
+ * Same as createShaderModule, for GLSL source translated by wgpu-native.
+ * GLSL modules contain a single entry point named "main" for the given stage.
+ * Defines are seen by the GLSL preprocessor as if #define'd in the source.
+ */
+WGPUShaderModule createGLSLShaderModule(
+    WGPUDevice device,
+    WGPUShaderStage stage,
+    char const * glslCode,
+    char const * label,
+    uint32_t defineCount = 0,
+    WGPUShaderDefine const * defines = nullptr);
+#endif // WEBGPU_BACKEND_WGPU
\ No newline at end of file